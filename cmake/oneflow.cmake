@@ -139,6 +139,9 @@ foreach(oneflow_single_file ${oneflow_all_src})
   if("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*\\.cpp$")
     if("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/core/transport/transport_test_main\\.cpp$")
       list(APPEND of_transport_test_cc ${oneflow_single_file})
+    elseif("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*_benchmark_main\\.cpp$")
+      # benchmark file
+      list(APPEND of_benchmark_cc ${oneflow_single_file})
     elseif("${oneflow_single_file}" MATCHES "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|xrt)/.*_test\\.cpp$")
       # test file
       list(APPEND of_all_test_cc ${oneflow_single_file})
@@ -237,7 +240,7 @@ add_dependencies(of_pyext_obj of_ccobj)
 if(APPLE)
   set(of_libs -Wl,-force_load of_ccobj of_protoobj of_cfgobj)
 elseif(UNIX)
-  set(of_libs -Wl,--whole-archive of_ccobj of_protoobj of_cfgobj -Wl,--no-whole-archive -ldl)
+  set(of_libs -Wl,--whole-archive of_ccobj of_protoobj of_cfgobj -Wl,--no-whole-archive -ldl -lrt)
 elseif(WIN32)
   set(of_libs of_ccobj of_protoobj of_cfgobj)
   set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} /WHOLEARCHIVE:of_ccobj")
@@ -329,6 +332,34 @@ foreach(cc ${of_transport_test_cc})
   set_target_properties(${transport_test_exe_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin")
 endforeach()
 
+# build benchmark
+if(BUILD_TESTING)
+  foreach(cc ${of_benchmark_cc})
+    get_filename_component(benchmark_name ${cc} NAME_WE)
+    string(REGEX REPLACE "_main$" "" benchmark_exe_name ${benchmark_name})
+    oneflow_add_executable(${benchmark_exe_name} ${cc})
+    target_link_libraries(${benchmark_exe_name} ${of_libs} ${oneflow_third_party_libs} ${oneflow_exe_third_party_libs})
+    set_target_properties(${benchmark_exe_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin")
+  endforeach()
+  # end-to-end runtime benchmark, run by `make runtime_benchmark`
+  add_custom_target(runtime_benchmark
+    COMMAND ${CMAKE_COMMAND} -E env PYTHONPATH=${of_pyscript_dir} ${Python_EXECUTABLE}
+        ${PROJECT_SOURCE_DIR}/oneflow/python/benchmarks/runtime_benchmark/runtime_benchmark.py
+        --work_dir=${PROJECT_BINARY_DIR}/runtime_benchmark
+        --output_json=${PROJECT_BINARY_DIR}/runtime_benchmark.json
+    WORKING_DIRECTORY ${PROJECT_BINARY_DIR}
+    USES_TERMINAL)
+  add_dependencies(runtime_benchmark generate_api)
+  # compile time of synthetic large jobs, run by `make compile_benchmark`
+  add_custom_target(compile_benchmark
+    COMMAND ${CMAKE_COMMAND} -E env PYTHONPATH=${of_pyscript_dir} ${Python_EXECUTABLE}
+        ${PROJECT_SOURCE_DIR}/oneflow/python/benchmarks/compile_benchmark/compile_benchmark.py
+        --work_dir=${PROJECT_BINARY_DIR}/compile_benchmark
+        --output_json=${PROJECT_BINARY_DIR}/compile_benchmark.json
+    WORKING_DIRECTORY ${PROJECT_BINARY_DIR}
+    USES_TERMINAL)
+  add_dependencies(compile_benchmark generate_api)
+endif()
 
 # build include
 set(ONEFLOW_INCLUDE_DIR "${PROJECT_BINARY_DIR}/python_scripts/oneflow/include")
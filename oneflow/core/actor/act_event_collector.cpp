@@ -0,0 +1,149 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/actor/act_event_collector.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+const size_t kActEventBatchByteSize = 64 * 1024;
+const double kActEventBatchMaxAge = 1e9;  // ns
+
+uint64_t NewActEventCollectorUid() {
+  static std::atomic<uint64_t> uid(0);
+  return ++uid;
+}
+
+template<typename T>
+void AppendRecord(const T& record, std::string* records) {
+  records->append(reinterpret_cast<const char*>(&record), sizeof(T));
+}
+
+template<typename T>
+void ReadRecord(const std::string& records, size_t* offset, T* record) {
+  CHECK_LE(*offset + sizeof(T), records.size());
+  std::memcpy(record, records.data() + *offset, sizeof(T));
+  *offset += sizeof(T);
+}
+
+}  // namespace
+
+void ForEachActEventInRecords(const std::string& records,
+                              const std::function<void(const ActEvent&)>& Handler) {
+  size_t offset = 0;
+  ActEvent act_event;
+  while (offset < records.size()) {
+    ActEventRecord record;
+    ReadRecord(records, &offset, &record);
+    act_event.Clear();
+    act_event.set_is_experiment_phase(record.is_experiment_phase != 0);
+    act_event.set_actor_id(record.actor_id);
+    act_event.set_work_stream_id(record.work_stream_id);
+    act_event.set_act_id(record.act_id);
+    act_event.set_ready_time(record.ready_time);
+    act_event.set_start_time(record.start_time);
+    act_event.set_stop_time(record.stop_time);
+    FOR_RANGE(int32_t, i, 0, record.readable_regst_num) {
+      ReadableRegstRecord regst;
+      ReadRecord(records, &offset, &regst);
+      ReadableRegstInfo* info = act_event.add_readable_regst_infos();
+      info->set_regst_desc_id(regst.regst_desc_id);
+      info->set_act_id(regst.act_id);
+    }
+    Handler(act_event);
+  }
+}
+
+ActEventCollector::ActEventCollector(bool is_experiment_phase)
+    : uid_(NewActEventCollectorUid()), pending_push_cnt_(0) {
+  // the improver expects every act of the experiment phase
+  sample_period_ =
+      is_experiment_phase ? 1 : Global<const ProfilerConf>::Get()->act_event_sample_period();
+  CHECK_GE(sample_period_, 1);
+}
+
+ActEventCollector::~ActEventCollector() {
+  std::unique_lock<std::mutex> lock(pending_push_mutex_);
+  pending_push_cond_.wait(lock, [this]() { return pending_push_cnt_ == 0; });
+}
+
+ActEventCollector::ThreadBuffer* ActEventCollector::ThisThreadBuffer() {
+  // threads outlive a collector, hence the buffer cached by a thread is tagged by its owner
+  thread_local std::pair<uint64_t, ThreadBuffer*> uid7buffer(0, nullptr);
+  if (uid7buffer.first != uid_) {
+    std::unique_lock<std::mutex> lock(thread_buffers_mutex_);
+    thread_buffers_.emplace_back();
+    uid7buffer = std::make_pair(uid_, &thread_buffers_.back());
+  }
+  return uid7buffer.second;
+}
+
+void ActEventCollector::Collect(const PendingActEvent& event) {
+  CHECK_EQ(event.record.readable_regst_num, event.readable_regsts.size());
+  ThreadBuffer* buffer = ThisThreadBuffer();
+  std::string records;
+  {
+    std::unique_lock<std::mutex> lock(buffer->mutex);
+    if (buffer->records.empty()) { buffer->first_event_time = event.record.stop_time; }
+    AppendRecord(event.record, &buffer->records);
+    for (const ReadableRegstRecord& regst : event.readable_regsts) {
+      AppendRecord(regst, &buffer->records);
+    }
+    if (buffer->records.size() < kActEventBatchByteSize
+        && event.record.stop_time - buffer->first_event_time < kActEventBatchMaxAge) {
+      return;
+    }
+    records.swap(buffer->records);
+  }
+  AsyncPush(std::move(records));
+}
+
+void ActEventCollector::AsyncPush(std::string&& records) {
+  {
+    std::unique_lock<std::mutex> lock(pending_push_mutex_);
+    pending_push_cnt_ += 1;
+  }
+  auto shared_records = std::make_shared<std::string>(std::move(records));
+  // The stream poller threads are not allowed to perform blocking RPC call. Hence, the RPC call
+  // is forwarded to the thread pool and will be executed there.
+  Global<ThreadPool>::Get()->AddWork([this, shared_records]() {
+    Global<CtrlClient>::Get()->PushActEvents(*shared_records);
+    std::unique_lock<std::mutex> lock(pending_push_mutex_);
+    pending_push_cnt_ -= 1;
+    if (pending_push_cnt_ == 0) { pending_push_cond_.notify_all(); }
+  });
+}
+
+void ActEventCollector::Flush() {
+  {
+    std::unique_lock<std::mutex> lock(thread_buffers_mutex_);
+    for (ThreadBuffer& buffer : thread_buffers_) {
+      std::string records;
+      {
+        std::unique_lock<std::mutex> buffer_lock(buffer.mutex);
+        records.swap(buffer.records);
+      }
+      if (!records.empty()) { AsyncPush(std::move(records)); }
+    }
+  }
+  std::unique_lock<std::mutex> lock(pending_push_mutex_);
+  pending_push_cond_.wait(lock, [this]() { return pending_push_cnt_ == 0; });
+}
+
+}  // namespace oneflow
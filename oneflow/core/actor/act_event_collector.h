@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_ACTOR_ACT_EVENT_COLLECTOR_H_
+#define ONEFLOW_CORE_ACTOR_ACT_EVENT_COLLECTOR_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/actor/act_event.pb.h"
+
+namespace oneflow {
+
+// An act event is packed as an ActEventRecord followed by readable_regst_num
+// ReadableRegstRecord, both of fixed size, and shipped to the master in batches of such records
+struct ActEventRecord {
+  int64_t actor_id;
+  int64_t work_stream_id;
+  int64_t act_id;
+  double ready_time;
+  double start_time;
+  double stop_time;
+  int32_t is_experiment_phase;
+  int32_t readable_regst_num;
+};
+
+struct ReadableRegstRecord {
+  int64_t regst_desc_id;
+  int64_t act_id;
+};
+
+struct PendingActEvent {
+  ActEventRecord record;
+  std::vector<ReadableRegstRecord> readable_regsts;
+};
+
+void ForEachActEventInRecords(const std::string& records,
+                              const std::function<void(const ActEvent&)>& Handler);
+
+// Collects the act events of this process into per-thread buffers, which are pushed to the
+// master in a single rpc once they are full or old enough
+class ActEventCollector final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActEventCollector);
+  ~ActEventCollector();
+
+  bool IsSampled(int64_t act_id) const { return act_id % sample_period_ == 0; }
+  void Collect(const PendingActEvent& event);
+  // Pushes the buffered events and waits until the master has received all of them
+  void Flush();
+
+ private:
+  friend class Global<ActEventCollector>;
+  explicit ActEventCollector(bool is_experiment_phase);
+
+  struct ThreadBuffer {
+    std::mutex mutex;
+    std::string records;
+    double first_event_time;
+  };
+  ThreadBuffer* ThisThreadBuffer();
+  void AsyncPush(std::string&& records);
+
+  const uint64_t uid_;
+  int64_t sample_period_;
+  std::mutex thread_buffers_mutex_;
+  std::list<ThreadBuffer> thread_buffers_;
+  std::mutex pending_push_mutex_;
+  std::condition_variable pending_push_cond_;
+  int64_t pending_push_cnt_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_ACTOR_ACT_EVENT_COLLECTOR_H_
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/actor/act_event_logger.h"
+#include "oneflow/core/actor/act_event_collector.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/common/protobuf.h"
 #include <google/protobuf/text_format.h>
@@ -23,12 +24,51 @@ namespace oneflow {
 const std::string ActEventLogger::experiment_prefix_("experiment_");
 const std::string ActEventLogger::act_event_bin_filename_("act_event.bin");
 const std::string ActEventLogger::act_event_txt_filename_("act_event.txt");
+const std::string ActEventLogger::act_latency_histogram_filename_("act_latency_histogram.txt");
+
+void LatencyHistogram::Add(double latency_ns) {
+  const double latency_us = std::max(latency_ns / 1e3, 0.0);
+  int32_t bucket = 0;
+  while (bucket < kBucketNum - 1 && latency_us >= std::ldexp(1.0, bucket)) { ++bucket; }
+  bucket_cnts_[bucket] += 1;
+  cnt_ += 1;
+  sum_ += latency_us;
+  max_ = std::max(max_, latency_us);
+}
+
+double LatencyHistogram::Quantile(double fraction) const {
+  int64_t acc_cnt = 0;
+  FOR_RANGE(int32_t, bucket, 0, kBucketNum) {
+    acc_cnt += bucket_cnts_[bucket];
+    if (acc_cnt >= fraction * cnt_) { return std::min(std::ldexp(1.0, bucket), max_); }
+  }
+  return max_;
+}
+
+std::string LatencyHistogram::ToString() const {
+  std::ostringstream ss;
+  ss << "cnt " << cnt_ << " mean_us " << (cnt_ > 0 ? sum_ / cnt_ : 0) << " p50_us "
+     << Quantile(0.5) << " p90_us " << Quantile(0.9) << " p99_us " << Quantile(0.99) << " max_us "
+     << max_ << " buckets";
+  int32_t last_bucket = kBucketNum - 1;
+  while (last_bucket > 0 && bucket_cnts_[last_bucket] == 0) { --last_bucket; }
+  FOR_RANGE(int32_t, bucket, 0, last_bucket + 1) { ss << " " << bucket_cnts_[bucket]; }
+  return ss.str();
+}
 
 void ActEventLogger::PrintActEventToLogDir(const ActEvent& act_event) {
   bin_out_stream_ << act_event;
   std::string act_event_txt;
   google::protobuf::TextFormat::PrintToString(act_event, &act_event_txt);
   txt_out_stream_ << act_event_txt;
+  auto& wait7act_histogram = actor_id2wait7act_histogram_[act_event.actor_id()];
+  wait7act_histogram.first.Add(act_event.start_time() - act_event.ready_time());
+  wait7act_histogram.second.Add(act_event.stop_time() - act_event.start_time());
+}
+
+void ActEventLogger::PrintActEventRecordsToLogDir(const std::string& act_event_records) {
+  ForEachActEventInRecords(act_event_records,
+                           [&](const ActEvent& act_event) { PrintActEventToLogDir(act_event); });
 }
 
 std::string ActEventLogger::experiment_act_event_bin_filename() {
@@ -41,7 +81,21 @@ ActEventLogger::ActEventLogger(bool is_experiment)
     : bin_out_stream_(LocalFS(), JoinPath(FLAGS_log_dir, (is_experiment ? experiment_prefix_ : "")
                                                              + act_event_bin_filename_)),
       txt_out_stream_(LocalFS(), JoinPath(FLAGS_log_dir, (is_experiment ? experiment_prefix_ : "")
-                                                             + act_event_txt_filename_)) {}
+                                                             + act_event_txt_filename_)),
+      is_experiment_phase_(is_experiment) {}
+
+ActEventLogger::~ActEventLogger() {
+  if (actor_id2wait7act_histogram_.empty()) { return; }
+  // bucket i of a histogram counts the latencies in [2^(i-1), 2^i) us
+  PersistentOutStream out_stream(
+      LocalFS(), JoinPath(FLAGS_log_dir, (is_experiment_phase_ ? experiment_prefix_ : "")
+                                             + act_latency_histogram_filename_));
+  for (const auto& pair : actor_id2wait7act_histogram_) {
+    out_stream << "actor " + std::to_string(pair.first) + "\n";
+    out_stream << "  wait: " + pair.second.first.ToString() + "\n";
+    out_stream << "  act: " + pair.second.second.ToString() + "\n";
+  }
+}
 
 void ParseActEvents(const std::string& act_event_filepath,
                     std::list<std::unique_ptr<ActEvent>>* act_events) {
@@ -20,15 +20,36 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/actor/act_event.pb.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
+#include <array>
 
 namespace oneflow {
 
+// Counts latencies in power-of-two buckets of microseconds
+class LatencyHistogram final {
+ public:
+  LatencyHistogram() : cnt_(0), sum_(0), max_(0) { bucket_cnts_.fill(0); }
+  ~LatencyHistogram() = default;
+
+  void Add(double latency_ns);
+  std::string ToString() const;
+
+ private:
+  static const int32_t kBucketNum = 32;
+  // the upper bound of the bucket where the given fraction of the latencies is reached
+  double Quantile(double fraction) const;
+
+  std::array<int64_t, kBucketNum> bucket_cnts_;
+  int64_t cnt_;
+  double sum_;
+  double max_;
+};
+
 class ActEventLogger final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ActEventLogger);
-  ~ActEventLogger() = default;
+  ~ActEventLogger();
 
-  void PrintActEventToLogDir(const ActEvent&);
+  void PrintActEventRecordsToLogDir(const std::string& act_event_records);
   static std::string experiment_act_event_bin_filename();
   static std::string act_event_bin_filename();
 
@@ -36,12 +57,16 @@ class ActEventLogger final {
   static const std::string experiment_prefix_;
   static const std::string act_event_bin_filename_;
   static const std::string act_event_txt_filename_;
+  static const std::string act_latency_histogram_filename_;
 
   friend class Global<ActEventLogger>;
   ActEventLogger(bool is_experiment_phase);
+  void PrintActEventToLogDir(const ActEvent&);
 
   PersistentOutStream bin_out_stream_;
   PersistentOutStream txt_out_stream_;
+  bool is_experiment_phase_;
+  std::map<int64_t, std::pair<LatencyHistogram, LatencyHistogram>> actor_id2wait7act_histogram_;
 };
 void ParseActEvents(const std::string& act_event_filepath,
                     std::list<std::unique_ptr<ActEvent>>* act_events);
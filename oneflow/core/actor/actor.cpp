@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/job/runtime_job_descs.h"
+#include "oneflow/core/profiler/tracer.h"
 
 namespace oneflow {
 
@@ -50,6 +51,18 @@ void Actor::Init(const JobDesc* job_desc, const TaskProto& task_proto,
     ek.kernel = ConstructKernel(job_desc_, node.kernel_conf(), device_ctx_.get());
     exec_kernel_vec_.push_back(std::move(ek));
   }
+  trace_name_ = TaskType_Name(task_proto.task_type());
+  if (!exec_kernel_vec_.empty()) {
+    trace_name_ += ":" + exec_kernel_vec_.front().kernel->op_conf().name();
+  }
+  trace_name_id_ = profiler::InternTraceName(trace_name_);
+  auto* metrics_registry = Global<profiler::MetricsRegistry>::Get();
+  metrics_ = nullptr;
+  if (metrics_registry != nullptr) {
+    metrics_ = metrics_registry->NewActorMetrics(actor_id_, trace_name_);
+  }
+  blocked_since_ns_ = -1;
+  is_blocked_on_read_ = true;
 
   is_kernel_launch_synchronized_ =
       std::all_of(exec_kernel_vec_.cbegin(), exec_kernel_vec_.cend(),
@@ -267,9 +280,9 @@ KernelCtx Actor::GenDefaultKernelCtx() const {
   return ctx;
 }
 
-void Actor::SetReadableRegstInfo(const Regst* regst, ReadableRegstInfo* info) const {
-  info->set_regst_desc_id(regst->regst_desc_id());
-  info->set_act_id(regst->act_id());
+void Actor::SetReadableRegstInfo(const Regst* regst, ReadableRegstRecord* info) const {
+  info->regst_desc_id = regst->regst_desc_id();
+  info->act_id = regst->act_id();
 }
 
 void Actor::ForEachCurNaiveReadableDataRegst(std::function<void(const Regst*)> func) const {
@@ -294,6 +307,8 @@ int Actor::HandlerNormal(const ActorMsg& msg) {
       NormalProcessCustomizedEordMsg(msg);
     }
   } else if (msg.msg_type() == ActorMsgType::kRegstMsg) {
+    OF_PROFILER_TRACE_INSTANT(kRegst, OF_PROFILER_TRACE_NAME_ID("RecvRegstMsg"),
+                              msg.src_actor_id());
     if (msg.SrcMachineId() == GlobalProcessCtx::Rank()) {
       Regst* regst = msg.regst();
       if (naive_consumed_rs_.HasRegstDescId(regst->regst_desc_id())) {
@@ -366,41 +381,64 @@ int Actor::HandlerZombie(const ActorMsg& msg) {
 }
 
 void Actor::TryLogActEvent(const std::function<void()>& DoAct) const {
-  if (Global<RuntimeCtx>::Get()->is_experiment_phase() || NeedCollectActEvent()) {
-    auto act_event = std::make_shared<ActEvent>();
-    act_event->set_is_experiment_phase(Global<RuntimeCtx>::Get()->is_experiment_phase());
-    act_event->set_actor_id(actor_id());
-    act_event->set_work_stream_id(GetGlobalWorkStreamId());
-    act_event->set_act_id(act_id_);
-    act_event->set_ready_time(GetCurTime());
+  ActEventCollector* collector = Global<ActEventCollector>::Get();
+  if ((Global<RuntimeCtx>::Get()->is_experiment_phase() || NeedCollectActEvent())
+      && collector != nullptr && collector->IsSampled(act_id_)) {
+    auto act_event = std::make_shared<PendingActEvent>();
+    ActEventRecord* record = &act_event->record;
+    record->is_experiment_phase = Global<RuntimeCtx>::Get()->is_experiment_phase();
+    record->actor_id = actor_id();
+    record->work_stream_id = GetGlobalWorkStreamId();
+    record->act_id = act_id_;
+    record->ready_time = GetCurTime();
     naive_consumed_rs_.ForEachFrontRegst([&](const Regst* readable_regst) {
-      ReadableRegstInfo* info = act_event->add_readable_regst_infos();
-      Actor::SetReadableRegstInfo(readable_regst, info);
+      act_event->readable_regsts.emplace_back();
+      Actor::SetReadableRegstInfo(readable_regst, &act_event->readable_regsts.back());
     });
     ForEachCurCustomizedReadableRegst([&](const Regst* readable_regst) {
-      ReadableRegstInfo* info = act_event->add_readable_regst_infos();
-      SetReadableRegstInfo(readable_regst, info);
+      act_event->readable_regsts.emplace_back();
+      SetReadableRegstInfo(readable_regst, &act_event->readable_regsts.back());
     });
-    device_ctx_->AddCallBack([act_event]() { act_event->set_start_time(GetCurTime()); });
+    record->readable_regst_num = act_event->readable_regsts.size();
+    device_ctx_->AddCallBack([act_event]() { act_event->record.start_time = GetCurTime(); });
 
     DoAct();
 
-    device_ctx_->AddCallBack([act_event]() {
-      act_event->set_stop_time(GetCurTime());
-      // The stream poller thread is not allowed to perform blocking RPC call. Hence, the
-      // RPC call is forwarded to the thread pool and will be executed there.
-      Global<ThreadPool>::Get()->AddWork(
-          [act_event]() { Global<CtrlClient>::Get()->PushActEvent(*act_event); });
+    device_ctx_->AddCallBack([act_event, collector]() {
+      act_event->record.stop_time = GetCurTime();
+      collector->Collect(*act_event);
     });
   } else {
     DoAct();
   }
 }
 
+void Actor::ChargeBlockedTimeToMetrics() {
+  if (blocked_since_ns_ < 0) { return; }
+  const int64_t blocked_ns = profiler::TraceNowNanos() - blocked_since_ns_;
+  profiler::IncreaseMetric(
+      is_blocked_on_read_ ? &metrics_->read_blocked_ns : &metrics_->write_blocked_ns, blocked_ns);
+}
+
+void Actor::UpdtMetricsOnBlocked() {
+  // the time until the next act is charged to the readiness failing now
+  is_blocked_on_read_ = !IsReadReady();
+  blocked_since_ns_ = profiler::TraceNowNanos();
+  profiler::SetMetric(&metrics_->consumed_regst_cnt,
+                      naive_consumed_rs_.regst_cnt() + inplace_consumed_rs_.regst_cnt());
+  profiler::SetMetric(&metrics_->produced_regst_cnt,
+                      naive_produced_rs_.regst_cnt() + inplace_produced_rs_.regst_cnt());
+}
+
 void Actor::ActUntilFail() {
+  if (metrics_ != nullptr) { ChargeBlockedTimeToMetrics(); }
   while (IsReadReady() && IsWriteReady()) {
     act_id_ += 1;
-    TryLogActEvent([&] { Act(); });
+    {
+      OF_PROFILER_TRACE_GUARD(kActor, trace_name_id_, act_id_);
+      TryLogActEvent([&] { Act(); });
+    }
+    if (metrics_ != nullptr) { profiler::IncreaseMetric(&metrics_->act_cnt, 1); }
 
     AsyncSendCustomizedProducedRegstMsgToConsumer();
     AsyncSendNaiveProducedRegstMsgToConsumer();
@@ -412,6 +450,7 @@ void Actor::ActUntilFail() {
 
     AsyncSendQueuedMsg();
   }
+  if (metrics_ != nullptr) { UpdtMetricsOnBlocked(); }
 }
 
 void Actor::AsyncSendNaiveProducedRegstMsgToConsumer() {
@@ -16,7 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_ACTOR_ACTOR_H_
 #define ONEFLOW_CORE_ACTOR_ACTOR_H_
 
-#include "oneflow/core/actor/act_event.pb.h"
+#include "oneflow/core/actor/act_event_collector.h"
 #include "oneflow/core/actor/actor_message_bus.h"
 #include "oneflow/core/device/cpu_device_context.h"
 #include "oneflow/core/device/cuda_device_context.h"
@@ -27,6 +27,7 @@ limitations under the License.
 #include "oneflow/core/register/register_manager.h"
 #include "oneflow/core/thread/thread_context.h"
 #include "oneflow/core/actor/register_slot.h"
+#include "oneflow/core/profiler/metrics.h"
 
 namespace oneflow {
 
@@ -74,7 +75,7 @@ class Actor {
   std::unique_ptr<DeviceCtx>& mut_device_ctx() { return device_ctx_; }
   KernelCtx GenDefaultKernelCtx() const;
   const std::vector<ExecKernel>& exec_kernel_vec() { return exec_kernel_vec_; }
-  virtual void SetReadableRegstInfo(const Regst*, ReadableRegstInfo*) const;
+  virtual void SetReadableRegstInfo(const Regst*, ReadableRegstRecord*) const;
   void ForEachCurNaiveReadableDataRegst(std::function<void(const Regst*)>) const;
 
   int64_t act_id() const { return act_id_; }
@@ -172,6 +173,8 @@ class Actor {
                   // area
   }
   void TryLogActEvent(const std::function<void()>& Callback) const;
+  void ChargeBlockedTimeToMetrics();
+  void UpdtMetricsOnBlocked();
 
   // Ready
   bool IsReadReady() const;
@@ -220,6 +223,11 @@ class Actor {
   const JobDesc* job_desc_;
   int64_t actor_id_;
   int64_t act_id_;
+  std::string trace_name_;
+  int64_t trace_name_id_;
+  profiler::ActorMetrics* metrics_;
+  int64_t blocked_since_ns_;
+  bool is_blocked_on_read_;
   std::unique_ptr<ParallelContext> parallel_ctx_;
   std::vector<ExecKernel> exec_kernel_vec_;
   HashMap<std::string, std::vector<int64_t>> name2regst_desc_id_;
@@ -18,14 +18,21 @@ limitations under the License.
 #include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/profiler/tracer.h"
 
 namespace oneflow {
 
 void ActorMsgBus::SendMsg(const ActorMsg& msg) {
   int64_t dst_machine_id = Global<IDMgr>::Get()->MachineId4ActorId(msg.dst_actor_id());
+  if (msg.msg_type() == ActorMsgType::kRegstMsg) {
+    OF_PROFILER_TRACE_INSTANT(kRegst, OF_PROFILER_TRACE_NAME_ID("SendRegstMsg"),
+                              msg.dst_actor_id());
+  }
   if (dst_machine_id == GlobalProcessCtx::Rank()) {
     SendMsgWithoutCommNet(msg);
   } else {
+    OF_PROFILER_TRACE_GUARD(kCommNet, OF_PROFILER_TRACE_NAME_ID("CommNetSendActorMsg"),
+                            dst_machine_id);
     Global<CommNet>::Get()->SendActorMsg(dst_machine_id, msg);
   }
 }
@@ -56,11 +56,11 @@ void CopyCommNetActor::ForEachCurCustomizedReadableRegst(
   handler(piece_id2regst_ctx_.at(next_piece_id_).regst_raw_ptr);
 }
 
-void CopyCommNetActor::SetReadableRegstInfo(const Regst* regst, ReadableRegstInfo* info) const {
+void CopyCommNetActor::SetReadableRegstInfo(const Regst* regst, ReadableRegstRecord* info) const {
   const RegstCtx& regst_ctx = piece_id2regst_ctx_.at(next_piece_id_);
   CHECK(regst == regst_ctx.regst_raw_ptr);
-  info->set_regst_desc_id(in_regst_desc_id_);
-  info->set_act_id(regst_ctx.act_id);
+  info->regst_desc_id = in_regst_desc_id_;
+  info->act_id = regst_ctx.act_id;
 }
 
 bool CopyCommNetActor::NormalTryProcessReadableMsgFromOtherMachine(const ActorMsg& msg) {
@@ -38,7 +38,7 @@ class CopyCommNetActor final : public Actor {
 
   void VirtualActorInit(const TaskProto&) override;
   void InitDeviceCtx(const ThreadCtx&) override;
-  void SetReadableRegstInfo(const Regst*, ReadableRegstInfo*) const override;
+  void SetReadableRegstInfo(const Regst*, ReadableRegstRecord*) const override;
 
   std::pair<RegstNameType, HashSet<std::string>> GetNaiveOrCustomizedConsumedRegstDescName()
       override {
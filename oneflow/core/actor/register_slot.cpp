@@ -33,6 +33,7 @@ int RegstSlot::TryPushBackRegst(Regst* regst) {
   if (it == regst_desc_id2regsts_.end()) { return -1; }
   if (it->second.empty()) { available_regst_desc_cnt_ += 1; }
   it->second.push_back(regst);
+  regst_cnt_ += 1;
   return 0;
 }
 
@@ -42,6 +43,7 @@ int RegstSlot::TryPopFrontRegst(int64_t regst_desc_id) {
   if (it == regst_desc_id2regsts_.end()) { return -1; }
   CHECK(it->second.empty() == false);
   it->second.pop_front();
+  regst_cnt_ -= 1;
   if (it->second.empty()) { available_regst_desc_cnt_ -= 1; }
   return 0;
 }
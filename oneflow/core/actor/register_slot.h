@@ -23,12 +23,14 @@ namespace oneflow {
 class RegstSlot final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(RegstSlot);
-  RegstSlot() : regst_desc_id2regsts_(), available_regst_desc_cnt_(0), is_inited_(false) {}
+  RegstSlot()
+      : regst_desc_id2regsts_(), available_regst_desc_cnt_(0), regst_cnt_(0), is_inited_(false) {}
   ~RegstSlot() = default;
 
   bool is_inited() const { return is_inited_; }
   size_t total_regst_desc_cnt() const { return regst_desc_id2regsts_.size(); }
   size_t available_regst_desc_cnt() const { return available_regst_desc_cnt_; }
+  size_t regst_cnt() const { return regst_cnt_; }
 
   bool IsCurSlotReady() const { return available_regst_desc_cnt() == total_regst_desc_cnt(); }
   bool HasRegstDescId(int64_t regst_desc_id) const;
@@ -55,6 +57,7 @@ class RegstSlot final {
  private:
   HashMap<int64_t, std::deque<Regst*>> regst_desc_id2regsts_;
   size_t available_regst_desc_cnt_;
+  size_t regst_cnt_;
   bool is_inited_;
 };
 
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/profiler/tracer.h"
 
 namespace oneflow {
 
@@ -38,7 +39,19 @@ void CommNet::Read(void* actor_read_id, int64_t src_machine_id, void* src_token,
   auto actor_read_ctx = static_cast<ActorReadContext*>(actor_read_id);
   ReadContext* read_ctx = new ReadContext;
   read_ctx->actor_read_ctx = actor_read_ctx;
+  read_ctx->src_machine_id = src_machine_id;
+  read_ctx->trace_begin_ns = -1;
+  auto* metrics_registry = Global<profiler::MetricsRegistry>::Get();
+  read_ctx->metrics = metrics_registry == nullptr
+                          ? nullptr
+                          : metrics_registry->CommNetPeerMetrics4MachineId(src_machine_id);
+  if (read_ctx->metrics != nullptr) {
+    profiler::IncreaseMetric(&read_ctx->metrics->read_cnt, 1);
+    profiler::IncreaseMetric(&read_ctx->metrics->read_bytes, ByteSize4Token(dst_token));
+    profiler::IncreaseMetric(&read_ctx->metrics->pending_read_cnt, 1);
+  }
   auto do_read = [this, read_ctx, src_machine_id, src_token, dst_token]() {
+    if (profiler::IsTracingEnabled()) { read_ctx->trace_begin_ns = profiler::TraceNowNanos(); }
     DoRead(read_ctx, src_machine_id, src_token, dst_token);
   };
   AddWorkToStream(actor_read_id, do_read, true);
@@ -50,6 +63,15 @@ void CommNet::AddReadCallBack(void* actor_read_id, std::function<void()> callbac
 
 void CommNet::ReadDone(void* read_id) {
   ReadContext* read_ctx = static_cast<ReadContext*>(read_id);
+  if (read_ctx->trace_begin_ns >= 0) {
+    profiler::RecordTraceEvent(profiler::TraceCategory::kCommNet,
+                               OF_PROFILER_TRACE_NAME_ID("CommNetRead"),
+                               read_ctx->trace_begin_ns, profiler::TraceNowNanos(),
+                               read_ctx->src_machine_id);
+  }
+  if (read_ctx->metrics != nullptr) {
+    profiler::IncreaseMetric(&read_ctx->metrics->pending_read_cnt, -1);
+  }
   ActorReadContext* actor_read_ctx = read_ctx->actor_read_ctx;
   CommNetItem item;
   {
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/common/platform.h"
 #include "oneflow/core/job/plan.pb.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/profiler/metrics.h"
 
 namespace oneflow {
 
@@ -42,6 +43,7 @@ class CommNet {
   virtual void* RegisterMemory(void* ptr, size_t byte_size) = 0;
   virtual void UnRegisterMemory(void* token) = 0;
   virtual void RegisterMemoryDone() = 0;
+  virtual size_t ByteSize4Token(void* token) = 0;
 
   // Stream
   void* NewActorReadId();
@@ -67,6 +69,9 @@ class CommNet {
   struct ActorReadContext;
   struct ReadContext {
     ActorReadContext* actor_read_ctx;
+    int64_t src_machine_id;
+    int64_t trace_begin_ns;
+    profiler::CommNetPeerMetrics* metrics;
   };
   struct ActorReadContext {
     std::mutex waiting_list_mtx;
@@ -88,6 +93,7 @@ class CommNetIf : public CommNet {
     MemDescType* mem_desc = NewMemDesc(ptr, byte_size);
     std::unique_lock<std::mutex> lck(mem_descs_mtx_);
     CHECK(mem_descs_.insert(mem_desc).second);
+    CHECK(mem_desc2byte_size_.emplace(mem_desc, byte_size).second);
     return mem_desc;
   }
 
@@ -96,6 +102,12 @@ class CommNetIf : public CommNet {
     delete mem_desc;
     std::unique_lock<std::mutex> lck(mem_descs_mtx_);
     CHECK_EQ(mem_descs_.erase(mem_desc), 1);
+    CHECK_EQ(mem_desc2byte_size_.erase(mem_desc), 1);
+  }
+
+  size_t ByteSize4Token(void* token) override {
+    std::unique_lock<std::mutex> lck(mem_descs_mtx_);
+    return mem_desc2byte_size_.at(static_cast<MemDescType*>(token));
   }
 
  protected:
@@ -105,6 +117,7 @@ class CommNetIf : public CommNet {
  private:
   std::mutex mem_descs_mtx_;
   HashSet<MemDescType*> mem_descs_;
+  HashMap<MemDescType*, size_t> mem_desc2byte_size_;
 };
 
 }  // namespace oneflow
@@ -55,14 +55,18 @@ int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_nu
   return bind_result;
 }
 
-int64_t GetMachineId(const sockaddr_in& sa) {
-  char addr[INET_ADDRSTRLEN];
-  memset(addr, '\0', sizeof(addr));
-  PCHECK(inet_ntop(AF_INET, &(sa.sin_addr), addr, INET_ADDRSTRLEN));
-  for (int64_t i = 0; i < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum(); ++i) {
-    if (Global<ResourceDesc, ForSession>::Get()->machine(i).addr() == addr) { return i; }
-  }
-  UNIMPLEMENTED();
+// peers are identified by the machine id sent right after connecting instead of by addr,
+// because several machines may share one host
+void SendMachineId(int sockfd, int64_t machine_id) {
+  PCHECK(write(sockfd, &machine_id, sizeof(machine_id)) == sizeof(machine_id));
+}
+
+int64_t RecvMachineId(int sockfd) {
+  int64_t machine_id = -1;
+  PCHECK(read(sockfd, &machine_id, sizeof(machine_id)) == sizeof(machine_id));
+  CHECK_GE(machine_id, 0);
+  CHECK_LT(machine_id, (Global<ResourceDesc, ForSession>::Get()->TotalMachineNum()));
+  return machine_id;
 }
 
 std::string GenPortKey(int64_t machine_id) { return "EpollPort/" + std::to_string(machine_id); }
@@ -179,6 +183,7 @@ void EpollCommNet::InitSockets() {
     PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
     PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
            == 0);
+    SendMachineId(sockfd, this_machine_id);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
     machine_id2sockfd_[peer_id] = sockfd;
   }
@@ -189,8 +194,9 @@ void EpollCommNet::InitSockets() {
     socklen_t len = sizeof(peer_sockaddr);
     int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
     PCHECK(sockfd != -1);
+    int64_t peer_machine_id = RecvMachineId(sockfd);
+    CHECK_EQ(machine_id2sockfd_[peer_machine_id], -1);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    int64_t peer_machine_id = GetMachineId(peer_sockaddr);
     machine_id2sockfd_[peer_machine_id] = sockfd;
   }
   PCHECK(close(listen_sockfd) == 0);
@@ -0,0 +1,169 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/control/ctrl_bootstrap.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/ctrl_server.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+
+#include <iomanip>
+
+#ifdef OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace {
+
+EnvProto GetEnvProto(int64_t rank, int32_t ctrl_port) {
+  EnvProto ret;
+  ret.set_ctrl_port(ctrl_port);
+  BootstrapConf* bootstrap_conf = ret.mutable_ctrl_bootstrap_conf();
+  bootstrap_conf->mutable_master_addr()->set_host("127.0.0.1");
+  bootstrap_conf->mutable_master_addr()->set_port(ctrl_port);
+  bootstrap_conf->set_rank(rank);
+  bootstrap_conf->set_world_size(2);
+  bootstrap_conf->set_host("127.0.0.1");
+  if (rank == 0) { bootstrap_conf->set_ctrl_port(ctrl_port); }
+  return ret;
+}
+
+Resource GetResource() {
+  Resource ret;
+  ret.set_machine_num(2);
+  ret.set_gpu_device_num(0);
+  ret.set_cpu_device_num(1);
+  ret.set_comm_net_worker_num(1);
+  ret.set_use_shm_comm_net(true);
+  return ret;
+}
+
+// machine 1 reads the buffer of machine 0, one read after another for the latency and all reads
+// in a stream for the bandwidth
+void BenchmarkRead(const std::string& name, CommNet* comm_net, size_t byte_size, int64_t iter_num) {
+  std::vector<char> buf(byte_size, GlobalProcessCtx::Rank());
+  void* token = comm_net->RegisterMemory(buf.data(), byte_size);
+  comm_net->RegisterMemoryDone();
+  const std::string key = "ShmCommNetBenchmark/" + name + "/" + std::to_string(byte_size);
+  if (GlobalProcessCtx::Rank() == 0) {
+    Global<CtrlClient>::Get()->PushKV(key, std::to_string(reinterpret_cast<uintptr_t>(token)));
+  } else {
+    uintptr_t src_token = 0;
+    Global<CtrlClient>::Get()->PullKV(
+        key, [&](const std::string& v) { src_token = oneflow_cast<uintptr_t>(v); });
+    void* read_id = comm_net->NewActorReadId();
+    auto ReadOnce = [&](BlockingCounter* bc) {
+      comm_net->Read(read_id, 0, reinterpret_cast<void*>(src_token), token);
+      comm_net->AddReadCallBack(read_id, [bc]() { bc->Decrease(); });
+    };
+    {
+      BlockingCounter bc(1);
+      ReadOnce(&bc);
+      bc.WaitUntilCntEqualZero();
+      CHECK_EQ(buf.front(), 0);
+      CHECK_EQ(buf.back(), 0);
+    }
+    const double latency_start = GetCurTime();
+    FOR_RANGE(int64_t, i, 0, iter_num) {
+      BlockingCounter bc(1);
+      ReadOnce(&bc);
+      bc.WaitUntilCntEqualZero();
+    }
+    const double latency_us = (GetCurTime() - latency_start) / 1e3 / iter_num;
+    const double bandwidth_start = GetCurTime();
+    {
+      BlockingCounter bc(iter_num);
+      FOR_RANGE(int64_t, i, 0, iter_num) { ReadOnce(&bc); }
+      bc.WaitUntilCntEqualZero();
+    }
+    const double bandwidth_mib =
+        byte_size * iter_num / ((GetCurTime() - bandwidth_start) / 1e9) / 1024.0 / 1024.0;
+    comm_net->DeleteActorReadId(read_id);
+    std::cout << std::setw(10) << std::left << name << std::setw(15) << std::left << byte_size
+              << std::setw(20) << std::left << latency_us << std::setw(20) << std::left
+              << bandwidth_mib << std::endl;
+  }
+  OF_ENV_BARRIER();
+  if (GlobalProcessCtx::Rank() == 0) { Global<CtrlClient>::Get()->ClearKV(key); }
+  comm_net->UnRegisterMemory(token);
+}
+
+Maybe<void> RunShmCommNetBenchmark(int64_t rank, int32_t ctrl_port, int64_t max_byte_size,
+                                   int64_t iter_num) {
+  Global<EnvDesc>::New(GetEnvProto(rank, ctrl_port));
+  Global<CtrlServer>::New(rank == 0 ? ctrl_port : 0);
+  Global<ProcessCtx>::New();
+  JUST(RankInfoCtrlBootstrap(Global<EnvDesc>::Get()->bootstrap_conf())
+           .InitProcessCtx(Global<CtrlServer>::Get()->port(), Global<ProcessCtx>::Get()));
+  Global<CtrlClient>::New(*Global<ProcessCtx>::Get());
+  Global<ResourceDesc, ForEnv>::New(GetResource());
+  Global<ResourceDesc, ForSession>::New(GetResource());
+  Global<EpollCommNet>::New();
+  Global<ShmCommNet>::New();
+  OF_ENV_BARRIER();
+
+  if (rank == 1) {
+    std::cout << std::setw(10) << std::left << "#net" << std::setw(15) << std::left << "#bytes"
+              << std::setw(20) << std::left << "#latency[us]" << std::setw(20) << std::left
+              << "#bandwidth[MiB/s]" << std::endl;
+  }
+  for (int64_t byte_size = 8; byte_size <= max_byte_size; byte_size *= 8) {
+    BenchmarkRead("epoll", Global<EpollCommNet>::Get(), byte_size, iter_num);
+    BenchmarkRead("shm", Global<ShmCommNet>::Get(), byte_size, iter_num);
+  }
+
+  OF_ENV_BARRIER();
+  Global<ShmCommNet>::Delete();
+  Global<EpollCommNet>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<ResourceDesc, ForEnv>::Delete();
+  Global<CtrlClient>::Delete();
+  Global<ProcessCtx>::Delete();
+  Global<CtrlServer>::Delete();
+  Global<EnvDesc>::Delete();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+/*
+ * Try run this benchmark exe in two processes on the same host by :
+ *     ./shm_comm_net_benchmark -rank=0 & ./shm_comm_net_benchmark -rank=1
+ */
+DEFINE_int64(rank, 0, "rank of this process, 0 or 1");
+DEFINE_int32(ctrl_port, 9527, "ctrl port of rank 0");
+DEFINE_int64(max_byte_size, 64 << 20, "max byte size of a read");
+DEFINE_int64(iter_num, 100, "number of reads for each byte size");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_JUST(
+      RunShmCommNetBenchmark(FLAGS_rank, FLAGS_ctrl_port, FLAGS_max_byte_size, FLAGS_iter_num));
+  return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) { return 0; }
+
+#endif  // OF_PLATFORM_POSIX
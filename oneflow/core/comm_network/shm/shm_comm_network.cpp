@@ -0,0 +1,273 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/actor/actor_message_bus.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+#ifdef OF_PLATFORM_POSIX
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kCacheLineSize = 64;
+
+}  // namespace
+
+struct ShmCommNet::ShmRing {
+  // head is only written by the consumer and tail only by the producer
+  alignas(kCacheLineSize) std::atomic<uint64_t> head;
+  alignas(kCacheLineSize) std::atomic<uint64_t> tail;
+  alignas(kCacheLineSize) uint64_t capacity;
+
+  ActorMsg* slots() { return reinterpret_cast<ActorMsg*>(this + 1); }
+  static size_t ByteSize(uint64_t capacity) {
+    return sizeof(ShmRing) + capacity * sizeof(ActorMsg);
+  }
+};
+
+struct ShmCommNet::ShmPeer {
+  int64_t machine_id;
+  pid_t pid;
+  // false when process_vm_readv is not permitted, e.g. by ptrace_scope, then regsts are read by
+  // epoll while actor msgs still go through shared memory
+  bool can_read_memory;
+  std::mutex send_mutex;
+  ShmRing* send_ring;
+  ShmRing* recv_ring;
+  std::string recv_ring_name;
+};
+
+namespace {
+
+constexpr uint64_t kProbeMagic = 0x6f6e65666c6f77ULL;
+const uint64_t probe_word = kProbeMagic;
+
+std::string GenRingName(pid_t dst_pid, int64_t src_machine_id) {
+  return "/oneflow-shm-comm-net-" + std::to_string(dst_pid) + "-" + std::to_string(src_machine_id);
+}
+
+std::string GenPeerKey(int64_t machine_id) { return "ShmCommNet/" + std::to_string(machine_id); }
+
+void* MapShm(const std::string& name, size_t byte_size, bool create) {
+  int fd = create ? shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)
+                  : shm_open(name.c_str(), O_RDWR, 0600);
+  PCHECK(fd != -1) << "shm_open " << name;
+  if (create) { PCHECK(ftruncate(fd, byte_size) == 0); }
+  void* ptr = mmap(nullptr, byte_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  PCHECK(ptr != MAP_FAILED) << "mmap " << name;
+  PCHECK(close(fd) == 0);
+  return ptr;
+}
+
+// returns false instead of failing only if the very first call is rejected, used for probing
+bool ReadPeerMemory(pid_t pid, void* dst, const void* src, size_t byte_size) {
+  size_t done = 0;
+  while (done < byte_size) {
+    iovec local{static_cast<char*>(dst) + done, byte_size - done};
+    iovec remote{const_cast<char*>(static_cast<const char*>(src)) + done, byte_size - done};
+    ssize_t ret = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    if (ret == -1 && done == 0 && (errno == EPERM || errno == ENOSYS)) { return false; }
+    PCHECK(ret > 0) << "process_vm_readv from pid " << pid;
+    done += ret;
+  }
+  return true;
+}
+
+}  // namespace
+
+ShmCommNet::~ShmCommNet() {
+  stop_polling_ = true;
+  ring_poller_.join();
+  read_thread_pool_.reset();
+  // TODO(chengcheng): change to OF_ENV_BARRIER
+  OF_SESSION_BARRIER();
+  const uint64_t ring_byte_size =
+      ShmRing::ByteSize(Global<ResourceDesc, ForSession>::Get()->shm_comm_net_ring_capacity());
+  for (const auto& peer : machine_id2shm_peer_) {
+    if (!peer) { continue; }
+    PCHECK(munmap(peer->send_ring, ring_byte_size) == 0);
+    PCHECK(munmap(peer->recv_ring, ring_byte_size) == 0);
+  }
+}
+
+void ShmCommNet::RegisterMemoryDone() {
+  // do nothing
+}
+
+void ShmCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) {
+  ShmPeer* peer = FindShmPeer(dst_machine_id);
+  if (peer == nullptr) {
+    Global<EpollCommNet>::Get()->SendActorMsg(dst_machine_id, msg);
+    return;
+  }
+  ShmRing* ring = peer->send_ring;
+  std::unique_lock<std::mutex> lck(peer->send_mutex);
+  const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  while (tail - ring->head.load(std::memory_order_acquire) >= ring->capacity) {
+    std::this_thread::yield();
+  }
+  std::memcpy(&ring->slots()[tail & (ring->capacity - 1)], &msg, sizeof(ActorMsg));
+  ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+SocketMemDesc* ShmCommNet::NewMemDesc(void* ptr, size_t byte_size) {
+  SocketMemDesc* mem_desc = new SocketMemDesc;
+  mem_desc->mem_ptr = ptr;
+  mem_desc->byte_size = byte_size;
+  return mem_desc;
+}
+
+ShmCommNet::ShmCommNet() : stop_polling_(false) {
+  CHECK(Global<EpollCommNet>::Get() != nullptr);
+  InitShmPeers();
+  read_thread_pool_.reset(
+      new ThreadPool(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum()));
+  ring_poller_ = std::thread([this]() { PollRecvRings(); });
+}
+
+void ShmCommNet::InitShmPeers() {
+  const int64_t this_machine_id = GlobalProcessCtx::Rank();
+  const auto* resource_desc = Global<ResourceDesc, ForSession>::Get();
+  const std::string& this_addr = resource_desc->machine(this_machine_id).addr();
+  const uint64_t capacity = resource_desc->shm_comm_net_ring_capacity();
+  CHECK_GT(capacity, 0);
+  CHECK_EQ(capacity & (capacity - 1), 0) << "shm_comm_net_ring_capacity should be a power of 2";
+  const size_t ring_byte_size = ShmRing::ByteSize(capacity);
+  const pid_t this_pid = getpid();
+  machine_id2shm_peer_.resize(resource_desc->TotalMachineNum());
+
+  // every process creates the rings it consumes
+  for (int64_t peer_id : peer_machine_id()) {
+    if (resource_desc->machine(peer_id).addr() != this_addr) { continue; }
+    ShmPeer* peer = new ShmPeer;
+    peer->machine_id = peer_id;
+    peer->recv_ring_name = GenRingName(this_pid, peer_id);
+    shm_unlink(peer->recv_ring_name.c_str());
+    peer->recv_ring = new (MapShm(peer->recv_ring_name, ring_byte_size, true)) ShmRing;
+    peer->recv_ring->head = 0;
+    peer->recv_ring->tail = 0;
+    peer->recv_ring->capacity = capacity;
+    machine_id2shm_peer_.at(peer_id).reset(peer);
+  }
+  Global<CtrlClient>::Get()->PushKV(
+      GenPeerKey(this_machine_id),
+      std::to_string(this_pid) + " " + std::to_string(reinterpret_cast<uintptr_t>(&probe_word)));
+
+  for (auto& peer : machine_id2shm_peer_) {
+    if (!peer) { continue; }
+    uintptr_t peer_probe_addr = 0;
+    Global<CtrlClient>::Get()->PullKV(GenPeerKey(peer->machine_id), [&](const std::string& v) {
+      std::istringstream iss(v);
+      iss >> peer->pid >> peer_probe_addr;
+    });
+    peer->send_ring = static_cast<ShmRing*>(
+        MapShm(GenRingName(peer->pid, this_machine_id), ring_byte_size, false));
+    CHECK_EQ(peer->send_ring->capacity, capacity);
+    uint64_t peer_probe_word = 0;
+    peer->can_read_memory =
+        ReadPeerMemory(peer->pid, &peer_probe_word, reinterpret_cast<void*>(peer_probe_addr),
+                       sizeof(uint64_t))
+        && peer_probe_word == kProbeMagic;
+    if (!peer->can_read_memory) {
+      LOG(WARNING) << "CommNet:Shm can not read memory of machine " << peer->machine_id
+                   << " (pid " << peer->pid << "), fall back to epoll for regst reading";
+    }
+    LOG(INFO) << "CommNet:Shm machine " << peer->machine_id << " pid " << peer->pid;
+  }
+
+  // names are no longer needed once all peers mapped their rings
+  OF_SESSION_BARRIER();
+  for (const auto& peer : machine_id2shm_peer_) {
+    if (peer) { PCHECK(shm_unlink(peer->recv_ring_name.c_str()) == 0); }
+  }
+  Global<CtrlClient>::Get()->ClearKV(GenPeerKey(this_machine_id));
+}
+
+void ShmCommNet::PollRecvRings() {
+  std::vector<ShmRing*> recv_rings;
+  for (const auto& peer : machine_id2shm_peer_) {
+    if (peer) { recv_rings.push_back(peer->recv_ring); }
+  }
+  // spin first, then yield, then sleep to keep an idle poller cheap
+  constexpr int64_t kSpinRounds = 1024;
+  constexpr int64_t kYieldRounds = 16384;
+  int64_t idle_rounds = 0;
+  while (!stop_polling_.load(std::memory_order_relaxed)) {
+    bool received = false;
+    for (ShmRing* ring : recv_rings) {
+      uint64_t head = ring->head.load(std::memory_order_relaxed);
+      const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+      while (head < tail) {
+        ActorMsg msg;
+        std::memcpy(&msg, &ring->slots()[head & (ring->capacity - 1)], sizeof(ActorMsg));
+        head += 1;
+        ring->head.store(head, std::memory_order_release);
+        Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(msg);
+        received = true;
+      }
+    }
+    if (received) {
+      idle_rounds = 0;
+    } else if (++idle_rounds > kYieldRounds) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    } else if (idle_rounds > kSpinRounds) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+ShmCommNet::ShmPeer* ShmCommNet::FindShmPeer(int64_t machine_id) const {
+  return machine_id2shm_peer_.at(machine_id).get();
+}
+
+void ShmCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
+  ShmPeer* peer = FindShmPeer(src_machine_id);
+  if (peer == nullptr || !peer->can_read_memory) {
+    SocketMsg msg;
+    msg.msg_type = SocketMsgType::kRequestWrite;
+    msg.request_write_msg.src_token = src_token;
+    msg.request_write_msg.dst_machine_id = GlobalProcessCtx::Rank();
+    msg.request_write_msg.dst_token = dst_token;
+    msg.request_write_msg.read_id = read_id;
+    Global<EpollCommNet>::Get()->SendSocketMsg(src_machine_id, msg);
+    return;
+  }
+  const pid_t pid = peer->pid;
+  read_thread_pool_->AddWork([this, pid, read_id, src_token, dst_token]() {
+    // the src token is a SocketMemDesc living in the peer process
+    SocketMemDesc src_mem_desc;
+    CHECK(ReadPeerMemory(pid, &src_mem_desc, src_token, sizeof(SocketMemDesc)));
+    const SocketMemDesc* dst_mem_desc = static_cast<const SocketMemDesc*>(dst_token);
+    CHECK_EQ(src_mem_desc.byte_size, dst_mem_desc->byte_size);
+    CHECK(ReadPeerMemory(pid, dst_mem_desc->mem_ptr, src_mem_desc.mem_ptr,
+                         dst_mem_desc->byte_size));
+    ReadDone(read_id);
+  });
+}
+
+}  // namespace oneflow
+
+#endif  // OF_PLATFORM_POSIX
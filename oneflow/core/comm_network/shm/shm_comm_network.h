@@ -0,0 +1,64 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
+
+#include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+#ifdef OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+// ShmCommNet serves the peers on the same host, the others are delegated to Global<EpollCommNet>,
+// so it must be created after and deleted before Global<EpollCommNet>.
+// Actor msgs go through a lock-free single producer single consumer ring in POSIX shared memory
+// per (src, dst) pair, and DoRead copies the src regst directly from the peer process by
+// process_vm_readv.
+class ShmCommNet final : public CommNetIf<SocketMemDesc> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShmCommNet);
+  ~ShmCommNet();
+
+  void RegisterMemoryDone() override;
+
+  void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
+
+ private:
+  struct ShmRing;
+  struct ShmPeer;
+
+  SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
+
+  friend class Global<ShmCommNet>;
+  ShmCommNet();
+  void InitShmPeers();
+  void PollRecvRings();
+  ShmPeer* FindShmPeer(int64_t machine_id) const;
+  void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
+
+  std::vector<std::unique_ptr<ShmPeer>> machine_id2shm_peer_;
+  std::unique_ptr<ThreadPool> read_thread_pool_;
+  std::atomic<bool> stop_polling_;
+  std::thread ring_poller_;
+};
+
+}  // namespace oneflow
+
+#endif  // OF_PLATFORM_POSIX
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
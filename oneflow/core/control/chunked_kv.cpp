@@ -0,0 +1,155 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/control/chunked_kv.h"
+#include "oneflow/core/control/chunked_kv.pb.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <lz4.h>
+
+namespace oneflow {
+
+namespace {
+
+struct Chunk {
+  size_t value_idx;
+  int64_t chunk_idx;
+  size_t offset;
+  size_t byte_size;
+};
+
+std::string MetaKey(const std::string& key) { return key + "/meta"; }
+
+std::string ChunkKey(const std::string& key, int64_t chunk_idx) {
+  return key + "/chunk_" + std::to_string(chunk_idx);
+}
+
+std::vector<Chunk> SplitChunks(const std::vector<ChunkedKVMeta>& metas) {
+  std::vector<Chunk> chunks;
+  FOR_RANGE(size_t, value_idx, 0, metas.size()) {
+    size_t offset = 0;
+    FOR_RANGE(int64_t, chunk_idx, 0, metas.at(value_idx).chunk_byte_size_size()) {
+      const size_t byte_size = metas.at(value_idx).chunk_byte_size(chunk_idx);
+      chunks.push_back(Chunk{value_idx, chunk_idx, offset, byte_size});
+      offset += byte_size;
+    }
+    CHECK_EQ(offset, metas.at(value_idx).byte_size());
+  }
+  return chunks;
+}
+
+void CompressChunk(const char* data, size_t byte_size, std::string* out) {
+  out->resize(LZ4_compressBound(byte_size));
+  const int compressed_size = LZ4_compress_default(data, &out->at(0), byte_size, out->size());
+  CHECK_GT(compressed_size, 0);
+  out->resize(compressed_size);
+}
+
+void DecompressChunk(const std::string& in, char* data, size_t byte_size) {
+  const int decompressed_size = LZ4_decompress_safe(in.data(), data, in.size(), byte_size);
+  CHECK_EQ(decompressed_size, byte_size);
+}
+
+}  // namespace
+
+size_t ChunkedKVUtil::PushKVs(const std::vector<std::pair<std::string, const PbMessage*>>& key7msgs,
+                              size_t chunk_byte_size, bool compress) {
+  CHECK_GT(chunk_byte_size, 0);
+  CHECK_LE(chunk_byte_size, LZ4_MAX_INPUT_SIZE);
+  std::vector<std::string> values(key7msgs.size());
+  MultiThreadLoop(key7msgs.size(), [&](size_t i) {
+    CHECK(key7msgs.at(i).second->SerializeToString(&values.at(i)));
+  });
+  std::vector<ChunkedKVMeta> metas(key7msgs.size());
+  FOR_RANGE(size_t, i, 0, values.size()) {
+    metas.at(i).set_byte_size(values.at(i).size());
+    metas.at(i).set_compressed(compress);
+    for (size_t offset = 0; offset < values.at(i).size(); offset += chunk_byte_size) {
+      metas.at(i).add_chunk_byte_size(std::min(chunk_byte_size, values.at(i).size() - offset));
+    }
+  }
+  const std::vector<Chunk> chunks = SplitChunks(metas);
+  std::atomic<size_t> pushed_byte_size(0);
+  MultiThreadLoop(chunks.size(), [&](size_t i) {
+    const Chunk& chunk = chunks.at(i);
+    const char* data = values.at(chunk.value_idx).data() + chunk.offset;
+    Global<CtrlClient>::Get()->PushKV(
+        ChunkKey(key7msgs.at(chunk.value_idx).first, chunk.chunk_idx), [&](std::string* out) {
+          if (compress) {
+            CompressChunk(data, chunk.byte_size, out);
+          } else {
+            out->assign(data, chunk.byte_size);
+          }
+          pushed_byte_size += out->size();
+        });
+  });
+  // metas are pushed last, so the chunks are complete once a meta can be pulled
+  FOR_RANGE(size_t, i, 0, key7msgs.size()) {
+    Global<CtrlClient>::Get()->PushKV(MetaKey(key7msgs.at(i).first), metas.at(i));
+  }
+  return pushed_byte_size;
+}
+
+size_t ChunkedKVUtil::PullKVs(const std::vector<std::pair<std::string, PbMessage*>>& key7msgs,
+                              const std::vector<std::string>& relay_keys) {
+  CHECK(relay_keys.empty() || relay_keys.size() == key7msgs.size());
+  std::vector<ChunkedKVMeta> metas(key7msgs.size());
+  MultiThreadLoop(key7msgs.size(), [&](size_t i) {
+    Global<CtrlClient>::Get()->PullKV(MetaKey(key7msgs.at(i).first), &metas.at(i));
+  });
+  std::vector<std::string> values(key7msgs.size());
+  FOR_RANGE(size_t, i, 0, values.size()) { values.at(i).resize(metas.at(i).byte_size()); }
+  const std::vector<Chunk> chunks = SplitChunks(metas);
+  std::atomic<size_t> pulled_byte_size(0);
+  MultiThreadLoop(chunks.size(), [&](size_t i) {
+    const Chunk& chunk = chunks.at(i);
+    char* data = &values.at(chunk.value_idx).at(chunk.offset);
+    Global<CtrlClient>::Get()->PullKV(
+        ChunkKey(key7msgs.at(chunk.value_idx).first, chunk.chunk_idx),
+        [&](const std::string& in) {
+          if (metas.at(chunk.value_idx).compressed()) {
+            DecompressChunk(in, data, chunk.byte_size);
+          } else {
+            CHECK_EQ(in.size(), chunk.byte_size);
+            std::memcpy(data, in.data(), chunk.byte_size);
+          }
+          pulled_byte_size += in.size();
+          if (!relay_keys.empty()) {
+            Global<CtrlClient>::Get()->PushKV(
+                ChunkKey(relay_keys.at(chunk.value_idx), chunk.chunk_idx), in);
+          }
+        });
+  });
+  FOR_RANGE(size_t, i, 0, relay_keys.size()) {
+    Global<CtrlClient>::Get()->PushKV(MetaKey(relay_keys.at(i)), metas.at(i));
+  }
+  MultiThreadLoop(key7msgs.size(), [&](size_t i) {
+    CHECK(key7msgs.at(i).second->ParseFromString(values.at(i)));
+  });
+  return pulled_byte_size;
+}
+
+void ChunkedKVUtil::ClearKVs(const std::vector<std::string>& keys) {
+  MultiThreadLoop(keys.size(), [&](size_t i) {
+    ChunkedKVMeta meta;
+    Global<CtrlClient>::Get()->PullKV(MetaKey(keys.at(i)), &meta);
+    FOR_RANGE(int64_t, chunk_idx, 0, meta.chunk_byte_size_size()) {
+      Global<CtrlClient>::Get()->ClearKV(ChunkKey(keys.at(i), chunk_idx));
+    }
+    Global<CtrlClient>::Get()->ClearKV(MetaKey(keys.at(i)));
+  });
+}
+
+}  // namespace oneflow
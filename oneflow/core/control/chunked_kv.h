@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_CONTROL_CHUNKED_KV_H_
+#define ONEFLOW_CORE_CONTROL_CHUNKED_KV_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/protobuf.h"
+
+namespace oneflow {
+
+// Large values in the ctrl KV store. A value is split into chunks, each optionally compressed by
+// lz4 and stored under its own key, so the chunks of a value spread over all ctrl servers. The
+// batch functions push or pull all chunks of all values in parallel on Global<ThreadPool> and
+// return the number of bytes transferred.
+struct ChunkedKVUtil {
+  static size_t PushKVs(const std::vector<std::pair<std::string, const PbMessage*>>& key7msgs,
+                        size_t chunk_byte_size, bool compress);
+  // if relay_keys is not empty, the pulled chunks of key7msgs.at(i) are also pushed as they are
+  // under relay_keys.at(i) for others to pull
+  static size_t PullKVs(const std::vector<std::pair<std::string, PbMessage*>>& key7msgs,
+                        const std::vector<std::string>& relay_keys);
+  static void ClearKVs(const std::vector<std::string>& keys);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_CONTROL_CHUNKED_KV_H_
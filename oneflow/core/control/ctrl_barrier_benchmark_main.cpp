@@ -0,0 +1,160 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/env.pb.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/ctrl_server.h"
+#include "oneflow/core/control/ctrl_bootstrap.h"
+#include "oneflow/core/control/ctrl_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+
+#include <iomanip>
+
+#ifdef OF_PLATFORM_POSIX
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace {
+
+EnvProto GetEnvProto(int64_t rank, int64_t rank_num, int32_t ctrl_port, int32_t fanout) {
+  EnvProto ret;
+  ret.set_ctrl_port(ctrl_port);
+  ret.set_ctrl_tree_fanout(fanout);
+  BootstrapConf* bootstrap_conf = ret.mutable_ctrl_bootstrap_conf();
+  bootstrap_conf->mutable_master_addr()->set_host("127.0.0.1");
+  bootstrap_conf->mutable_master_addr()->set_port(ctrl_port);
+  bootstrap_conf->set_rank(rank);
+  bootstrap_conf->set_world_size(rank_num);
+  bootstrap_conf->set_host("127.0.0.1");
+  if (rank == 0) { bootstrap_conf->set_ctrl_port(ctrl_port); }
+  return ret;
+}
+
+// microseconds per call of Run, measured on rank 0
+double MeasureMicroseconds(int64_t iter_num, const std::function<void(int64_t)>& Run) {
+  Global<CtrlClient>::Get()->Barrier("BarrierBenchmark/Start");
+  const double start = GetCurTime();
+  FOR_RANGE(int64_t, i, 0, iter_num) { Run(i); }
+  Global<CtrlClient>::Get()->Barrier("BarrierBenchmark/End");
+  return (GetCurTime() - start) / 1e3 / iter_num;
+}
+
+Maybe<void> RunRank(int64_t rank, int64_t rank_num, int32_t ctrl_port, int32_t fanout,
+                    int64_t iter_num) {
+  Global<EnvDesc>::New(GetEnvProto(rank, rank_num, ctrl_port, fanout));
+  Global<CtrlServer>::New(rank == 0 ? ctrl_port : 0);
+  Global<ProcessCtx>::New();
+  JUST(RankInfoCtrlBootstrap(Global<EnvDesc>::Get()->bootstrap_conf())
+           .InitProcessCtx(Global<CtrlServer>::Get()->port(), Global<ProcessCtx>::Get()));
+  Global<CtrlClient>::New(*Global<ProcessCtx>::Get());
+  CtrlClient* client = Global<CtrlClient>::Get();
+
+  const double flat_barrier_us =
+      MeasureMicroseconds(iter_num, [&](int64_t) { client->Barrier("FlatBarrier", rank_num); });
+  const double tree_barrier_us =
+      MeasureMicroseconds(iter_num, [&](int64_t) { client->TreeBarrier("TreeBarrier"); });
+  const auto KVKey = [](const std::string& prefix, int64_t i) {
+    return "BarrierBenchmark/" + prefix + "/" + std::to_string(i);
+  };
+  const double master_kv_us = MeasureMicroseconds(iter_num, [&](int64_t i) {
+    Address msg;
+    if (rank == 0) {
+      client->PushMasterKV(KVKey("MasterKV", i), msg);
+    } else {
+      client->PullMasterKV(KVKey("MasterKV", i), &msg);
+    }
+  });
+  const double broadcast_kv_us = MeasureMicroseconds(iter_num, [&](int64_t i) {
+    Address msg;
+    if (rank == 0) {
+      client->PushBroadcastKV(KVKey("BroadcastKV", i), msg);
+    } else {
+      client->PullBroadcastKV(KVKey("BroadcastKV", i), &msg);
+    }
+  });
+  FOR_RANGE(int64_t, i, 0, iter_num) {
+    if (rank == 0) { client->ClearMasterKV(KVKey("MasterKV", i)); }
+    client->ClearBroadcastKV(KVKey("BroadcastKV", i));
+  }
+  if (rank == 0) {
+    std::cout << std::setw(10) << std::left << rank_num << std::setw(20) << std::left
+              << flat_barrier_us << std::setw(20) << std::left << tree_barrier_us << std::setw(20)
+              << std::left << master_kv_us << std::setw(20) << std::left << broadcast_kv_us
+              << std::endl;
+  }
+  client->Barrier("BarrierBenchmark/Exit");
+
+  Global<CtrlClient>::Delete();
+  Global<ProcessCtx>::Delete();
+  Global<CtrlServer>::Delete();
+  Global<EnvDesc>::Delete();
+  return Maybe<void>::Ok();
+}
+
+// every rank is a child process, so that the parent never initializes grpc before forking
+void RunBarrierBenchmark(int64_t rank_num, int32_t fanout, int64_t iter_num) {
+  const int port = CtrlUtil().FindAvailablePort();
+  CHECK_NE(port, -1);
+  std::vector<pid_t> pids;
+  FOR_RANGE(int64_t, rank, 0, rank_num) {
+    const pid_t pid = fork();
+    PCHECK(pid != -1);
+    if (pid == 0) {
+      CHECK_JUST(RunRank(rank, rank_num, port, fanout, iter_num));
+      _exit(0);
+    }
+    pids.push_back(pid);
+  }
+  for (pid_t pid : pids) {
+    int status = 0;
+    PCHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "rank process " << pid << " failed";
+  }
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+/*
+ * Try run this benchmark exe by :
+ *     ./ctrl_barrier_benchmark -max_rank_num=64 -fanout=8 -iter_num=100
+ */
+DEFINE_int64(max_rank_num, 64, "rank numbers 2, 4, ... up to this are measured");
+DEFINE_int32(fanout, 8, "ctrl_tree_fanout of the env");
+DEFINE_int64(iter_num, 100, "number of barriers or broadcasts for each rank number");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  std::cout << std::setw(10) << std::left << "#ranks" << std::setw(20) << std::left
+            << "#flat barrier[us]" << std::setw(20) << std::left << "#tree barrier[us]"
+            << std::setw(20) << std::left << "#master kv[us]" << std::setw(20) << std::left
+            << "#broadcast kv[us]" << std::endl;
+  for (int64_t rank_num = 2; rank_num <= FLAGS_max_rank_num; rank_num *= 2) {
+    RunBarrierBenchmark(rank_num, FLAGS_fanout, FLAGS_iter_num);
+  }
+  return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) { return 0; }
+
+#endif  // OF_PLATFORM_POSIX
@@ -40,10 +40,10 @@ class CtrlClient final : public RpcClient {
 
 #define FILE_LINE_STR __FILE__ ":" OF_PP_STRINGIZE(__LINE__)
 
-#define OF_ENV_BARRIER() Global<CtrlClient>::Get()->Barrier(FILE_LINE_STR)
-#define OF_SESSION_BARRIER()                        \
-  Global<CtrlClient>::Get()->Barrier(FILE_LINE_STR, \
-                                     Global<ResourceDesc, ForSession>::Get()->TotalMachineNum())
+#define OF_ENV_BARRIER() Global<CtrlClient>::Get()->TreeBarrier(FILE_LINE_STR)
+#define OF_SESSION_BARRIER()                            \
+  Global<CtrlClient>::Get()->TreeBarrier(FILE_LINE_STR, \
+                                         Global<ResourceDesc, ForSession>::Get()->TotalMachineNum())
 
 static void OfCallOnce(const std::string& name, std::function<void()> f) {
   TryLockResult lock_ret = Global<CtrlClient>::Get()->TryLock(name);
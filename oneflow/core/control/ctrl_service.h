@@ -41,7 +41,7 @@ namespace oneflow {
   OF_PP_MAKE_TUPLE_SEQ(PushKV)        \
   OF_PP_MAKE_TUPLE_SEQ(ClearKV)       \
   OF_PP_MAKE_TUPLE_SEQ(PullKV)        \
-  OF_PP_MAKE_TUPLE_SEQ(PushActEvent)  \
+  OF_PP_MAKE_TUPLE_SEQ(PushActEvents) \
   OF_PP_MAKE_TUPLE_SEQ(Clear)         \
   OF_PP_MAKE_TUPLE_SEQ(IncreaseCount) \
   OF_PP_MAKE_TUPLE_SEQ(EraseCount)
@@ -45,6 +45,23 @@ class ClientCall final {
   CtrlResponse<ctrl_method> response_;
 };
 
+void BarrierOn(CtrlService::Stub* stub, const std::string& barrier_name, int32_t barrier_num) {
+  ClientCall<CtrlMethod::kBarrier> call;
+  call.mut_request()->set_name(barrier_name);
+  call.mut_request()->set_num(barrier_num);
+  call(stub);
+}
+
+// ranks form a complete tree of the fanout rooted at rank 0
+int64_t TreeParent(int64_t rank, int64_t fanout) { return (rank - 1) / fanout; }
+
+int64_t TreeChildNum(int64_t rank, int64_t rank_num, int64_t fanout) {
+  const int64_t first_child = rank * fanout + 1;
+  return std::max<int64_t>(std::min<int64_t>(rank_num, first_child + fanout) - first_child, 0);
+}
+
+std::string GetBroadcastKVKey(const std::string& k) { return "BroadcastKV/" + k; }
+
 }  // namespace
 
 void RpcClient::Barrier(const std::string& barrier_name) {
@@ -52,10 +69,35 @@ void RpcClient::Barrier(const std::string& barrier_name) {
 }
 
 void RpcClient::Barrier(const std::string& barrier_name, int32_t barrier_num) {
-  ClientCall<CtrlMethod::kBarrier> call;
-  call.mut_request()->set_name(barrier_name);
-  call.mut_request()->set_num(barrier_num);
-  call(GetMasterStub());
+  BarrierOn(GetMasterStub(), barrier_name, barrier_num);
+}
+
+void RpcClient::TreeBarrier(const std::string& barrier_name) {
+  TreeBarrier(barrier_name, Global<EnvDesc>::Get()->TotalMachineNum());
+}
+
+void RpcClient::TreeBarrier(const std::string& barrier_name, int32_t rank_num) {
+  const int64_t fanout = Global<EnvDesc>::Get()->ctrl_tree_fanout();
+  // a tree of one level only adds a round trip
+  if (fanout <= 0 || rank_num <= fanout + 1) {
+    Barrier(barrier_name, rank_num);
+    return;
+  }
+  const int64_t rank = GlobalProcessCtx::Rank();
+  CHECK_LT(rank, rank_num);
+  const int64_t child_num = TreeChildNum(rank, rank_num, fanout);
+  // every rank waits for the subtrees of its children, reports to its parent and waits there
+  // until the root got all ranks, then releases its children
+  const std::string gather_name = barrier_name + "/gather";
+  const std::string release_name = barrier_name + "/release";
+  if (child_num > 0) { BarrierOn(GetStub(rank), gather_name, child_num + 1); }
+  if (rank > 0) {
+    const int64_t parent = TreeParent(rank, fanout);
+    const int64_t parent_barrier_num = TreeChildNum(parent, rank_num, fanout) + 1;
+    BarrierOn(GetStub(parent), gather_name, parent_barrier_num);
+    BarrierOn(GetStub(parent), release_name, parent_barrier_num);
+  }
+  if (child_num > 0) { BarrierOn(GetStub(rank), release_name, child_num + 1); }
 }
 
 TryLockResult RpcClient::TryLock(const std::string& name) {
@@ -150,9 +192,45 @@ void RpcClient::PullMasterKV(const std::string& k, PbMessage* msg) {
   PullMasterKV(k, [&](const std::string& i) { msg->ParseFromString(i); });
 }
 
-void RpcClient::PushActEvent(const ActEvent& act_event) {
-  ClientCall<CtrlMethod::kPushActEvent> call;
-  *(call.mut_request()->mutable_act_event()) = act_event;
+void RpcClient::PushBroadcastKV(const std::string& k, const PbMessage& msg) {
+  CHECK_EQ(GlobalProcessCtx::Rank(), 0);
+  ClientCall<CtrlMethod::kPushKV> call;
+  call.mut_request()->set_key(GetBroadcastKVKey(k));
+  msg.SerializeToString(call.mut_request()->mutable_val());
+  call(GetMasterStub());
+}
+
+void RpcClient::PullBroadcastKV(const std::string& k, PbMessage* msg) {
+  const int64_t rank = GlobalProcessCtx::Rank();
+  CHECK_GT(rank, 0);
+  const int64_t fanout = Global<EnvDesc>::Get()->ctrl_tree_fanout();
+  const int64_t rank_num = Global<EnvDesc>::Get()->TotalMachineNum();
+  ClientCall<CtrlMethod::kPullKV> pull_call;
+  pull_call.mut_request()->set_key(GetBroadcastKVKey(k));
+  pull_call(GetStub(fanout > 0 ? TreeParent(rank, fanout) : 0));
+  if (fanout > 0 && TreeChildNum(rank, rank_num, fanout) > 0) {
+    ClientCall<CtrlMethod::kPushKV> push_call;
+    push_call.mut_request()->set_key(GetBroadcastKVKey(k));
+    push_call.mut_request()->set_val(pull_call.response().val());
+    push_call(GetThisStub());
+  }
+  msg->ParseFromString(pull_call.response().val());
+}
+
+void RpcClient::ClearBroadcastKV(const std::string& k) {
+  const int64_t rank = GlobalProcessCtx::Rank();
+  const int64_t fanout = Global<EnvDesc>::Get()->ctrl_tree_fanout();
+  const int64_t rank_num = Global<EnvDesc>::Get()->TotalMachineNum();
+  if (rank == 0 || (fanout > 0 && TreeChildNum(rank, rank_num, fanout) > 0)) {
+    ClientCall<CtrlMethod::kClearKV> call;
+    call.mut_request()->set_key(GetBroadcastKVKey(k));
+    call(GetThisStub());
+  }
+}
+
+void RpcClient::PushActEvents(const std::string& act_event_records) {
+  ClientCall<CtrlMethod::kPushActEvents> call;
+  call.mut_request()->set_act_event_records(act_event_records);
   call(GetMasterStub());
 }
 
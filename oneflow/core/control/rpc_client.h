@@ -30,6 +30,10 @@ class RpcClient {
 
   void Barrier(const std::string& barrier_name);
   void Barrier(const std::string& barrier_name, int32_t barrier_num);
+  // Collective over the ranks [0, rank_num), every rank calls it exactly once. The ranks meet in
+  // a tree of ctrl servers so that no server serves more than ctrl_tree_fanout + 1 of them.
+  void TreeBarrier(const std::string& barrier_name);
+  void TreeBarrier(const std::string& barrier_name, int32_t rank_num);
 
   TryLockResult TryLock(const std::string& name);
   void NotifyDone(const std::string& name);
@@ -51,6 +55,12 @@ class RpcClient {
   void PullKV(const std::string& k, std::string* v);
   void PullKV(const std::string& k, PbMessage* msg);
   void PullMasterKV(const std::string& k, PbMessage* msg);
+  // The master pushes a value pulled by all the other ranks. Ranks pull it from their parent in
+  // the tree and keep a copy on their own ctrl server for their children, which is removed by
+  // ClearBroadcastKV on every rank.
+  void PushBroadcastKV(const std::string& k, const PbMessage& msg);
+  void PullBroadcastKV(const std::string& k, PbMessage* msg);
+  void ClearBroadcastKV(const std::string& k);
   template<typename T>
   typename std::enable_if<std::is_arithmetic<T>::value>::type PullKVT(const std::string& k, T* v) {
     std::string v_str;
@@ -58,7 +68,7 @@ class RpcClient {
     *v = oneflow_cast<T>(v_str);
   }
 
-  void PushActEvent(const ActEvent&);
+  void PushActEvents(const std::string& act_event_records);
   void Clear();
 
   int32_t IncreaseCount(const std::string& k, int32_t v);
@@ -74,6 +84,7 @@ class RpcClient {
   CtrlService::Stub* GetMasterStub() { return stubs_[0].get(); }
   CtrlService::Stub* GetThisStub();
   CtrlService::Stub* GetResponsibleStub(const std::string& key);
+  CtrlService::Stub* GetStub(int64_t rank) { return stubs_.at(rank).get(); }
 
   std::vector<std::unique_ptr<CtrlService::Stub>> stubs_;
   std::mutex done_names_mtx_;
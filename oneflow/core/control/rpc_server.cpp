@@ -167,11 +167,11 @@ void RpcServer::Init() {
     EnqueueRequest<CtrlMethod::kPullKV>();
   });
 
-  Add([this](CtrlCall<CtrlMethod::kPushActEvent>* call) {
-    ActEvent act_event = call->request().act_event();
+  Add([this](CtrlCall<CtrlMethod::kPushActEvents>* call) {
+    Global<ActEventLogger>::Get()->PrintActEventRecordsToLogDir(
+        call->request().act_event_records());
     call->SendResponse();
-    Global<ActEventLogger>::Get()->PrintActEventToLogDir(act_event);
-    EnqueueRequest<CtrlMethod::kPushActEvent>();
+    EnqueueRequest<CtrlMethod::kPushActEvents>();
   });
 
   Add([this](CtrlCall<CtrlMethod::kClear>* call) {
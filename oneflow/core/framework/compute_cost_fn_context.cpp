@@ -0,0 +1,68 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/compute_cost_fn_context.h"
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace user_op {
+
+namespace {
+
+int64_t ElemCnt4Args(const ComputeCostFnContext* ctx,
+                     const std::vector<std::pair<std::string, int32_t>>& args) {
+  int64_t elem_cnt = 0;
+  for (const auto& pair : args) {
+    elem_cnt += ctx->TensorDesc4ArgNameAndIndex(pair.first, pair.second)->shape().elem_cnt();
+  }
+  return elem_cnt;
+}
+
+int64_t ByteSize4Args(const ComputeCostFnContext* ctx,
+                      const std::vector<std::pair<std::string, int32_t>>& args) {
+  int64_t byte_size = 0;
+  for (const auto& pair : args) {
+    const TensorDesc* tensor_desc = ctx->TensorDesc4ArgNameAndIndex(pair.first, pair.second);
+    byte_size += tensor_desc->shape().elem_cnt() * GetSizeOfDataType(tensor_desc->data_type());
+  }
+  return byte_size;
+}
+
+}  // namespace
+
+Maybe<void> ComputeCostFnUtil::Elementwise(ComputeCostFnContext* ctx) {
+  JUST(MemoryOnly(ctx));
+  ctx->mut_compute_cost()->flops = ElemCnt4Args(ctx, ctx->outputs());
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> ComputeCostFnUtil::Reduce(ComputeCostFnContext* ctx) {
+  JUST(MemoryOnly(ctx));
+  ctx->mut_compute_cost()->flops = ElemCnt4Args(ctx, ctx->inputs());
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> ComputeCostFnUtil::MemoryOnly(ComputeCostFnContext* ctx) {
+  ComputeCost* cost = ctx->mut_compute_cost();
+  cost->flops = 0;
+  cost->read_bytes = ByteSize4Args(ctx, ctx->inputs());
+  cost->written_bytes = ByteSize4Args(ctx, ctx->outputs());
+  return Maybe<void>::Ok();
+}
+
+}  // namespace user_op
+
+}  // namespace oneflow
@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_COMPUTE_COST_FN_CONTEXT_H_
+#define ONEFLOW_CORE_FRAMEWORK_COMPUTE_COST_FN_CONTEXT_H_
+
+#include "oneflow/core/framework/user_op_conf.h"
+#include "oneflow/core/framework/tensor_desc.h"
+#include "oneflow/core/operator/compute_cost.h"
+
+namespace oneflow {
+
+namespace user_op {
+
+class ComputeCostFnContext {
+ public:
+  ComputeCostFnContext() = default;
+  virtual ~ComputeCostFnContext() = default;
+  ComputeCostFnContext(const ComputeCostFnContext&) = delete;
+
+  virtual const TensorDesc* TensorDesc4ArgNameAndIndex(const std::string& arg_name,
+                                                       int32_t index) const = 0;
+  virtual const std::vector<std::pair<std::string, int32_t>>& inputs() const = 0;
+  virtual const std::vector<std::pair<std::string, int32_t>>& outputs() const = 0;
+  virtual const UserOpConfWrapper& user_op_conf() const = 0;
+  virtual ComputeCost* mut_compute_cost() = 0;
+
+  template<typename T>
+  T Attr(const std::string& attr_name) const {
+    return user_op_conf().attr<T>(attr_name);
+  }
+};
+
+struct ComputeCostFnUtil {
+  // one operation per output element, every input read and every output written once
+  static Maybe<void> Elementwise(ComputeCostFnContext*);
+  // one operation per input element, every input read and every output written once
+  static Maybe<void> Reduce(ComputeCostFnContext*);
+  // bytes of all the inputs and outputs, leaving flops as zero
+  static Maybe<void> MemoryOnly(ComputeCostFnContext*);
+};
+
+}  // namespace user_op
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_COMPUTE_COST_FN_CONTEXT_H_
@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/framework/infer_util.h"
 #include "oneflow/core/framework/sbp_context.h"
 #include "oneflow/core/framework/infer_output_blob_time_shape_fn_context.h"
+#include "oneflow/core/framework/compute_cost_fn_context.h"
 #include "oneflow/core/framework/user_op_hob.h"
 
 #include "oneflow/core/framework/tensor_desc.h"
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/attr_value.h"
 #include "oneflow/core/framework/attr_value_accessor.h"
 #include "oneflow/core/framework/sbp_context.h"
+#include "oneflow/core/framework/compute_cost_fn_context.h"
 
 namespace oneflow {
 
@@ -187,6 +188,11 @@ OpRegistry& OpRegistry::SetInferOutputBlobTimeShapeFn(
   return *this;
 }
 
+OpRegistry& OpRegistry::SetComputeCostFn(ComputeCostFn compute_cost_fn) {
+  result_.compute_cost_fn = std::move(compute_cost_fn);
+  return *this;
+}
+
 OpRegistry& OpRegistry::Finish() {
   CHECK(result_.logical_tensor_desc_infer_fn != nullptr)
       << "No logical TensorDescInfer function for " << result_.op_type_name;
@@ -202,6 +208,9 @@ OpRegistry& OpRegistry::Finish() {
   if (result_.output_arg_modify_fn == nullptr) {
     result_.output_arg_modify_fn = [](GetOutputArgModifier, const UserOpConfWrapper&) {};
   }
+  if (result_.compute_cost_fn == nullptr) {
+    result_.compute_cost_fn = ComputeCostFnUtil::Elementwise;
+  }
   return *this;
 }
 
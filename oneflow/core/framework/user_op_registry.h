@@ -33,6 +33,7 @@ class InferContext;
 class SbpContext;
 class InferSbpSignatureFnContext;
 class InferOutputBlobTimeShapeFnContext;
+class ComputeCostFnContext;
 
 using CheckAttrFn = std::function<Maybe<void>(const UserOpDefWrapper&, const UserOpConfWrapper&)>;
 using TensorDescInferFn = std::function<Maybe<void>(InferContext*)>;
@@ -47,6 +48,7 @@ using GetOutputArgModifier =
     std::function<OutputArgModifier*(const std::string& out_arg_name, int32_t out_arg_index)>;
 using OutputArgModifyFn = std::function<void(GetOutputArgModifier, const UserOpConfWrapper&)>;
 using InferOutputBlobTimeShapeFn = std::function<Maybe<void>(InferOutputBlobTimeShapeFnContext*)>;
+using ComputeCostFn = std::function<Maybe<void>(ComputeCostFnContext*)>;
 
 struct OpRegistryResult {
   OpRegistryResult() : cpu_only_supported(false), same_output_regst_num(-1) {}
@@ -66,6 +68,7 @@ struct OpRegistryResult {
   InputArgModifyFn input_arg_modify_fn;
   OutputArgModifyFn output_arg_modify_fn;
   InferOutputBlobTimeShapeFn infer_output_blob_time_shape_fn;
+  ComputeCostFn compute_cost_fn;
 };
 
 class OpRegistry final {
@@ -107,6 +110,7 @@ class OpRegistry final {
   OpRegistry& SetOutputArgModifyFn(OutputArgModifyFn fn);
   OpRegistry& SetInferOutputBlobTimeShapeFn(InferOutputBlobTimeShapeFn fn);
   OpRegistry& SetCheckAttrFn(CheckAttrFn fn);
+  OpRegistry& SetComputeCostFn(ComputeCostFn fn);
 
   OpRegistry& Finish();
   OpRegistryResult GetResult() { return result_; }
@@ -24,6 +24,8 @@ limitations under the License.
 #include "oneflow/core/common/id_util.h"
 #include "oneflow/core/graph/id_serialization.h"
 #include "oneflow/core/device/cuda_stream_index.h"
+#include "oneflow/core/device/cpu_stream_index.h"
+#include "oneflow/core/job/distribute_hirarchy.pb.h"
 #ifdef WITH_CUDA
 #include <nccl.h>
 #endif
@@ -34,13 +36,13 @@ using namespace boxing::collective;
 
 namespace {
 
-void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
-                            const ParallelDesc& parallel_desc, int64_t parallel_id,
-                            const std::string& name, const LogicalBlobId& lbi,
-                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+OperatorConf GenCollectiveBoxingOpConf(const ParallelDesc& parallel_desc, int64_t parallel_id,
+                                       const std::string& name, const LogicalBlobId& lbi,
+                                       const BlobDesc& logical_blob_desc, OpType op_type,
+                                       int64_t root, Backend backend) {
   OperatorConf op_conf;
   op_conf.set_name(name);
-  op_conf.set_device_tag(CHECK_JUST(DeviceTag4DeviceType(DeviceType::kGPU)));
+  op_conf.set_device_tag(CHECK_JUST(DeviceTag4DeviceType(parallel_desc.device_type())));
   CollectiveBoxingGenericOpConf* conf = op_conf.mutable_collective_boxing_generic_conf();
   *conf->mutable_lbi() = lbi;
   RankDesc* rank_desc = conf->mutable_rank_desc();
@@ -61,9 +63,18 @@ void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
   } else {
     CHECK_EQ(root, -1);
   }
-  op_desc->set_backend(Backend::kBackendNCCL);
+  op_desc->set_backend(backend);
   rank_desc->set_rank(parallel_id);
+  return op_conf;
+}
 
+void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
+                            const ParallelDesc& parallel_desc, int64_t parallel_id,
+                            const std::string& name, const LogicalBlobId& lbi,
+                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+  const OperatorConf op_conf =
+      GenCollectiveBoxingOpConf(parallel_desc, parallel_id, name, lbi, logical_blob_desc, op_type,
+                                root, Backend::kBackendNCCL);
   const int64_t machine_id = CHECK_JUST(parallel_desc.MachineId4ParallelId(parallel_id));
   const int64_t device_index = CHECK_JUST(parallel_desc.DeviceId4ParallelId(parallel_id));
   DeviceId device_id{static_cast<DeviceId::rank_t>(machine_id), DeviceType::kGPU,
@@ -76,6 +87,25 @@ void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
   node->Init(machine_id, thrd_id, op_conf);
 }
 
+// all cpu ranks of a machine share one independent stream, their kernels only enqueue requests
+void CpuInitCollectiveNode(CollectiveBoxingGenericTaskNode* node, const ParallelDesc& parallel_desc,
+                           int64_t parallel_id, const std::string& name, const LogicalBlobId& lbi,
+                           const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+  const OperatorConf op_conf =
+      GenCollectiveBoxingOpConf(parallel_desc, parallel_id, name, lbi, logical_blob_desc, op_type,
+                                root, Backend::kBackendCPU);
+  const int64_t machine_id = CHECK_JUST(parallel_desc.MachineId4ParallelId(parallel_id));
+  DeviceId device_id{static_cast<DeviceId::rank_t>(machine_id), DeviceType::kCPU,
+                     DeviceId::kCPUDeviceIndex};
+  auto* stream_index_generator = dynamic_cast<CPUStreamIndexGenerator*>(
+      Global<IDMgr>::Get()->GetStreamIndexGeneratorManager()->GetGenerator(device_id));
+  CHECK_NOTNULL(stream_index_generator);
+  auto stream_index = stream_index_generator->GenerateIndependentTaskStreamIndex(
+      TaskType::kCollectiveBoxingGeneric);
+  const int64_t thrd_id = SerializeStreamIdToInt64(StreamId{device_id, stream_index});
+  node->Init(machine_id, thrd_id, op_conf);
+}
+
 int64_t FindRootParallelId(const ParallelDesc& multi_device, const ParallelDesc& sole_device) {
   CHECK_EQ(sole_device.parallel_num(), 1);
   const int64_t root_machine_id = CHECK_JUST(sole_device.MachineId4ParallelId(0));
@@ -93,6 +123,45 @@ int64_t FindRootParallelId(const ParallelDesc& multi_device, const ParallelDesc&
 
 bool IsSourceTimeShape(const Shape& shape) { return shape.elem_cnt() == 1; }
 
+// machines as the outer dim and the devices of each machine as the inner dim, fails unless every
+// machine holds the same number of devices
+bool TryGetMachineDeviceHirarchy(const ParallelDesc& parallel_desc,
+                                 const SbpParallel& sbp_parallel, DistributeHirarchy* hirarchy) {
+  const int64_t machine_num = parallel_desc.sorted_machine_ids().size();
+  if (parallel_desc.parallel_num() % machine_num != 0) { return false; }
+  const int64_t device_num_of_each_machine = parallel_desc.parallel_num() / machine_num;
+  for (const int64_t machine_id : parallel_desc.sorted_machine_ids()) {
+    if (parallel_desc.sorted_dev_phy_ids(machine_id).size() != device_num_of_each_machine) {
+      return false;
+    }
+  }
+  hirarchy->Clear();
+  for (const int64_t distribute_num : {machine_num, device_num_of_each_machine}) {
+    DistributeDim* dim = hirarchy->add_dim();
+    dim->set_distribute_type(DistributeType::kSpaceDistribute);
+    *dim->mutable_sbp_parallel() = sbp_parallel;
+    dim->set_distribute_num(distribute_num);
+  }
+  return true;
+}
+
+// estimated bytes sent over each inter-node link by a flat ring all-reduce and by the
+// hierarchical one, whose inter-node rings only carry 1/D of the blob each
+std::string AllReduceInterNodeCostComment(const DistributeHirarchy& hirarchy,
+                                          const BlobDesc& logical_blob_desc) {
+  const int64_t machine_num = hirarchy.dim(0).distribute_num();
+  const int64_t device_num = hirarchy.dim(1).distribute_num();
+  const int64_t rank_num = machine_num * device_num;
+  const double size = static_cast<double>(logical_blob_desc.shape().elem_cnt()
+                                          * GetSizeOfDataType(logical_blob_desc.data_type()));
+  const double flat_bytes = 2.0 * (rank_num - 1) / rank_num * size;
+  const double hierarchical_bytes = 2.0 * (machine_num - 1) / machine_num * size / device_num;
+  return "machine_num:" + std::to_string(machine_num) + " device_num:"
+         + std::to_string(device_num) + " flat_inter_node_bytes:"
+         + std::to_string(static_cast<int64_t>(flat_bytes)) + " hierarchical_inter_node_bytes:"
+         + std::to_string(static_cast<int64_t>(hierarchical_bytes));
+}
+
 class NcclCollectiveBoxingAllReduceSubTskGphBuilder final : public SubTskGphBuilder {
  public:
   OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingAllReduceSubTskGphBuilder);
@@ -120,7 +189,108 @@ class NcclCollectiveBoxingAllReduceSubTskGphBuilder final : public SubTskGphBuil
         Connect<TaskNode>(in_node, ctx->task_graph()->NewEdge(), collective_node);
         sorted_out_tasks->push_back(collective_node);
       }
-      return TRY(BuildSubTskGphBuilderStatus("NcclCollectiveBoxingAllReduceSubTskGphBuilder", ""));
+      std::string comment;
+      DistributeHirarchy hirarchy;
+      if (TryGetMachineDeviceHirarchy(in_parallel_desc, in_sbp_parallel, &hirarchy)
+          && hirarchy.dim(0).distribute_num() > 1) {
+        comment = AllReduceInterNodeCostComment(hirarchy, logical_blob_desc);
+      }
+      return TRY(
+          BuildSubTskGphBuilderStatus("NcclCollectiveBoxingAllReduceSubTskGphBuilder", comment));
+    } else {
+      return Error::BoxingNotSupportedError();
+    }
+  }
+};
+
+// reduce-scatter inside each machine, all-reduce the 1/D chunks across machines between the
+// devices of the same local index, then all-gather inside each machine
+class NcclCollectiveBoxingHierarchicalAllReduceSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingHierarchicalAllReduceSubTskGphBuilder);
+  NcclCollectiveBoxingHierarchicalAllReduceSubTskGphBuilder() = default;
+  ~NcclCollectiveBoxingHierarchicalAllReduceSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(
+      SubTskGphBuilderCtx* ctx, const std::vector<TaskNode*>& sorted_in_tasks,
+      std::vector<TaskNode*>* sorted_out_tasks,
+      std::vector<std::vector<TaskNode*>>* sorted_ctrl_tasks, const ParallelDesc& in_parallel_desc,
+      const ParallelDesc& out_parallel_desc, const LogicalBlobId& lbi,
+      const BlobDesc& logical_blob_desc, const SbpParallel& in_sbp_parallel,
+      const SbpParallel& out_sbp_parallel, const Shape& time_shape) const override {
+    DistributeHirarchy hirarchy;
+    if (out_parallel_desc.Equals(in_parallel_desc)
+        && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        && out_parallel_desc.device_type() == DeviceType::kGPU
+        && SubTskGphBuilderUtil::IsBoxingP2B(in_sbp_parallel, out_sbp_parallel)
+        && logical_blob_desc.shape().NumAxes() > 0
+        && TryGetMachineDeviceHirarchy(in_parallel_desc, in_sbp_parallel, &hirarchy)
+        && hirarchy.dim(0).distribute_num() > 1 && hirarchy.dim(1).distribute_num() > 1
+        && logical_blob_desc.shape().At(0) % hirarchy.dim(1).distribute_num() == 0) {
+      const std::vector<int64_t>& machine_ids = in_parallel_desc.sorted_machine_ids();
+      const int64_t machine_num = hirarchy.dim(0).distribute_num();
+      const int64_t device_num = hirarchy.dim(1).distribute_num();
+      auto GetDeviceName = [&](int64_t machine_idx, int64_t local_idx) {
+        const int64_t machine_id = machine_ids.at(machine_idx);
+        return std::to_string(machine_id) + ":"
+               + std::to_string(in_parallel_desc.sorted_dev_phy_ids(machine_id).at(local_idx));
+      };
+      std::vector<ParallelDesc> intra_node_parallel_descs;
+      FOR_RANGE(int64_t, machine_idx, 0, machine_num) {
+        ParallelConf parallel_conf;
+        parallel_conf.set_device_tag("gpu");
+        FOR_RANGE(int64_t, local_idx, 0, device_num) {
+          parallel_conf.add_device_name(GetDeviceName(machine_idx, local_idx));
+        }
+        intra_node_parallel_descs.emplace_back(parallel_conf);
+      }
+      std::vector<ParallelDesc> inter_node_parallel_descs;
+      FOR_RANGE(int64_t, local_idx, 0, device_num) {
+        ParallelConf parallel_conf;
+        parallel_conf.set_device_tag("gpu");
+        FOR_RANGE(int64_t, machine_idx, 0, machine_num) {
+          parallel_conf.add_device_name(GetDeviceName(machine_idx, local_idx));
+        }
+        inter_node_parallel_descs.emplace_back(parallel_conf);
+      }
+      Shape chunk_shape = logical_blob_desc.shape();
+      chunk_shape.Set(0, chunk_shape.At(0) / device_num);
+      const BlobDesc chunk_blob_desc(chunk_shape, logical_blob_desc.data_type());
+      const std::string op_name_prefix =
+          "System-Boxing-NcclCollectiveBoxingHierarchicalAllReduce-" + NewUniqueId();
+      sorted_out_tasks->resize(in_parallel_desc.parallel_num());
+      FOR_RANGE(int64_t, machine_idx, 0, machine_num) {
+        const int64_t machine_id = machine_ids.at(machine_idx);
+        FOR_RANGE(int64_t, local_idx, 0, device_num) {
+          const int64_t dev_phy_id = in_parallel_desc.sorted_dev_phy_ids(machine_id).at(local_idx);
+          const int64_t parallel_id =
+              JUST(in_parallel_desc.ParallelId4MachineDeviceId(machine_id, dev_phy_id));
+          TaskNode* in_node = sorted_in_tasks.at(parallel_id);
+          auto* reduce_scatter_node =
+              ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+          NcclInitCollectiveNode(reduce_scatter_node, intra_node_parallel_descs.at(machine_idx),
+                                 local_idx,
+                                 op_name_prefix + "-ReduceScatter-" + std::to_string(machine_idx),
+                                 lbi, logical_blob_desc, OpType::kOpTypeReduceScatter, -1);
+          Connect<TaskNode>(in_node, ctx->task_graph()->NewEdge(), reduce_scatter_node);
+          auto* all_reduce_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+          NcclInitCollectiveNode(all_reduce_node, inter_node_parallel_descs.at(local_idx),
+                                 machine_idx,
+                                 op_name_prefix + "-AllReduce-" + std::to_string(local_idx), lbi,
+                                 chunk_blob_desc, OpType::kOpTypeAllReduce, -1);
+          Connect<TaskNode>(reduce_scatter_node, ctx->task_graph()->NewEdge(), all_reduce_node);
+          auto* all_gather_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+          NcclInitCollectiveNode(all_gather_node, intra_node_parallel_descs.at(machine_idx),
+                                 local_idx,
+                                 op_name_prefix + "-AllGather-" + std::to_string(machine_idx),
+                                 lbi, logical_blob_desc, OpType::kOpTypeAllGather, -1);
+          Connect<TaskNode>(all_reduce_node, ctx->task_graph()->NewEdge(), all_gather_node);
+          sorted_out_tasks->at(parallel_id) = all_gather_node;
+        }
+      }
+      return TRY(BuildSubTskGphBuilderStatus(
+          "NcclCollectiveBoxingHierarchicalAllReduceSubTskGphBuilder",
+          AllReduceInterNodeCostComment(hirarchy, logical_blob_desc)));
     } else {
       return Error::BoxingNotSupportedError();
     }
@@ -423,12 +593,110 @@ class NcclCollectiveBoxingAll2AllSubTskGphBuilder final : public SubTskGphBuilde
   }
 };
 
+// all reduce, reduce scatter or all gather between cpu devices of the same placement
+class CpuCollectiveBoxingSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingSubTskGphBuilder);
+  explicit CpuCollectiveBoxingSubTskGphBuilder(OpType op_type) : op_type_(op_type) {}
+  ~CpuCollectiveBoxingSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(
+      SubTskGphBuilderCtx* ctx, const std::vector<TaskNode*>& sorted_in_tasks,
+      std::vector<TaskNode*>* sorted_out_tasks,
+      std::vector<std::vector<TaskNode*>>* sorted_ctrl_tasks, const ParallelDesc& in_parallel_desc,
+      const ParallelDesc& out_parallel_desc, const LogicalBlobId& lbi,
+      const BlobDesc& logical_blob_desc, const SbpParallel& in_sbp_parallel,
+      const SbpParallel& out_sbp_parallel, const Shape& time_shape) const override {
+    if (!out_parallel_desc.Equals(in_parallel_desc)
+        || SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        || out_parallel_desc.device_type() != DeviceType::kCPU
+        || out_parallel_desc.parallel_num() <= 1
+        || !IsSupportedSbp(in_sbp_parallel, out_sbp_parallel)) {
+      return Error::BoxingNotSupportedError();
+    }
+    if (op_type_ != OpType::kOpTypeAllReduce
+        && logical_blob_desc.shape().At(0) % out_parallel_desc.parallel_num() != 0) {
+      return Error::BoxingNotSupportedError();
+    }
+    const std::string op_name = "System-Boxing-CpuCollectiveBoxing-" + NewUniqueId();
+    FOR_RANGE(int64_t, i, 0, in_parallel_desc.parallel_num()) {
+      TaskNode* in_node = sorted_in_tasks.at(i);
+      auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+      CpuInitCollectiveNode(collective_node, in_parallel_desc, i, op_name, lbi, logical_blob_desc,
+                            op_type_, -1);
+      Connect<TaskNode>(in_node, ctx->task_graph()->NewEdge(), collective_node);
+      sorted_out_tasks->push_back(collective_node);
+    }
+    return TRY(
+        BuildSubTskGphBuilderStatus("CpuCollectiveBoxingSubTskGphBuilder", OpType_Name(op_type_)));
+  }
+
+ private:
+  bool IsSupportedSbp(const SbpParallel& in_sbp_parallel,
+                      const SbpParallel& out_sbp_parallel) const {
+    if (op_type_ == OpType::kOpTypeAllReduce) {
+      return SubTskGphBuilderUtil::IsBoxingP2B(in_sbp_parallel, out_sbp_parallel);
+    } else if (op_type_ == OpType::kOpTypeReduceScatter) {
+      return SubTskGphBuilderUtil::IsBoxingP2S(in_sbp_parallel, out_sbp_parallel)
+             && out_sbp_parallel.split_parallel().axis() == 0;
+    } else if (op_type_ == OpType::kOpTypeAllGather) {
+      return SubTskGphBuilderUtil::IsBoxingS2B(in_sbp_parallel, out_sbp_parallel)
+             && in_sbp_parallel.split_parallel().axis() == 0;
+    } else {
+      UNIMPLEMENTED();
+      return false;
+    }
+  }
+
+  const OpType op_type_;
+};
+
+class CpuCollectiveBoxingBroadcastSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingBroadcastSubTskGphBuilder);
+  CpuCollectiveBoxingBroadcastSubTskGphBuilder() = default;
+  ~CpuCollectiveBoxingBroadcastSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(
+      SubTskGphBuilderCtx* ctx, const std::vector<TaskNode*>& sorted_in_tasks,
+      std::vector<TaskNode*>* sorted_out_tasks,
+      std::vector<std::vector<TaskNode*>>* sorted_ctrl_tasks, const ParallelDesc& in_parallel_desc,
+      const ParallelDesc& out_parallel_desc, const LogicalBlobId& lbi,
+      const BlobDesc& logical_blob_desc, const SbpParallel& in_sbp_parallel,
+      const SbpParallel& out_sbp_parallel, const Shape& time_shape) const override {
+    if (in_parallel_desc.parallel_num() == 1 && out_parallel_desc.parallel_num() > 1
+        && in_parallel_desc.device_type() == DeviceType::kCPU
+        && out_parallel_desc.device_type() == DeviceType::kCPU
+        && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        && out_sbp_parallel.has_broadcast_parallel()) {
+      const int64_t root_parallel_id = FindRootParallelId(out_parallel_desc, in_parallel_desc);
+      if (root_parallel_id == -1) { return Error::BoxingNotSupportedError(); }
+      TaskNode* in_node = sorted_in_tasks.front();
+      const std::string op_name = "System-Boxing-CpuCollectiveBoxingBroadcast-" + NewUniqueId();
+      FOR_RANGE(int64_t, i, 0, out_parallel_desc.parallel_num()) {
+        auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+        CpuInitCollectiveNode(collective_node, out_parallel_desc, i, op_name, lbi,
+                              logical_blob_desc, OpType::kOpTypeBroadcast, root_parallel_id);
+        if (i != root_parallel_id) { in_node->BuildCtrlRegstDesc(collective_node); }
+        Connect<TaskNode>(in_node, ctx->task_graph()->NewEdge(), collective_node);
+        sorted_out_tasks->push_back(collective_node);
+      }
+      return TRY(BuildSubTskGphBuilderStatus("CpuCollectiveBoxingBroadcastSubTskGphBuilder", ""));
+    } else {
+      return Error::BoxingNotSupportedError();
+    }
+  }
+};
+
 }  // namespace
 
 CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
   const CollectiveBoxingConf collective_boxing_conf =
       Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf();
   std::vector<std::shared_ptr<SubTskGphBuilder>> builders;
+  if (collective_boxing_conf.nccl_enable_hierarchical_all_reduce()) {
+    builders.emplace_back(new NcclCollectiveBoxingHierarchicalAllReduceSubTskGphBuilder());
+  }
   builders.emplace_back(new NcclCollectiveBoxingAllReduceSubTskGphBuilder());
   builders.emplace_back(new NcclCollectiveBoxingReduceScatterSubTskGphBuilder());
   builders.emplace_back(new NcclCollectiveBoxingAllGatherSubTskGphBuilder());
@@ -442,6 +710,12 @@ CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
     LOG(WARNING) << "nccl_enable_all_to_all is unavailable unless NCCL_VERSION > 2.7.0";
 #endif
   }
+  if (collective_boxing_conf.cpu_enable()) {
+    builders.emplace_back(new CpuCollectiveBoxingSubTskGphBuilder(OpType::kOpTypeAllReduce));
+    builders.emplace_back(new CpuCollectiveBoxingSubTskGphBuilder(OpType::kOpTypeReduceScatter));
+    builders.emplace_back(new CpuCollectiveBoxingSubTskGphBuilder(OpType::kOpTypeAllGather));
+    builders.emplace_back(new CpuCollectiveBoxingBroadcastSubTskGphBuilder());
+  }
   chain_builder_.reset(new ChainSubTskGphBuilder(builders));
 }
 
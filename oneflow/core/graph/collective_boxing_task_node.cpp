@@ -59,4 +59,7 @@ void CollectiveBoxingGenericTaskNode::InferProducedDataRegstTimeShape() {
   if (out_regst != nullptr) { out_regst->mut_data_regst_time_shape()->reset(new Shape({1, 1})); }
 }
 
+// cpu collective boxing nodes of a machine share one thread
+REGISTER_INDEPENDENT_THREAD_NUM(TaskType::kCollectiveBoxingGeneric, 1);
+
 }  // namespace oneflow
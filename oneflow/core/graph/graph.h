@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/graph/node.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -39,6 +40,16 @@ class Graph {
   void ReverseTopoForEachNode(std::function<void(NodeType*)> NodeHandler) const;
   void ForEachEdge(std::function<void(EdgeType*)> EdgeHandler) const;
 
+  // Parallel For Each
+  // Nodes of the same topological level don't depend on each other, the levels are visited in
+  // topological order
+  void TopoForEachNodeLevel(
+      const std::function<void(const std::vector<NodeType*>&)>& LevelHandler) const;
+  // NodeHandler must be safe to be called concurrently on different nodes
+  void ParallelForEachNode(const std::function<void(NodeType*)>& NodeHandler) const;
+  // NodeHandler must be safe to be called concurrently on nodes of the same topological level
+  void ParallelTopoForEachNode(const std::function<void(NodeType*)>& NodeHandler) const;
+
   void SortedTopoForEachNode(std::function<bool(const EdgeType* lhs, const EdgeType* rhs)> LessThan,
                              std::function<void(NodeType*)> NodeHandler) const;
 
@@ -178,6 +189,51 @@ Maybe<void> Graph<NodeType, EdgeType>::MaybeForEachNode(
   return Maybe<void>::Ok();
 }
 
+template<typename NodeType, typename EdgeType>
+void Graph<NodeType, EdgeType>::TopoForEachNodeLevel(
+    const std::function<void(const std::vector<NodeType*>&)>& LevelHandler) const {
+  HashMap<NodeType*, size_t> node2in_edge_cnt;
+  std::vector<NodeType*> cur_level;
+  ForEachNode([&](NodeType* node) {
+    if (node->in_edges().empty()) {
+      cur_level.push_back(node);
+    } else {
+      node2in_edge_cnt.emplace(node, node->in_edges().size());
+    }
+  });
+  size_t visited_cnt = 0;
+  while (!cur_level.empty()) {
+    LevelHandler(cur_level);
+    visited_cnt += cur_level.size();
+    std::vector<NodeType*> next_level;
+    for (NodeType* node : cur_level) {
+      node->ForEachNodeOnOutEdge([&](NodeType* out_node) {
+        if (--node2in_edge_cnt.at(out_node) == 0) { next_level.push_back(out_node); }
+      });
+    }
+    cur_level.swap(next_level);
+  }
+  CHECK_EQ(visited_cnt, node_num()) << "cycle found in " << TypeName();
+}
+
+template<typename NodeType, typename EdgeType>
+void Graph<NodeType, EdgeType>::ParallelForEachNode(
+    const std::function<void(NodeType*)>& NodeHandler) const {
+  MultiThreadLoop(nodes_.size(), [&](size_t i) { NodeHandler(nodes_.at(i).get()); });
+}
+
+template<typename NodeType, typename EdgeType>
+void Graph<NodeType, EdgeType>::ParallelTopoForEachNode(
+    const std::function<void(NodeType*)>& NodeHandler) const {
+  TopoForEachNodeLevel([&](const std::vector<NodeType*>& level) {
+    if (level.size() == 1) {
+      NodeHandler(level.front());
+    } else {
+      MultiThreadLoop(level.size(), [&](size_t i) { NodeHandler(level.at(i)); });
+    }
+  });
+}
+
 template<typename NodeType, typename EdgeType>
 std::list<NodeType*> Graph<NodeType, EdgeType>::source_nodes() const {
   std::list<NodeType*> ret;
@@ -0,0 +1,125 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/graph/graph.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+class SyntheticEdge;
+
+class SyntheticNode final : public Node<SyntheticNode, SyntheticEdge> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SyntheticNode);
+  SyntheticNode() : is_handled_(false), result_(0) {}
+  ~SyntheticNode() = default;
+
+  // Burn cpu for about the same time as a TaskNode::Build of a typical op
+  void Handle(int64_t work_size) {
+    ForEachNodeOnInEdge([](SyntheticNode* in_node) { CHECK(in_node->is_handled()); });
+    uint64_t result = node_id();
+    FOR_RANGE(int64_t, i, 0, work_size) { result = result * 6364136223846793005ULL + i; }
+    result_ = result;
+    is_handled_ = true;
+  }
+  void Reset() { is_handled_ = false; }
+  bool is_handled() const { return is_handled_; }
+
+ private:
+  std::atomic<bool> is_handled_;
+  uint64_t result_;
+};
+
+class SyntheticEdge final : public Edge<SyntheticNode, SyntheticEdge> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SyntheticEdge);
+  SyntheticEdge() = default;
+  ~SyntheticEdge() = default;
+};
+
+class SyntheticGraph final : public Graph<SyntheticNode, SyntheticEdge> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SyntheticGraph);
+  // depth levels of width nodes, each node consumes in_degree random nodes of the previous level
+  SyntheticGraph(int64_t depth, int64_t width, int64_t in_degree) {
+    std::mt19937 gen(0);
+    std::vector<SyntheticNode*> prev_level;
+    FOR_RANGE(int64_t, d, 0, depth) {
+      std::vector<SyntheticNode*> cur_level;
+      FOR_RANGE(int64_t, w, 0, width) {
+        SyntheticNode* node = NewNode();
+        if (!prev_level.empty()) {
+          std::uniform_int_distribution<size_t> dis(0, prev_level.size() - 1);
+          FOR_RANGE(int64_t, i, 0, in_degree) { Connect(prev_level.at(dis(gen)), NewEdge(), node); }
+        }
+        cur_level.push_back(node);
+      }
+      prev_level.swap(cur_level);
+    }
+  }
+  ~SyntheticGraph() = default;
+
+  const char* TypeName() const override { return "SyntheticGraph"; }
+};
+
+double MeasureSeconds(const SyntheticGraph& graph, const std::function<void()>& Run) {
+  graph.ForEachNode([](SyntheticNode* node) { node->Reset(); });
+  const double start = GetCurTime();
+  Run();
+  const double seconds = (GetCurTime() - start) / 1e9;
+  graph.ForEachNode([](SyntheticNode* node) { CHECK(node->is_handled()); });
+  return seconds;
+}
+
+void RunGraphBenchmark(int64_t depth, int64_t width, int64_t in_degree, int64_t work_size) {
+  const double construct_start = GetCurTime();
+  SyntheticGraph graph(depth, width, in_degree);
+  const double construct_seconds = (GetCurTime() - construct_start) / 1e9;
+  auto Handler = [work_size](SyntheticNode* node) { node->Handle(work_size); };
+  const double topo_seconds = MeasureSeconds(graph, [&]() { graph.TopoForEachNode(Handler); });
+  const double parallel_topo_seconds =
+      MeasureSeconds(graph, [&]() { graph.ParallelTopoForEachNode(Handler); });
+  std::cout << "node_num: " << graph.node_num() << ", edge_num: " << graph.edge_num()
+            << ", thread_num: " << Global<ThreadPool>::Get()->thread_num() << std::endl
+            << "  construct: " << construct_seconds << " seconds" << std::endl
+            << "  TopoForEachNode: " << topo_seconds << " seconds" << std::endl
+            << "  ParallelTopoForEachNode: " << parallel_topo_seconds << " seconds, speedup "
+            << topo_seconds / parallel_topo_seconds << std::endl;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+/*
+ * Try run this benchmark exe by :
+ *     ./graph_benchmark -depth=1000 -width=256 -in_degree=2 -work_size=20000
+ */
+DEFINE_int64(depth, 1000, "number of topological levels of the synthetic graph");
+DEFINE_int64(width, 256, "number of nodes per level");
+DEFINE_int64(in_degree, 2, "number of in edges per node, except for the source nodes");
+DEFINE_int64(work_size, 20000, "iterations of synthetic work done on each node");
+DEFINE_int32(thread_num, std::thread::hardware_concurrency(), "size of the thread pool");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  Global<ThreadPool>::New(FLAGS_thread_num);
+  RunGraphBenchmark(FLAGS_depth, FLAGS_width, FLAGS_in_degree, FLAGS_work_size);
+  Global<ThreadPool>::Delete();
+  return 0;
+}
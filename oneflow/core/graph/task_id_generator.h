@@ -30,6 +30,10 @@ class TaskIdGenerator final {
   ~TaskIdGenerator() = default;
 
   TaskId Generate(const StreamId& stream_id);
+  void ForEachTaskIndexCounter(
+      const std::function<void(const StreamId&, task_index_t)>& Handler) const;
+  void SetTaskIndexCounter(const StreamId& stream_id, task_index_t counter);
+  void ClearTaskIndexCounters() { stream_id2task_index_counter_.clear(); }
 
  private:
   HashMap<StreamId, task_index_t> stream_id2task_index_counter_;
@@ -40,6 +44,16 @@ inline TaskId TaskIdGenerator::Generate(const StreamId& stream_id) {
   return TaskId{stream_id, task_index};
 }
 
+inline void TaskIdGenerator::ForEachTaskIndexCounter(
+    const std::function<void(const StreamId&, task_index_t)>& Handler) const {
+  for (const auto& pair : stream_id2task_index_counter_) { Handler(pair.first, pair.second); }
+}
+
+inline void TaskIdGenerator::SetTaskIndexCounter(const StreamId& stream_id,
+                                                 task_index_t counter) {
+  stream_id2task_index_counter_[stream_id] = counter;
+}
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_GRAPH_TASK_ID_GENERATOR_H_
@@ -70,10 +70,8 @@ void OccasionallyClearCtrlKV(const std::string& key) {
   // 1 instead of 0 is better for avoid clearing no ctrl kv
   if ((seq++) % interval == 1) {
     OF_ENV_BARRIER();
-    if (GlobalProcessCtx::IsThisProcessMaster()) {
-      Global<ObsoleteCtrlKeys>::Get()->ForEach(
-          [](const std::string& k) { Global<CtrlClient>::Get()->ClearMasterKV(k); });
-    }
+    Global<ObsoleteCtrlKeys>::Get()->ForEach(
+        [](const std::string& k) { Global<CtrlClient>::Get()->ClearBroadcastKV(k); });
     Global<ObsoleteCtrlKeys>::Get()->Clear();
     OF_ENV_BARRIER();
   }
@@ -81,13 +79,13 @@ void OccasionallyClearCtrlKV(const std::string& key) {
 
 void PushClusterInstruction(const ClusterInstructionProto& cluster_instruction) {
   const std::string& key = GetClusterInstructionKey();
-  Global<CtrlClient>::Get()->PushMasterKV(key, cluster_instruction);
+  Global<CtrlClient>::Get()->PushBroadcastKV(key, cluster_instruction);
   OccasionallyClearCtrlKV(key);
 }
 
 void PullClusterInstruction(ClusterInstructionProto* cluster_instruction) {
   const std::string& key = GetClusterInstructionKey();
-  Global<CtrlClient>::Get()->PullMasterKV(key, cluster_instruction);
+  Global<CtrlClient>::Get()->PullBroadcastKV(key, cluster_instruction);
   OccasionallyClearCtrlKV(key);
 }
 
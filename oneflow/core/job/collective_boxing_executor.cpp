@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -50,6 +51,27 @@ void SortRequestsByOrder(std::vector<const RequestDesc*>* requests) {
             [](const RequestDesc* a, const RequestDesc* b) { return a->order() < b->order(); });
 }
 
+int64_t GetGradientBucketId(const RequestDesc* request) {
+  return request->has_gradient_bucket_id() ? request->gradient_bucket_id() : -1;
+}
+
+// requests of the same dependency depth do not wait for each other, so they are free to be
+// launched bucket by bucket. The requests not in any bucket go last, so that they never delay
+// the first gradient buckets.
+void SortRequestsByGradientBucket(std::vector<const RequestDesc*>* requests) {
+  const auto GetLaunchOrder = [](const RequestDesc* request) -> int64_t {
+    const int64_t bucket_id = GetGradientBucketId(request);
+    return bucket_id == -1 ? GetMaxVal<int64_t>() : bucket_id;
+  };
+  std::stable_sort(requests->begin(), requests->end(),
+                   [&](const RequestDesc* a, const RequestDesc* b) {
+                     if (a->dependency_depth() != b->dependency_depth()) {
+                       return a->dependency_depth() < b->dependency_depth();
+                     }
+                     return GetLaunchOrder(a) < GetLaunchOrder(b);
+                   });
+}
+
 bool IsDeviceOnThisMachine(const DeviceDesc& device_desc) {
   return device_desc.machine_id() == GlobalProcessCtx::Rank();
 }
@@ -75,8 +97,6 @@ int64_t GetAlignedRequestSize(const RequestDesc* request) {
 
 }  // namespace
 
-#ifdef WITH_CUDA
-
 void CollectiveBoxingExecutorBackend::GroupRequests(
     const std::vector<const RequestDesc*>& requests,
     std::vector<std::vector<const RequestDesc*>>* groups) {
@@ -85,6 +105,8 @@ void CollectiveBoxingExecutorBackend::GroupRequests(
   }
 }
 
+#ifdef WITH_CUDA
+
 class NcclCollectiveBoxingExecutorBackend : public CollectiveBoxingExecutorBackend {
  public:
   OF_DISALLOW_COPY_AND_MOVE(NcclCollectiveBoxingExecutorBackend)
@@ -517,6 +539,13 @@ CollectiveBoxingExecutor::CollectiveBoxingExecutor(const Plan& plan)
           .first;
   it->second->Init(collective_boxing_plan_);
 #endif
+  if (Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf().cpu_enable()) {
+    auto cpu_it =
+        backends_
+            .emplace(Backend::kBackendCPU, std::make_unique<CpuCollectiveBoxingExecutorBackend>())
+            .first;
+    cpu_it->second->Init(collective_boxing_plan_);
+  }
   Init();
   DumpSummary();
 }
@@ -538,10 +567,12 @@ void CollectiveBoxingExecutor::Init() {
                                return a->dependency_depth() > b->dependency_depth();
                              })
           == requests.end());
+    SortRequestsByGradientBucket(&requests);
     std::vector<std::vector<const RequestDesc*>> rough_groups;
     for (const auto* request : requests) {
       if ((!collective_boxing_conf.enable_fusion()) || rough_groups.empty()
           || request->dependency_depth() != rough_groups.back().front()->dependency_depth()
+          || GetGradientBucketId(request) != GetGradientBucketId(rough_groups.back().front())
           || request->op_desc().backend() != rough_groups.back().front()->op_desc().backend()
           || request->device_set() != rough_groups.back().front()->device_set()) {
         rough_groups.emplace_back(std::vector<const RequestDesc*>({request}));
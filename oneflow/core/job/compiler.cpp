@@ -15,12 +15,39 @@ limitations under the License.
 */
 #include "oneflow/core/job/compiler.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/graph/op_graph.h"
+#include "oneflow/core/graph/normal_forward_compute_task_node.h"
 #include "oneflow/core/job_rewriter/job_completer.h"
+#include "oneflow/core/profiler/compile_stats.h"
+#include "oneflow/core/profiler/roofline.h"
 
 namespace oneflow {
 
+namespace {
+
+// pipeline stages keep the outputs of as many micro-batches as they have in flight
+void UpdtMinRegstNumByOpName(const Job& job, TaskGraph* task_gph) {
+  const auto& op_name2min_register_num = job.helper().op_name2min_register_num();
+  if (op_name2min_register_num.empty()) { return; }
+  task_gph->ForEachNode([&](TaskNode* task_node) {
+    auto* fw_comp_node = dynamic_cast<NormalForwardCompTaskNode*>(task_node);
+    if (fw_comp_node == nullptr || fw_comp_node->logical_node()->op_vec().size() != 1) { return; }
+    const auto it =
+        op_name2min_register_num.find(fw_comp_node->logical_node()->SoleOp()->op_name());
+    if (it == op_name2min_register_num.end()) { return; }
+    for (const auto& pair : fw_comp_node->produced_regsts()) {
+      if (pair.first.find("out") != 0) { continue; }
+      RegstDesc* regst_desc = pair.second.get();
+      regst_desc->UpdtMinRegstNumIfNeed(
+          std::min<int32_t>(it->second, regst_desc->max_register_num()));
+    }
+  });
+}
+
+}  // namespace
+
 void Compiler::GenNetTopo(Plan* plan) const {
   HashMap<int64_t, int64_t> rid2mid;
   HashMap<int64_t, int64_t> tid2mid;
@@ -64,27 +91,56 @@ void Compiler::GenNetTopo(Plan* plan) const {
 
 void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
   const JobDesc& job_desc = GlobalJobDesc();
-  if (need_job_complete) { JobCompleter().Complete(job); }
+  profiler::CompileStageTimer timer(job_desc.job_id());
+  if (need_job_complete) {
+    JobCompleter().Complete(job);
+    timer.Tick("JobCompleter::Complete");
+  }
   Global<OpGraph>::New(*job);
+  timer.Tick("OpGraph");
   if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
     TeePersistentLogStream::Create(StrCat("optimized_job", job_desc.job_id()))->Write(*job);
     Global<OpGraph>::Get()->ToDotWithFilePath("optimized_dlnet_" + std::to_string(job_desc.job_id())
                                               + "_op_graph.dot");
   }
+  const ProfilerConf* profiler_conf = Global<const ProfilerConf>::Get();
+  if (profiler_conf != nullptr && profiler_conf->roofline_report()) {
+    auto Peak4DeviceType = [&](DeviceType device_type) -> profiler::RooflinePeak {
+      if (device_type == DeviceType::kGPU) {
+        return {profiler_conf->roofline_gpu_peak_gflops(),
+                profiler_conf->roofline_gpu_peak_memory_gbps()};
+      }
+      return {profiler_conf->roofline_cpu_peak_gflops(),
+              profiler_conf->roofline_cpu_peak_memory_gbps()};
+    };
+    TeePersistentLogStream::Create(StrCat("roofline_", job_desc.job_id()))
+        ->Write(profiler::GenRooflineReport(*Global<OpGraph>::Get(), Peak4DeviceType));
+    timer.Tick("RooflineReport");
+  }
   auto logical_gph = std::make_unique<LogicalGraph>(*job);
+  timer.Tick("LogicalGraph");
   auto task_gph = std::make_unique<TaskGraph>(std::move(logical_gph));
+  timer.Tick("TaskGraph");
   using std::placeholders::_1;
+  // ProduceAllRegstsAndBindEdges allocates regst desc ids and PinConsumedRegst modifies regsts
+  // shared by other consumers, both of them stay serial to keep the plan deterministic
   task_gph->ForEachNode(std::bind(&TaskNode::ProduceAllRegstsAndBindEdges, _1));
-  task_gph->ForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
+  UpdtMinRegstNumByOpName(*job, task_gph.get());
+  task_gph->ParallelForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::PinConsumedRegst, _1));
-  task_gph->TopoForEachNode(&TaskNode::Build);
+  timer.Tick("ProduceAndConsumeRegsts");
+  task_gph->ParallelTopoForEachNode(&TaskNode::Build);
+  timer.Tick("TaskNode::Build");
   task_gph->RemoveEmptyRegsts();
   task_gph->MergeChainAndAddOrderingCtrlEdgeInSameChain();
+  timer.Tick("MergeChainAndAddOrderingCtrlEdge");
   if (job_desc.enable_inplace()) {
     auto IsReachable = Global<OpGraph>::Get()->MakePredicatorIsOpNameDataOrCtrlReachable();
     task_gph->EnableInplaceMemSharing(IsReachable);
+    timer.Tick("EnableInplaceMemSharing");
   }
-  task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
+  task_gph->ParallelTopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
+  timer.Tick("InferTimeShape");
 
   task_gph->ForEachNode([&](TaskNode* task_node) {
     if (task_node->IsMeaningLess()) { return; }
@@ -95,6 +151,8 @@ void Compiler::Compile(Job* job, Plan* plan, bool need_job_complete) const {
     (*job_id2job_conf)[GlobalJobDesc().job_id()] = GlobalJobDesc().job_conf();
   }
   Global<OpGraph>::Delete();
+  timer.Tick("ToProto");
+  LOG(INFO) << "job_id: " << job_desc.job_id() << " , compile stages:" << timer.ToString();
 }
 
 }  // namespace oneflow
@@ -0,0 +1,389 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/cpu_collective_boxing_executor_backend.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/graph/boxing/collective_boxing_util.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/data_type_seq.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/transport/transport.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+template<typename T>
+void AddTo(char* dst, const char* src, int64_t elem_cnt) {
+  T* dst_ptr = reinterpret_cast<T*>(dst);
+  const T* src_ptr = reinterpret_cast<const T*>(src);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { dst_ptr[i] += src_ptr[i]; }
+}
+
+void AddTo(DataType data_type, char* dst, const char* src, size_t byte_size) {
+  const int64_t elem_cnt = byte_size / GetSizeOfDataType(data_type);
+  switch (data_type) {
+#define ADD_TO_CASE(type_cpp, type_proto) \
+  case type_proto: AddTo<type_cpp>(dst, src, elem_cnt); break;
+    OF_PP_FOR_EACH_TUPLE(ADD_TO_CASE, ARITHMETIC_DATA_TYPE_SEQ)
+    default: UNIMPLEMENTED();
+  }
+#undef ADD_TO_CASE
+}
+
+void CopyIfNotSame(void* dst, const void* src, size_t byte_size) {
+  if (dst != src && byte_size > 0) { std::memcpy(dst, src, byte_size); }
+}
+
+int64_t GetRequestSize(const RequestDesc* request) {
+  return Shape(request->op_desc().shape()).elem_cnt()
+         * GetSizeOfDataType(request->op_desc().data_type());
+}
+
+// Machines taking part in one execution of a request, indexed in the order of ranks. Ranks of a
+// machine are contiguous since they come from a ParallelDesc.
+class MachineRing final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MachineRing);
+  MachineRing(const RequestDesc& request, int64_t execution_id);
+  ~MachineRing() = default;
+
+  int64_t num_machines() const { return machine_ids_.size(); }
+  int64_t this_machine_idx() const { return this_machine_idx_; }
+  int64_t machine_idx4rank(int64_t rank) const { return rank2machine_idx_.at(rank); }
+  const std::vector<int64_t>& ranks4machine_idx(int64_t machine_idx) const {
+    return machine_idx2ranks_.at(machine_idx);
+  }
+
+  // sends to dst and receives from src at the same time and waits for both, a side is skipped
+  // if its machine_idx is -1 or its size is 0
+  void SendRecv(int64_t step, int64_t dst_machine_idx, const char* send_ptr, size_t send_size,
+                int64_t src_machine_idx, char* recv_ptr, size_t recv_size) const;
+
+ private:
+  uint64_t Token(int64_t step, int64_t src_machine_idx, int64_t dst_machine_idx) const;
+
+  std::vector<int64_t> machine_ids_;
+  std::vector<std::vector<int64_t>> machine_idx2ranks_;
+  std::vector<int64_t> rank2machine_idx_;
+  int64_t this_machine_idx_;
+  size_t token_seed_;
+};
+
+MachineRing::MachineRing(const RequestDesc& request, int64_t execution_id)
+    : this_machine_idx_(-1) {
+  const DeviceSet& device_set = request.device_set();
+  FOR_RANGE(int64_t, rank, 0, device_set.device_size()) {
+    const int64_t machine_id = device_set.device(rank).machine_id();
+    if (machine_ids_.empty() || machine_ids_.back() != machine_id) {
+      CHECK(std::find(machine_ids_.cbegin(), machine_ids_.cend(), machine_id)
+            == machine_ids_.cend());
+      if (machine_id == GlobalProcessCtx::Rank()) { this_machine_idx_ = machine_ids_.size(); }
+      machine_ids_.push_back(machine_id);
+      machine_idx2ranks_.emplace_back();
+    }
+    machine_idx2ranks_.back().push_back(rank);
+    rank2machine_idx_.push_back(machine_ids_.size() - 1);
+  }
+  CHECK_GE(this_machine_idx_, 0);
+  token_seed_ = std::hash<std::string>()(request.op_desc().name());
+  HashCombine(&token_seed_, std::hash<int64_t>()(execution_id));
+}
+
+uint64_t MachineRing::Token(int64_t step, int64_t src_machine_idx,
+                            int64_t dst_machine_idx) const {
+  size_t token = token_seed_;
+  HashCombine(&token, std::hash<int64_t>()(step));
+  HashCombine(&token, std::hash<int64_t>()(src_machine_idx));
+  HashCombine(&token, std::hash<int64_t>()(dst_machine_idx));
+  return token;
+}
+
+void MachineRing::SendRecv(int64_t step, int64_t dst_machine_idx, const char* send_ptr,
+                           size_t send_size, int64_t src_machine_idx, char* recv_ptr,
+                           size_t recv_size) const {
+  const bool need_send = dst_machine_idx != -1 && send_size > 0;
+  const bool need_recv = src_machine_idx != -1 && recv_size > 0;
+  BlockingCounter bc(static_cast<int64_t>(need_send) + static_cast<int64_t>(need_recv));
+  if (need_send) {
+    Global<Transport>::Get()->Send(Token(step, this_machine_idx_, dst_machine_idx),
+                                   machine_ids_.at(dst_machine_idx), send_ptr, send_size,
+                                   [&bc]() { bc.Decrease(); });
+  }
+  if (need_recv) {
+    Global<Transport>::Get()->Receive(Token(step, src_machine_idx, this_machine_idx_),
+                                      machine_ids_.at(src_machine_idx), recv_ptr, recv_size,
+                                      [&bc]() { bc.Decrease(); });
+  }
+  if (need_send || need_recv) { bc.WaitUntilCntEqualZero(); }
+}
+
+// After reduce scatter, the range [offsets[i], offsets[i + 1]) of buf on machine i is the sum of
+// that range over all machines. All gather is the inverse.
+
+void RingReduceScatter(const MachineRing& ring, int64_t* step, DataType data_type, char* buf,
+                       const std::vector<size_t>& offsets, std::vector<char>* tmp) {
+  const int64_t n = ring.num_machines();
+  const int64_t me = ring.this_machine_idx();
+  auto Size4Idx = [&](int64_t idx) { return offsets.at(idx + 1) - offsets.at(idx); };
+  FOR_RANGE(int64_t, s, 0, n - 1) {
+    const int64_t send_idx = (me - s - 1 + 2 * n) % n;
+    const int64_t recv_idx = (me - s - 2 + 2 * n) % n;
+    if (tmp->size() < Size4Idx(recv_idx)) { tmp->resize(Size4Idx(recv_idx)); }
+    ring.SendRecv(*step, (me + 1) % n, buf + offsets.at(send_idx), Size4Idx(send_idx),
+                  (me - 1 + n) % n, tmp->data(), Size4Idx(recv_idx));
+    AddTo(data_type, buf + offsets.at(recv_idx), tmp->data(), Size4Idx(recv_idx));
+    *step += 1;
+  }
+}
+
+void RingAllGather(const MachineRing& ring, int64_t* step, char* buf,
+                   const std::vector<size_t>& offsets) {
+  const int64_t n = ring.num_machines();
+  const int64_t me = ring.this_machine_idx();
+  auto Size4Idx = [&](int64_t idx) { return offsets.at(idx + 1) - offsets.at(idx); };
+  FOR_RANGE(int64_t, s, 0, n - 1) {
+    const int64_t send_idx = (me - s + n) % n;
+    const int64_t recv_idx = (me - s - 1 + n) % n;
+    ring.SendRecv(*step, (me + 1) % n, buf + offsets.at(send_idx), Size4Idx(send_idx),
+                  (me - 1 + n) % n, buf + offsets.at(recv_idx), Size4Idx(recv_idx));
+    *step += 1;
+  }
+}
+
+// log(n) steps instead of n - 1, n must be a power of 2
+void RecursiveHalvingReduceScatter(const MachineRing& ring, int64_t* step, DataType data_type,
+                                   char* buf, const std::vector<size_t>& offsets,
+                                   std::vector<char>* tmp) {
+  const int64_t n = ring.num_machines();
+  const int64_t me = ring.this_machine_idx();
+  int64_t lo = 0;
+  int64_t hi = n;
+  for (int64_t distance = n / 2; distance >= 1; distance /= 2) {
+    const int64_t peer = me ^ distance;
+    const int64_t mid = lo + distance;
+    const bool keep_lower = (me & distance) == 0;
+    const int64_t keep_lo = keep_lower ? lo : mid;
+    const int64_t keep_hi = keep_lower ? mid : hi;
+    const int64_t send_lo = keep_lower ? mid : lo;
+    const int64_t send_hi = keep_lower ? hi : mid;
+    const size_t keep_size = offsets.at(keep_hi) - offsets.at(keep_lo);
+    if (tmp->size() < keep_size) { tmp->resize(keep_size); }
+    ring.SendRecv(*step, peer, buf + offsets.at(send_lo), offsets.at(send_hi) - offsets.at(send_lo),
+                  peer, tmp->data(), keep_size);
+    AddTo(data_type, buf + offsets.at(keep_lo), tmp->data(), keep_size);
+    lo = keep_lo;
+    hi = keep_hi;
+    *step += 1;
+  }
+}
+
+void RecursiveDoublingAllGather(const MachineRing& ring, int64_t* step, char* buf,
+                                const std::vector<size_t>& offsets) {
+  const int64_t n = ring.num_machines();
+  const int64_t me = ring.this_machine_idx();
+  for (int64_t distance = 1; distance < n; distance *= 2) {
+    const int64_t peer = me ^ distance;
+    const int64_t lo = me / distance * distance;
+    const int64_t peer_lo = peer / distance * distance;
+    ring.SendRecv(*step, peer, buf + offsets.at(lo), offsets.at(lo + distance) - offsets.at(lo),
+                  peer, buf + offsets.at(peer_lo),
+                  offsets.at(peer_lo + distance) - offsets.at(peer_lo));
+    *step += 1;
+  }
+}
+
+void BinomialTreeBroadcast(const MachineRing& ring, int64_t* step, int64_t root_machine_idx,
+                           char* buf, size_t size) {
+  const int64_t n = ring.num_machines();
+  const int64_t relative_idx = (ring.this_machine_idx() - root_machine_idx + n) % n;
+  for (int64_t distance = 1; distance < n; distance *= 2) {
+    if (relative_idx < distance && relative_idx + distance < n) {
+      ring.SendRecv(*step, (relative_idx + distance + root_machine_idx) % n, buf, size, -1,
+                    nullptr, 0);
+    } else if (relative_idx >= distance && relative_idx < 2 * distance) {
+      ring.SendRecv(*step, -1, nullptr, 0, (relative_idx - distance + root_machine_idx) % n, buf,
+                    size);
+    }
+    *step += 1;
+  }
+}
+
+}  // namespace
+
+CpuCollectiveBoxingExecutorBackend::CpuCollectiveBoxingExecutorBackend()
+    : collective_boxing_conf_(Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf()) {
+  CHECK_GE(collective_boxing_conf_.cpu_fusion_threshold_mb(), 0);
+  fusion_threshold_ = collective_boxing_conf_.cpu_fusion_threshold_mb() * 1024 * 1024;
+  worker_ = std::thread([this]() {
+    std::function<void()> work;
+    while (work_channel_.Receive(&work) == kChannelStatusSuccess) { work(); }
+  });
+}
+
+CpuCollectiveBoxingExecutorBackend::~CpuCollectiveBoxingExecutorBackend() {
+  work_channel_.Close();
+  worker_.join();
+}
+
+void CpuCollectiveBoxingExecutorBackend::GroupRequests(
+    const std::vector<const RequestDesc*>& requests,
+    std::vector<std::vector<const RequestDesc*>>* groups) {
+  std::vector<const RequestDesc*> group;
+  int64_t group_size = 0;
+  auto CanFuse = [&](const RequestDesc* lhs, const RequestDesc* rhs) -> bool {
+    return lhs->device_set() == rhs->device_set()
+           && lhs->op_desc().op_type() == rhs->op_desc().op_type();
+  };
+  for (const RequestDesc* request : requests) {
+    const int64_t size = GetRequestSize(request);
+    if (group.empty() || !CanFuse(group.back(), request) || group_size + size > fusion_threshold_
+        || group.size() >= collective_boxing_conf_.cpu_fusion_max_ops()) {
+      if (!group.empty()) {
+        groups->emplace_back();
+        groups->back().swap(group);
+        group_size = 0;
+      }
+    }
+    group.push_back(request);
+    group_size += size;
+  }
+  if (!group.empty()) {
+    groups->emplace_back();
+    groups->back().swap(group);
+  }
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteGroup(
+    const std::vector<const RequestDesc*>& group,
+    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) {
+  CHECK_EQ(group.size(), ranks.size());
+  if (group.empty()) { return; }
+  work_channel_.Send([this, group, ranks]() {
+    FOR_RANGE(int64_t, i, 0, group.size()) {
+      ExecuteRequest(group.at(i), ranks.at(i));
+      for (const auto& rank7request_info : ranks.at(i)) {
+        (*rank7request_info.second.callback)(Maybe<void>::Ok());
+      }
+    }
+  });
+}
+
+void CpuCollectiveBoxingExecutorBackend::ExecuteRequest(
+    const RequestDesc* request, const std::map<int64_t, RuntimeRequestInfo>& rank2request_info) {
+  const OpDesc& op_desc = request->op_desc();
+  const MachineRing ring(*request, name2execution_cnt_[op_desc.name()]++);
+  const int64_t num_machines = ring.num_machines();
+  const std::vector<int64_t>& local_ranks = ring.ranks4machine_idx(ring.this_machine_idx());
+  CHECK_EQ(rank2request_info.size(), local_ranks.size());
+  const RuntimeRequestInfo& first_request_info = rank2request_info.at(local_ranks.front());
+  const DataType data_type = op_desc.data_type();
+  const size_t size = GetRequestSize(request);
+  const size_t chunk_size = size / op_desc.num_ranks();
+  const bool use_recursive_halving = collective_boxing_conf_.cpu_enable_recursive_halving()
+                                     && (num_machines & (num_machines - 1)) == 0;
+  int64_t step = 0;
+  auto ReduceScatter = [&](char* buf, const std::vector<size_t>& offsets) {
+    if (use_recursive_halving) {
+      RecursiveHalvingReduceScatter(ring, &step, data_type, buf, offsets, &recv_buffer_);
+    } else {
+      RingReduceScatter(ring, &step, data_type, buf, offsets, &recv_buffer_);
+    }
+  };
+  auto AllGather = [&](char* buf, const std::vector<size_t>& offsets) {
+    if (use_recursive_halving) {
+      RecursiveDoublingAllGather(ring, &step, buf, offsets);
+    } else {
+      RingAllGather(ring, &step, buf, offsets);
+    }
+  };
+  // each machine owns the chunks of its ranks
+  auto GetRankChunkOffsets = [&]() {
+    std::vector<size_t> offsets(num_machines + 1, size);
+    FOR_RANGE(int64_t, i, 0, num_machines) {
+      offsets.at(i) = ring.ranks4machine_idx(i).front() * chunk_size;
+    }
+    return offsets;
+  };
+  // sums the inputs of all local ranks into buf
+  auto ReduceLocalRanks = [&](char* buf) {
+    CopyIfNotSame(buf, first_request_info.send_buff, size);
+    for (const auto& rank7request_info : rank2request_info) {
+      if (rank7request_info.first == local_ranks.front()) { continue; }
+      AddTo(data_type, buf, static_cast<const char*>(rank7request_info.second.send_buff), size);
+    }
+  };
+  auto CopyToLocalRanks = [&](const char* buf) {
+    for (const auto& rank7request_info : rank2request_info) {
+      CopyIfNotSame(rank7request_info.second.recv_buff, buf, size);
+    }
+  };
+  const OpType op_type = op_desc.op_type();
+  if (op_type == OpType::kOpTypeAllReduce) {
+    char* buf = static_cast<char*>(first_request_info.recv_buff);
+    ReduceLocalRanks(buf);
+    if (num_machines > 1) {
+      std::vector<size_t> offsets(num_machines + 1);
+      const int64_t elem_cnt = Shape(op_desc.shape()).elem_cnt();
+      const size_t size_of_data_type = GetSizeOfDataType(data_type);
+      FOR_RANGE(int64_t, i, 0, num_machines + 1) {
+        offsets.at(i) = elem_cnt * i / num_machines * size_of_data_type;
+      }
+      ReduceScatter(buf, offsets);
+      AllGather(buf, offsets);
+    }
+    CopyToLocalRanks(buf);
+  } else if (op_type == OpType::kOpTypeReduceScatter) {
+    if (machine_buffer_.size() < size) { machine_buffer_.resize(size); }
+    char* buf = machine_buffer_.data();
+    ReduceLocalRanks(buf);
+    if (num_machines > 1) { ReduceScatter(buf, GetRankChunkOffsets()); }
+    for (const auto& rank7request_info : rank2request_info) {
+      std::memcpy(rank7request_info.second.recv_buff, buf + rank7request_info.first * chunk_size,
+                  chunk_size);
+    }
+  } else if (op_type == OpType::kOpTypeAllGather) {
+    char* buf = static_cast<char*>(first_request_info.recv_buff);
+    for (const auto& rank7request_info : rank2request_info) {
+      CopyIfNotSame(buf + rank7request_info.first * chunk_size,
+                    rank7request_info.second.send_buff, chunk_size);
+    }
+    if (num_machines > 1) { AllGather(buf, GetRankChunkOffsets()); }
+    CopyToLocalRanks(buf);
+  } else if (op_type == OpType::kOpTypeBroadcast) {
+    char* buf = static_cast<char*>(first_request_info.recv_buff);
+    const auto& root_it = rank2request_info.find(op_desc.root());
+    if (root_it != rank2request_info.end()) {
+      CopyIfNotSame(buf, root_it->second.send_buff, size);
+    }
+    if (num_machines > 1) {
+      BinomialTreeBroadcast(ring, &step, ring.machine_idx4rank(op_desc.root()), buf, size);
+    }
+    CopyToLocalRanks(buf);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
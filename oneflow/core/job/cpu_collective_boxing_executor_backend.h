@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+#define ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
+
+#include "oneflow/core/job/collective_boxing_executor.h"
+#include "oneflow/core/job/resource.pb.h"
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+// Executes requests of kBackendCPU. Ranks on the same machine live in this process and are
+// reduced or copied in place, machines talk to each other through Global<Transport> with ring or
+// recursive halving/doubling algorithms, broadcast uses a binomial tree.
+class CpuCollectiveBoxingExecutorBackend final : public CollectiveBoxingExecutorBackend {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveBoxingExecutorBackend);
+  CpuCollectiveBoxingExecutorBackend();
+  ~CpuCollectiveBoxingExecutorBackend() override;
+
+ private:
+  void GroupRequests(const std::vector<const RequestDesc*>& requests,
+                     std::vector<std::vector<const RequestDesc*>>* groups) override;
+  void ExecuteGroup(const std::vector<const RequestDesc*>& group,
+                    const std::vector<std::map<int64_t, RuntimeRequestInfo>>& ranks) override;
+
+  void ExecuteRequest(const RequestDesc* request,
+                      const std::map<int64_t, RuntimeRequestInfo>& rank2request_info);
+
+  const CollectiveBoxingConf collective_boxing_conf_;
+  int64_t fusion_threshold_;
+  // requests are executed one by one in the order of groups, which is the same on all machines,
+  // so that blocking on a peer never deadlocks
+  Channel<std::function<void()>> work_channel_;
+  std::thread worker_;
+  // only touched by worker_
+  HashMap<std::string, int64_t> name2execution_cnt_;
+  std::vector<char> machine_buffer_;
+  std::vector<char> recv_buffer_;
+};
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_CPU_COLLECTIVE_BOXING_EXECUTOR_BACKEND_H_
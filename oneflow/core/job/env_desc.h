@@ -31,6 +31,7 @@ class EnvDesc final {
   const Machine& machine(int32_t idx) const { return env_proto_.machine(idx); }
   int32_t ctrl_port() const { return env_proto_.ctrl_port(); }
   int32_t data_port() const { return env_proto_.data_port(); }
+  int32_t ctrl_tree_fanout() const { return env_proto_.ctrl_tree_fanout(); }
   bool has_ctrl_bootstrap_conf() const { return env_proto_.has_ctrl_bootstrap_conf(); }
   bool has_bootstrap_conf_ctrl_port() const {
     return has_ctrl_bootstrap_conf() && env_proto_.ctrl_bootstrap_conf().has_ctrl_port();
@@ -64,6 +64,35 @@ int64_t IDMgr::PickCpuThrdIdEvenly(int64_t machine_id) {
   return SerializeStreamIdToInt64(stream_id);
 }
 
+void IDMgr::DumpState(IDMgrState* state) const {
+  state->set_regst_desc_id_count(regst_desc_id_count_);
+  state->set_mem_block_id_count(mem_block_id_count_);
+  state->set_chunk_id_count(chunk_id_count_);
+  std::vector<std::pair<int64_t, int64_t>> stream_id7counters;
+  task_id_gen_.ForEachTaskIndexCounter(
+      [&](const StreamId& stream_id, TaskIdGenerator::task_index_t counter) {
+        stream_id7counters.emplace_back(SerializeStreamIdToInt64(stream_id), counter);
+      });
+  std::sort(stream_id7counters.begin(), stream_id7counters.end());
+  state->clear_task_index_counter();
+  for (const auto& pair : stream_id7counters) {
+    TaskIndexCounter* counter = state->add_task_index_counter();
+    counter->set_stream_id(pair.first);
+    counter->set_task_index(pair.second);
+  }
+}
+
+void IDMgr::RestoreState(const IDMgrState& state) {
+  regst_desc_id_count_ = state.regst_desc_id_count();
+  mem_block_id_count_ = state.mem_block_id_count();
+  chunk_id_count_ = state.chunk_id_count();
+  task_id_gen_.ClearTaskIndexCounters();
+  for (const TaskIndexCounter& counter : state.task_index_counter()) {
+    task_id_gen_.SetTaskIndexCounter(DeserializeStreamIdFromInt64(counter.stream_id()),
+                                     counter.task_index());
+  }
+}
+
 IDMgr::IDMgr() {
   CHECK_LT((Global<ResourceDesc, ForSession>::Get()->TotalMachineNum()),
            static_cast<int64_t>(1) << machine_id_bit_num_);
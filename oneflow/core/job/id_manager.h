@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/device/stream_index.h"
 #include "oneflow/core/graph/task_id_generator.h"
+#include "oneflow/core/job/plan_cache.pb.h"
 
 namespace oneflow {
 
@@ -67,6 +68,10 @@ class IDMgr final {
   StreamIndexGeneratorManager* GetStreamIndexGeneratorManager() { return &stream_index_gen_mgr_; }
   TaskIdGenerator* GetTaskIdGenerator() { return &task_id_gen_; }
 
+  // State of the id counters, task index counters are sorted by stream id
+  void DumpState(IDMgrState* state) const;
+  void RestoreState(const IDMgrState& state);
+
  private:
   friend class Global<IDMgr>;
   IDMgr();
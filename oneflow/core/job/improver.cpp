@@ -230,10 +230,13 @@ uint64_t CalcMemoryConsumed(
   for (const RegstDescProto* regst_desc : regst_descs) {
     uint64_t regst_num =
         CalcRegstNum(*regst_desc, PathDurations4RegstDescId, ii, PathIIScales4RegstDescId);
-    uint64_t total_byte_size = RtRegstDesc(*regst_desc).TotalMainByteSize4AllRegst();
+    const RtRegstDesc rt_regst_desc(*regst_desc);
     if (regst_desc->mem_block_id() == -1) {
+      // a regst with a memory block of its own takes regst_num times its size
+      const uint64_t total_byte_size = rt_regst_desc.MainByteSize4OneRegst() * regst_num;
       mem_consuming += RoundUp(total_byte_size, kCudaMemAllocAlignSize);
     } else {
+      uint64_t total_byte_size = rt_regst_desc.TotalMainByteSize4AllRegst();
       total_byte_size += regst_desc->mem_block_offset();
       CHECK_EQ(regst_num, 1);
       int32_t mem_block_id = regst_desc->mem_block_id();
@@ -716,6 +719,70 @@ Maybe<Plan> Improver::Improve(const AvailableMemDesc& amd, const Plan& naive_pla
   return plan;
 }
 
+Maybe<void> Improver::GenRegstNumPatch(const AvailableMemDesc& amd, const Plan& complete_plan,
+                                       const std::string& act_event_filepath,
+                                       RegstNumPatch* patch) {
+  amd_ = amd;
+  patch->Clear();
+  std::list<std::unique_ptr<ActEvent>> act_events;
+  ParseActEvents(act_event_filepath, &act_events);
+  if (act_events.empty()) { return Maybe<void>::Ok(); }
+  ChainActGraph chain_act_graph(complete_plan, std::move(act_events));
+
+  // Regsts sharing a memory block were planned with register_num == 1 and keep it. The others are
+  // released from their memory blocks so that their size scales with the tuned register_num.
+  HashMap<int64_t, int64_t> mem_block_id2regst_desc_num;
+  for (const auto& task : complete_plan.task()) {
+    for (const auto& pair : task.produced_regst_desc()) {
+      mem_block_id2regst_desc_num[pair.second.mem_block_id()] += 1;
+    }
+  }
+  Plan plan(complete_plan);
+  HashSet<int64_t> fixed_regst_desc_ids;
+  for (TaskProto& task : *plan.mutable_task()) {
+    for (auto& pair : *task.mutable_produced_regst_desc()) {
+      RegstDescProto* regst_desc = &pair.second;
+      if (mem_block_id2regst_desc_num.at(regst_desc->mem_block_id()) > 1) {
+        fixed_regst_desc_ids.insert(regst_desc->regst_desc_id());
+      } else {
+        regst_desc->set_mem_block_id(-1);
+        regst_desc->set_mem_block_offset(-1);
+      }
+    }
+  }
+  auto PathDurations4RegstDescId = MakeGetterPathDurations4RegstDescId(chain_act_graph);
+  auto PathIIScales4RegstDescId = MakeGetterPathIIScales4RegstDescId(chain_act_graph);
+  const HashMap<int64_t, double> empty;
+  auto PathDurations4TunedRegstDescId =
+      [&](int64_t regst_desc_id) -> const HashMap<int64_t, double>& {
+    if (fixed_regst_desc_ids.find(regst_desc_id) != fixed_regst_desc_ids.end()) { return empty; }
+    return PathDurations4RegstDescId(regst_desc_id);
+  };
+  const double base_ii = chain_act_graph.CalcBaseII();
+  Plan tuned_plan(plan);
+  JUST(ForEachImprovedRegstNum(plan, true, base_ii, PathDurations4TunedRegstDescId,
+                               PathIIScales4RegstDescId, MakeSetterSetPlanRegstNum(&tuned_plan)));
+  FixReliantCtrlRegstNum(tuned_plan, MakeGetterGetPlanRegstNum(&tuned_plan),
+                         MakeSetterSetPlanRegstNum(&tuned_plan));
+
+  patch->set_base_ii(base_ii);
+  FOR_RANGE(int64_t, i, 0, plan.task_size()) {
+    const TaskProto& task = plan.task(i);
+    const auto& tuned_produced_regst_desc = tuned_plan.task(i).produced_regst_desc();
+    for (const auto& pair : task.produced_regst_desc()) {
+      const int64_t register_num = tuned_produced_regst_desc.at(pair.first).register_num();
+      if (register_num == pair.second.register_num()) { continue; }
+      RegstNumPatchEntry* entry = patch->add_entry();
+      entry->set_producer_task_id(task.task_id());
+      entry->set_regst_name(pair.first);
+      entry->set_register_num(register_num);
+    }
+  }
+  LOG(INFO) << "regst num patch: base_ii " << base_ii << ", " << patch->entry_size()
+            << " regsts tuned";
+  return Maybe<void>::Ok();
+}
+
 Plan Improver::GenAndInferMemBlockId(const Plan& naive_plan) const {
   Plan plan(naive_plan);
   PlanTaskGraph plan_task_graph(naive_plan);
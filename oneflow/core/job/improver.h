@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/protobuf.h"
 #include "oneflow/core/memory/memory_case.pb.h"
 #include "oneflow/core/job/available_memory_desc.pb.h"
+#include "oneflow/core/job/regst_num_patch.pb.h"
 #include "oneflow/core/graph/chain_act_graph.h"
 
 namespace oneflow {
@@ -33,6 +34,10 @@ class Improver final {
   Maybe<Plan> Improve(const AvailableMemDesc& amd, const Plan& naive_plan,
                       const std::string& act_event_filepath);
   Maybe<Plan> GenAndInferMemBlockIdOnly(const AvailableMemDesc& amd, const Plan& naive_plan);
+  // Tunes register_num of the regsts with a memory block of their own from the act events measured
+  // on complete_plan, within the available memory. Only changed register_num go into the patch.
+  Maybe<void> GenRegstNumPatch(const AvailableMemDesc& amd, const Plan& complete_plan,
+                               const std::string& act_event_filepath, RegstNumPatch* patch);
 
  private:
   Plan GenAndInferMemBlockId(const Plan& naive_plan) const;
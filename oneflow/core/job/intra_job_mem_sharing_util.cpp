@@ -27,6 +27,7 @@ enum MemAllocAlgoType {
   kMemSizeFirstAlgo = 0,
   kMutualExclusionFirstAlgo = 1,
   kTimeLineAlgo = 2,
+  kLifetimeBestFitAlgo = 3,
 };
 
 }  // namespace oneflow
@@ -592,6 +593,131 @@ void MemReusedAlgorithm_TimeLineAlgo(
   result->mem_block_size = bfc_allocator.buffer_size();
 }
 
+void MemReusedAlgorithm_LifetimeBestFitAlgo(
+    const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+    const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
+    const HashMap<RegstDescProto*, HashSet<RegstDescProto*>>& regst2mutual_exclusion_regsts,
+    MemBlockResultInfo* result) {
+  HashMap<RegstDescProto*, int64_t> regst_desc2alloc_index;
+  HashMap<RegstDescProto*, int64_t> regst_desc2lifetime;
+  CHECK_EQ(alloc_regsts_timeline.size(), free_regsts_timeline.size());
+  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
+    for (RegstDescProto* alloc_regst : alloc_regsts_timeline.at(i)) {
+      CHECK(regst_desc2alloc_index.emplace(alloc_regst, i).second);
+    }
+    for (RegstDescProto* free_regst : free_regsts_timeline.at(i)) {
+      CHECK(regst_desc2lifetime.emplace(free_regst, i - regst_desc2alloc_index.at(free_regst) + 1)
+                .second);
+    }
+  }
+  std::vector<RegstDescProto*> order;
+  HashMap<RegstDescProto*, int64_t> regst_desc2size;
+  for (const auto& pair : regst2mutual_exclusion_regsts) {
+    order.push_back(pair.first);
+    CHECK(regst_desc2size.emplace(pair.first, RtRegstDesc(*pair.first).TotalMainByteSize4AllRegst())
+              .second);
+  }
+  // greedy by size, long living regsts first among the same size
+  std::sort(order.begin(), order.end(), [&](RegstDescProto* lhs, RegstDescProto* rhs) {
+    const int64_t lhs_size = regst_desc2size.at(lhs);
+    const int64_t rhs_size = regst_desc2size.at(rhs);
+    if (lhs_size != rhs_size) { return lhs_size > rhs_size; }
+    const int64_t lhs_lifetime = regst_desc2lifetime.at(lhs);
+    const int64_t rhs_lifetime = regst_desc2lifetime.at(rhs);
+    if (lhs_lifetime != rhs_lifetime) { return lhs_lifetime > rhs_lifetime; }
+    return lhs->regst_desc_id() < rhs->regst_desc_id();
+  });
+  HashMap<RegstDescProto*, int64_t>* regst_desc2offset = &(result->regst_desc2offset);
+  int64_t buffer_size = 1;
+  for (RegstDescProto* regst_desc : order) {
+    // only the regsts whose lifetime overlaps with this one constrain its offset
+    std::vector<std::pair<int64_t, int64_t>> occupied_ranges;
+    for (RegstDescProto* mutual_regst : regst2mutual_exclusion_regsts.at(regst_desc)) {
+      const auto offset_it = regst_desc2offset->find(mutual_regst);
+      if (offset_it == regst_desc2offset->end()) { continue; }
+      occupied_ranges.emplace_back(offset_it->second,
+                                   offset_it->second + regst_desc2size.at(mutual_regst));
+    }
+    std::sort(occupied_ranges.begin(), occupied_ranges.end());
+    const int64_t size = regst_desc2size.at(regst_desc);
+    int64_t best_offset = -1;
+    int64_t best_gap_size = GetMaxVal<int64_t>();
+    auto TryGap = [&](int64_t begin, int64_t end) {
+      const int64_t gap_size = end - begin;
+      if (gap_size >= size && gap_size < best_gap_size) {
+        best_offset = begin;
+        best_gap_size = gap_size;
+      }
+    };
+    int64_t free_begin = 0;
+    for (const auto& range : occupied_ranges) {
+      TryGap(free_begin, range.first);
+      free_begin = std::max(free_begin, range.second);
+    }
+    TryGap(free_begin, buffer_size);
+    if (best_offset == -1) { best_offset = free_begin; }
+    buffer_size = std::max(buffer_size, best_offset + size);
+    CHECK(regst_desc2offset->emplace(regst_desc, best_offset).second);
+  }
+  result->mem_block_size = buffer_size;
+}
+
+void MemReusedAlgorithm_LocalSearchRefine(
+    const HashMap<RegstDescProto*, HashSet<RegstDescProto*>>& regst2mutual_exclusion_regsts,
+    int64_t lower_bound, int64_t time_limit_ms, int64_t seed, MemBlockResultInfo* result) {
+  HashMap<RegstDescProto*, int64_t> regst_desc2size;
+  std::vector<RegstDescProto*> order;
+  for (const auto& pair : result->regst_desc2offset) {
+    order.push_back(pair.first);
+    CHECK(regst_desc2size.emplace(pair.first, RtRegstDesc(*pair.first).TotalMainByteSize4AllRegst())
+              .second);
+  }
+  if (order.size() < 2) { return; }
+  // allocating by the order of current offsets never gives a larger mem block, so the search
+  // starts from the current result and walks through its neighbours by swapping two regsts
+  std::sort(order.begin(), order.end(), [&](RegstDescProto* lhs, RegstDescProto* rhs) {
+    const int64_t lhs_offset = result->regst_desc2offset.at(lhs);
+    const int64_t rhs_offset = result->regst_desc2offset.at(rhs);
+    if (lhs_offset != rhs_offset) { return lhs_offset < rhs_offset; }
+    return regst_desc2size.at(lhs) > regst_desc2size.at(rhs);
+  });
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> dis(0, order.size() - 1);
+  const double deadline = GetCurTime() + time_limit_ms * 1e6;
+  while (static_cast<int64_t>(result->mem_block_size) > lower_bound && GetCurTime() < deadline) {
+    const size_t i = dis(gen);
+    const size_t j = dis(gen);
+    if (i == j) { continue; }
+    std::swap(order.at(i), order.at(j));
+    MemBlockResultInfo candidate;
+    MemReusedAlgorithm_AllocateByOrderAndMutualExclusion(order, regst_desc2size,
+                                                         regst2mutual_exclusion_regsts, &candidate);
+    if (candidate.mem_block_size <= result->mem_block_size) {
+      *result = std::move(candidate);
+    } else {
+      std::swap(order.at(i), order.at(j));
+    }
+  }
+}
+
+int64_t CalcPeakLiveMemSize(const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
+                            const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline) {
+  int64_t live_size = 0;
+  int64_t peak_live_size = 0;
+  CHECK_EQ(alloc_regsts_timeline.size(), free_regsts_timeline.size());
+  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
+    for (RegstDescProto* alloc_regst : alloc_regsts_timeline.at(i)) {
+      live_size += RtRegstDesc(*alloc_regst).TotalMainByteSize4AllRegst();
+    }
+    peak_live_size = std::max(peak_live_size, live_size);
+    for (RegstDescProto* free_regst : free_regsts_timeline.at(i)) {
+      live_size -= RtRegstDesc(*free_regst).TotalMainByteSize4AllRegst();
+    }
+  }
+  CHECK_EQ(live_size, 0);
+  return peak_live_size;
+}
+
 void SelectAlgorithmGenMemBlockOffset4Regsts(
     MemAllocAlgoType algo_id, const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
     const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
@@ -609,6 +735,10 @@ void SelectAlgorithmGenMemBlockOffset4Regsts(
     case kTimeLineAlgo:
       MemReusedAlgorithm_TimeLineAlgo(alloc_regsts_timeline, free_regsts_timeline, result);
       break;
+    case kLifetimeBestFitAlgo:
+      MemReusedAlgorithm_LifetimeBestFitAlgo(alloc_regsts_timeline, free_regsts_timeline,
+                                             regst2mutual_exclusion_regsts, result);
+      break;
     default: UNIMPLEMENTED();
   }
   CHECK_GT(result->mem_block_size, 0);
@@ -622,6 +752,7 @@ int64_t CountMemAllocAlgoNum() {
   if (mem_alloc_algo_conf.use_mem_size_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_mutual_exclusion_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_time_line_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.use_lifetime_best_fit_algo()) { ++ret; }
   CHECK_GE(ret, 0);
   return ret;
 }
@@ -639,6 +770,20 @@ void InitAlgo2Result(HashMap<MemAllocAlgoType, MemBlockResultInfo>* algo2result)
   if (mem_alloc_algo_conf.use_time_line_algo()) {
     CHECK(algo2result->emplace(kTimeLineAlgo, MemBlockResultInfo()).second);
   }
+  if (mem_alloc_algo_conf.use_lifetime_best_fit_algo()) {
+    CHECK(algo2result->emplace(kLifetimeBestFitAlgo, MemBlockResultInfo()).second);
+  }
+}
+
+std::string MemAllocAlgoTypeName(MemAllocAlgoType algo_id) {
+  switch (algo_id) {
+    case kMemSizeFirstAlgo: return "MemSizeFirstAlgo";
+    case kMutualExclusionFirstAlgo: return "MutualExclusionFirstAlgo";
+    case kTimeLineAlgo: return "TimeLineAlgo";
+    case kLifetimeBestFitAlgo: return "LifetimeBestFitAlgo";
+    default: UNIMPLEMENTED();
+  }
+  return "";
 }
 
 }  // namespace
@@ -698,15 +843,118 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(Plan* plan,
     counter.WaitUntilCntEqualZero();
   }
 
-  // step 3: choose best one for each mem chain and set offset for inplace consumer regst
-  for (const auto& pair : mem_chain2algo2result) {
-    const MemBlockResultInfo* best_result = nullptr;
-    for (const auto& algo_result_pair : pair.second) {
+  // step 3: choose best one for each mem chain and refine it by local search in limited time
+  HashMap<int64_t, std::pair<MemAllocAlgoType, MemBlockResultInfo*>> mem_chain2best_result;
+  HashMap<int64_t, int64_t> mem_chain2lower_bound;
+  for (auto& pair : mem_chain2algo2result) {
+    MemAllocAlgoType best_algo_id = kMemSizeFirstAlgo;
+    MemBlockResultInfo* best_result = nullptr;
+    for (auto& algo_result_pair : pair.second) {
       if (!best_result || algo_result_pair.second.mem_block_size < best_result->mem_block_size) {
+        best_algo_id = algo_result_pair.first;
         best_result = &algo_result_pair.second;
       }
     }
     CHECK(best_result != nullptr);
+    mem_chain2best_result.emplace(pair.first, std::make_pair(best_algo_id, best_result));
+    mem_chain2lower_bound.emplace(
+        pair.first, CalcPeakLiveMemSize(mem_chain2task2alloc_regsts.at(pair.first),
+                                        mem_chain2task2free_regsts.at(pair.first)));
+  }
+  const int64_t local_search_time_limit_ms =
+      GlobalJobDesc().job_conf().memory_allocation_algorithm_conf().local_search_time_limit_ms();
+  HashMap<int64_t, int64_t> mem_chain2size_before_local_search;
+  if (local_search_time_limit_ms > 0) {
+    BlockingCounter counter(mem_chains.size());
+    ThreadPool thread_pool(
+        std::min<int64_t>(mem_chains.size(), std::thread::hardware_concurrency()));
+    for (int64_t mem_chain_id : mem_chains) {
+      MemBlockResultInfo* result = mem_chain2best_result.at(mem_chain_id).second;
+      mem_chain2size_before_local_search.emplace(mem_chain_id, result->mem_block_size);
+      const int64_t lower_bound = mem_chain2lower_bound.at(mem_chain_id);
+      thread_pool.AddWork([mem_chain_id, lower_bound, local_search_time_limit_ms,
+                           &mem_chain2regst2mutual_exclusion_regsts, result, &counter]() {
+        MemReusedAlgorithm_LocalSearchRefine(
+            mem_chain2regst2mutual_exclusion_regsts.at(mem_chain_id), lower_bound,
+            local_search_time_limit_ms, mem_chain_id, result);
+        counter.Decrease();
+      });
+    }
+    counter.WaitUntilCntEqualZero();
+  }
+
+  // step 4: report mem block size against the peak live size which no algorithm can go below
+  {
+    std::vector<int64_t> sorted_mem_chains(mem_chains.begin(), mem_chains.end());
+    std::sort(sorted_mem_chains.begin(), sorted_mem_chains.end());
+    std::ostringstream report;
+    for (int64_t mem_chain_id : sorted_mem_chains) {
+      const TaskProto* first_task = mem_chain2sorted_tasks.at(mem_chain_id).front();
+      const auto& best_result = mem_chain2best_result.at(mem_chain_id);
+      const int64_t mem_block_size = best_result.second->mem_block_size;
+      const int64_t lower_bound = mem_chain2lower_bound.at(mem_chain_id);
+      report << "\n  mem_chain " << mem_chain_id << " (machine " << first_task->machine_id()
+             << ", gpu " << Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(first_task->thrd_id())
+             << "): regst_num " << best_result.second->regst_desc2offset.size()
+             << ", mem_block_size " << mem_block_size << " by "
+             << MemAllocAlgoTypeName(best_result.first);
+      const auto before_it = mem_chain2size_before_local_search.find(mem_chain_id);
+      if (before_it != mem_chain2size_before_local_search.end()
+          && before_it->second != mem_block_size) {
+        report << " and local search (from " << before_it->second << ")";
+      }
+      report << ", lower_bound " << lower_bound;
+      if (lower_bound > 0) {
+        report << ", overhead " << 100.0 * (mem_block_size - lower_bound) / lower_bound << "%";
+      }
+    }
+    LOG(INFO) << "job_id: " << GlobalJobDesc().job_id() << " , mem block report:" << report.str();
+  }
+  // verify the recomputation chosen by CheckpointingPass against the device memory really planned:
+  // the reused mem blocks of all the chains on a device plus the regsts which are not reused, such
+  // as the variables and the regsts with more than one register
+  const int64_t memory_budget_mbyte =
+      GlobalJobDesc().job_conf().auto_checkpointing_memory_budget_mbyte();
+  if (memory_budget_mbyte > 0) {
+    const int64_t memory_budget = memory_budget_mbyte * 1024 * 1024;
+    HashMap<int64_t, int64_t> device_unique_id2mem_size;
+    HashSet<const RegstDescProto*> planned_regsts;
+    for (int64_t mem_chain_id : mem_chains) {
+      const TaskProto* first_task = mem_chain2sorted_tasks.at(mem_chain_id).front();
+      const int64_t device_unique_id = GenDeviceUniqueId(
+          first_task->machine_id(),
+          Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(first_task->thrd_id()));
+      device_unique_id2mem_size[device_unique_id] +=
+          mem_chain2best_result.at(mem_chain_id).second->mem_block_size;
+      for (const RegstDescProto* regst_desc : mem_chain2mem_reused_regsts.at(mem_chain_id)) {
+        planned_regsts.insert(regst_desc);
+      }
+    }
+    for (int64_t i = 0; i < plan->task_size(); ++i) {
+      const TaskProto& task = plan->task(i);
+      for (const auto& pair : task.produced_regst_desc()) {
+        const RegstDescProto& regst_desc = pair.second;
+        if (!regst_desc.mem_case().has_device_cuda_mem()) { continue; }
+        if (planned_regsts.find(&regst_desc) != planned_regsts.end()) { continue; }
+        const int64_t device_unique_id = GenDeviceUniqueId(
+            task.machine_id(), regst_desc.mem_case().device_cuda_mem().device_id());
+        device_unique_id2mem_size[device_unique_id] +=
+            RtRegstDesc(regst_desc).TotalMainByteSize4AllRegst();
+      }
+    }
+    for (const auto& pair : device_unique_id2mem_size) {
+      if (pair.second > memory_budget) {
+        LOG(WARNING) << "machine " << (pair.first >> 32) << ", gpu " << (pair.first & 0xffffffff)
+                     << " needs " << pair.second
+                     << " bytes which exceeds auto_checkpointing_memory_budget_mbyte "
+                     << memory_budget_mbyte;
+      }
+    }
+  }
+
+  // step 5: set mem block id and offset for regsts and inplace consumer regsts
+  for (const auto& pair : mem_chain2algo2result) {
+    const MemBlockResultInfo* best_result = mem_chain2best_result.at(pair.first).second;
     int64_t mem_block_id = Global<IDMgr>::Get()->NewMemBlockId();
     CHECK_EQ(mem_chain2mem_reused_regsts.at(pair.first).size(),
              (best_result->regst_desc2offset.size()
@@ -16,7 +16,9 @@ limitations under the License.
 #include "oneflow/core/common/range.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/common/id_util.h"
 #include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/chunked_kv.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/common/buffer_manager.h"
 #include "oneflow/core/job/compiler.h"
@@ -35,6 +37,9 @@ limitations under the License.
 #include "oneflow/core/job/model_io_job.h"
 #include "oneflow/core/job/inter_job_mem_sharing_util.h"
 #include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/job/regst_num_patch.h"
+#include "oneflow/core/job_rewriter/job_completer.h"
 #include "oneflow/core/operator/interface_op_util.h"
 #include "oneflow/core/job/critical_section_desc.h"
 #include "oneflow/core/job/global_for.h"
@@ -42,6 +47,8 @@ limitations under the License.
 #include "oneflow/core/graph/plan_task_graph.h"
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/memory_report.h"
+#include "oneflow/core/profiler/compile_stats.h"
 
 namespace std {
 
@@ -83,13 +90,8 @@ std::string cluster_thrd_ids_key(const std::string& plan_name) {
   return plan_name + "_cluster_thrd_ids";
 }
 
-std::string net_topo_key(const std::string& plan_name) { return plan_name + "_net_topo"; }
-
-std::string job_id2job_conf(const std::string& plan_name) { return plan_name + "_job_id2job_conf"; }
-
-std::string GetCollectiveBoxingPlanKey(const std::string& plan_name) {
-  return plan_name + "_collective_boxing_plan";
-}
+// net topo, job confs and collective boxing plan, which are needed by all machines
+std::string shared_plan_key(const std::string& plan_name) { return plan_name + "_shared_plan"; }
 
 std::string sub_plan_key(const std::string& plan_name, int64_t machine_id, int64_t thrd_id) {
   return plan_name + "_" + std::to_string(machine_id) + "_" + std::to_string(thrd_id);
@@ -108,7 +110,30 @@ std::shared_ptr<OperatorConf> CreateSinkTickOpConf(const std::string& in_op_name
   return tick_op;
 }
 
-void PushPlan(const std::string& plan_name, const Plan& plan) {
+std::string relayed_key(const std::string& key, int64_t relay_machine_id) {
+  return key + "_relayed_by_" + std::to_string(relay_machine_id);
+}
+
+// the master holds the first copy of the shared parts, and every worker pulls them from its parent
+// in a tree of relay_fanout, or from the master if relay_fanout is 0
+int64_t RelayParentMachineId(int64_t machine_id) {
+  CHECK_GT(machine_id, 0);
+  const int64_t fanout =
+      Global<ResourceDesc, ForSession>::Get()->plan_distribution_conf().relay_fanout();
+  return fanout > 0 ? (machine_id - 1) / fanout : 0;
+}
+
+bool HasRelayChildren(int64_t machine_id) {
+  const int64_t fanout =
+      Global<ResourceDesc, ForSession>::Get()->plan_distribution_conf().relay_fanout();
+  return fanout > 0
+         && machine_id * fanout + 1 < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
+}
+
+double SecondsSince(double start) { return (GetCurTime() - start) / 1e9; }
+
+void PushPlan(const std::string& plan_name, const Plan& plan, std::vector<std::string>* keys) {
+  const double start = GetCurTime();
   HashMap<int64_t, std::set<int64_t>> machine_id2thrd_id_set;
   HashMap<std::pair<int64_t, int64_t>, std::vector<TaskProto>> mchn_thrd_id2task_protos;
   HashMap<int64_t, MemBlockAndChunkList> machine_id2block7chunk;
@@ -127,13 +152,20 @@ void PushPlan(const std::string& plan_name, const Plan& plan) {
 
   ClusterThrdIds cluster_thrd_ids;
   *(cluster_thrd_ids.mutable_machine_id2thrd_ids()) = HashMap2PbMap(machine_id2thrd_ids);
-  Global<CtrlClient>::Get()->PushKV(cluster_thrd_ids_key(plan_name), cluster_thrd_ids);
-
+  Plan shared_plan;
+  *(shared_plan.mutable_net_topo()) = plan.net_topo();
+  *(shared_plan.mutable_job_confs()) = plan.job_confs();
+  *(shared_plan.mutable_collective_boxing_plan()) = plan.collective_boxing_plan();
+  std::vector<std::pair<std::string, const PbMessage*>> key7msgs;
+  key7msgs.emplace_back(relayed_key(cluster_thrd_ids_key(plan_name), 0), &cluster_thrd_ids);
+  key7msgs.emplace_back(relayed_key(shared_plan_key(plan_name), 0), &shared_plan);
+
+  std::vector<SubPlan> sub_plans(mchn_thrd_id2task_protos.size());
+  size_t sub_plan_idx = 0;
   for (const auto& pair : mchn_thrd_id2task_protos) {
-    SubPlan sub_plan;
-    *(sub_plan.mutable_task()) = StdVec2PbRpf(pair.second);
-    Global<CtrlClient>::Get()->PushKV(sub_plan_key(plan_name, pair.first.first, pair.first.second),
-                                      sub_plan);
+    SubPlan* sub_plan = &sub_plans.at(sub_plan_idx++);
+    *(sub_plan->mutable_task()) = StdVec2PbRpf(pair.second);
+    key7msgs.emplace_back(sub_plan_key(plan_name, pair.first.first, pair.first.second), sub_plan);
   }
 
   for (const auto& mem_block : plan.block_chunk_list().mem_block()) {
@@ -143,41 +175,66 @@ void PushPlan(const std::string& plan_name, const Plan& plan) {
     *machine_id2block7chunk[chunk.machine_id()].add_chunk() = chunk;
   }
   for (const auto& pair : machine_id2block7chunk) {
-    Global<CtrlClient>::Get()->PushKV(block7chunk_key(plan_name, pair.first), pair.second);
+    key7msgs.emplace_back(block7chunk_key(plan_name, pair.first), &pair.second);
   }
-
-  Global<CtrlClient>::Get()->PushKV(net_topo_key(plan_name), plan.net_topo());
-  Global<CtrlClient>::Get()->PushKV(job_id2job_conf(plan_name), plan.job_confs());
-  Global<CtrlClient>::Get()->PushKV(GetCollectiveBoxingPlanKey(plan_name),
-                                    plan.collective_boxing_plan());
+  const double split_seconds = SecondsSince(start);
+
+  const double push_start = GetCurTime();
+  const auto& conf = Global<ResourceDesc, ForSession>::Get()->plan_distribution_conf();
+  const size_t pushed_byte_size = ChunkedKVUtil::PushKVs(key7msgs, conf.chunk_kbyte() * 1024,
+                                                         conf.enable_compression());
+  for (const auto& pair : key7msgs) { keys->push_back(pair.first); }
+  LOG(INFO) << "PushPlan " << plan_name << ": split " << split_seconds << " seconds, push "
+            << SecondsSince(push_start) << " seconds, " << key7msgs.size() << " values in "
+            << pushed_byte_size << " bytes";
 }
 
-void PullPlan(const std::string& plan_name, Plan* plan) {
+void PullPlan(const std::string& plan_name, Plan* plan, std::vector<std::string>* keys) {
+  const int64_t machine_id = GlobalProcessCtx::Rank();
+  const double start = GetCurTime();
   ClusterThrdIds cluster_thrd_ids;
-  Global<CtrlClient>::Get()->PullKV(cluster_thrd_ids_key(plan_name), &cluster_thrd_ids);
+  Plan shared_plan;
+  std::vector<std::string> relay_keys;
+  if (HasRelayChildren(machine_id)) {
+    relay_keys.push_back(relayed_key(cluster_thrd_ids_key(plan_name), machine_id));
+    relay_keys.push_back(relayed_key(shared_plan_key(plan_name), machine_id));
+  }
+  const int64_t parent_machine_id = RelayParentMachineId(machine_id);
+  const size_t shared_byte_size = ChunkedKVUtil::PullKVs(
+      {{relayed_key(cluster_thrd_ids_key(plan_name), parent_machine_id), &cluster_thrd_ids},
+       {relayed_key(shared_plan_key(plan_name), parent_machine_id), &shared_plan}},
+      relay_keys);
+  keys->insert(keys->end(), relay_keys.begin(), relay_keys.end());
+  const double shared_seconds = SecondsSince(start);
   PrintProtoToTextFile(cluster_thrd_ids, JoinPath(FLAGS_log_dir, cluster_thrd_ids_key(plan_name)));
+
+  const double own_start = GetCurTime();
   HashMap<int64_t, ThrdIds> machine_id2thrd_ids;
   machine_id2thrd_ids = PbMap2HashMap(cluster_thrd_ids.machine_id2thrd_ids());
-  int64_t machine_id = GlobalProcessCtx::Rank();
   auto thrd_ids_it = machine_id2thrd_ids.find(machine_id);
   CHECK(thrd_ids_it != machine_id2thrd_ids.end());
   std::vector<int64_t> thrd_id_vec = PbRf2StdVec(thrd_ids_it->second.thrd_id());
-  for (auto thrd_id : thrd_id_vec) {
-    SubPlan sub_plan;
-    Global<CtrlClient>::Get()->PullKV(sub_plan_key(plan_name, machine_id, thrd_id), &sub_plan);
-    plan->mutable_task()->MergeFrom(sub_plan.task());
-  }
-  NetTopo net_topo;
-  Global<CtrlClient>::Get()->PullKV(net_topo_key(plan_name), &net_topo);
-  *(plan->mutable_net_topo()) = net_topo;
-  JobConfs job_confs;
-  Global<CtrlClient>::Get()->PullKV(job_id2job_conf(plan_name), &job_confs);
-  *(plan->mutable_job_confs()) = job_confs;
-  Global<CtrlClient>::Get()->PullKV(GetCollectiveBoxingPlanKey(plan_name),
-                                    plan->mutable_collective_boxing_plan());
+  std::vector<SubPlan> sub_plans(thrd_id_vec.size());
   MemBlockAndChunkList block7chunk;
-  Global<CtrlClient>::Get()->PullKV(block7chunk_key(plan_name, machine_id), &block7chunk);
+  std::vector<std::pair<std::string, PbMessage*>> key7msgs;
+  FOR_RANGE(size_t, i, 0, thrd_id_vec.size()) {
+    key7msgs.emplace_back(sub_plan_key(plan_name, machine_id, thrd_id_vec.at(i)), &sub_plans.at(i));
+  }
+  key7msgs.emplace_back(block7chunk_key(plan_name, machine_id), &block7chunk);
+  const size_t own_byte_size = ChunkedKVUtil::PullKVs(key7msgs, {});
+  const double own_seconds = SecondsSince(own_start);
+
+  const double merge_start = GetCurTime();
+  for (const auto& sub_plan : sub_plans) { plan->mutable_task()->MergeFrom(sub_plan.task()); }
+  *(plan->mutable_net_topo()) = shared_plan.net_topo();
+  *(plan->mutable_job_confs()) = shared_plan.job_confs();
+  *(plan->mutable_collective_boxing_plan()) = shared_plan.collective_boxing_plan();
   plan->mutable_block_chunk_list()->CopyFrom(block7chunk);
+  LOG(INFO) << "PullPlan " << plan_name << ": shared parts from machine " << parent_machine_id
+            << " " << shared_seconds << " seconds in " << shared_byte_size << " bytes"
+            << (relay_keys.empty() ? "" : " and relayed") << ", own parts " << own_seconds
+            << " seconds in " << own_byte_size << " bytes, merge " << SecondsSince(merge_start)
+            << " seconds";
 }
 
 bool IsCollectiveBoxingNode(const PlanTaskNode* node) {
@@ -199,12 +256,23 @@ const boxing::collective::RankDesc& GetRankDesc(const TaskProto& task_proto) {
       task_proto.exec_sequence().exec_node(0).kernel_conf().op_attribute().op_conf());
 }
 
+const LogicalBlobId& GetCollectiveBoxingLbi(const TaskProto& task_proto) {
+  CHECK_EQ(task_proto.exec_sequence().exec_node_size(), 1);
+  const OperatorConf& conf =
+      task_proto.exec_sequence().exec_node(0).kernel_conf().op_attribute().op_conf();
+  CHECK(conf.has_collective_boxing_generic_conf());
+  return conf.collective_boxing_generic_conf().lbi();
+}
+
 void GetDeviceDesc(const TaskProto* task_proto, boxing::collective::DeviceDesc* device_desc) {
   device_desc->set_machine_id(task_proto->machine_id());
   const int64_t thrd_id = Global<IDMgr>::Get()->ThrdId4ActorId(task_proto->task_id());
   device_desc->set_device_type(Global<IDMgr>::Get()->GetDeviceTypeFromThrdId(thrd_id));
   if (device_desc->device_type() == DeviceType::kGPU) {
     device_desc->set_device_id(Global<IDMgr>::Get()->GetGpuPhyIdFromThrdId(thrd_id));
+  } else if (device_desc->device_type() == DeviceType::kCPU) {
+    // all cpu ranks of a machine share one device, they are told apart by rank
+    device_desc->set_device_id(DeviceId::kCPUDeviceIndex);
   } else {
     UNIMPLEMENTED();
   }
@@ -307,6 +375,12 @@ void GenCollectiveBoxingPlan(Job* job, Plan* plan) {
         }
         request_desc->set_order(info.order);
         request_desc->set_dependency_depth(info.dependency_depth);
+        const auto& lbn2bucket_id = job->helper().lbn2gradient_bucket_id();
+        const auto bucket_it = lbn2bucket_id.find(
+            GenLogicalBlobName(GetCollectiveBoxingLbi(*info.rank2node.at(0)->task_proto())));
+        if (bucket_it != lbn2bucket_id.end()) {
+          request_desc->set_gradient_bucket_id(bucket_it->second);
+        }
       } else {
         CHECK_LT(info.rank2node.size(), info.op_desc.num_ranks());
         for (const auto& pair : info.rank2node) { visited.erase(pair.second); }
@@ -323,9 +397,26 @@ Maybe<void> CompileCurJobOnMaster(Job* job, Plan* improved_plan, bool need_job_c
   Plan naive_plan;
   if (GlobalProcessCtx::IsThisProcessMaster()) {
     double start = GetCurTime();
-    Compiler().Compile(job, &naive_plan, need_job_complete);
-    *improved_plan =
-        *JUST(Improver().GenAndInferMemBlockIdOnly(*Global<AvailableMemDesc>::Get(), naive_plan));
+    std::string fingerprint;
+    if (PlanCacheUtil::Enabled()) {
+      // the fingerprint is computed on the completed job
+      if (need_job_complete) { JobCompleter().Complete(job); }
+      need_job_complete = false;
+      fingerprint = PlanCacheUtil::GenFingerprint(*job);
+    }
+    if (fingerprint.empty() || !PlanCacheUtil::TryLoad(fingerprint, improved_plan)) {
+      Compiler().Compile(job, &naive_plan, need_job_complete);
+      RegstNumPatch regst_num_patch;
+      if (RegstNumPatchUtil::TryLoad(&regst_num_patch)) {
+        RegstNumPatchUtil::Apply(regst_num_patch, &naive_plan);
+      }
+      profiler::CompileStageTimer timer(job_desc.job_id());
+      *improved_plan = *JUST(
+          Improver().GenAndInferMemBlockIdOnly(*Global<AvailableMemDesc>::Get(), naive_plan));
+      timer.Tick("Improver::GenAndInferMemBlockIdOnly");
+      LOG(INFO) << "job_id: " << job_desc.job_id() << " , improve stages:" << timer.ToString();
+      if (!fingerprint.empty()) { PlanCacheUtil::Store(fingerprint, *improved_plan); }
+    }
     LOG(INFO) << "\njob_id: " << job_desc.job_id() << " , job_name: " << job_desc.job_name()
               << " , compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds.\n";
     if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
@@ -1061,6 +1152,7 @@ Maybe<void> CompileAndMergePlanOnMaster(const PbRpf<Job>& conf_jobs, Plan* plan)
     auto scope = std::make_unique<GlobalJobDescScope>(jobs.at(i)->job_conf(), i);
     JUST(CompileCurJobOnMaster(jobs.at(i).get(), &sub_plans.at(i), true));
   }
+  std::vector<std::string> plan_keys;
   if (GlobalProcessCtx::IsThisProcessMaster()) {
     MergeSubPlanWithoutGenNetTopo(plan, sub_plans);
     InterJobMemSharingUtil::MergeMemReusedChunkBetweenUserJobs(function_jobs, plan);
@@ -1082,14 +1174,30 @@ Maybe<void> CompileAndMergePlanOnMaster(const PbRpf<Job>& conf_jobs, Plan* plan)
       TeePersistentLogStream::Create("merged_plan")->Write(*plan);
       PlanUtil::ToDotFile(*plan, "/dot/merged_plan.dot");
     }
-    PushPlan("merged_plan", *plan);
+    const ProfilerConf& profiler_conf = *Global<const ProfilerConf>::Get();
+    if (profiler_conf.memory_report()) {
+      std::string json;
+      std::string html;
+      profiler::GenMemoryReport(*plan, profiler_conf.memory_report_top_num(), &json, &html);
+      TeePersistentLogStream::Create("memory_report.json")->Write(json);
+      TeePersistentLogStream::Create("memory_report.html")->Write(html);
+    }
+    if (profiler_conf.compile_stats_report()) {
+      TeePersistentLogStream::Create("compile_stats.json")
+          ->Write(Global<profiler::CompileStats>::Get()->ToJson());
+    }
+    if (Global<ResourceDesc, ForSession>::Get()->TotalMachineNum() > 1) {
+      PushPlan("merged_plan", *plan, &plan_keys);
+    }
   } else {
-    PullPlan("merged_plan", plan);
+    PullPlan("merged_plan", plan, &plan_keys);
     if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
       TeePersistentLogStream::Create("merged_plan")->Write(*plan);
     }
   }
   OF_SESSION_BARRIER();
+  // every machine clears the values it pushed once all machines got their plan
+  ChunkedKVUtil::ClearKVs(plan_keys);
   return Maybe<void>::Ok();
 }
 
@@ -1113,9 +1221,21 @@ Maybe<void> Oneflow::Init(const oneflow::JobSet& job_set) {
 Oneflow::~Oneflow() {
   if (GlobalProcessCtx::IsThisProcessMaster()) { runtime_buffers_scope_.reset(); }
   runtime_.reset();
+  const std::string act_event_filepath =
+      JoinPath(FLAGS_log_dir, ActEventLogger::act_event_bin_filename());
   if (Global<Profiler>::Get() != nullptr) {
-    Global<Profiler>::Get()->Profile(
-        plan_, JoinPath(FLAGS_log_dir, ActEventLogger::act_event_bin_filename()));
+    Global<Profiler>::Get()->Profile(plan_, act_event_filepath);
+  }
+  if (GlobalProcessCtx::IsThisProcessMaster()
+      && Global<const ProfilerConf>::Get()->tune_regst_num()) {
+    RegstNumPatch regst_num_patch;
+    const auto& status = TRY(Improver().GenRegstNumPatch(
+        *Global<AvailableMemDesc>::Get(), plan_, act_event_filepath, &regst_num_patch));
+    if (status.IsOk()) {
+      RegstNumPatchUtil::Dump(regst_num_patch);
+    } else {
+      LOG(WARNING) << "failed to tune register_num: " << status.GetSerializedError();
+    }
   }
 }
 
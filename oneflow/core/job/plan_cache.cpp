@@ -0,0 +1,220 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/job/plan_cache.pb.h"
+#include "oneflow/core/job/regst_num_patch.h"
+#include "oneflow/core/job/available_memory_desc.pb.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job/version.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+namespace oneflow {
+
+namespace {
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+void Fnv1aHashCombine(uint64_t* hash, const std::string& data) {
+  for (const unsigned char c : data) {
+    *hash ^= c;
+    *hash *= kFnvPrime;
+  }
+  // separate adjacent fields so that ("ab", "c") and ("a", "bc") hash differently
+  const uint64_t size = data.size();
+  FOR_RANGE(int32_t, i, 0, sizeof(size)) {
+    *hash ^= (size >> (i * 8)) & 0xff;
+    *hash *= kFnvPrime;
+  }
+}
+
+// maps and unknown fields are serialized in a stable order
+std::string SerializeDeterministically(const PbMessage& msg) {
+  std::string serialized;
+  {
+    google::protobuf::io::StringOutputStream output(&serialized);
+    google::protobuf::io::CodedOutputStream coded_output(&output);
+    coded_output.SetSerializationDeterministic(true);
+    CHECK(msg.SerializeToCodedStream(&coded_output));
+  }
+  return serialized;
+}
+
+bool TryGetVersion(std::string* version) {
+#ifdef WITH_GIT_VERSION
+  *version = GetOneFlowGitVersion();
+  return true;
+#else
+  return false;
+#endif  // WITH_GIT_VERSION
+}
+
+std::string CacheFilePath(const std::string& fingerprint) {
+  return JoinPath(Global<ResourceDesc, ForSession>::Get()->plan_cache_dir(),
+                  "plan_" + fingerprint + ".pb");
+}
+
+int64_t GetMemoryZoneId(const MemoryCase& mem_case) {
+  if (mem_case.has_device_cuda_mem()) {
+    return mem_case.device_cuda_mem().device_id();
+  } else {
+    return Global<ResourceDesc, ForSession>::Get()->GpuDeviceNum();
+  }
+}
+
+bool IsPlanFitCurrentCluster(const Plan& plan) {
+  const ResourceDesc* resource_desc = Global<ResourceDesc, ForSession>::Get();
+  const IDMgr* id_mgr = Global<IDMgr>::Get();
+  for (const TaskProto& task : plan.task()) {
+    if (task.machine_id() >= resource_desc->TotalMachineNum()) {
+      LOG(WARNING) << "cached plan uses machine " << task.machine_id() << " which does not exist";
+      return false;
+    }
+    if (id_mgr->GetDeviceTypeFromThrdId(task.thrd_id()) == DeviceType::kGPU
+        && id_mgr->GetGpuPhyIdFromThrdId(task.thrd_id()) >= resource_desc->GpuDeviceNum()) {
+      LOG(WARNING) << "cached plan uses gpu " << id_mgr->GetGpuPhyIdFromThrdId(task.thrd_id())
+                   << " which does not exist";
+      return false;
+    }
+  }
+  HashMap<std::pair<int64_t, int64_t>, int64_t> machine7zone2mem_size;
+  for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
+    machine7zone2mem_size[std::make_pair(chunk.machine_id(), GetMemoryZoneId(chunk.mem_case()))] +=
+        chunk.mem_size();
+  }
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    if (mem_block.chunk_id() != -1) { continue; }
+    machine7zone2mem_size[std::make_pair(mem_block.machine_id(),
+                                         GetMemoryZoneId(mem_block.mem_case()))] +=
+        mem_block.mem_size();
+  }
+  const AvailableMemDesc& amd = *Global<AvailableMemDesc>::Get();
+  for (const auto& pair : machine7zone2mem_size) {
+    const int64_t machine_id = pair.first.first;
+    const int64_t mem_zone_id = pair.first.second;
+    if (machine_id >= amd.machine_amd_size()
+        || mem_zone_id >= amd.machine_amd(machine_id).zone_size_size()) {
+      return false;
+    }
+    int64_t available = amd.machine_amd(machine_id).zone_size(mem_zone_id);
+    if (mem_zone_id == resource_desc->GpuDeviceNum()) {
+      available -= resource_desc->reserved_host_mem_byte();
+    } else {
+      available -= resource_desc->reserved_device_mem_byte();
+    }
+    if (pair.second >= available) {
+      LOG(WARNING) << "cached plan needs " << pair.second << " bytes in memory zone "
+                   << mem_zone_id << " of machine " << machine_id << " but only " << available
+                   << " bytes are available";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool PlanCacheUtil::Enabled() {
+  if (Global<ResourceDesc, ForSession>::Get()->plan_cache_dir().empty()) { return false; }
+  std::string version;
+  if (!TryGetVersion(&version)) {
+    static std::once_flag warn_once;
+    std::call_once(warn_once, []() {
+      LOG(WARNING) << "plan cache is disabled since oneflow is built without git version";
+    });
+    return false;
+  }
+  return true;
+}
+
+std::string PlanCacheUtil::GenFingerprint(const Job& job) {
+  uint64_t hash = kFnvOffsetBasis;
+  std::string version;
+  CHECK(TryGetVersion(&version));
+  Fnv1aHashCombine(&hash, version);
+  Resource resource = Global<ResourceDesc, ForSession>::Get()->resource();
+  resource.clear_plan_cache_dir();
+  resource.clear_enable_debug_mode();
+  Fnv1aHashCombine(&hash, SerializeDeterministically(resource));
+  Fnv1aHashCombine(&hash, std::to_string(GlobalJobDesc().job_id()));
+  Fnv1aHashCombine(&hash, SerializeDeterministically(job));
+  // the only scope attribute TaskGraph depends on
+  for (const OperatorConf& op_conf : job.net().op()) {
+    if (!op_conf.has_scope_symbol_id()) { continue; }
+    const Scope& scope = Global<symbol::Storage<Scope>>::Get()->Get(op_conf.scope_symbol_id());
+    Fnv1aHashCombine(&hash, scope.scope_proto().calculation_pass_name());
+  }
+  // register_num patched before memory planning
+  RegstNumPatch regst_num_patch;
+  if (RegstNumPatchUtil::TryLoad(&regst_num_patch)) {
+    Fnv1aHashCombine(&hash, SerializeDeterministically(regst_num_patch));
+  }
+  IDMgrState id_state;
+  Global<IDMgr>::Get()->DumpState(&id_state);
+  Fnv1aHashCombine(&hash, SerializeDeterministically(id_state));
+  char fingerprint[17];
+  snprintf(fingerprint, sizeof(fingerprint), "%016llx", static_cast<unsigned long long>(hash));
+  return fingerprint;
+}
+
+bool PlanCacheUtil::TryLoad(const std::string& fingerprint, Plan* plan) {
+  const std::string file_path = CacheFilePath(fingerprint);
+  if (!LocalFS()->FileExists(file_path)) { return false; }
+  PlanCacheEntry entry;
+  if (!TryParseProtoFromPbFile(file_path, &entry) || entry.fingerprint() != fingerprint) {
+    LOG(WARNING) << "ignore broken plan cache " << file_path;
+    return false;
+  }
+  if (!IsPlanFitCurrentCluster(entry.plan())) {
+    LOG(WARNING) << "ignore plan cache " << file_path << " which does not fit current cluster";
+    return false;
+  }
+  Global<IDMgr>::Get()->RestoreState(entry.id_state());
+  plan->Swap(entry.mutable_plan());
+  LOG(INFO) << "plan cache hit: " << file_path;
+  return true;
+}
+
+void PlanCacheUtil::Store(const std::string& fingerprint, const Plan& plan) {
+  PlanCacheEntry entry;
+  entry.set_fingerprint(fingerprint);
+  Global<IDMgr>::Get()->DumpState(entry.mutable_id_state());
+  *entry.mutable_plan() = plan;
+  LocalFS()->RecursivelyCreateDirIfNotExist(
+      Global<ResourceDesc, ForSession>::Get()->plan_cache_dir());
+  const std::string file_path = CacheFilePath(fingerprint);
+  // write to a temporary file first so that readers never see a partially written entry
+  const std::string tmp_file_path = file_path + ".tmp";
+  {
+    std::ofstream out_stream(tmp_file_path, std::ofstream::out | std::ofstream::binary
+                                                | std::ofstream::trunc);
+    if (!entry.SerializeToOstream(&out_stream)) {
+      LOG(WARNING) << "fail to write plan cache " << tmp_file_path;
+      return;
+    }
+  }
+  LocalFS()->RenameFile(tmp_file_path, file_path);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,38 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+#define ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+// On-disk cache of compiled plans. An entry is keyed by the fingerprint of a completed job, which
+// covers the job itself, the session resource, the oneflow version and the IDMgr state before
+// compiling, so a hit yields exactly the plan a fresh compilation would produce.
+struct PlanCacheUtil {
+  static bool Enabled();
+  static std::string GenFingerprint(const Job& job);
+  // Returns false on a miss or on an entry which does not fit the current cluster. On a hit the
+  // IDMgr state is restored to the one right after the cached plan was compiled.
+  static bool TryLoad(const std::string& fingerprint, Plan* plan);
+  static void Store(const std::string& fingerprint, const Plan& plan);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PLAN_CACHE_H_
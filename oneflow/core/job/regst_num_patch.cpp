@@ -0,0 +1,62 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/regst_num_patch.h"
+#include "oneflow/core/job/job_set.pb.h"
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+bool RegstNumPatchUtil::TryLoad(RegstNumPatch* patch) {
+  const std::string& path = Global<const ProfilerConf>::Get()->regst_num_patch_path();
+  if (path.empty()) { return false; }
+  CHECK(TryParseProtoFromTextFile(path, patch)) << "failed to parse regst num patch " << path;
+  return true;
+}
+
+void RegstNumPatchUtil::Apply(const RegstNumPatch& patch, Plan* plan) {
+  HashMap<int64_t, TaskProto*> task_id2task;
+  for (TaskProto& task : *plan->mutable_task()) {
+    CHECK(task_id2task.emplace(task.task_id(), &task).second);
+  }
+  int64_t applied_num = 0;
+  for (const RegstNumPatchEntry& entry : patch.entry()) {
+    const auto task_it = task_id2task.find(entry.producer_task_id());
+    if (task_it == task_id2task.end()) { continue; }
+    auto* produced_regst_desc = task_it->second->mutable_produced_regst_desc();
+    const auto regst_it = produced_regst_desc->find(entry.regst_name());
+    if (regst_it == produced_regst_desc->end()) { continue; }
+    RegstDescProto* regst_desc = &regst_it->second;
+    if (entry.register_num() < regst_desc->min_register_num()
+        || entry.register_num() > regst_desc->max_register_num()) {
+      LOG(WARNING) << "ignore register_num " << entry.register_num() << " of regst "
+                   << entry.regst_name() << " produced by task " << entry.producer_task_id()
+                   << ", out of [" << regst_desc->min_register_num() << ", "
+                   << regst_desc->max_register_num() << "]";
+      continue;
+    }
+    regst_desc->set_register_num(entry.register_num());
+    applied_num += 1;
+  }
+  LOG(INFO) << "regst num patch: " << applied_num << " of " << patch.entry_size()
+            << " entries applied";
+}
+
+void RegstNumPatchUtil::Dump(const RegstNumPatch& patch) {
+  TeePersistentLogStream::Create("regst_num_patch")->Write(patch);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,35 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_REGST_NUM_PATCH_H_
+#define ONEFLOW_CORE_JOB_REGST_NUM_PATCH_H_
+
+#include "oneflow/core/job/plan.pb.h"
+#include "oneflow/core/job/regst_num_patch.pb.h"
+
+namespace oneflow {
+
+struct RegstNumPatchUtil {
+  // Returns false if ProfilerConf.regst_num_patch_path is not set
+  static bool TryLoad(RegstNumPatch* patch);
+  // Entries which do not match any regst of the plan or violate its register_num bounds are
+  // ignored, so a patch of a different job set does no harm
+  static void Apply(const RegstNumPatch& patch, Plan* plan);
+  static void Dump(const RegstNumPatch& patch);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_REGST_NUM_PATCH_H_
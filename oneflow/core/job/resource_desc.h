@@ -42,6 +42,8 @@ class ResourceDesc final {
   size_t reserved_host_mem_byte() const { return resource_.reserved_host_mem_mbyte() * kMB; }
   size_t reserved_device_mem_byte() const { return resource_.reserved_device_mem_mbyte() * kMB; }
   bool use_rdma() const { return resource_.use_rdma(); }
+  bool use_shm_comm_net() const { return resource_.use_shm_comm_net(); }
+  int64_t shm_comm_net_ring_capacity() const { return resource_.shm_comm_net_ring_capacity(); }
   bool enable_numa_aware_cuda_malloc_host() const {
     return resource_.enable_numa_aware_cuda_malloc_host();
   }
@@ -53,11 +55,15 @@ class ResourceDesc final {
   int32_t ComputeThreadPoolSize() const;
   bool enable_debug_mode() const;
   CollectiveBoxingConf collective_boxing_conf() const;
+  const PlanDistributionConf& plan_distribution_conf() const {
+    return resource_.plan_distribution_conf();
+  }
   bool nccl_use_compute_stream() const;
 
   void SetMachineNum(int32_t val) { resource_.set_machine_num(val); }
   void SetCpuDeviceNum(int32_t val) { resource_.set_cpu_device_num(val); }
   bool enable_tensor_float_32_compute() const { return resource_.enable_tensor_float_32_compute(); }
+  const std::string& plan_cache_dir() const { return resource_.plan_cache_dir(); }
   const Resource& resource() const { return resource_; }
 
  private:
@@ -17,6 +17,8 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
 #include "oneflow/core/comm_network/ibverbs/ibverbs_comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include "oneflow/core/transport/transport.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -24,6 +26,8 @@ limitations under the License.
 #include "oneflow/core/job/runtime_job_descs.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/actor/act_event_logger.h"
+#include "oneflow/core/actor/act_event_collector.h"
+#include "oneflow/core/profiler/metrics.h"
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/memory/memory_allocator.h"
@@ -90,14 +94,32 @@ Runtime::Runtime(const Plan& plan, size_t total_piece_num, bool is_experiment_ph
 
 Runtime::~Runtime() {
   Global<RuntimeCtx>::Get()->WaitUntilCntEqualZero("running_actor_cnt");
+  if (Global<ActEventCollector>::Get() != nullptr) { Global<ActEventCollector>::Get()->Flush(); }
   OF_SESSION_BARRIER();
   DeleteAllGlobal();
 }
 
 void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_experiment_phase) {
   Global<RuntimeCtx>::New(total_piece_num, is_experiment_phase);
-  if (GlobalProcessCtx::IsThisProcessMaster() && Global<RuntimeCtx>::Get()->NeedCollectActEvent()) {
-    Global<ActEventLogger>::New(is_experiment_phase);
+  if (Global<RuntimeCtx>::Get()->NeedCollectActEvent()) {
+    if (GlobalProcessCtx::IsThisProcessMaster()) {
+      Global<ActEventLogger>::New(is_experiment_phase);
+    }
+    Global<ActEventCollector>::New(is_experiment_phase);
+  }
+  Global<profiler::MetricsRegistry>::New();
+  const ProfilerConf& profiler_conf = *Global<const ProfilerConf>::Get();
+  if (!profiler_conf.metrics_export_path().empty() || profiler_conf.metrics_http_port() > 0) {
+    std::string path = profiler_conf.metrics_export_path();
+    if (!path.empty() && GlobalProcessCtx::WorldSize() > 1) {
+      path += "." + std::to_string(GlobalProcessCtx::Rank());
+    }
+    const int32_t http_port = profiler_conf.metrics_http_port() > 0
+                                  ? profiler_conf.metrics_http_port() + GlobalProcessCtx::Rank()
+                                  : 0;
+    Global<profiler::MetricsExporter>::New(path, http_port,
+                                           profiler_conf.metrics_http_bind_address(),
+                                           profiler_conf.metrics_export_interval_ms());
   }
   // TODO(chengcheng)
   // this code should be called before Runtime::NewAllGlobal, maybe after Eager ENV init
@@ -107,6 +129,8 @@ void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_exp
     // NOTE(chengcheng): Global<EpollCommNet> will new in any case.
     // if use RDMA,
     //   The Global<CommNet> is set allocated by new Global<IBVerbsCommNet>
+    // else if use shm,
+    //   The Global<CommNet> is set allocated by Global<ShmCommNet>
     // else,
     //   The Global<CommNet> is set allocated by Global<EpollCommNet>
     Global<EpollCommNet>::New();
@@ -117,9 +141,16 @@ void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_exp
 #else
       LOG(FATAL) << "RDMA components not found";
 #endif
+    } else if (Global<ResourceDesc, ForSession>::Get()->use_shm_comm_net()) {
+      Global<ShmCommNet>::New();
+      Global<CommNet>::SetAllocated(Global<ShmCommNet>::Get());
     } else {
       Global<CommNet>::SetAllocated(Global<EpollCommNet>::Get());
     }
+    // cpu collective boxing sends data between machines through Transport
+    if (Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf().cpu_enable()) {
+      Global<Transport>::New();
+    }
 #endif
   }
   Global<boxing::collective::CollectiveBoxingExecutor>::New(plan);
@@ -133,6 +164,7 @@ void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_exp
 }
 
 void Runtime::DeleteAllGlobal() {
+  Global<profiler::MetricsExporter>::Delete();
   Global<RuntimeJobDescs>::Delete();
   Global<boxing::collective::CollectiveBoxingDeviceCtxPoller>::Delete();
   Global<ThreadMgr>::Delete();
@@ -140,6 +172,9 @@ void Runtime::DeleteAllGlobal() {
   Global<RegstMgr>::Delete();
   Global<MemoryAllocator>::Delete();
   Global<boxing::collective::CollectiveBoxingExecutor>::Delete();
+#ifdef OF_PLATFORM_POSIX
+  Global<Transport>::Delete();
+#endif
 
   // should be called after Global<Transport>::Delete()
   if (Global<ResourceDesc, ForSession>::Get()->TotalMachineNum() > 1) {
@@ -155,6 +190,11 @@ void Runtime::DeleteAllGlobal() {
 #else
       LOG(FATAL) << "RDMA components not found";
 #endif
+    } else if (Global<ResourceDesc, ForSession>::Get()->use_shm_comm_net()) {
+      CHECK(Global<ShmCommNet>::Get() == static_cast<ShmCommNet*>(Global<CommNet>::Get()));
+      // NOTE: Global<ShmCommNet> delegates remote peers to Global<EpollCommNet>,
+      // so it must be deleted before Global<EpollCommNet>.
+      Global<ShmCommNet>::Delete();
     } else {
       CHECK(Global<EpollCommNet>::Get() == static_cast<EpollCommNet*>(Global<CommNet>::Get()));
       // NOTE(chengcheng): it means that Global<CommNet>::SetAllocated(Global<EpollCommNet>::Get())
@@ -165,6 +205,8 @@ void Runtime::DeleteAllGlobal() {
 #endif
   }
 
+  Global<profiler::MetricsRegistry>::Delete();
+  Global<ActEventCollector>::Delete();
   Global<ActEventLogger>::Delete();
   Global<RuntimeCtx>::Delete();
   Global<summary::EventsWriter>::Delete();
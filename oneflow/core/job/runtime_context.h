@@ -33,7 +33,9 @@ class RuntimeCtx final {
   int64_t total_piece_num() const { return total_piece_num_; }
   bool is_experiment_phase() const { return is_experiment_phase_; }
   bool NeedCollectActEvent() const {
-    return is_experiment_phase_ || Global<const ProfilerConf>::Get()->collect_act_event();
+    const ProfilerConf* profiler_conf = Global<const ProfilerConf>::Get();
+    return is_experiment_phase_ || profiler_conf->collect_act_event()
+           || profiler_conf->tune_regst_num();
   }
 
   void NewCounter(const std::string& name, int64_t val);
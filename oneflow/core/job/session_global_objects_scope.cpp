@@ -34,6 +34,7 @@ limitations under the License.
 #include "oneflow/core/job/runtime_buffer_managers_scope.h"
 #include "oneflow/core/framework/load_library.h"
 #include "oneflow/core/job/version.h"
+#include "oneflow/core/profiler/compile_stats.h"
 #include "oneflow/core/job/global_for.h"
 
 namespace oneflow {
@@ -91,6 +92,7 @@ Maybe<void> SessionGlobalObjectsScope::Init(const ConfigProto& config_proto) {
     Global<LazyJobBuildAndInferCtxMgr>::New();
     Global<JobSetCompileCtx>::New();
     Global<RuntimeBufferManagersScope>::New();
+    Global<profiler::CompileStats>::New();
   }
   for (const std::string lib_path : config_proto.load_lib_path()) { JUST(LoadLibrary(lib_path)); }
   return Maybe<void>::Ok();
@@ -98,6 +100,7 @@ Maybe<void> SessionGlobalObjectsScope::Init(const ConfigProto& config_proto) {
 
 SessionGlobalObjectsScope::~SessionGlobalObjectsScope() {
   if (GlobalProcessCtx::IsThisProcessMaster()) {
+    Global<profiler::CompileStats>::Delete();
     Global<RuntimeBufferManagersScope>::Delete();
     Global<JobSetCompileCtx>::Delete();
     Global<LazyJobBuildAndInferCtxMgr>::Delete();
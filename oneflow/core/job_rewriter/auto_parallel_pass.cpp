@@ -0,0 +1,411 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
+#include "oneflow/core/job/job_builder.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/framework/user_op_registry_manager.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// AutoParallelPass searches the sbp signatures of all ops for a low estimated cost of the whole
+// job, instead of letting each op follow its producers greedily in topological order.
+class AutoParallelPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AutoParallelPass);
+  AutoParallelPass() = default;
+  ~AutoParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().auto_parallel_conf().enable();
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+};
+
+// boxing can not produce partial sum from anything but partial sum in the same placement
+constexpr double kInfeasibleBoxingCost = 1e18;
+
+// seconds to move the blob from producer_sbp to consumer_sbp, estimated by the bytes each
+// consumer device receives through the collective boxing would take
+double BoxingCost(const BlobDesc& logical_blob_desc, const ParallelDesc& producer_parallel_desc,
+                  const SbpParallel& producer_sbp, const ParallelDesc& consumer_parallel_desc,
+                  const SbpParallel& consumer_sbp, const AutoParallelConf& conf) {
+  const bool is_same_placement = producer_parallel_desc == consumer_parallel_desc;
+  if (is_same_placement && producer_sbp == consumer_sbp) { return 0; }
+  if (consumer_sbp.has_partial_sum_parallel()) { return kInfeasibleBoxingCost; }
+  const double logical_bytes =
+      logical_blob_desc.shape().elem_cnt() * GetSizeOfDataType(logical_blob_desc.data_type());
+  double bytes = 0;
+  if (is_same_placement) {
+    const double n = producer_parallel_desc.parallel_num();
+    if (producer_sbp.has_broadcast_parallel()) {
+      // every device slices its part locally
+      bytes = 0;
+    } else if (producer_sbp.has_split_parallel()) {
+      // all-gather or all-to-all
+      bytes = consumer_sbp.has_broadcast_parallel() ? logical_bytes * (n - 1) / n
+                                                    : logical_bytes * (n - 1) / (n * n);
+    } else {
+      // all-reduce or reduce-scatter
+      bytes = consumer_sbp.has_broadcast_parallel() ? 2 * logical_bytes * (n - 1) / n
+                                                    : logical_bytes * (n - 1) / n;
+    }
+  } else {
+    bytes = consumer_sbp.has_split_parallel()
+                ? logical_bytes / consumer_parallel_desc.parallel_num()
+                : logical_bytes;
+    // every partial value takes part in the sum
+    if (producer_sbp.has_partial_sum_parallel()) {
+      bytes *= producer_parallel_desc.parallel_num();
+    }
+  }
+  const bool is_inter_node =
+      producer_parallel_desc.sorted_machine_ids().size() > 1
+      || producer_parallel_desc.sorted_machine_ids() != consumer_parallel_desc.sorted_machine_ids();
+  const double gbyte_per_sec = is_inter_node ? conf.inter_node_bandwidth_gbyte_per_sec()
+                                             : conf.intra_node_bandwidth_gbyte_per_sec();
+  return bytes / (gbyte_per_sec * 1e9);
+}
+
+// the logical flops are divided among the devices if any input is split
+double ComputeCost(const OpNode& op_node, const SbpSignature& sbp_signature, double flops,
+                   const AutoParallelConf& conf) {
+  const Operator& op = op_node.op();
+  const auto& bns = op.input_bns().empty() ? op.output_bns() : op.input_bns();
+  double fraction = 1;
+  for (const std::string& bn : bns) {
+    if (sbp_signature.bn_in_op2sbp_parallel().at(bn).has_split_parallel()) {
+      fraction = 1.0 / op_node.parallel_desc().parallel_num();
+    }
+  }
+  return flops * fraction / (conf.device_gflops() * 1e9);
+}
+
+std::string SbpSignatureToString(const Operator& op, const SbpSignature& sbp_signature) {
+  std::string ret;
+  auto Append = [&](const std::string& bn) {
+    if (!ret.empty()) { ret += ", "; }
+    ret += bn + ":" + SbpParallelToString(sbp_signature.bn_in_op2sbp_parallel().at(bn));
+  };
+  for (const std::string& ibn : op.input_bns()) { Append(ibn); }
+  for (const std::string& obn : op.output_bns()) { Append(obn); }
+  return ret;
+}
+
+bool IsSbpSignatureSearchable(const OpNode& op_node, const HashSet<std::string>& fixed_op_names) {
+  if (op_node.parallel_desc().parallel_num() == 1) { return false; }
+  const OperatorConf& op_conf = op_node.op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (fixed_op_names.find(op_conf.name()) != fixed_op_names.end()) { return false; }
+  // ops inferring sbp signatures by themselves may not pick among their GetSbpSignatures
+  const auto* registry_result =
+      user_op::UserOpRegistryMgr::Get().GetOpRegistryResult(op_conf.user_conf().op_type_name());
+  if (registry_result == nullptr || registry_result->infer_sbp_signature_fn) { return false; }
+  for (const std::string& obn : op_node.op().output_bns()) {
+    if (CHECK_JUST(op_node.op().OptMirroredParallel4BnInOp(obn))->has_mirrored_parallel()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class SbpSignatureSearcher final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SbpSignatureSearcher);
+  SbpSignatureSearcher(const OpGraph& op_graph, const Job& job, const AutoParallelConf& conf);
+  ~SbpSignatureSearcher() = default;
+
+  double TotalCost() const;
+  // dynamic programming on chains then local search, round by round until no improvement
+  void Search();
+  void ForEachSearchedSbpSignature(
+      const std::function<void(const OpNode*, const SbpSignature&)>& Handler) const;
+  // per op chosen sbp signature with its compute and input boxing cost
+  std::string CostReport() const;
+
+ private:
+  struct OpState {
+    std::vector<SbpSignature> candidates;
+    std::vector<double> compute_costs;
+    int64_t chosen;
+  };
+  void InitOpState(const OpNode* op_node, bool is_searchable, const SbpSignature& sbp_sig_conf);
+  void InitChains();
+  double EdgeCost(const OpEdge* edge, int64_t src_candidate, int64_t dst_candidate) const;
+  // cost of op_node taking candidate while its neighbours keep their choices, the two edges
+  // ignored are left to the caller
+  double LocalCost(const OpNode* op_node, int64_t candidate, const OpEdge* ignored_in_edge,
+                   const OpEdge* ignored_out_edge) const;
+  void SearchChainByDp(const std::vector<const OpNode*>& chain);
+  void SearchLocally();
+
+  const AutoParallelConf& conf_;
+  std::vector<const OpNode*> op_nodes_;
+  HashMap<const OpNode*, OpState> op_node2state_;
+  // each chain is a path whose inner edges are the only out edge of their src and the only in
+  // edge of their dst
+  std::vector<std::vector<const OpNode*>> chains_;
+};
+
+SbpSignatureSearcher::SbpSignatureSearcher(const OpGraph& op_graph, const Job& job,
+                                           const AutoParallelConf& conf)
+    : conf_(conf) {
+  HashSet<std::string> fixed_op_names;
+  for (const auto& pair : job.helper().identical_sbp_oba_pairs().pair()) {
+    fixed_op_names.insert(pair.first().op_name());
+    fixed_op_names.insert(pair.second().op_name());
+  }
+  const auto& op_name2sbp_sig_conf = job.job_parallel_view_conf().op_name2sbp_signature_conf();
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    const auto& it = op_name2sbp_sig_conf.find(op_node->op().op_name());
+    const SbpSignature sbp_sig_conf =
+        it == op_name2sbp_sig_conf.end() ? SbpSignature() : it->second;
+    InitOpState(op_node, IsSbpSignatureSearchable(*op_node, fixed_op_names), sbp_sig_conf);
+    op_nodes_.push_back(op_node);
+  });
+  InitChains();
+}
+
+void SbpSignatureSearcher::InitOpState(const OpNode* op_node, bool is_searchable,
+                                       const SbpSignature& sbp_sig_conf) {
+  OpState* state = &op_node2state_[op_node];
+  const SbpSignature& inferred = op_node->sbp_signature();
+  if (is_searchable) {
+    HashMap<std::string, SbpInferHint> ibn2sbp_infer_hint;
+    for (const std::string& ibn : op_node->op().input_bns()) {
+      const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(ibn);
+      const OpNode& producer = op_node->SrcNode4Ibn(ibn);
+      ibn2sbp_infer_hint.emplace(
+          ibn, SbpInferHint(&producer.parallel_desc(), &producer.LogicalBlobDesc4Lbi(lbi),
+                            &producer.SbpParallel4Lbi(lbi)));
+    }
+    auto SbpInferHint4Ibn = [&](const std::string& ibn) -> Maybe<const SbpInferHint*> {
+      const auto& it = ibn2sbp_infer_hint.find(ibn);
+      CHECK_OR_RETURN(it != ibn2sbp_infer_hint.end());
+      return &it->second;
+    };
+    SbpSignatureList valid_sbp_sig_list;
+    CHECK_JUST(op_node->op().GetValidSbpSignaturesIf(SbpInferHint4Ibn, op_node->parallel_desc(),
+                                                     &valid_sbp_sig_list));
+    SbpSignatureList filtered_sbp_sig_list;
+    FilterSbpSignatureList(valid_sbp_sig_list, sbp_sig_conf, &filtered_sbp_sig_list);
+    for (const SbpSignature& sbp_signature : filtered_sbp_sig_list.sbp_signature()) {
+      if (std::find(state->candidates.begin(), state->candidates.end(), sbp_signature)
+          == state->candidates.end()) {
+        state->candidates.push_back(sbp_signature);
+      }
+    }
+  }
+  // starts from the greedily inferred one, so that the search never ends up worse than it
+  const auto& it = std::find(state->candidates.begin(), state->candidates.end(), inferred);
+  if (it == state->candidates.end()) {
+    state->chosen = state->candidates.size();
+    state->candidates.push_back(inferred);
+  } else {
+    state->chosen = it - state->candidates.begin();
+  }
+  const double flops = EstimateLogicalFlops(*op_node);
+  for (const SbpSignature& sbp_signature : state->candidates) {
+    state->compute_costs.push_back(ComputeCost(*op_node, sbp_signature, flops, conf_));
+  }
+}
+
+void SbpSignatureSearcher::InitChains() {
+  auto IsSearchable = [&](const OpNode* op_node) {
+    return op_node2state_.at(op_node).candidates.size() > 1;
+  };
+  HashSet<const OpNode*> chained;
+  for (const OpNode* op_node : op_nodes_) {
+    if (chained.find(op_node) != chained.end() || !IsSearchable(op_node)) { continue; }
+    std::vector<const OpNode*> chain{op_node};
+    chained.insert(op_node);
+    const OpNode* cur_node = op_node;
+    while (cur_node->out_edges().size() == 1) {
+      const OpNode* next_node = cur_node->SoleOutEdge()->dst_node();
+      if (next_node->in_edges().size() != 1 || !IsSearchable(next_node)
+          || chained.find(next_node) != chained.end()) {
+        break;
+      }
+      chain.push_back(next_node);
+      chained.insert(next_node);
+      cur_node = next_node;
+    }
+    if (chain.size() > 1) { chains_.push_back(chain); }
+  }
+}
+
+double SbpSignatureSearcher::EdgeCost(const OpEdge* edge, int64_t src_candidate,
+                                      int64_t dst_candidate) const {
+  const OpNode* src_node = edge->src_node();
+  const OpNode* dst_node = edge->dst_node();
+  const auto& src_bn2sbp =
+      op_node2state_.at(src_node).candidates.at(src_candidate).bn_in_op2sbp_parallel();
+  const auto& dst_bn2sbp =
+      op_node2state_.at(dst_node).candidates.at(dst_candidate).bn_in_op2sbp_parallel();
+  double cost = 0;
+  for (const LogicalBlobId& lbi : edge->lbis()) {
+    const SbpParallel& producer_sbp = src_bn2sbp.at(edge->lbi2obn().at(lbi));
+    for (const std::string& ibn : edge->lbi2ibns().at(lbi)) {
+      cost += BoxingCost(src_node->LogicalBlobDesc4Lbi(lbi), src_node->parallel_desc(),
+                         producer_sbp, dst_node->parallel_desc(), dst_bn2sbp.at(ibn), conf_);
+    }
+  }
+  return cost;
+}
+
+double SbpSignatureSearcher::LocalCost(const OpNode* op_node, int64_t candidate,
+                                       const OpEdge* ignored_in_edge,
+                                       const OpEdge* ignored_out_edge) const {
+  double cost = op_node2state_.at(op_node).compute_costs.at(candidate);
+  for (const OpEdge* edge : op_node->in_edges()) {
+    if (edge == ignored_in_edge) { continue; }
+    cost += EdgeCost(edge, op_node2state_.at(edge->src_node()).chosen, candidate);
+  }
+  for (const OpEdge* edge : op_node->out_edges()) {
+    if (edge == ignored_out_edge) { continue; }
+    cost += EdgeCost(edge, candidate, op_node2state_.at(edge->dst_node()).chosen);
+  }
+  return cost;
+}
+
+double SbpSignatureSearcher::TotalCost() const {
+  double cost = 0;
+  for (const OpNode* op_node : op_nodes_) {
+    const OpState& state = op_node2state_.at(op_node);
+    cost += state.compute_costs.at(state.chosen);
+    for (const OpEdge* edge : op_node->in_edges()) {
+      cost += EdgeCost(edge, op_node2state_.at(edge->src_node()).chosen, state.chosen);
+    }
+  }
+  return cost;
+}
+
+void SbpSignatureSearcher::SearchChainByDp(const std::vector<const OpNode*>& chain) {
+  // cost.at(i).at(s) is the least cost of chain[0..i] given chain[i] takes candidate s, and
+  // prev.at(i).at(s) is the candidate of chain[i - 1] reaching it
+  std::vector<std::vector<double>> cost(chain.size());
+  std::vector<std::vector<int64_t>> prev(chain.size());
+  FOR_RANGE(int64_t, i, 0, chain.size()) {
+    const OpNode* op_node = chain.at(i);
+    const OpEdge* in_edge = i > 0 ? op_node->SoleInEdge() : nullptr;
+    const OpEdge* out_edge = i + 1 < chain.size() ? op_node->SoleOutEdge() : nullptr;
+    const int64_t candidate_num = op_node2state_.at(op_node).candidates.size();
+    cost.at(i).resize(candidate_num);
+    prev.at(i).resize(candidate_num, -1);
+    FOR_RANGE(int64_t, s, 0, candidate_num) {
+      cost.at(i).at(s) = LocalCost(op_node, s, in_edge, out_edge);
+      if (i == 0) { continue; }
+      double min_prev_cost = std::numeric_limits<double>::max();
+      FOR_RANGE(int64_t, t, 0, cost.at(i - 1).size()) {
+        const double prev_cost = cost.at(i - 1).at(t) + EdgeCost(in_edge, t, s);
+        if (prev_cost < min_prev_cost) {
+          min_prev_cost = prev_cost;
+          prev.at(i).at(s) = t;
+        }
+      }
+      cost.at(i).at(s) += min_prev_cost;
+    }
+  }
+  // keep the current choice of the chain end unless another one is strictly better
+  int64_t candidate = op_node2state_.at(chain.back()).chosen;
+  FOR_RANGE(int64_t, s, 0, cost.back().size()) {
+    if (cost.back().at(s) < cost.back().at(candidate)) { candidate = s; }
+  }
+  for (int64_t i = chain.size() - 1; i >= 0; --i) {
+    op_node2state_.at(chain.at(i)).chosen = candidate;
+    candidate = prev.at(i).at(candidate);
+  }
+}
+
+void SbpSignatureSearcher::SearchLocally() {
+  for (const OpNode* op_node : op_nodes_) {
+    OpState* state = &op_node2state_.at(op_node);
+    if (state->candidates.size() <= 1) { continue; }
+    double min_cost = LocalCost(op_node, state->chosen, nullptr, nullptr);
+    FOR_RANGE(int64_t, s, 0, state->candidates.size()) {
+      const double cost = LocalCost(op_node, s, nullptr, nullptr);
+      if (cost < min_cost) {
+        min_cost = cost;
+        state->chosen = s;
+      }
+    }
+  }
+}
+
+void SbpSignatureSearcher::Search() {
+  FOR_RANGE(int32_t, round, 0, conf_.max_search_rounds()) {
+    const double cost_before = TotalCost();
+    for (const auto& chain : chains_) { SearchChainByDp(chain); }
+    SearchLocally();
+    if (TotalCost() >= cost_before) { break; }
+  }
+}
+
+void SbpSignatureSearcher::ForEachSearchedSbpSignature(
+    const std::function<void(const OpNode*, const SbpSignature&)>& Handler) const {
+  for (const OpNode* op_node : op_nodes_) {
+    const OpState& state = op_node2state_.at(op_node);
+    if (state.candidates.size() > 1) { Handler(op_node, state.candidates.at(state.chosen)); }
+  }
+}
+
+std::string SbpSignatureSearcher::CostReport() const {
+  std::ostringstream report;
+  report << "total_cost " << TotalCost() << " seconds\n";
+  for (const OpNode* op_node : op_nodes_) {
+    const OpState& state = op_node2state_.at(op_node);
+    double boxing_cost = 0;
+    for (const OpEdge* edge : op_node->in_edges()) {
+      boxing_cost += EdgeCost(edge, op_node2state_.at(edge->src_node()).chosen, state.chosen);
+    }
+    report << op_node->op().op_name() << " {"
+           << SbpSignatureToString(op_node->op(), state.candidates.at(state.chosen))
+           << "} candidate_num " << state.candidates.size() << ", compute_cost "
+           << state.compute_costs.at(state.chosen) << ", input_boxing_cost " << boxing_cost
+           << "\n";
+  }
+  return report.str();
+}
+
+Maybe<void> AutoParallelPass::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  const OpGraph op_graph(*job);
+  SbpSignatureSearcher searcher(op_graph, *job, ctx->job_desc().job_conf().auto_parallel_conf());
+  const double greedy_cost = searcher.TotalCost();
+  searcher.Search();
+  LOG(INFO) << "job_id: " << ctx->job_desc().job_id() << " , auto parallel estimated cost "
+            << greedy_cost << " seconds greedily, " << searcher.TotalCost()
+            << " seconds searched";
+  TeePersistentLogStream::Create(StrCat("auto_parallel_report_job_", ctx->job_desc().job_id()))
+      ->Write(searcher.CostReport());
+  // every searched op is pinned, otherwise it would be inferred greedily from the new producers
+  JobBuilder job_builder(job);
+  searcher.ForEachSearchedSbpSignature([&](const OpNode* op_node, const SbpSignature& signature) {
+    job_builder.AddSbpSignature4OpName(op_node->op().op_name(), signature);
+  });
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("AutoParallelPass", AutoParallelPass);
+
+}  // namespace oneflow
@@ -127,6 +127,12 @@ void GenerateOriginDiffLbi(JobPassCtx* ctx, const OpGraph& op_graph, JobBuilder*
     } else {
       origin_grad = 1.0;
     }
+    // the losses of the pipeline micro-batches are averaged
+    const PipelineParallelConf& pipeline_parallel_conf =
+        ctx->job_desc().job_conf().pipeline_parallel_conf();
+    if (pipeline_parallel_conf.stage_num() > 1) {
+      origin_grad /= pipeline_parallel_conf.micro_batch_num();
+    }
     constant_like_conf->set_float_operand(origin_grad);
   }
   op_confs->push_back(constant_like_op);
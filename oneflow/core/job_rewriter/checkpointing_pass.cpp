@@ -17,15 +17,19 @@ limitations under the License.
 #include "oneflow/core/job/job.pb.h"
 #include "oneflow/core/job/scope.h"
 #include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
 #include "oneflow/core/vm/symbol_storage.h"
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/operator/operator.h"
+#include "oneflow/core/job/job_desc.h"
 
 namespace oneflow {
 
 namespace {
 
 // Do CheckpointingPass will use backward recomputation for sublinear memory cost.
+// Besides the ops in checkpointing scopes, ops are chosen automatically to recompute if
+// auto_checkpointing_memory_budget_mbyte is set.
 class CheckpointingPass final : public JobPass {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CheckpointingPass);
@@ -61,27 +65,187 @@ bool IsForwardPass7CheckpointingScope(const Scope& scope) {
   return IsForwardPassScope(scope) && scope.Bool("checkpointing");
 }
 
-void CollectAllCheckpointingOpsInForwardPass(
-    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+bool IsIgnoredOpType4Recomputation(const std::string& op_type_name) {
   // NOTE(chengcheng):
   //   ignore batch_norm ops because of recompute bn will repeat the calculation of 'm' and 'v'.
   //   in the future, we need to support the recomputation version of batch_norm which do NOT
   //   update forward variables.
-  HashSet<std::string> ignore_op_type_names = {"normalization", "normalization_add_relu",
-                                               "cudnn_fused_normalization_add_relu"};
+  // random ops are ignored because their recomputation does not reproduce the forward outputs.
+  static const HashSet<std::string> ignore_op_type_names = {
+      "normalization", "normalization_add_relu", "cudnn_fused_normalization_add_relu",
+      "random_mask_like", "generate_random_batch_permutation_indices"};
+  return ignore_op_type_names.find(op_type_name) != ignore_op_type_names.end();
+}
+
+void CollectAllCheckpointingOpsInForwardPass(
+    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
   op_graph.ForEachNode([&](const OpNode* op_node) {
     const OperatorConf& op_conf = op_node->op().op_conf();
     if (!op_conf.has_user_conf()) { return; }
-    if (ignore_op_type_names.find(op_conf.user_conf().op_type_name())
-        != ignore_op_type_names.end()) {
-      return;
-    }
+    if (IsIgnoredOpType4Recomputation(op_conf.user_conf().op_type_name())) { return; }
     if (IsForwardPass7CheckpointingScope(Scope4OpNode(op_node))) {
       CHECK(checkpointing_op_name2op_node->emplace(op_conf.name(), op_node).second);
     }
   });
 }
 
+int64_t PhysicalByteSize4Lbi(const OpNode* producer, const LogicalBlobId& lbi) {
+  const BlobDesc& blob_desc = producer->LogicalBlobDesc4Lbi(lbi);
+  const int64_t byte_size = blob_desc.shape().elem_cnt() * GetSizeOfDataType(blob_desc.data_type());
+  if (!producer->SbpParallel4Lbi(lbi).has_split_parallel()) { return byte_size; }
+  const int64_t parallel_num = producer->parallel_desc().parallel_num();
+  return (byte_size + parallel_num - 1) / parallel_num;
+}
+
+bool IsAutoCheckpointingCandidate(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (IsIgnoredOpType4Recomputation(op_conf.user_conf().op_type_name())) { return false; }
+  // recomputing a source op such as a data reader does not reproduce its outputs
+  return IsForwardPassScope(Scope4OpNode(op_node)) && !op_node->in_edges().empty();
+}
+
+// Adds forward ops to recompute until the estimated memory of each placement, i.e. variables plus
+// the forward activations kept alive for backward, fits into memory_budget. An activation is kept
+// alive if a backward op or a recomputed forward op consumes it, unless its producer is recomputed
+// in the same placement. Each step greedily picks the op freeing the most bytes per flop.
+void CollectAutoCheckpointingOpsInForwardPass(
+    const OpGraph& op_graph, int64_t memory_budget,
+    HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+  HashSet<const OpNode*> recomputed_nodes;
+  for (const auto& pair : *checkpointing_op_name2op_node) { recomputed_nodes.insert(pair.second); }
+  HashSet<const OpNode*> fw_nodes;
+  std::vector<const OpNode*> order2node;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (IsForwardPassScope(Scope4OpNode(op_node))) { fw_nodes.insert(op_node); }
+    order2node.push_back(op_node);
+  });
+  HashMap<ParallelDesc, int64_t> placement2byte_size;
+  HashMap<LogicalBlobId, const OpNode*> fw_lbi2producer;
+  HashMap<LogicalBlobId, std::vector<const OpNode*>> fw_lbi2consumers;
+  HashMap<LogicalBlobId, int64_t> fw_lbi2byte_size;
+  for (const OpNode* op_node : fw_nodes) {
+    // variables live during the whole job no matter what is recomputed
+    const bool is_variable = op_node->op().op_conf().has_variable_conf();
+    for (const std::string& obn : op_node->op().output_bns()) {
+      const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(obn);
+      const int64_t byte_size = PhysicalByteSize4Lbi(op_node, lbi);
+      if (is_variable) { placement2byte_size[op_node->parallel_desc()] += byte_size; }
+      fw_lbi2byte_size.emplace(lbi, is_variable ? 0 : byte_size);
+      fw_lbi2producer.emplace(lbi, op_node);
+    }
+    for (const OpEdge* edge : op_node->out_edges()) {
+      for (const LogicalBlobId& lbi : edge->lbis()) {
+        fw_lbi2consumers[lbi].push_back(edge->dst_node());
+      }
+    }
+  }
+  auto IsRecomputed = [&](const OpNode* op_node) {
+    return recomputed_nodes.find(op_node) != recomputed_nodes.end();
+  };
+  auto IsKeptAlive = [&](const LogicalBlobId& lbi) {
+    const OpNode* producer = fw_lbi2producer.at(lbi);
+    const bool is_producer_recomputed = IsRecomputed(producer);
+    const auto consumers_it = fw_lbi2consumers.find(lbi);
+    if (consumers_it == fw_lbi2consumers.end()) { return false; }
+    for (const OpNode* consumer : consumers_it->second) {
+      if (fw_nodes.find(consumer) == fw_nodes.end()) {
+        if (!is_producer_recomputed) { return true; }
+      } else if (IsRecomputed(consumer)) {
+        if (!is_producer_recomputed || consumer->parallel_desc() != producer->parallel_desc()) {
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+  for (const auto& pair : fw_lbi2byte_size) {
+    if (IsKeptAlive(pair.first)) {
+      placement2byte_size[fw_lbi2producer.at(pair.first)->parallel_desc()] += pair.second;
+    }
+  }
+  const HashMap<ParallelDesc, int64_t> placement2origin_byte_size = placement2byte_size;
+  // only the inputs and outputs of op_node may change their liveness when it is recomputed
+  auto CalcFreedByteSize = [&](const OpNode* op_node,
+                               HashMap<ParallelDesc, int64_t>* placement2freed) -> int64_t {
+    HashMap<LogicalBlobId, bool> lbi2kept_alive;
+    for (const OpEdge* edge : op_node->out_edges()) {
+      for (const LogicalBlobId& lbi : edge->lbis()) { lbi2kept_alive[lbi] = IsKeptAlive(lbi); }
+    }
+    for (const OpEdge* edge : op_node->in_edges()) {
+      for (const LogicalBlobId& lbi : edge->lbis()) {
+        if (fw_lbi2producer.find(lbi) != fw_lbi2producer.end()) {
+          lbi2kept_alive[lbi] = IsKeptAlive(lbi);
+        }
+      }
+    }
+    CHECK(recomputed_nodes.insert(op_node).second);
+    int64_t freed = 0;
+    for (const auto& pair : lbi2kept_alive) {
+      const int64_t kept_alive_diff = static_cast<int64_t>(pair.second) - IsKeptAlive(pair.first);
+      const int64_t diff = kept_alive_diff * fw_lbi2byte_size.at(pair.first);
+      freed += diff;
+      if (placement2freed != nullptr) {
+        (*placement2freed)[fw_lbi2producer.at(pair.first)->parallel_desc()] += diff;
+      }
+    }
+    recomputed_nodes.erase(op_node);
+    return freed;
+  };
+  auto IsOverBudget = [&](const OpNode* op_node) {
+    return placement2byte_size.at(op_node->parallel_desc()) > memory_budget;
+  };
+
+  HashMap<const OpNode*, int64_t> node2order;
+  HashMap<const OpNode*, double> node2flops;
+  FOR_RANGE(int64_t, i, 0, order2node.size()) {
+    const OpNode* op_node = order2node.at(i);
+    node2order.emplace(op_node, i);
+    if (IsAutoCheckpointingCandidate(op_node)) {
+      node2flops.emplace(op_node, EstimateLogicalFlops(*op_node));
+    }
+  }
+  // max heap of (freed bytes per flop, -topo order), so that ties are broken deterministically
+  std::priority_queue<std::pair<double, int64_t>> queue;
+  auto TryPush = [&](const OpNode* op_node) {
+    if (node2flops.find(op_node) == node2flops.end() || IsRecomputed(op_node)) { return; }
+    const int64_t freed = CalcFreedByteSize(op_node, nullptr);
+    if (freed > 0) { queue.emplace(freed / node2flops.at(op_node), -node2order.at(op_node)); }
+  };
+  for (const OpNode* op_node : order2node) { TryPush(op_node); }
+  while (!queue.empty()) {
+    const std::pair<double, int64_t> top = queue.top();
+    queue.pop();
+    const OpNode* op_node = order2node.at(-top.second);
+    if (IsRecomputed(op_node) || !IsOverBudget(op_node)) { continue; }
+    HashMap<ParallelDesc, int64_t> placement2freed;
+    const int64_t freed = CalcFreedByteSize(op_node, &placement2freed);
+    if (freed <= 0) { continue; }
+    const double score = freed / node2flops.at(op_node);
+    // the score is stale since a neighbour got recomputed
+    if (score < top.first) {
+      queue.emplace(score, top.second);
+      continue;
+    }
+    CHECK(recomputed_nodes.insert(op_node).second);
+    for (const auto& pair : placement2freed) { placement2byte_size[pair.first] -= pair.second; }
+    CHECK(checkpointing_op_name2op_node->emplace(op_node->op().op_name(), op_node).second);
+    op_node->ForEachNodeOnInOutEdge(TryPush);
+  }
+  for (const auto& pair : placement2byte_size) {
+    std::ostringstream msg;
+    msg << "auto checkpointing estimates " << pair.second << " bytes per device for placement "
+        << pair.first.parallel_conf().ShortDebugString() << " ("
+        << placement2origin_byte_size.at(pair.first)
+        << " bytes without recomputation), memory budget " << memory_budget << " bytes";
+    if (pair.second > memory_budget) {
+      LOG(WARNING) << msg.str();
+    } else {
+      LOG(INFO) << msg.str();
+    }
+  }
+}
+
 void GenConnectedCheckpointingSubgraphs(
     const HashMap<std::string, const OpNode*>& checkpointing_op_name2op_node,
     std::vector<HashSet<const OpNode*>>* checkpointing_subgraphs) {
@@ -123,6 +287,12 @@ Maybe<void> CheckpointingPass::Apply(const OpGraph& op_graph, JobBuilder* job_bu
   // step 1. collect all checkpointing ops in forwardpass.
   HashMap<std::string, const OpNode*> checkpointing_op_name2op_node;
   CollectAllCheckpointingOpsInForwardPass(op_graph, &checkpointing_op_name2op_node);
+  const int64_t memory_budget_mbyte =
+      GlobalJobDesc().job_conf().auto_checkpointing_memory_budget_mbyte();
+  if (memory_budget_mbyte > 0) {
+    CollectAutoCheckpointingOpsInForwardPass(op_graph, memory_budget_mbyte * 1024 * 1024,
+                                             &checkpointing_op_name2op_node);
+  }
   if (checkpointing_op_name2op_node.empty()) { return Maybe<void>::Ok(); }
 
   // step 2. get all connected subgraphs in checkpointing ops.
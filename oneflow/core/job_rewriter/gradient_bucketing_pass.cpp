@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace {
+
+// Do GradientBucketingPass will pack the all-reduces of gradients into buckets of bounded size,
+// numbered in the order backward produces the gradients. The collective boxing executor launches
+// the buckets one by one, so the all-reduces of the first gradients overlap with the backward
+// compute of the rest.
+class GradientBucketingPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(GradientBucketingPass);
+  GradientBucketingPass() = default;
+  ~GradientBucketingPass() = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    return Apply(op_graph, job);
+  }
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain()
+           && Global<ResourceDesc, ForSession>::Get()
+                  ->collective_boxing_conf()
+                  .enable_gradient_bucketing();
+  }
+
+  Maybe<void> Apply(const OpGraph& op_graph, Job* job) const;
+};
+
+Maybe<bool> IsBackwardPassOpNode(const OpNode* op_node) {
+  const int64_t scope_symbol_id = op_node->op().op_conf().scope_symbol_id();
+  const auto& scope = JUST(Global<symbol::Storage<Scope>>::Get()->MaybeGet(scope_symbol_id));
+  return scope.scope_proto().calculation_pass_name() == kBackwardPass;
+}
+
+bool IsAllReduceEdge(const OpEdge* op_edge, const LogicalBlobId& lbi) {
+  const OpNode* src_node = op_edge->src_node();
+  const OpNode* dst_node = op_edge->dst_node();
+  if (src_node->parallel_desc().parallel_num() <= 1) { return false; }
+  if (src_node->parallel_desc() != dst_node->parallel_desc()) { return false; }
+  if (src_node->LogicalBlobDesc4Lbi(lbi).is_dynamic()) { return false; }
+  return src_node->SbpParallel4Lbi(lbi).has_partial_sum_parallel()
+         && dst_node->SbpParallel4Lbi(lbi).has_broadcast_parallel();
+}
+
+Maybe<void> GradientBucketingPass::Apply(const OpGraph& op_graph, Job* job) const {
+  const int64_t bucket_byte_size = Global<ResourceDesc, ForSession>::Get()
+                                       ->collective_boxing_conf()
+                                       .gradient_bucket_size_mb()
+                                   * 1024 * 1024;
+  CHECK_GT_OR_RETURN(bucket_byte_size, 0);
+  // NOTE: topological order of the producers is the order backward computes the gradients, which
+  //   is the reverse of the order forward consumes the variables
+  std::vector<LogicalBlobId> gradient_lbis;
+  HashSet<LogicalBlobId> visited_lbis;
+  std::vector<const OpNode*> backward_nodes;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (CHECK_JUST(IsBackwardPassOpNode(op_node))) { backward_nodes.push_back(op_node); }
+  });
+  for (const OpNode* src_node : backward_nodes) {
+    for (const OpEdge* op_edge : src_node->out_edges()) {
+      for (const LogicalBlobId& lbi : op_edge->lbis()) {
+        if (!IsAllReduceEdge(op_edge, lbi)) { continue; }
+        if (visited_lbis.insert(lbi).second) { gradient_lbis.push_back(lbi); }
+      }
+    }
+  }
+  auto* lbn2bucket_id = job->mutable_helper()->mutable_lbn2gradient_bucket_id();
+  lbn2bucket_id->clear();
+  int64_t bucket_id = 0;
+  int64_t cur_bucket_byte_size = 0;
+  for (const LogicalBlobId& lbi : gradient_lbis) {
+    const BlobDesc& blob_desc = op_graph.GetLogicalBlobDesc(lbi);
+    const int64_t byte_size =
+        blob_desc.shape().elem_cnt() * GetSizeOfDataType(blob_desc.data_type());
+    if (cur_bucket_byte_size > 0 && cur_bucket_byte_size + byte_size > bucket_byte_size) {
+      bucket_id += 1;
+      cur_bucket_byte_size = 0;
+    }
+    (*lbn2bucket_id)[GenLogicalBlobName(lbi)] = bucket_id;
+    cur_bucket_byte_size += byte_size;
+  }
+  if (!gradient_lbis.empty()) {
+    LOG(INFO) << "GradientBucketingPass: " << gradient_lbis.size() << " gradients in "
+              << bucket_id + 1 << " buckets";
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("GradientBucketingPass", GradientBucketingPass);
+
+}  // namespace oneflow
@@ -0,0 +1,278 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace {
+
+// Do GradientCompressionPass will compress the gradients of data parallel variables before they
+// are all-reduced by the boxing in front of the parallel casts added by autograd, and decompress
+// them after.
+class GradientCompressionPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(GradientCompressionPass);
+  GradientCompressionPass() = default;
+  ~GradientCompressionPass() = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(*ctx, op_graph, &job_builder);
+  }
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain() && ctx.job_desc().job_conf().has_gradient_compression_conf()
+           && ctx.job_desc().job_conf().gradient_compression_conf().enable();
+  }
+
+  Maybe<void> Apply(const JobPassCtx& ctx, const OpGraph& op_graph, JobBuilder* job_builder) const;
+};
+
+const std::string kGradientCompressionOpNamePrefix = "System-GradientCompression-";
+
+bool IsUserOpWithTypeName(const OperatorConf& op_conf, const std::string& op_type_name) {
+  return op_conf.has_user_conf() && op_conf.user_conf().op_type_name() == op_type_name;
+}
+
+Maybe<bool> IsOptimizerPassOpNode(const OpNode* op_node) {
+  const int64_t scope_symbol_id = op_node->op().op_conf().scope_symbol_id();
+  const auto& scope = JUST(Global<symbol::Storage<Scope>>::Get()->MaybeGet(scope_symbol_id));
+  return scope.scope_proto().calculation_pass_name() == kOptimizerPass;
+}
+
+// the parallel casts of gradients from partial sum to broadcast, where autograd all-reduces them
+bool IsGradientParallelCast(const OpNode* op_node) {
+  if (!IsUserOpWithTypeName(op_node->op().op_conf(), "parallel_cast")) { return false; }
+  if (!CHECK_JUST(IsOptimizerPassOpNode(op_node))) { return false; }
+  if (op_node->in_edges().size() != 1) { return false; }
+  if (op_node->parallel_desc().parallel_num() <= 1) { return false; }
+  const OpNode* producer = op_node->SoleInEdge()->src_node();
+  if (producer->parallel_desc() != op_node->parallel_desc()) { return false; }
+  const LogicalBlobId in_lbi = op_node->op().BnInOp2Lbi(GenRepeatedBn("in", 0));
+  if (op_node->LogicalBlobDesc4Lbi(in_lbi).is_dynamic()) { return false; }
+  return producer->SbpParallel4Lbi(in_lbi).has_partial_sum_parallel()
+         && op_node->SbpParallel4Lbi(in_lbi).has_broadcast_parallel();
+}
+
+// variable op name of the gradients in the job helper, the gradient may have passed through a
+// cast_to_static_shape on the way to the parallel cast
+std::function<const std::string*(const LogicalBlobId&)> MakeGetterVariableOpName4Gradient(
+    const OpGraph& op_graph, const Job& job) {
+  auto diff_lbi2variable_op_name = std::make_shared<HashMap<LogicalBlobId, std::string>>();
+  const auto& tag2lbi_relations = job.helper().tag2lbi_relations();
+  const auto& it = tag2lbi_relations.find(kProducedLbi2ConsumedDiffLbi);
+  if (it != tag2lbi_relations.end()) {
+    for (const auto& pair : it->second.pair()) {
+      const OpNode* producer = op_graph.OpNode4OpName(pair.first().op_name());
+      if (producer == nullptr || !producer->op().op_conf().has_variable_conf()) { continue; }
+      diff_lbi2variable_op_name->emplace(pair.second(), pair.first().op_name());
+    }
+  }
+  return [&op_graph, diff_lbi2variable_op_name](const LogicalBlobId& lbi) -> const std::string* {
+    LogicalBlobId cur_lbi = lbi;
+    while (true) {
+      const auto& it = diff_lbi2variable_op_name->find(cur_lbi);
+      if (it != diff_lbi2variable_op_name->end()) { return &it->second; }
+      const OpNode* producer = op_graph.OpNode4OpName(cur_lbi.op_name());
+      if (producer == nullptr) { return nullptr; }
+      const OperatorConf& producer_op_conf = producer->op().op_conf();
+      if (!IsUserOpWithTypeName(producer_op_conf, "cast_to_static_shape")) { return nullptr; }
+      cur_lbi = GenLogicalBlobId(user_op::UserOpConfWrapper(producer_op_conf).input("input", 0));
+    }
+  };
+}
+
+std::string AddScalarMul(const std::string& in_lbn, double factor, int64_t scope_symbol_id,
+                         const ParallelConf& parallel_conf, JobBuilder* job_builder) {
+  auto scalar_mul_op =
+      user_op::UserOpConfWrapperBuilder(kGradientCompressionOpNamePrefix + "ScalarMul-"
+                                        + NewUniqueId())
+          .Op("scalar_mul")
+          .Input("in", in_lbn)
+          .Output("out")
+          .Attr<bool>("has_float_operand", true)
+          .Attr<double>("float_operand", factor)
+          .Attr<bool>("has_int_operand", false)
+          .Attr<int64_t>("int_operand", 0)
+          .ScopeSymbolId(scope_symbol_id)
+          .Build();
+  job_builder->AddOps(parallel_conf, {scalar_mul_op.op_conf()});
+  return scalar_mul_op.output("out", 0);
+}
+
+std::string AddCast(const std::string& in_lbn, DataType data_type, int64_t scope_symbol_id,
+                    const ParallelConf& parallel_conf, JobBuilder* job_builder) {
+  auto cast_op = user_op::UserOpConfWrapperBuilder(kGradientCompressionOpNamePrefix + "Cast-"
+                                                   + NewUniqueId())
+                     .Op("cast")
+                     .Input("in", in_lbn)
+                     .Output("out")
+                     .Attr<DataType>("dtype", data_type)
+                     .ScopeSymbolId(scope_symbol_id)
+                     .Build();
+  job_builder->AddOps(parallel_conf, {cast_op.op_conf()});
+  return cast_op.output("out", 0);
+}
+
+std::string AddBroadcastParallelCast(const std::string& in_lbn, int64_t scope_symbol_id,
+                                     const ParallelConf& parallel_conf, JobBuilder* job_builder) {
+  SbpParallel broadcast;
+  broadcast.mutable_broadcast_parallel();
+  auto parallel_cast_op =
+      user_op::UserOpConfWrapperBuilder(kGradientCompressionOpNamePrefix + "ParallelCast-"
+                                        + NewUniqueId())
+          .Op("parallel_cast")
+          .Input("in", in_lbn)
+          .Output("out")
+          .Attr("sbp_parallel", SbpParallelToString(broadcast))
+          .ScopeSymbolId(scope_symbol_id)
+          .Build();
+  job_builder->AddOps(parallel_conf, {parallel_cast_op.op_conf()});
+  return parallel_cast_op.output("out", 0);
+}
+
+// all-reduce in float16: P(float) -> [scale] -> cast -> P2B -> cast -> [scale] -> B(float)
+std::string CompressByFloat16(const std::string& gradient_lbn, int64_t parallel_num,
+                              bool has_dynamic_loss_scale, int64_t scope_symbol_id,
+                              const ParallelConf& parallel_conf, JobBuilder* job_builder) {
+  std::string lbn = gradient_lbn;
+  if (!has_dynamic_loss_scale) {
+    lbn = AddScalarMul(lbn, 1.0 / parallel_num, scope_symbol_id, parallel_conf, job_builder);
+  }
+  lbn = AddCast(lbn, DataType::kFloat16, scope_symbol_id, parallel_conf, job_builder);
+  lbn = AddBroadcastParallelCast(lbn, scope_symbol_id, parallel_conf, job_builder);
+  lbn = AddCast(lbn, DataType::kFloat, scope_symbol_id, parallel_conf, job_builder);
+  if (!has_dynamic_loss_scale) {
+    lbn = AddScalarMul(lbn, parallel_num, scope_symbol_id, parallel_conf, job_builder);
+  }
+  return lbn;
+}
+
+// all-gather indexed slices: P(dense) -> top_k_gradient_sparsify -> S2B -> unsorted_segment_sum
+// -> B(dense), which is also the pattern IndexedSlicesOptimizerRewritePass turns into indexed
+// slices model updates
+std::string CompressByTopK(const std::string& gradient_lbn, const std::string& variable_op_name,
+                           const BlobDesc& gradient_desc, int64_t parallel_num, float ratio,
+                           int64_t scope_symbol_id, const ParallelConf& parallel_conf,
+                           JobBuilder* job_builder) {
+  const Shape& shape = gradient_desc.shape();
+  OperatorConf residual_op_conf{};
+  residual_op_conf.set_name(variable_op_name + "-" + kGradientCompressionOpNamePrefix
+                            + "TopKResidual");
+  residual_op_conf.set_scope_symbol_id(scope_symbol_id);
+  VariableOpConf* residual_conf = residual_op_conf.mutable_variable_conf();
+  residual_conf->set_out("out");
+  DimVector residual_dim_vec = shape.dim_vec();
+  residual_dim_vec.at(0) *= parallel_num;
+  Shape(residual_dim_vec).ToProto(residual_conf->mutable_shape());
+  residual_conf->set_data_type(gradient_desc.data_type());
+  residual_conf->mutable_split_axis()->set_value(0);
+  residual_conf->mutable_initializer()->mutable_constant_conf()->set_value(0);
+  residual_conf->set_trainable(false);
+  job_builder->AddOps(parallel_conf, {residual_op_conf});
+  auto sparsify_op =
+      user_op::UserOpConfWrapperBuilder(kGradientCompressionOpNamePrefix + "TopK-"
+                                        + NewUniqueId())
+          .Op("top_k_gradient_sparsify")
+          .Input("gradient", gradient_lbn)
+          .Input("residual", GenLogicalBlobName(residual_op_conf.name(), residual_conf->out()))
+          .Output("indices")
+          .Output("values")
+          .Attr<float>("ratio", ratio)
+          .ScopeSymbolId(scope_symbol_id)
+          .Build();
+  job_builder->AddOps(parallel_conf, {sparsify_op.op_conf()});
+  auto segment_sum_op =
+      user_op::UserOpConfWrapperBuilder(kGradientCompressionOpNamePrefix + "UnsortedSegmentSum-"
+                                        + NewUniqueId())
+          .Op("unsorted_segment_sum")
+          .Input("data", AddBroadcastParallelCast(sparsify_op.output("values", 0),
+                                                  scope_symbol_id, parallel_conf, job_builder))
+          .Input("segment_ids", AddBroadcastParallelCast(sparsify_op.output("indices", 0),
+                                                         scope_symbol_id, parallel_conf,
+                                                         job_builder))
+          .Output("out")
+          .Attr<int64_t>("axis", 0)
+          .Attr<int64_t>("num_segments", shape.At(0))
+          .ScopeSymbolId(scope_symbol_id)
+          .Build();
+  job_builder->AddOps(parallel_conf, {segment_sum_op.op_conf()});
+  return segment_sum_op.output("out", 0);
+}
+
+Maybe<void> GradientCompressionPass::Apply(const JobPassCtx& ctx, const OpGraph& op_graph,
+                                           JobBuilder* job_builder) const {
+  const GradientCompressionConf& conf = ctx.job_desc().job_conf().gradient_compression_conf();
+  const bool has_dynamic_loss_scale =
+      ctx.job_desc().job_conf().train_conf().has_dynamic_loss_scale_policy();
+  const PbRpf<std::string>& top_k_include_op_names = conf.top_k_include_op_names().op_name();
+  const HashSet<std::string> top_k_include_op_name_set(top_k_include_op_names.cbegin(),
+                                                       top_k_include_op_names.cend());
+  const auto VariableOpName4Gradient =
+      MakeGetterVariableOpName4Gradient(op_graph, job_builder->job());
+  std::vector<OperatorConf> parallel_cast_op_confs;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    if (!IsGradientParallelCast(op_node)) { return; }
+    const OpNode* producer = op_node->SoleInEdge()->src_node();
+    const LogicalBlobId in_lbi = op_node->op().BnInOp2Lbi(GenRepeatedBn("in", 0));
+    const BlobDesc& gradient_desc = op_node->LogicalBlobDesc4Lbi(in_lbi);
+    const std::string* variable_op_name = VariableOpName4Gradient(in_lbi);
+    // NOTE: the compression ops take the scope of the op feeding the parallel cast. That is the
+    //   cast_to_static_shape which AddDiffStaticShapeCast adds in the scope of the variable, not a
+    //   backward op, so the compression runs next to the parallel cast in front of the optimizer
+    const int64_t scope_symbol_id = producer->op().op_conf().scope_symbol_id();
+    const ParallelConf& parallel_conf = op_node->parallel_desc().parallel_conf();
+    const int64_t parallel_num = op_node->parallel_desc().parallel_num();
+    std::string compressed_lbn;
+    if (variable_op_name != nullptr
+        && top_k_include_op_name_set.find(*variable_op_name) != top_k_include_op_name_set.end()
+        && (gradient_desc.data_type() == DataType::kFloat
+            || gradient_desc.data_type() == DataType::kDouble)) {
+      compressed_lbn = CompressByTopK(GenLogicalBlobName(in_lbi), *variable_op_name,
+                                      gradient_desc, parallel_num, conf.top_k_ratio(),
+                                      scope_symbol_id, parallel_conf, job_builder);
+    } else if (conf.enable_fp16() && gradient_desc.data_type() == DataType::kFloat) {
+      compressed_lbn = CompressByFloat16(GenLogicalBlobName(in_lbi), parallel_num,
+                                         has_dynamic_loss_scale, scope_symbol_id, parallel_conf,
+                                         job_builder);
+    } else {
+      return;
+    }
+    OperatorConf parallel_cast_op_conf = op_node->op().op_conf();
+    const auto& old_val =
+        ReplaceInputLbnInOpCustomizedConf(&parallel_cast_op_conf, GenRepeatedBn("in", 0),
+                                          compressed_lbn);
+    CHECK_EQ(GenLogicalBlobName(in_lbi), old_val);
+    parallel_cast_op_confs.push_back(parallel_cast_op_conf);
+  });
+  job_builder->MutOpsOnlyOnce(parallel_cast_op_confs);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("GradientCompressionPass", GradientCompressionPass);
+
+}  // namespace oneflow
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/job_rewriter/group_boxing_by_dst_parallel.h"
 #include "oneflow/core/framework/config_def.h"
 #include "oneflow/core/job_rewriter/xrt_compilation.h"
+#include "oneflow/core/profiler/compile_stats.h"
 
 namespace oneflow {
 
@@ -95,7 +96,11 @@ void SetCtrlInOpName4VariableOp(const OpGraph& op_graph, JobBuilder* job_builder
 
 void JobCompleter::Complete(Job* job) const {
   JobPassCtx job_pass_ctx(GlobalJobDesc());
-  JobPass4Name("DumpTimeShapeAndBlobParallelConfPass")(job, &job_pass_ctx);
+  auto DoPass = [&](const std::string& pass_name) {
+    profiler::ScopedCompileStage stage(GlobalJobDesc().job_id(), pass_name);
+    JobPass4Name(pass_name)(job, &job_pass_ctx);
+  };
+  DoPass("DumpTimeShapeAndBlobParallelConfPass");
   // NOTE(chengcheng): disable this pass for reduce boxing memory life cycle to memory cost.
   if (!Global<ResourceDesc, ForSession>::Get()->resource().disable_group_boxing_by_dst_parallel()) {
     WithOpGraphAndMutJobBuilder(job, &GroupBoxingByDstParallel);
@@ -107,7 +112,7 @@ void JobCompleter::Complete(Job* job) const {
   WithOpGraphAndMutJobBuilder(job, &AutoSourceAndSinkTick);
   WithOpGraphAndMutJobBuilder(job, &AddGlobalInputCriticalSections);
   WithOpGraphAndMutJobBuilder(job, &AddGlobalOutputCriticalSections);
-  JobPass4Name("DumpTimeShapeAndBlobParallelConfPass")(job, &job_pass_ctx);
+  DoPass("DumpTimeShapeAndBlobParallelConfPass");
   if (XrtCompilationEnabled(GlobalJobDesc())) {
 #ifdef OF_WITH_XRT
     WithOpGraphAndMutJob(job, &RebuildXrtCompiledJob);
@@ -117,11 +122,12 @@ void JobCompleter::Complete(Job* job) const {
 #endif  // OF_WITH_XRT
   }
 
+  DoPass("GradientBucketingPass");
   if (Global<ResourceDesc, ForSession>::Get()->nccl_use_compute_stream()) {
     // NOTE(chengcheng): this pass need as last pass for insert correct op with nccl boxing.
-    JobPass4Name("InsertNcclLogicalOpPass")(job, &job_pass_ctx);
+    DoPass("InsertNcclLogicalOpPass");
     // NOTE(chengcheng): Becasue insert new logical nccl op, MUST dump time shape, sbp again.
-    JobPass4Name("DumpTimeShapeAndBlobParallelConfPass")(job, &job_pass_ctx);
+    DoPass("DumpTimeShapeAndBlobParallelConfPass");
   }
   CheckOpGraph(OpGraph(*job));
 }
@@ -17,11 +17,18 @@ limitations under the License.
 #include "oneflow/core/job_rewriter/job_pass.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include "oneflow/core/framework/framework.h"
 
 namespace oneflow {
 
 namespace {
 
+constexpr char kParameterShardingGatherOpNamePrefix[] = "System-ParameterSharding-Gather-";
+constexpr char kParameterShardingRegatherOpNamePrefix[] = "System-ParameterSharding-Regather-";
+
 int64_t GetSoleOutBlobSize(const OpNode* node) {
   const BlobDesc& blob_desc =
       node->LogicalBlobDesc4Lbi(node->op().BnInOp2Lbi(node->op().SoleObn()));
@@ -259,6 +266,167 @@ Maybe<void> RewriteDistributedSplit(const OpGraph& op_graph, JobBuilder* builder
   return Maybe<void>::Ok();
 }
 
+const OpNode* GetFirstConsumer(const std::vector<const OpNode*>& consumers,
+                               const std::function<int64_t(const OpNode*)>& OpNode2Order) {
+  return *std::min_element(consumers.cbegin(), consumers.cend(),
+                           [&](const OpNode* lhs, const OpNode* rhs) {
+                             return OpNode2Order(lhs) < OpNode2Order(rhs);
+                           });
+}
+
+// gathers are grouped by their first consumer, each group may start once the first consumer of
+// the previous group is done, so at most the parameters of two groups are gathered at a time.
+// first_consumers.at(i) is the first consumer of gather_op_confs->at(i).
+void AddPrefetchCtrlEdges(const std::vector<const OpNode*>& first_consumers,
+                          const std::function<int64_t(const OpNode*)>& OpNode2Order,
+                          std::vector<OperatorConf>* gather_op_confs) {
+  CHECK_EQ(first_consumers.size(), gather_op_confs->size());
+  std::vector<int64_t> sorted_gather_idx(gather_op_confs->size());
+  FOR_RANGE(int64_t, i, 0, sorted_gather_idx.size()) { sorted_gather_idx.at(i) = i; }
+  std::stable_sort(sorted_gather_idx.begin(), sorted_gather_idx.end(),
+                   [&](int64_t lhs, int64_t rhs) {
+                     return OpNode2Order(first_consumers.at(lhs))
+                            < OpNode2Order(first_consumers.at(rhs));
+                   });
+  const OpNode* prev_group_first_consumer = nullptr;
+  const OpNode* cur_group_first_consumer = nullptr;
+  for (int64_t gather_idx : sorted_gather_idx) {
+    if (first_consumers.at(gather_idx) != cur_group_first_consumer) {
+      prev_group_first_consumer = cur_group_first_consumer;
+      cur_group_first_consumer = first_consumers.at(gather_idx);
+    }
+    if (prev_group_first_consumer != nullptr) {
+      gather_op_confs->at(gather_idx).add_ctrl_in_op_name(
+          prev_group_first_consumer->op().op_name());
+    }
+  }
+}
+
+// variables are split like distributed_split, their consumers read them through a gather op whose
+// backward reduce-scatters the gradient. The gathered parameters are released after the forward
+// consumers, backward consumers gather them again in ParameterShardingRegatherPass.
+Maybe<void> RewriteFullySharded(const OpGraph& op_graph, JobBuilder* builder) {
+  const int64_t threshold = builder->job().job_conf().optimizer_placement_optimization_threshold();
+  const auto IsAllowed = [threshold](const OpNode* n) -> bool {
+    if (n->op().op_conf().has_variable_conf()) {
+      const Shape shape(n->op().op_conf().variable_conf().shape());
+      const int64_t parallel_num = n->parallel_desc().parallel_num();
+      return shape.At(0) % parallel_num == 0 && shape.elem_cnt() >= threshold * parallel_num;
+    } else {
+      return IsS0SignatureSupported(n);
+    }
+  };
+  auto OpNode2Order = MakeGetterOpNode2TopoOrder(op_graph);
+  HashMap<std::string, OperatorConf> consumer_op_name2op_conf;
+  const auto ShardSequences = [&](const ParallelDesc& pd,
+                                  std::vector<SequencePtr>&& sorted_sequences) {
+    std::vector<OperatorConf> gather_op_confs;
+    std::vector<const OpNode*> first_consumers;
+    for (const SequencePtr& sequence : sorted_sequences) {
+      const OpNode* last_node = sequence->GetLastNode();
+      std::vector<const OpNode*> consumers;
+      last_node->ForEachNodeOnOutEdge(
+          [&](const OpNode* out_node) { consumers.push_back(out_node); });
+      if (consumers.empty()) { continue; }
+      OperatorConf var_op_conf = sequence->GetVariableNode()->op().op_conf();
+      var_op_conf.mutable_variable_conf()->mutable_split_axis()->set_value(0);
+      builder->MutOpsOnlyOnce({var_op_conf});
+      const LogicalBlobId& lbi = last_node->op().BnInOp2Lbi(last_node->op().SoleObn());
+      const auto gather_op =
+          user_op::UserOpConfWrapperBuilder(kParameterShardingGatherOpNamePrefix
+                                            + last_node->op().op_name())
+              .Op("parallel_cast")
+              .Input("in", GenLogicalBlobName(lbi))
+              .Output("out")
+              .Attr<std::string>("sbp_parallel", "B")
+              .Attr<std::string>("grad_sbp_parallel", "S(0)")
+              .ScopeSymbolId(last_node->op().op_conf().scope_symbol_id())
+              .Build();
+      gather_op_confs.push_back(gather_op.op_conf());
+      first_consumers.push_back(GetFirstConsumer(consumers, OpNode2Order));
+      ForEachOutNodeConsumingSoleOut(
+          last_node, [&](const OpNode* out_node, const std::string& ibn) {
+            const std::string& op_name = out_node->op().op_name();
+            auto it = consumer_op_name2op_conf.find(op_name);
+            if (it == consumer_op_name2op_conf.end()) {
+              it = consumer_op_name2op_conf.emplace(op_name, out_node->op().op_conf()).first;
+            }
+            ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, gather_op.output("out", 0));
+          });
+    }
+    AddPrefetchCtrlEdges(first_consumers, OpNode2Order, &gather_op_confs);
+    builder->AddOps(pd.parallel_conf(), gather_op_confs);
+  };
+  ForEachParallelSortedNodeSequence(op_graph, IsAllowed, SequenceCompSortedByOrderAsc,
+                                    ShardSequences);
+  for (const auto& pair : consumer_op_name2op_conf) { builder->MutOpsOnlyOnce({pair.second}); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<bool> IsBackwardPassOpNode(const OpNode* op_node) {
+  const int64_t scope_symbol_id = op_node->op().op_conf().scope_symbol_id();
+  const auto& scope = JUST(Global<symbol::Storage<Scope>>::Get()->MaybeGet(scope_symbol_id));
+  return scope.scope_proto().calculation_pass_name() == kBackwardPass;
+}
+
+// backward consumers of a gathered parameter read a gather of their own instead of keeping the
+// forward one alive through the whole iteration
+Maybe<void> RegatherShardedParameters4Backward(const OpGraph& op_graph, JobBuilder* builder) {
+  auto OpNode2Order = MakeGetterOpNode2TopoOrder(op_graph);
+  HashMap<std::string, OperatorConf> consumer_op_name2op_conf;
+  HashMap<ParallelDesc, std::vector<OperatorConf>> parallel_desc2regather_op_confs;
+  HashMap<ParallelDesc, std::vector<const OpNode*>> parallel_desc2first_consumers;
+  const std::string prefix = kParameterShardingGatherOpNamePrefix;
+  std::vector<const OpNode*> gather_nodes;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    if (op_node->op().op_name().compare(0, prefix.size(), prefix) == 0) {
+      gather_nodes.push_back(op_node);
+    }
+  });
+  for (const OpNode* gather_node : gather_nodes) {
+    const LogicalBlobId& lbi = gather_node->op().BnInOp2Lbi(gather_node->op().SoleObn());
+    std::vector<const OpNode*> bw_consumers;
+    for (const OpEdge* edge : gather_node->out_edges()) {
+      if (JUST(IsBackwardPassOpNode(edge->dst_node()))) {
+        bw_consumers.push_back(edge->dst_node());
+      }
+    }
+    if (bw_consumers.empty()) { continue; }
+    const OpNode* first_consumer = GetFirstConsumer(bw_consumers, OpNode2Order);
+    const user_op::UserOpConfWrapper gather_op(gather_node->op().op_conf());
+    const auto regather_op =
+        user_op::UserOpConfWrapperBuilder(kParameterShardingRegatherOpNamePrefix
+                                          + gather_node->op().op_name().substr(prefix.size()))
+            .Op("parallel_cast")
+            .Input("in", gather_op.input("in", 0))
+            .Output("out")
+            .Attr<std::string>("sbp_parallel", "B")
+            .ScopeSymbolId(first_consumer->op().op_conf().scope_symbol_id())
+            .Build();
+    parallel_desc2regather_op_confs[gather_node->parallel_desc()].push_back(regather_op.op_conf());
+    parallel_desc2first_consumers[gather_node->parallel_desc()].push_back(first_consumer);
+    for (const OpNode* consumer : bw_consumers) {
+      const std::string& op_name = consumer->op().op_name();
+      auto it = consumer_op_name2op_conf.find(op_name);
+      if (it == consumer_op_name2op_conf.end()) {
+        it = consumer_op_name2op_conf.emplace(op_name, consumer->op().op_conf()).first;
+      }
+      for (const std::string& ibn : consumer->op().input_bns()) {
+        if (consumer->op().BnInOp2Lbi(ibn) == lbi) {
+          ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, regather_op.output("out", 0));
+        }
+      }
+    }
+  }
+  for (auto& pair : parallel_desc2regather_op_confs) {
+    AddPrefetchCtrlEdges(parallel_desc2first_consumers.at(pair.first), OpNode2Order,
+                         &pair.second);
+    builder->AddOps(pair.first.parallel_conf(), pair.second);
+  }
+  for (const auto& pair : consumer_op_name2op_conf) { builder->MutOpsOnlyOnce({pair.second}); }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> RewriteNonDistributed(const OpGraph& op_graph, JobBuilder* builder) {
   HashMap<ParallelDesc, std::vector<SequencePtr>> new_parallel_desc2sequences;
   const auto RewritePartition = [&](const ParallelDesc& new_parallel_desc,
@@ -321,6 +489,8 @@ class OptimizerPlacementOptimizationPass final : public JobPass {
       return RewriteNonDistributed(op_graph, &job_builder);
     } else if (mode == "distributed_split") {
       return RewriteDistributedSplit(op_graph, &job_builder);
+    } else if (mode == "fully_sharded") {
+      return RewriteFullySharded(op_graph, &job_builder);
     } else {
       return Error::Unimplemented();
     }
@@ -329,6 +499,27 @@ class OptimizerPlacementOptimizationPass final : public JobPass {
 
 REGISTER_JOB_PASS("OptimizerPlacementOptimizationPass", OptimizerPlacementOptimizationPass);
 
+class ParameterShardingRegatherPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ParameterShardingRegatherPass);
+  ParameterShardingRegatherPass() = default;
+  ~ParameterShardingRegatherPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain()
+           && ctx.job_desc().job_conf().optimizer_placement_optimization_mode() == "fully_sharded";
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return RegatherShardedParameters4Backward(op_graph, &job_builder);
+  }
+};
+
+REGISTER_JOB_PASS("ParameterShardingRegatherPass", ParameterShardingRegatherPass);
+
 }  // namespace
 
 }  // namespace oneflow
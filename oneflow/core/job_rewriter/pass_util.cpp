@@ -28,6 +28,24 @@ std::string ReplaceSlashToDash4Lbn(std::string lbn) {
   return lbn;
 }
 
+double EstimateLogicalFlops(const OpNode& op_node) {
+  return EstimateLogicalFlops(op_node.op(), [&](const LogicalBlobId& lbi) -> const BlobDesc& {
+    return op_node.LogicalBlobDesc4Lbi(lbi);
+  });
+}
+
+double EstimateLogicalFlops(
+    const Operator& op,
+    const std::function<const BlobDesc&(const LogicalBlobId&)>& LogicalBlobDesc4Lbi) {
+  ComputeCost cost;
+  CHECK_JUST(op.InferComputeCost(
+      [&](const std::string& bn) -> const BlobDesc* {
+        return &LogicalBlobDesc4Lbi(op.BnInOp2Lbi(bn));
+      },
+      &cost));
+  return std::max<double>(cost.flops, 1);
+}
+
 void DfsTopoGraphTraversal(const OpGraph& graph, bool reversed,
                            std::function<bool(OpNode*)> IsCurNodeStartNode,
                            std::function<bool(OpNode*)> IsCurNodeSatisfied,
@@ -46,6 +46,13 @@ std::string Container2Str(const ContainerT& container,
 
 std::string ReplaceSlashToDash4Lbn(std::string lbn);
 
+// Rough floating point operation count of the logical op given by Operator::InferComputeCost,
+// at least one
+double EstimateLogicalFlops(const OpNode& op_node);
+double EstimateLogicalFlops(
+    const Operator& op,
+    const std::function<const BlobDesc&(const LogicalBlobId&)>& LogicalBlobDesc4Lbi);
+
 void DfsTopoGraphTraversal(const OpGraph& graph, bool reversed,
                            std::function<bool(OpNode*)> IsCurNodeStartNode,
                            std::function<bool(OpNode*)> IsCurNodeSatisfied,
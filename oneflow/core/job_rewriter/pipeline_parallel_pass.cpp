@@ -0,0 +1,324 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
+#include "oneflow/core/job/job_builder.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr char kPipelineParallelOpNamePrefix[] = "System-PipelineParallel-";
+
+// PipelineParallelPass splits the ops placed with the loss into stages of contiguous ops in
+// topological order, balanced by estimated compute and activation transfer time. With
+// micro-batches, the inputs of the stages are unpacked or repeated so that the stages work on
+// different micro-batches at the same time.
+class PipelineParallelPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PipelineParallelPass);
+  PipelineParallelPass() = default;
+  ~PipelineParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain()
+           && ctx.job_desc().job_conf().pipeline_parallel_conf().stage_num() > 1;
+  }
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override;
+};
+
+// the devices of parallel_desc in parallel id order, divided into stage_num contiguous groups
+std::vector<ParallelConf> GenStageParallelConfs(const ParallelDesc& parallel_desc,
+                                                int64_t stage_num) {
+  const int64_t stage_parallel_num = parallel_desc.parallel_num() / stage_num;
+  std::vector<ParallelConf> stage_parallel_confs(stage_num);
+  FOR_RANGE(int64_t, stage, 0, stage_num) {
+    ParallelConf* parallel_conf = &stage_parallel_confs.at(stage);
+    parallel_conf->set_device_tag(parallel_desc.parallel_conf().device_tag());
+    FOR_RANGE(int64_t, parallel_id, stage * stage_parallel_num,
+              (stage + 1) * stage_parallel_num) {
+      parallel_conf->add_device_name(
+          std::to_string(CHECK_JUST(parallel_desc.MachineId4ParallelId(parallel_id))) + ":"
+          + std::to_string(CHECK_JUST(parallel_desc.DeviceId4ParallelId(parallel_id))));
+    }
+  }
+  return stage_parallel_confs;
+}
+
+// splits ops with the given per op time and per cut time into stage_num non-empty contiguous
+// ranges minimizing the time of the slowest stage, returns the first op of every stage
+std::vector<int64_t> PartitionStages(const std::vector<double>& op_times,
+                                     const std::vector<double>& cut_times, int64_t stage_num) {
+  const int64_t op_num = op_times.size();
+  std::vector<double> prefix_times(op_num + 1, 0);
+  FOR_RANGE(int64_t, i, 0, op_num) { prefix_times.at(i + 1) = prefix_times.at(i) + op_times.at(i); }
+  // ops [begin, end) send their activations over the cut before end
+  auto StageTime = [&](int64_t begin, int64_t end) {
+    return prefix_times.at(end) - prefix_times.at(begin) + (end < op_num ? cut_times.at(end) : 0);
+  };
+  // max_times[s][end]: the lowest time of the slowest stage splitting ops [0, end) into s+1 stages
+  const double kInf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> max_times(stage_num, std::vector<double>(op_num + 1, kInf));
+  std::vector<std::vector<int64_t>> last_begins(stage_num, std::vector<int64_t>(op_num + 1, 0));
+  FOR_RANGE(int64_t, end, 1, op_num + 1) { max_times.at(0).at(end) = StageTime(0, end); }
+  FOR_RANGE(int64_t, stage, 1, stage_num) {
+    FOR_RANGE(int64_t, end, stage + 1, op_num + 1) {
+      FOR_RANGE(int64_t, begin, stage, end) {
+        const double time = std::max(max_times.at(stage - 1).at(begin), StageTime(begin, end));
+        if (time < max_times.at(stage).at(end)) {
+          max_times.at(stage).at(end) = time;
+          last_begins.at(stage).at(end) = begin;
+        }
+      }
+    }
+  }
+  std::vector<int64_t> stage_begins(stage_num, 0);
+  int64_t end = op_num;
+  for (int64_t stage = stage_num - 1; stage > 0; --stage) {
+    stage_begins.at(stage) = last_begins.at(stage).at(end);
+    end = stage_begins.at(stage);
+  }
+  return stage_begins;
+}
+
+// the share of time the devices idle in one iteration, when every stage forwards and backwards
+// micro_batch_num micro-batches through the pipeline
+double PredictBubbleFraction(const std::vector<double>& stage_times, int64_t micro_batch_num) {
+  const double sum_time = std::accumulate(stage_times.begin(), stage_times.end(), 0.0);
+  const double max_time = *std::max_element(stage_times.begin(), stage_times.end());
+  const double iteration_time = sum_time + (micro_batch_num - 1) * max_time;
+  if (iteration_time <= 0) { return 0; }
+  return 1 - micro_batch_num * sum_time / (stage_times.size() * iteration_time);
+}
+
+Maybe<void> PipelineParallelPass::Apply(Job* job, JobPassCtx* ctx) const {
+  if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+  const PipelineParallelConf& conf = ctx->job_desc().job_conf().pipeline_parallel_conf();
+  const TrainConf& train_conf = ctx->job_desc().job_conf().train_conf();
+  const int64_t stage_num = conf.stage_num();
+  const int64_t micro_batch_num = conf.micro_batch_num();
+  CHECK_GT_OR_RETURN(micro_batch_num, 0);
+  // The dynamic loss scale is updated once per iteration from the overflow check of the whole
+  // batch, while with micro-batches the backward ops run once per micro-batch and nothing here
+  // repeats the loss scale or accumulates the check over them, so the two can not be combined
+  CHECK_OR_RETURN(micro_batch_num == 1 || !train_conf.has_dynamic_loss_scale_policy())
+      << "pipeline micro-batches do not support dynamic loss scale";
+  CHECK_GT_OR_RETURN(train_conf.loss_lbn_size(), 0);
+  const OpGraph op_graph(*job);
+  const ParallelDesc parallel_desc =
+      op_graph.OpNode4OpName(GenLogicalBlobId(train_conf.loss_lbn(0)).op_name())->parallel_desc();
+  CHECK_EQ_OR_RETURN(parallel_desc.parallel_num() % stage_num, 0)
+      << "the " << parallel_desc.parallel_num() << " devices of the loss can not be divided into "
+      << stage_num << " pipeline stages";
+  const int64_t stage_parallel_num = parallel_desc.parallel_num() / stage_num;
+
+  // sources are the variables and other ops without inputs, they join their first consumer
+  std::vector<const OpNode*> compute_nodes;
+  std::vector<const OpNode*> source_nodes;
+  HashMap<const OpNode*, int64_t> compute_node2index;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (op_node->parallel_desc() != parallel_desc) { return; }
+    if (!op_conf.has_user_conf() && !op_conf.has_variable_conf()) { return; }
+    if (op_node->in_edges().empty()) {
+      source_nodes.push_back(op_node);
+    } else {
+      compute_node2index.emplace(op_node, compute_nodes.size());
+      compute_nodes.push_back(op_node);
+    }
+  });
+  const int64_t op_num = compute_nodes.size();
+  CHECK_GE_OR_RETURN(op_num, stage_num)
+      << "only " << op_num << " ops can not be split into " << stage_num << " pipeline stages";
+  auto IsComputeNode = [&](const OpNode* op_node) {
+    return compute_node2index.find(op_node) != compute_node2index.end();
+  };
+
+  // per micro-batch, forward and backward are taken as three times the forward flops and each
+  // activation crossing a cut is sent forward and its diff backward
+  std::vector<double> op_times(op_num);
+  std::vector<double> cut_bytes(op_num + 1, 0);
+  FOR_RANGE(int64_t, i, 0, op_num) {
+    const OpNode* op_node = compute_nodes.at(i);
+    op_times.at(i) = 3 * EstimateLogicalFlops(*op_node)
+                     / (micro_batch_num * stage_parallel_num * conf.device_gflops() * 1e9);
+    HashMap<LogicalBlobId, int64_t> lbi2last_consumer_index;
+    for (const OpEdge* edge : op_node->out_edges()) {
+      if (!IsComputeNode(edge->dst_node())) { continue; }
+      const int64_t consumer_index = compute_node2index.at(edge->dst_node());
+      for (const LogicalBlobId& lbi : edge->lbis()) {
+        int64_t* last_consumer_index = &lbi2last_consumer_index[lbi];
+        *last_consumer_index = std::max(*last_consumer_index, consumer_index);
+      }
+    }
+    for (const auto& pair : lbi2last_consumer_index) {
+      const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(pair.first);
+      const double bytes =
+          blob_desc.shape().elem_cnt() * GetSizeOfDataType(blob_desc.data_type());
+      FOR_RANGE(int64_t, cut, i + 1, pair.second + 1) { cut_bytes.at(cut) += bytes; }
+    }
+  }
+  std::vector<double> cut_times(op_num + 1);
+  FOR_RANGE(int64_t, cut, 0, op_num + 1) {
+    cut_times.at(cut) = 2 * cut_bytes.at(cut)
+                        / (micro_batch_num * stage_parallel_num
+                           * conf.inter_stage_bandwidth_gbyte_per_sec() * 1e9);
+  }
+  const std::vector<int64_t> stage_begins = PartitionStages(op_times, cut_times, stage_num);
+
+  HashMap<const OpNode*, int64_t> op_node2stage;
+  std::vector<double> stage_times(stage_num, 0);
+  std::vector<int64_t> stage_op_nums(stage_num, 0);
+  FOR_RANGE(int64_t, stage, 0, stage_num) {
+    const int64_t end = stage + 1 < stage_num ? stage_begins.at(stage + 1) : op_num;
+    FOR_RANGE(int64_t, i, stage_begins.at(stage), end) {
+      op_node2stage.emplace(compute_nodes.at(i), stage);
+      stage_times.at(stage) += op_times.at(i);
+    }
+    stage_times.at(stage) += end < op_num ? cut_times.at(end) : 0;
+    stage_op_nums.at(stage) = end - stage_begins.at(stage);
+  }
+  for (const OpNode* source_node : source_nodes) {
+    int64_t stage = stage_num;
+    for (const OpEdge* edge : source_node->out_edges()) {
+      if (IsComputeNode(edge->dst_node())) {
+        stage = std::min(stage, op_node2stage.at(edge->dst_node()));
+      }
+    }
+    op_node2stage.emplace(source_node, stage == stage_num ? 0 : stage);
+  }
+
+  JobBuilder job_builder(job);
+  const std::vector<ParallelConf> stage_parallel_confs =
+      GenStageParallelConfs(parallel_desc, stage_num);
+  for (const auto& pair : op_node2stage) {
+    job_builder.MutParallelConfOnlyOnce(pair.first->op().op_name(),
+                                        stage_parallel_confs.at(pair.second));
+  }
+
+  if (micro_batch_num > 1) {
+    // stage s has up to stage_num - s micro-batches in flight between their forward and backward
+    auto* op_name2min_register_num =
+        job_builder.mutable_helper()->mutable_op_name2min_register_num();
+    auto MinRegisterNum4Stage = [&](int64_t stage) {
+      return std::min(stage_num - stage, micro_batch_num);
+    };
+    for (const OpNode* op_node : compute_nodes) {
+      (*op_name2min_register_num)[op_node->op().op_name()] =
+          MinRegisterNum4Stage(op_node2stage.at(op_node));
+    }
+    HashMap<std::string, OperatorConf> op_name2op_conf;
+    auto ReplaceInputLbn = [&](const OpNode* consumer, const std::vector<std::string>& ibns,
+                               const std::string& new_lbn) {
+      const std::string& op_name = consumer->op().op_name();
+      auto it = op_name2op_conf.find(op_name);
+      if (it == op_name2op_conf.end()) {
+        it = op_name2op_conf.emplace(op_name, consumer->op().op_conf()).first;
+      }
+      for (const std::string& ibn : ibns) {
+        const std::string old_lbn = ReplaceInputLbnInOpCustomizedConf(&it->second, ibn, new_lbn);
+        CHECK_EQ(old_lbn, GenLogicalBlobName(consumer->op().BnInOp2Lbi(ibn)));
+      }
+    };
+    op_graph.ForEachNode([&](const OpNode* producer) {
+      HashMap<LogicalBlobId, std::vector<std::pair<const OpNode*, std::vector<std::string>>>>
+          lbi2consumers;
+      for (const OpEdge* edge : producer->out_edges()) {
+        // the blobs entering the pipeline from sources, the blobs leaving it to other ops
+        if (IsComputeNode(producer) == IsComputeNode(edge->dst_node())) { continue; }
+        for (const auto& pair : edge->lbi2ibns()) {
+          lbi2consumers[pair.first].emplace_back(edge->dst_node(), pair.second);
+        }
+      }
+      for (const auto& pair : lbi2consumers) {
+        const LogicalBlobId& lbi = pair.first;
+        const std::string adapter_name =
+            kPipelineParallelOpNamePrefix + lbi.op_name() + "-" + lbi.blob_name();
+        user_op::UserOpConfWrapperBuilder builder(adapter_name);
+        int64_t stage = stage_num;
+        int64_t scope_symbol_id = 0;
+        if (IsComputeNode(producer)) {
+          // the outputs of all micro-batches are concatenated
+          stage = op_node2stage.at(producer);
+          scope_symbol_id = producer->op().op_conf().scope_symbol_id();
+          builder.OpTypeName("pack").Attr<int32_t>("pack_num", micro_batch_num);
+        } else {
+          for (const auto& consumer7ibns : pair.second) {
+            if (op_node2stage.at(consumer7ibns.first) < stage) {
+              stage = op_node2stage.at(consumer7ibns.first);
+              scope_symbol_id = consumer7ibns.first->op().op_conf().scope_symbol_id();
+            }
+          }
+          // data split along the batch axis is unpacked into micro-batches, the rest is repeated
+          const BlobDesc& blob_desc = producer->LogicalBlobDesc4Lbi(lbi);
+          const SbpParallel& sbp_parallel = producer->SbpParallel4Lbi(lbi);
+          if (!producer->op().op_conf().has_variable_conf() && sbp_parallel.has_split_parallel()
+              && sbp_parallel.split_parallel().axis() == 0 && blob_desc.shape().NumAxes() > 0
+              && blob_desc.shape().At(0) % micro_batch_num == 0) {
+            builder.OpTypeName("unpack").Attr<int32_t>("unpack_num", micro_batch_num);
+          } else {
+            builder.OpTypeName("repeat").Attr<int32_t>("repeat_num", micro_batch_num);
+          }
+          (*op_name2min_register_num)[adapter_name] = MinRegisterNum4Stage(stage);
+        }
+        const auto adapter_op = builder.Input("in", GenLogicalBlobName(lbi))
+                                    .Output("out")
+                                    .ScopeSymbolId(scope_symbol_id)
+                                    .Build();
+        job_builder.AddOps(stage_parallel_confs.at(stage), {adapter_op.op_conf()});
+        for (const auto& consumer7ibns : pair.second) {
+          ReplaceInputLbn(consumer7ibns.first, consumer7ibns.second, adapter_op.output("out", 0));
+        }
+      }
+    });
+    std::vector<OperatorConf> op_confs;
+    for (const auto& pair : op_name2op_conf) { op_confs.push_back(pair.second); }
+    job_builder.MutOpsOnlyOnce(op_confs);
+  }
+
+  const double bubble_fraction = PredictBubbleFraction(stage_times, micro_batch_num);
+  std::ostringstream report;
+  report << "stage_num " << stage_num << " micro_batch_num " << micro_batch_num
+         << " predicted_bubble_fraction " << bubble_fraction << "\n";
+  FOR_RANGE(int64_t, stage, 0, stage_num) {
+    const int64_t end = stage + 1 < stage_num ? stage_begins.at(stage + 1) : op_num;
+    std::string device_names;
+    for (const std::string& device_name : stage_parallel_confs.at(stage).device_name()) {
+      device_names += (device_names.empty() ? "" : ",") + device_name;
+    }
+    report << "stage " << stage << " devices " << device_names << " op_num "
+           << stage_op_nums.at(stage) << " first_op "
+           << compute_nodes.at(stage_begins.at(stage))->op().op_name() << " time_per_micro_batch "
+           << stage_times.at(stage) << " seconds sent_bytes_per_micro_batch "
+           << (end < op_num ? cut_bytes.at(end) / micro_batch_num : 0) << "\n";
+  }
+  TeePersistentLogStream::Create("pipeline_parallel_report_job_"
+                                 + std::to_string(ctx->job_desc().job_id()))
+      ->Write(report.str());
+  LOG(INFO) << "job " << ctx->job_desc().job_name() << " is split into " << stage_num
+            << " pipeline stages, predicted bubble fraction " << bubble_fraction;
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("PipelineParallelPass", PipelineParallelPass);
+
+}  // namespace oneflow
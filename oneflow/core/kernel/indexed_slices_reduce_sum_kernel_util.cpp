@@ -40,8 +40,12 @@ void IndexedSlicesReduceSumKernelUtil<device_type, K, T, IDX>::ReduceSum(
   const Shape flat_in_shape({1, n, m});
   Memset<device_type>(ctx, values_out, 0, n * m * sizeof(T));
 
+  // unique_idx only takes [0, num_unique_indices), which is known on the host for cpu. Rows of
+  // values_out beyond it stay zero.
+  const int64_t num_segments =
+      device_type == DeviceType::kCPU ? static_cast<int64_t>(*num_unique_indices) : n;
   UnsortedSegmentSumKernelUtil<device_type, T, IDX, T>::UnsortedSegmentSum(
-      ctx, unique_idx_ptr, values, n, n, 1, m, 0, values_out);
+      ctx, unique_idx_ptr, values, n, num_segments, 1, m, 0, values_out);
 }
 
 template<DeviceType device_type, typename K, typename T, typename IDX>
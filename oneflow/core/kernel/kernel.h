@@ -72,7 +72,7 @@ class Kernel {
       std::function<Blob*(const std::string&)> BnInOp2Blob) const;
 
  protected:
-  Kernel() : job_desc_(nullptr), shape_infer_helper_(nullptr) {}
+  Kernel() : job_desc_(nullptr), shape_infer_helper_(nullptr), trace_name_id_(-1) {}
   void InitBase(const JobDesc* job_desc, const KernelConf&);
   virtual void VirtualKernelInit(DeviceCtx* device_ctx) { VirtualKernelInit(); }
   virtual void VirtualKernelInit() {}
@@ -129,6 +129,7 @@ class Kernel {
   const JobDesc* job_desc_;
   RuntimeBlobShapeInferHelper* shape_infer_helper_;
   KernelConf kernel_conf_;
+  int64_t trace_name_id_;
 };
 
 template<DeviceType device_type>
@@ -0,0 +1,147 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// ids drawn from a zipf distribution over [0, vocab_size), the way sparse features are skewed
+std::vector<int64_t> GenZipfIds(int64_t n, int64_t vocab_size, double exponent) {
+  std::vector<double> cdf(vocab_size);
+  double sum = 0;
+  FOR_RANGE(int64_t, i, 0, vocab_size) {
+    sum += 1.0 / std::pow(i + 1, exponent);
+    cdf.at(i) = sum;
+  }
+  std::mt19937_64 gen(0);
+  std::uniform_real_distribution<double> dis(0, sum);
+  // scatter the ranks over the id space so that hot ids are not the small ones
+  std::vector<int64_t> rank2id(vocab_size);
+  std::iota(rank2id.begin(), rank2id.end(), 0);
+  std::shuffle(rank2id.begin(), rank2id.end(), gen);
+  std::vector<int64_t> ids(n);
+  for (int64_t& id : ids) {
+    const int64_t rank = std::lower_bound(cdf.begin(), cdf.end(), dis(gen)) - cdf.begin();
+    id = rank2id.at(std::min(rank, vocab_size - 1));
+  }
+  return ids;
+}
+
+struct UniqueResult {
+  int64_t num_unique;
+  std::vector<int64_t> unique_out;
+  std::vector<int64_t> idx_out;
+  std::vector<int64_t> count;
+};
+
+// the node based hash map the cpu unique used to be
+void NaiveUniqueWithCounts(const std::vector<int64_t>& ids, UniqueResult* result) {
+  HashMap<int64_t, int64_t> map;
+  FOR_RANGE(int64_t, i, 0, ids.size()) {
+    auto it = map.find(ids.at(i));
+    if (it == map.end()) {
+      const int64_t idx = map.size();
+      result->count.at(idx) = 1;
+      result->idx_out.at(i) = idx;
+      result->unique_out.at(idx) = ids.at(i);
+      map[ids.at(i)] = idx;
+    } else {
+      result->count.at(it->second) += 1;
+      result->idx_out.at(i) = it->second;
+    }
+  }
+  result->num_unique = map.size();
+}
+
+void CpuUniqueWithCounts(const std::vector<int64_t>& ids, std::vector<char>* workspace,
+                         UniqueResult* result) {
+  UniqueKernelUtil<DeviceType::kCPU, int64_t, int64_t>::UniqueWithCounts(
+      nullptr, ids.size(), ids.data(), &result->num_unique, result->unique_out.data(),
+      result->idx_out.data(), result->count.data(), workspace->data(), workspace->size());
+}
+
+double MeasureMilliseconds(int64_t iters, const std::function<void()>& Run) {
+  Run();
+  const double start = GetCurTime();
+  FOR_RANGE(int64_t, i, 0, iters) { Run(); }
+  return (GetCurTime() - start) / 1e6 / iters;
+}
+
+void RunUniqueBenchmark(int64_t n, int64_t vocab_size, double exponent, int64_t iters,
+                        int32_t thread_num) {
+  const std::vector<int64_t> ids = GenZipfIds(n, vocab_size, exponent);
+  auto NewResult = [n]() {
+    return UniqueResult{0, std::vector<int64_t>(n), std::vector<int64_t>(n),
+                        std::vector<int64_t>(n)};
+  };
+  int64_t workspace_size = 0;
+  UniqueKernelUtil<DeviceType::kCPU, int64_t, int64_t>::GetUniqueWithCountsWorkspaceSizeInBytes(
+      nullptr, n, &workspace_size);
+  std::vector<char> workspace(workspace_size);
+
+  UniqueResult naive = NewResult();
+  const double naive_ms = MeasureMilliseconds(iters, [&]() {
+    std::fill(naive.count.begin(), naive.count.end(), 0);
+    NaiveUniqueWithCounts(ids, &naive);
+  });
+  auto MeasureCpuUnique = [&](int32_t pool_size) {
+    Global<ThreadPool>::New(pool_size);
+    UniqueResult result = NewResult();
+    const double ms = MeasureMilliseconds(
+        iters, [&]() { CpuUniqueWithCounts(ids, &workspace, &result); });
+    Global<ThreadPool>::Delete();
+    CHECK_EQ(result.num_unique, naive.num_unique);
+    CHECK(result.idx_out == naive.idx_out);
+    CHECK(std::equal(naive.unique_out.begin(), naive.unique_out.begin() + naive.num_unique,
+                     result.unique_out.begin()));
+    CHECK(std::equal(naive.count.begin(), naive.count.begin() + naive.num_unique,
+                     result.count.begin()));
+    return ms;
+  };
+  const double serial_ms = MeasureCpuUnique(1);
+  const double parallel_ms = MeasureCpuUnique(thread_num);
+  std::cout << "n: " << n << ", vocab_size: " << vocab_size << ", exponent: " << exponent
+            << ", num_unique: " << naive.num_unique << ", workspace: " << workspace_size
+            << " bytes" << std::endl
+            << "  HashMap: " << naive_ms << " ms" << std::endl
+            << "  open addressing: " << serial_ms << " ms, speedup " << naive_ms / serial_ms
+            << std::endl
+            << "  " << thread_num << " threads: " << parallel_ms << " ms, speedup "
+            << naive_ms / parallel_ms << std::endl;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+/*
+ * Try run this benchmark exe by :
+ *     ./unique_benchmark -n=4000000 -vocab_size=10000000 -exponent=1.05 -thread_num=16
+ */
+DEFINE_int64(n, 1 << 22, "number of ids of a batch");
+DEFINE_int64(vocab_size, 10000000, "number of distinct ids the batch is drawn from");
+DEFINE_double(exponent, 1.05, "exponent of the zipf distribution");
+DEFINE_int64(iters, 10, "timed iterations");
+DEFINE_int32(thread_num, std::thread::hardware_concurrency(), "size of the thread pool");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  RunUniqueBenchmark(FLAGS_n, FLAGS_vocab_size, FLAGS_exponent, FLAGS_iters, FLAGS_thread_num);
+  return 0;
+}
@@ -14,9 +14,252 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
+namespace {
+
+// fewer keys are deduplicated by the calling thread alone
+constexpr int64_t kParallelUniqueMinKeyNum = 1 << 16;
+constexpr int64_t kMaxUniquePartitionNum = 64;
+
+template<typename KEY, typename IDX>
+struct UniqueSlot {
+  KEY key;
+  // -1 for empty slots
+  IDX idx;
+};
+
+template<typename KEY>
+uint64_t HashUniqueKey(KEY key) {
+  // std::hash of integers is the identity, mix it by the finalizer of murmur3
+  uint64_t hash = std::hash<KEY>()(key);
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// power of 2 with a load factor of at most 2/3, so no more than 3 * key_num + 2 slots
+int64_t UniqueTableCapacity(int64_t key_num) {
+  int64_t capacity = 1;
+  while (capacity < key_num + key_num / 2 + 1) { capacity <<= 1; }
+  return capacity;
+}
+
+// open addressing with linear probing over slots in the workspace
+template<typename KEY, typename IDX>
+class UniqueTable final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(UniqueTable);
+  UniqueTable(UniqueSlot<KEY, IDX>* slots, int64_t capacity)
+      : slots_(slots), mask_(capacity - 1) {
+    std::memset(slots, 0xff, capacity * sizeof(UniqueSlot<KEY, IDX>));
+  }
+  ~UniqueTable() = default;
+
+  // idx of the key, which is new_idx if the key is inserted by this call
+  IDX FindOrInsert(KEY key, uint64_t hash, IDX new_idx, bool* inserted) {
+    for (uint64_t i = hash & mask_;; i = (i + 1) & mask_) {
+      UniqueSlot<KEY, IDX>* slot = slots_ + i;
+      if (slot->idx == -1) {
+        slot->key = key;
+        slot->idx = new_idx;
+        *inserted = true;
+        return new_idx;
+      }
+      if (slot->key == key) {
+        *inserted = false;
+        return slot->idx;
+      }
+    }
+  }
+
+ private:
+  UniqueSlot<KEY, IDX>* slots_;
+  uint64_t mask_;
+};
+
+template<typename KEY, typename IDX>
+struct UniqueWorkspace {
+  UniqueSlot<KEY, IDX>* slots;
+  // the following ones are used by the parallel unique only
+  IDX* part_sorted_idx;
+  IDX* first_idx;
+  IDX* part_count;
+  uint8_t* part_id;
+  int64_t* chunk7part2offset;
+};
+
+// returns the size in bytes, and the pointers into workspace if it is not null
+template<typename KEY, typename IDX>
+int64_t LayoutUniqueWorkspace(int64_t n, char* workspace, UniqueWorkspace<KEY, IDX>* ws) {
+  int64_t offset = 0;
+  auto Take = [&](int64_t size) -> char* {
+    char* ptr = workspace == nullptr ? nullptr : workspace + offset;
+    offset += GetCudaAlignedSize(size);
+    return ptr;
+  };
+  ws->slots = reinterpret_cast<UniqueSlot<KEY, IDX>*>(
+      Take((3 * n + 2 * kMaxUniquePartitionNum) * sizeof(UniqueSlot<KEY, IDX>)));
+  if (n < kParallelUniqueMinKeyNum) { return offset; }
+  ws->part_sorted_idx = reinterpret_cast<IDX*>(Take(n * sizeof(IDX)));
+  ws->first_idx = reinterpret_cast<IDX*>(Take(n * sizeof(IDX)));
+  ws->part_count = reinterpret_cast<IDX*>(Take(n * sizeof(IDX)));
+  ws->part_id = reinterpret_cast<uint8_t*>(Take(n * sizeof(uint8_t)));
+  ws->chunk7part2offset = reinterpret_cast<int64_t*>(
+      Take(kMaxUniquePartitionNum * kMaxUniquePartitionNum * sizeof(int64_t)));
+  return offset;
+}
+
+int64_t UniquePartitionNum(int64_t n) {
+  if (n < kParallelUniqueMinKeyNum || Global<ThreadPool>::Get() == nullptr) { return 1; }
+  return std::min<int64_t>(Global<ThreadPool>::Get()->thread_num(), kMaxUniquePartitionNum);
+}
+
+template<typename KEY, typename IDX>
+void SerialUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                            IDX* idx_out, IDX* count, const UniqueWorkspace<KEY, IDX>& ws) {
+  UniqueTable<KEY, IDX> table(ws.slots, UniqueTableCapacity(n));
+  IDX unique_num = 0;
+  FOR_RANGE(int64_t, i, 0, n) {
+    bool inserted = false;
+    const IDX idx = table.FindOrInsert(in[i], HashUniqueKey(in[i]), unique_num, &inserted);
+    if (inserted) {
+      unique_out[idx] = in[i];
+      if (count != nullptr) { count[idx] = 0; }
+      ++unique_num;
+    }
+    if (count != nullptr) { count[idx] += 1; }
+    idx_out[i] = idx;
+  }
+  *num_unique = unique_num;
+}
+
+// The keys are hash partitioned and each partition is deduplicated by one thread. The unique keys
+// are then numbered by their first occurrence, the same as the serial one, by a prefix sum over
+// the marks of first occurrences.
+template<typename KEY, typename IDX>
+void ParallelUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                              IDX* idx_out, IDX* count, const UniqueWorkspace<KEY, IDX>& ws,
+                              int64_t part_num) {
+  const BalancedSplitter chunks(n, part_num);
+  int64_t* chunk7part2offset = ws.chunk7part2offset;
+  MultiThreadLoop(part_num, [&](size_t chunk_id) {
+    int64_t* part2cnt = chunk7part2offset + chunk_id * part_num;
+    std::fill(part2cnt, part2cnt + part_num, 0);
+    const Range range = chunks.At(chunk_id);
+    FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+      const uint8_t part_id = (HashUniqueKey(in[i]) >> 32) % part_num;
+      ws.part_id[i] = part_id;
+      part2cnt[part_id] += 1;
+    }
+  });
+  // partitions one after another, each of them holds the keys of its chunks in order
+  std::vector<int64_t> part_offsets(part_num + 1);
+  int64_t offset = 0;
+  FOR_RANGE(int64_t, part_id, 0, part_num) {
+    part_offsets.at(part_id) = offset;
+    FOR_RANGE(int64_t, chunk_id, 0, part_num) {
+      const int64_t cnt = chunk7part2offset[chunk_id * part_num + part_id];
+      chunk7part2offset[chunk_id * part_num + part_id] = offset;
+      offset += cnt;
+    }
+  }
+  part_offsets.at(part_num) = offset;
+  MultiThreadLoop(part_num, [&](size_t chunk_id) {
+    int64_t* part2offset = chunk7part2offset + chunk_id * part_num;
+    const Range range = chunks.At(chunk_id);
+    FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+      ws.part_sorted_idx[part2offset[ws.part_id[i]]++] = i;
+    }
+  });
+  std::vector<int64_t> slot_offsets(part_num + 1, 0);
+  FOR_RANGE(int64_t, part_id, 0, part_num) {
+    slot_offsets.at(part_id + 1) =
+        slot_offsets.at(part_id)
+        + UniqueTableCapacity(part_offsets.at(part_id + 1) - part_offsets.at(part_id));
+  }
+  // idx_out and first_idx hold the idx local to the partition for now
+  std::vector<int64_t> part2unique_num(part_num);
+  MultiThreadLoop(part_num, [&](size_t part_id) {
+    const int64_t part_begin = part_offsets.at(part_id);
+    const int64_t part_end = part_offsets.at(part_id + 1);
+    UniqueTable<KEY, IDX> table(ws.slots + slot_offsets.at(part_id),
+                                UniqueTableCapacity(part_end - part_begin));
+    IDX* first_idx = ws.first_idx + part_begin;
+    IDX* part_count = ws.part_count + part_begin;
+    IDX unique_num = 0;
+    FOR_RANGE(int64_t, j, part_begin, part_end) {
+      const IDX i = ws.part_sorted_idx[j];
+      bool inserted = false;
+      const IDX idx = table.FindOrInsert(in[i], HashUniqueKey(in[i]), unique_num, &inserted);
+      if (inserted) {
+        first_idx[idx] = i;
+        if (count != nullptr) { part_count[idx] = 0; }
+        ++unique_num;
+      }
+      if (count != nullptr) { part_count[idx] += 1; }
+      idx_out[i] = idx;
+    }
+    part2unique_num.at(part_id) = unique_num;
+  });
+  // the tables are done with, their slots are reused for the global idx of first occurrences
+  IDX* global_idx = reinterpret_cast<IDX*>(ws.slots);
+  MultiThreadLoop(part_num, [&](size_t chunk_id) {
+    const Range range = chunks.At(chunk_id);
+    std::fill(global_idx + range.begin(), global_idx + range.end(), 0);
+  });
+  MultiThreadLoop(part_num, [&](size_t part_id) {
+    const IDX* first_idx = ws.first_idx + part_offsets.at(part_id);
+    FOR_RANGE(int64_t, j, 0, part2unique_num.at(part_id)) { global_idx[first_idx[j]] = 1; }
+  });
+  std::vector<int64_t> chunk_offsets(part_num + 1, 0);
+  MultiThreadLoop(part_num, [&](size_t chunk_id) {
+    const Range range = chunks.At(chunk_id);
+    IDX sum = 0;
+    FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+      const IDX mark = global_idx[i];
+      global_idx[i] = sum;
+      sum += mark;
+    }
+    chunk_offsets.at(chunk_id + 1) = sum;
+  });
+  FOR_RANGE(int64_t, chunk_id, 0, part_num) {
+    chunk_offsets.at(chunk_id + 1) += chunk_offsets.at(chunk_id);
+  }
+  MultiThreadLoop(part_num, [&](size_t chunk_id) {
+    const Range range = chunks.At(chunk_id);
+    const IDX chunk_offset = chunk_offsets.at(chunk_id);
+    FOR_RANGE(int64_t, i, range.begin(), range.end()) { global_idx[i] += chunk_offset; }
+  });
+  // first_idx is replaced by the global idx of the unique key in place
+  MultiThreadLoop(part_num, [&](size_t part_id) {
+    IDX* first_idx = ws.first_idx + part_offsets.at(part_id);
+    const IDX* part_count = ws.part_count + part_offsets.at(part_id);
+    FOR_RANGE(int64_t, j, 0, part2unique_num.at(part_id)) {
+      const IDX i = first_idx[j];
+      const IDX idx = global_idx[i];
+      unique_out[idx] = in[i];
+      if (count != nullptr) { count[idx] = part_count[j]; }
+      first_idx[j] = idx;
+    }
+  });
+  MultiThreadLoop(part_num, [&](size_t chunk_id) {
+    const Range range = chunks.At(chunk_id);
+    FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+      idx_out[i] = ws.first_idx[part_offsets.at(ws.part_id[i]) + idx_out[i]];
+    }
+  });
+  *num_unique = chunk_offsets.at(part_num);
+}
+
+}  // namespace
+
 template<typename KEY, typename IDX>
 struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void Unique(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
@@ -27,31 +270,27 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
+    UniqueWorkspace<KEY, IDX> ws;
+    const int64_t required_workspace_size =
+        LayoutUniqueWorkspace<KEY, IDX>(n, static_cast<char*>(workspace), &ws);
+    CHECK_LE(required_workspace_size, workspace_size_in_bytes);
+    const int64_t part_num = UniquePartitionNum(n);
+    if (part_num == 1) {
+      SerialUniqueWithCounts<KEY, IDX>(n, in, num_unique, unique_out, idx_out, count, ws);
+    } else {
+      ParallelUniqueWithCounts<KEY, IDX>(n, in, num_unique, unique_out, idx_out, count, ws,
+                                         part_num);
     }
-    *num_unique = map.size();
   }
   static void GetUniqueWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    UniqueWorkspace<KEY, IDX> ws;
+    *workspace_size_in_bytes = LayoutUniqueWorkspace<KEY, IDX>(n, nullptr, &ws);
   }
   static void GetUniqueWithCountsWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                                       int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    UniqueWorkspace<KEY, IDX> ws;
+    *workspace_size_in_bytes = LayoutUniqueWorkspace<KEY, IDX>(n, nullptr, &ws);
   }
 };
 
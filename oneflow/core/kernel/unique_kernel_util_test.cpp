@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename KEY>
+struct UniqueResult {
+  int32_t num_unique;
+  std::vector<KEY> unique_out;
+  std::vector<int32_t> idx_out;
+  std::vector<int32_t> count;
+};
+
+// Runs the cpu unique with a thread pool of thread_num threads, keys are deduplicated by the
+// calling thread alone if thread_num is 1
+template<typename KEY>
+UniqueResult<KEY> UniqueWithCounts(const std::vector<KEY>& in, int32_t thread_num) {
+  using Util = UniqueKernelUtil<DeviceType::kCPU, KEY, int32_t>;
+  const int64_t n = in.size();
+  Global<ThreadPool>::New(thread_num);
+  int64_t workspace_size = 0;
+  Util::GetUniqueWithCountsWorkspaceSizeInBytes(nullptr, n, &workspace_size);
+  std::vector<char> workspace(workspace_size);
+  UniqueResult<KEY> result;
+  result.unique_out.resize(n);
+  result.idx_out.resize(n);
+  result.count.resize(n);
+  Util::UniqueWithCounts(nullptr, n, in.data(), &result.num_unique, result.unique_out.data(),
+                         result.idx_out.data(), result.count.data(), workspace.data(),
+                         workspace_size);
+  Global<ThreadPool>::Delete();
+  result.unique_out.resize(result.num_unique);
+  result.count.resize(result.num_unique);
+  return result;
+}
+
+template<typename KEY>
+void TestParallelUnique(const std::vector<KEY>& in) {
+  const UniqueResult<KEY> serial_result = UniqueWithCounts(in, 1);
+  for (int32_t thread_num : {3, 8}) {
+    const UniqueResult<KEY> result = UniqueWithCounts(in, thread_num);
+    ASSERT_EQ(result.num_unique, serial_result.num_unique);
+    ASSERT_TRUE(result.unique_out == serial_result.unique_out);
+    ASSERT_TRUE(result.idx_out == serial_result.idx_out);
+    ASSERT_TRUE(result.count == serial_result.count);
+  }
+}
+
+// n keys drawn from vocab_size ids, a quarter of them from 16 hot ids
+std::vector<int64_t> GenIds(int64_t n, int64_t vocab_size) {
+  std::mt19937_64 gen(0);
+  std::uniform_int_distribution<int64_t> id_dis(0, vocab_size - 1);
+  std::vector<int64_t> ids(n);
+  for (int64_t& id : ids) { id = gen() % 4 == 0 ? id_dis(gen) % 16 : id_dis(gen); }
+  return ids;
+}
+
+}  // namespace
+
+TEST(UniqueKernelUtil, cpu_parallel_int64_keys) {
+  TestParallelUnique<int64_t>(GenIds(1 << 17, 1 << 15));
+  TestParallelUnique<int64_t>(GenIds(1 << 16, 1LL << 40));
+}
+
+TEST(UniqueKernelUtil, cpu_parallel_int32_keys) {
+  const std::vector<int64_t> ids = GenIds(1 << 16, 100);
+  TestParallelUnique<int32_t>(std::vector<int32_t>(ids.begin(), ids.end()));
+}
+
+TEST(UniqueKernelUtil, cpu_parallel_float_keys) {
+  const std::vector<int64_t> ids = GenIds(1 << 16, 1 << 12);
+  std::vector<float> keys(ids.size());
+  FOR_RANGE(int64_t, i, 0, ids.size()) { keys.at(i) = (ids.at(i) - (1 << 11)) * 0.25f; }
+  // 0 and -0 are equal keys
+  keys.at(7) = -0.0f;
+  keys.at(11) = 0.0f;
+  TestParallelUnique<float>(keys);
+}
+
+}  // namespace oneflow
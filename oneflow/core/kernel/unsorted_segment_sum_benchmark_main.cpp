@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/unsorted_segment_sum_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// the serial loop the cpu unsorted segment sum used to be
+void NaiveUnsortedSegmentSum(const int32_t* segment_ids, const float* data,
+                             int64_t num_segment_ids, int64_t num_segments, int64_t inner_dim_size,
+                             float* out) {
+  FOR_RANGE(int64_t, i, 0, num_segment_ids) {
+    float* to = out + segment_ids[i] * inner_dim_size;
+    const float* from = data + i * inner_dim_size;
+    std::transform(from, from + inner_dim_size, to, to, std::plus<float>());
+  }
+}
+
+double MeasureMilliseconds(int64_t iters, const std::function<void()>& Run) {
+  Run();
+  const double start = GetCurTime();
+  FOR_RANGE(int64_t, i, 0, iters) { Run(); }
+  return (GetCurTime() - start) / 1e6 / iters;
+}
+
+// the gradient of an embedding lookup: num_segment_ids rows of inner_dim_size summed into the
+// rows of their ids, which are drawn from num_segments with a few hot ones
+void RunSegmentSumBenchmark(int64_t num_segment_ids, int64_t num_segments, int64_t inner_dim_size,
+                            int64_t iters, int32_t thread_num) {
+  std::mt19937 gen(0);
+  std::vector<int32_t> segment_ids(num_segment_ids);
+  std::uniform_int_distribution<int32_t> id_dis(0, num_segments - 1);
+  std::uniform_int_distribution<int32_t> hot_id_dis(0, 15);
+  for (int32_t& id : segment_ids) { id = gen() % 4 == 0 ? hot_id_dis(gen) : id_dis(gen); }
+  std::vector<float> data(num_segment_ids * inner_dim_size);
+  std::uniform_real_distribution<float> value_dis(-1, 1);
+  for (float& value : data) { value = value_dis(gen); }
+
+  // out is zeroed once, the timed runs keep adding to it
+  std::vector<float> naive_out(num_segments * inner_dim_size);
+  NaiveUnsortedSegmentSum(segment_ids.data(), data.data(), num_segment_ids, num_segments,
+                          inner_dim_size, naive_out.data());
+  const std::vector<float> expected_out = naive_out;
+  const double naive_ms = MeasureMilliseconds(iters, [&]() {
+    NaiveUnsortedSegmentSum(segment_ids.data(), data.data(), num_segment_ids, num_segments,
+                            inner_dim_size, naive_out.data());
+  });
+  auto MeasureCpuSegmentSum = [&](int32_t pool_size) {
+    Global<ThreadPool>::New(pool_size);
+    std::vector<float> out(num_segments * inner_dim_size);
+    auto Run = [&]() {
+      UnsortedSegmentSumKernelUtil<DeviceType::kCPU, float, int32_t, float>::UnsortedSegmentSum(
+          nullptr, segment_ids.data(), data.data(), num_segment_ids, num_segments, 1,
+          inner_dim_size, 0, out.data());
+    };
+    Run();
+    // the rows of a segment are added in the same order, so the sums are bitwise equal
+    CHECK(out == expected_out);
+    const double ms = MeasureMilliseconds(iters, Run);
+    Global<ThreadPool>::Delete();
+    return ms;
+  };
+  const double serial_ms = MeasureCpuSegmentSum(1);
+  const double parallel_ms = MeasureCpuSegmentSum(thread_num);
+  std::cout << "num_segment_ids: " << num_segment_ids << ", num_segments: " << num_segments
+            << ", inner_dim_size: " << inner_dim_size << std::endl
+            << "  std::transform: " << naive_ms << " ms" << std::endl
+            << "  1 thread: " << serial_ms << " ms, speedup " << naive_ms / serial_ms << std::endl
+            << "  " << thread_num << " threads: " << parallel_ms << " ms, speedup "
+            << naive_ms / parallel_ms << std::endl;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+/*
+ * Try run this benchmark exe by :
+ *     ./unsorted_segment_sum_benchmark -num_segment_ids=65536 -num_segments=1000000 \
+ *         -inner_dim_sizes=16,64,128,256 -thread_num=16
+ */
+DEFINE_int64(num_segment_ids, 1 << 16, "number of rows summed, the looked up ids of a batch");
+DEFINE_int64(num_segments, 1000000, "number of rows of out, the vocabulary size");
+DEFINE_string(inner_dim_sizes, "16,64,128,256", "comma separated embedding dims");
+DEFINE_int64(iters, 20, "timed iterations");
+DEFINE_int32(thread_num, std::thread::hardware_concurrency(), "size of the thread pool");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  std::istringstream inner_dim_sizes(FLAGS_inner_dim_sizes);
+  std::string inner_dim_size;
+  while (std::getline(inner_dim_sizes, inner_dim_size, ',')) {
+    RunSegmentSumBenchmark(FLAGS_num_segment_ids, FLAGS_num_segments, std::stoll(inner_dim_size),
+                           FLAGS_iters, FLAGS_thread_num);
+  }
+  return 0;
+}
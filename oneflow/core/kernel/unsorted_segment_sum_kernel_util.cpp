@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/unsorted_segment_sum_kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -25,23 +27,123 @@ struct UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K, T> final {
                                  int64_t segment_id_offset, T* out);
 };
 
+namespace {
+
+// fewer elements of data are summed by the calling thread alone
+constexpr int64_t kParallelSegmentSumMinElemCnt = 1 << 15;
+// columns of a row summed by one thread at least
+constexpr int64_t kSegmentSumMinColBlockSize = 16;
+// ids sampled for every block when the blocks are split by quantiles of the ids
+constexpr int64_t kSegmentSumSampleNumPerPart = 64;
+
+template<typename T>
+void AddRow(const T* __restrict__ from, T* __restrict__ to, int64_t size) {
+  FOR_RANGE(int64_t, i, 0, size) { to[i] += from[i]; }
+}
+
+// Sums the rows of data whose segment falls in [segment_begin, segment_end) restricted to the
+// columns [col_begin, col_end). The rows of a segment are added in the order of segment_ids, so
+// the result does not depend on the partition.
 template<typename T, typename K>
-void UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K, T>::UnsortedSegmentSum(
-    DeviceCtx* ctx, const K* segment_ids, const T* data, int64_t num_segment_ids,
-    int64_t num_segments, int64_t outer_dim_size, int64_t inner_dim_size, int64_t segment_id_offset,
-    T* out) {
+void SumSegmentRange(const K* segment_ids, const T* data, int64_t num_segment_ids,
+                     int64_t num_segments, int64_t outer_dim_size, int64_t inner_dim_size,
+                     int64_t segment_id_offset, int64_t segment_begin, int64_t segment_end,
+                     int64_t col_begin, int64_t col_end, T* out) {
   FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
     FOR_RANGE(int64_t, i, 0, num_segment_ids) {
       CHECK_GE(segment_ids[i], 0);
       const int64_t idx = segment_ids[i] - segment_id_offset;
-      T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
-      if (idx >= 0 && idx < num_segments) {
+      if (idx >= segment_begin && idx < segment_end) {
+        T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
         const T* from = data + outer_idx * num_segment_ids * inner_dim_size + i * inner_dim_size;
-        std::transform(from, from + inner_dim_size, to, to, std::plus<T>());
+        AddRow(from + col_begin, to + col_begin, col_end - col_begin);
       }
     }
   }
 }
+
+// Splits [0, num_segments) into part_num contiguous blocks holding about the same number of rows,
+// since the ids are usually skewed: only [0, num_unique) is used after a unique, and hot ids take
+// most of the rows. part i is [(*bounds)[i], (*bounds)[i + 1]), a block may be empty.
+// With no more segments than ids, the bounds come from the exact row count of every segment.
+// Otherwise, e.g. for the gradient of a large embedding table, they are quantiles of a sample of
+// the ids, so the cost does not grow with num_segments.
+template<typename K>
+void SplitSegmentsByRowCnt(const K* segment_ids, int64_t num_segment_ids, int64_t num_segments,
+                           int64_t segment_id_offset, int64_t part_num,
+                           std::vector<int64_t>* bounds) {
+  bounds->assign(part_num + 1, num_segments);
+  bounds->front() = 0;
+  if (num_segments <= num_segment_ids) {
+    std::vector<int64_t> row_cnt_prefix_sum(num_segments + 1, 0);
+    FOR_RANGE(int64_t, i, 0, num_segment_ids) {
+      const int64_t idx = segment_ids[i] - segment_id_offset;
+      if (idx >= 0 && idx < num_segments) { row_cnt_prefix_sum[idx + 1] += 1; }
+    }
+    FOR_RANGE(int64_t, idx, 0, num_segments) {
+      row_cnt_prefix_sum[idx + 1] += row_cnt_prefix_sum[idx];
+    }
+    const BalancedSplitter row_parts(row_cnt_prefix_sum.back(), part_num);
+    FOR_RANGE(int64_t, part_id, 1, part_num) {
+      // the first segment whose rows are not all before the part
+      const auto it = std::upper_bound(row_cnt_prefix_sum.begin(), row_cnt_prefix_sum.end(),
+                                       row_parts.At(part_id).begin());
+      bounds->at(part_id) = std::max<int64_t>(it - row_cnt_prefix_sum.begin() - 1,
+                                              bounds->at(part_id - 1));
+    }
+  } else {
+    const int64_t stride =
+        std::max<int64_t>(num_segment_ids / (kSegmentSumSampleNumPerPart * part_num), 1);
+    std::vector<int64_t> sampled_idx;
+    for (int64_t i = 0; i < num_segment_ids; i += stride) {
+      const int64_t idx = segment_ids[i] - segment_id_offset;
+      if (idx >= 0 && idx < num_segments) { sampled_idx.push_back(idx); }
+    }
+    if (sampled_idx.empty()) { return; }
+    std::sort(sampled_idx.begin(), sampled_idx.end());
+    FOR_RANGE(int64_t, part_id, 1, part_num) {
+      bounds->at(part_id) = std::max<int64_t>(
+          sampled_idx.at(part_id * sampled_idx.size() / part_num), bounds->at(part_id - 1));
+    }
+  }
+}
+
+}  // namespace
+
+template<typename T, typename K>
+void UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K, T>::UnsortedSegmentSum(
+    DeviceCtx* ctx, const K* segment_ids, const T* data, int64_t num_segment_ids,
+    int64_t num_segments, int64_t outer_dim_size, int64_t inner_dim_size, int64_t segment_id_offset,
+    T* out) {
+  const int64_t elem_cnt = outer_dim_size * num_segment_ids * inner_dim_size;
+  const int64_t thread_num =
+      Global<ThreadPool>::Get() == nullptr ? 1 : Global<ThreadPool>::Get()->thread_num();
+  if (elem_cnt < kParallelSegmentSumMinElemCnt || thread_num == 1 || num_segments == 0) {
+    SumSegmentRange(segment_ids, data, num_segment_ids, num_segments, outer_dim_size,
+                    inner_dim_size, segment_id_offset, 0, num_segments, 0, inner_dim_size, out);
+    return;
+  }
+  // each thread owns a block of segments and columns of out, so no two threads add to the same
+  // element, and every thread scans all the segment ids for the rows of its segments
+  const int64_t segment_part_num = std::min(thread_num, num_segments);
+  const int64_t col_part_num = std::max<int64_t>(
+      std::min(thread_num / segment_part_num, inner_dim_size / kSegmentSumMinColBlockSize), 1);
+  std::vector<int64_t> segment_bounds;
+  SplitSegmentsByRowCnt(segment_ids, num_segment_ids, num_segments, segment_id_offset,
+                        segment_part_num, &segment_bounds);
+  const BalancedSplitter col_parts(inner_dim_size, col_part_num);
+  MultiThreadLoop(segment_part_num * col_part_num, [&](size_t part_id) {
+    const int64_t segment_part_id = part_id / col_part_num;
+    const int64_t segment_begin = segment_bounds.at(segment_part_id);
+    const int64_t segment_end = segment_bounds.at(segment_part_id + 1);
+    if (segment_begin == segment_end) { return; }
+    const Range col_range = col_parts.At(part_id % col_part_num);
+    SumSegmentRange(segment_ids, data, num_segment_ids, num_segments, outer_dim_size,
+                    inner_dim_size, segment_id_offset, segment_begin, segment_end,
+                    col_range.begin(), col_range.end(), out);
+  });
+}
+
 #define INITIATE_UNSORTED_SEGMENT_SUM_KERNEL_UTIL_CPU(in_type_pair, index_type_pair)             \
   template struct UnsortedSegmentSumKernelUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(in_type_pair), \
                                                OF_PP_PAIR_FIRST(index_type_pair),                \
@@ -0,0 +1,83 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/unsorted_segment_sum_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+// Runs the cpu segment sum with a thread pool of thread_num threads, or without any pool
+std::vector<float> SegmentSum(const std::vector<int32_t>& segment_ids,
+                              const std::vector<float>& data, int64_t num_segments,
+                              int64_t inner_dim_size, int32_t segment_id_offset,
+                              int32_t thread_num) {
+  if (thread_num > 0) { Global<ThreadPool>::New(thread_num); }
+  std::vector<float> out(num_segments * inner_dim_size, 0);
+  UnsortedSegmentSumKernelUtil<DeviceType::kCPU, float, int32_t, float>::UnsortedSegmentSum(
+      nullptr, segment_ids.data(), data.data(), segment_ids.size(), num_segments, 1,
+      inner_dim_size, segment_id_offset, out.data());
+  if (thread_num > 0) { Global<ThreadPool>::Delete(); }
+  return out;
+}
+
+// the ids only take the first num_used_segments of num_segments and half of the rows go to a few
+// hot ids, as in the gradient of an embedding lookup after a unique
+void TestParallelSegmentSum(int64_t num_segment_ids, int64_t num_segments,
+                            int64_t num_used_segments, int64_t inner_dim_size,
+                            int32_t segment_id_offset) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int32_t> id_dis(0, num_used_segments - 1);
+  std::uniform_int_distribution<int32_t> hot_id_dis(0, 3);
+  std::vector<int32_t> segment_ids(num_segment_ids);
+  for (int32_t& id : segment_ids) {
+    id = (gen() % 2 == 0 ? hot_id_dis(gen) : id_dis(gen)) + segment_id_offset;
+  }
+  // an id out of [segment_id_offset, segment_id_offset + num_segments) is skipped
+  segment_ids.back() = segment_id_offset + num_segments;
+  std::vector<float> data(num_segment_ids * inner_dim_size);
+  std::uniform_real_distribution<float> value_dis(-1, 1);
+  for (float& value : data) { value = value_dis(gen); }
+  const std::vector<float> serial_out =
+      SegmentSum(segment_ids, data, num_segments, inner_dim_size, segment_id_offset, 0);
+  // the rows of a segment are added in the same order by any partition, so the sums are exact
+  for (int32_t thread_num : {1, 3, 8}) {
+    ASSERT_TRUE(SegmentSum(segment_ids, data, num_segments, inner_dim_size, segment_id_offset,
+                           thread_num)
+                == serial_out);
+  }
+}
+
+}  // namespace
+
+TEST(UnsortedSegmentSumKernelUtil, cpu_parallel_wide_rows) {
+  TestParallelSegmentSum(4096, 4096, 100, 64, 0);
+}
+
+TEST(UnsortedSegmentSumKernelUtil, cpu_parallel_narrow_rows) {
+  TestParallelSegmentSum(1 << 16, 1 << 16, 1 << 10, 1, 5);
+}
+
+// far more segments than ids, the blocks are split by sampled ids
+TEST(UnsortedSegmentSumKernelUtil, cpu_parallel_sparse_segments) {
+  TestParallelSegmentSum(1 << 13, 1 << 18, 1 << 18, 8, 0);
+}
+
+TEST(UnsortedSegmentSumKernelUtil, cpu_parallel_fewer_segments_than_threads) {
+  TestParallelSegmentSum(1 << 12, 2, 2, 32, 0);
+}
+
+}  // namespace oneflow
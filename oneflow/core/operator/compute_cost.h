@@ -0,0 +1,34 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_OPERATOR_COMPUTE_COST_H_
+#define ONEFLOW_CORE_OPERATOR_COMPUTE_COST_H_
+
+#include <cstdint>
+
+namespace oneflow {
+
+// Rough cost of one execution of an op, a multiply-add counts as two floating point operations
+struct ComputeCost {
+  ComputeCost() : flops(0), read_bytes(0), written_bytes(0) {}
+
+  double flops;
+  int64_t read_bytes;
+  int64_t written_bytes;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_OPERATOR_COMPUTE_COST_H_
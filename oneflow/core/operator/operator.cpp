@@ -371,6 +371,24 @@ Maybe<void> Operator::InferOutputBlobTimeShape(
   return Maybe<void>::Ok();
 }
 
+Maybe<void> Operator::InferComputeCost(
+    const std::function<const BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+    ComputeCost* cost) const {
+  auto ByteSize4Bn = [&](const std::string& bn) -> int64_t {
+    const BlobDesc* blob_desc = BlobDesc4BnInOp(bn);
+    if (blob_desc == nullptr) { return 0; }
+    return blob_desc->shape().elem_cnt() * GetSizeOfDataType(blob_desc->data_type());
+  };
+  *cost = ComputeCost();
+  for (const std::string& ibn : input_bns()) { cost->read_bytes += ByteSize4Bn(ibn); }
+  for (const std::string& obn : output_bns()) {
+    const BlobDesc* blob_desc = BlobDesc4BnInOp(obn);
+    if (blob_desc != nullptr) { cost->flops += blob_desc->shape().elem_cnt(); }
+    cost->written_bytes += ByteSize4Bn(obn);
+  }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> Operator::GetSbpSignaturesIf(
     const std::function<Maybe<const BlobDesc&>(const std::string&)>& LogicalBlobDesc4Ibn,
     const ParallelDesc& parallel_desc, SbpSignatureList* sbp_sig_list) const {
@@ -460,24 +478,29 @@ Maybe<void> Operator::FilterAndCheckValidSbpSignatureListByLogicalShape(
   return Maybe<void>::Ok();
 }
 
-Maybe<void> Operator::InferSbpSignature(
-    SbpSignature* sbp_signature, const SbpSignature& sbp_sig_conf,
-    const std::function<int32_t(const SbpSignature&)>& CalcOrderValue4SbpSig,
+Maybe<void> Operator::GetValidSbpSignaturesIf(
     std::function<Maybe<const SbpInferHint*>(const std::string&)> SbpInferHint4Ibn,
-    const ParallelDesc& parallel_desc) const {
+    const ParallelDesc& parallel_desc, SbpSignatureList* sbp_sig_list) const {
   // get op sbp signatures
   auto LogicalBlobDesc4Ibn = [&](const std::string& ibn) -> Maybe<const BlobDesc&> {
     const SbpInferHint* sbp_infer_hint = JUST(SbpInferHint4Ibn(ibn));
     return Maybe<const BlobDesc&>(sbp_infer_hint->logical_blob_desc());
   };
+  SbpSignatureList total_sbp_sig_list;
+  JUST(GetSbpSignaturesIf(LogicalBlobDesc4Ibn, parallel_desc, &total_sbp_sig_list));
+  // filter sbp signatures by logical shape
+  JUST(FilterAndCheckValidSbpSignatureListByLogicalShape(total_sbp_sig_list, SbpInferHint4Ibn,
+                                                         parallel_desc, sbp_sig_list));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Operator::InferSbpSignature(
+    SbpSignature* sbp_signature, const SbpSignature& sbp_sig_conf,
+    const std::function<int32_t(const SbpSignature&)>& CalcOrderValue4SbpSig,
+    std::function<Maybe<const SbpInferHint*>(const std::string&)> SbpInferHint4Ibn,
+    const ParallelDesc& parallel_desc) const {
   SbpSignatureList valid_sbp_sig_list;
-  {
-    SbpSignatureList total_sbp_sig_list;
-    JUST(GetSbpSignaturesIf(LogicalBlobDesc4Ibn, parallel_desc, &total_sbp_sig_list));
-    // filter sbp signatures by logical shape
-    JUST(FilterAndCheckValidSbpSignatureListByLogicalShape(total_sbp_sig_list, SbpInferHint4Ibn,
-                                                           parallel_desc, &valid_sbp_sig_list));
-  }
+  JUST(GetValidSbpSignaturesIf(SbpInferHint4Ibn, parallel_desc, &valid_sbp_sig_list));
   // filter sbp signatures by sbp signature conf
   SbpSignatureList filtered_sbp_sigs_by_conf;
   FilterSbpSignatureList(valid_sbp_sig_list, sbp_sig_conf, &filtered_sbp_sigs_by_conf);
@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/core/job/sbp_parallel.h"
 #include "oneflow/core/job/mirrored_parallel.pb.h"
 #include "oneflow/core/operator/op_conf_util.h"
+#include "oneflow/core/operator/compute_cost.h"
 #include "oneflow/core/register/blob_desc.h"
 #include "oneflow/core/job/job_builder.h"
 #include "oneflow/core/job/sbp_signature_builder.h"
@@ -129,6 +130,12 @@ class Operator {
       std::function<const Shape*(const std::string&)> GetTimeShape4BnInOp, const ParallelContext*,
       Shape* time_shape) const;
 
+  // Cost of one execution on the given blob descs, which are either logical or physical.
+  // The default takes one operation per output element and reads and writes every blob once
+  virtual Maybe<void> InferComputeCost(
+      const std::function<const BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+      ComputeCost* cost) const;
+
   Maybe<void> FillSbpSignature(const SbpSignature& sbp_signature);
   Maybe<void> InferSbpSignatureIf(
       const SbpSignature& sbp_sig_conf,
@@ -150,6 +157,10 @@ class Operator {
   Maybe<void> GetSbpSignaturesIf(
       const std::function<Maybe<const BlobDesc&>(const std::string&)>& LogicalBlobDesc4Ibn,
       const ParallelDesc& parallel_desc, SbpSignatureList* sbp_sig_list) const;
+  // sbp signatures of GetSbpSignaturesIf which the logical shapes of inputs can be split by
+  Maybe<void> GetValidSbpSignaturesIf(
+      std::function<Maybe<const SbpInferHint*>(const std::string&)> SbpInferHint4Ibn,
+      const ParallelDesc& parallel_desc, SbpSignatureList* sbp_sig_list) const;
 
   void ForEachBnInOp(std::function<void(const std::string&)>) const;
 
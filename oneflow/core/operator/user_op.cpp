@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/to_string.h"
 #include "oneflow/core/operator/user_op.h"
 #include "oneflow/core/framework/infer_output_blob_time_shape_fn_context.h"
+#include "oneflow/core/framework/compute_cost_fn_context.h"
 
 namespace oneflow {
 
@@ -315,6 +316,51 @@ class UserOpInferOutputBlobTimeShapeFnContext : public user_op::InferOutputBlobT
   Shape* output_blob_time_shape_;
 };
 
+class UserOpComputeCostFnContext : public user_op::ComputeCostFnContext {
+ public:
+  using ArgVec = std::vector<std::pair<std::string, int32_t>>;
+  UserOpComputeCostFnContext(
+      const OperatorConf& op_conf,
+      const std::function<const BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+      ComputeCost* compute_cost)
+      : user_op_conf_(op_conf), compute_cost_(compute_cost) {
+    auto InitInOrOut = [&](const PbMap<std::string, UserOpConf::ListString>& arg_map,
+                           ArgVec* arg_vec) {
+      for (auto it = arg_map.begin(); it != arg_map.end(); ++it) {
+        const std::string& arg_name = it->first;
+        for (int32_t i = 0; i < it->second.s_size(); ++i) {
+          const BlobDesc* blob_desc = BlobDesc4BnInOp(GenRepeatedBn(arg_name, i));
+          if (blob_desc == nullptr) { continue; }
+          arg2tensor_desc_.emplace(std::make_pair(arg_name, i),
+                                   GenTensorDescFromBlobDesc(blob_desc));
+          arg_vec->emplace_back(std::make_pair(arg_name, i));
+        }
+      }
+    };
+    InitInOrOut(op_conf.user_conf().input(), &inputs_);
+    InitInOrOut(op_conf.user_conf().output(), &outputs_);
+  }
+  ~UserOpComputeCostFnContext() override = default;
+
+  const user_op::TensorDesc* TensorDesc4ArgNameAndIndex(const std::string& arg_name,
+                                                        int32_t index) const override {
+    auto it = arg2tensor_desc_.find(std::make_pair(arg_name, index));
+    if (it == arg2tensor_desc_.end()) { return nullptr; };
+    return &(it->second);
+  }
+  const ArgVec& inputs() const override { return inputs_; }
+  const ArgVec& outputs() const override { return outputs_; }
+  const user_op::UserOpConfWrapper& user_op_conf() const override { return user_op_conf_; }
+  ComputeCost* mut_compute_cost() override { return compute_cost_; }
+
+ private:
+  ArgVec inputs_;
+  ArgVec outputs_;
+  HashMap<std::pair<std::string, int32_t>, user_op::TensorDesc> arg2tensor_desc_;
+  user_op::UserOpConfWrapper user_op_conf_;
+  ComputeCost* compute_cost_;
+};
+
 void UserOp::InitFromOpConf() {
   CHECK(op_conf().has_user_conf());
   for (const auto& pair : op_conf().user_conf().input()) {
@@ -559,6 +605,16 @@ Maybe<void> UserOp::InferOutputBlobTimeShape(
   }
 }
 
+Maybe<void> UserOp::InferComputeCost(
+    const std::function<const BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+    ComputeCost* cost) const {
+  CHECK_OR_RETURN(val_ != nullptr)
+      << "cannot find op_type: " << op_conf().user_conf().op_type_name() << " in op registry!";
+  *cost = ComputeCost();
+  UserOpComputeCostFnContext compute_cost_fn_ctx(op_conf(), BlobDesc4BnInOp, cost);
+  return val_->compute_cost_fn(&compute_cost_fn_ctx);
+}
+
 Symbol<OperatorConf> UserOp::GetOpConfWithoutOpNameAndLbn() const {
   OperatorConf op_conf(this->op_conf());
   op_conf.set_name("undefined-op-name");
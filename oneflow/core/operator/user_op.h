@@ -41,6 +41,9 @@ class UserOp final : public Operator {
       HashMap<std::string, std::string>* con_inplace_obn2ibn,
       const std::function<BlobDesc*(const std::string&)>& GetBlobDesc4BnInOp,
       const ParallelContext* parallel_ctx) const override;
+  Maybe<void> InferComputeCost(
+      const std::function<const BlobDesc*(const std::string&)>& BlobDesc4BnInOp,
+      ComputeCost* cost) const override;
   Symbol<OperatorConf> GetOpConfWithoutOpNameAndLbn() const override;
 
  private:
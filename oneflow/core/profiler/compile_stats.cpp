@@ -0,0 +1,142 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/compile_stats.h"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <json.hpp>
+#include "oneflow/core/common/global.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+thread_local int64_t compile_stage_depth = 0;
+
+int64_t GetRssBytes() {
+  std::ifstream statm("/proc/self/statm");
+  int64_t size_pages = 0;
+  int64_t resident_pages = 0;
+  if (!(statm >> size_pages >> resident_pages)) { return 0; }
+  return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+int64_t GetPeakRssBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+  // in kilobytes on linux
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+}
+
+}  // namespace
+
+void CompileStats::Add(int64_t job_id, const CompileStageStats& stats) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_id2stages_[job_id].push_back(stats);
+}
+
+std::string CompileStats::ToJson() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  nlohmann::json report;
+  report["jobs"] = nlohmann::json::array();
+  std::map<std::string, CompileStageStats> stage_name2total;
+  std::map<std::string, int64_t> stage_name2count;
+  for (const auto& pair : job_id2stages_) {
+    nlohmann::json stages = nlohmann::json::array();
+    double total_seconds = 0;
+    for (const CompileStageStats& stats : pair.second) {
+      stages.push_back({{"stage_name", stats.stage_name},
+                        {"depth", stats.depth},
+                        {"seconds", stats.seconds},
+                        {"rss_growth_bytes", stats.rss_growth_bytes},
+                        {"peak_rss_growth_bytes", stats.peak_rss_growth_bytes}});
+      if (stats.depth == 0) { total_seconds += stats.seconds; }
+      auto it = stage_name2total.find(stats.stage_name);
+      if (it == stage_name2total.end()) {
+        stage_name2total.emplace(stats.stage_name, stats);
+      } else {
+        it->second.seconds += stats.seconds;
+        it->second.rss_growth_bytes += stats.rss_growth_bytes;
+        it->second.peak_rss_growth_bytes += stats.peak_rss_growth_bytes;
+      }
+      ++stage_name2count[stats.stage_name];
+    }
+    report["jobs"].push_back(
+        {{"job_id", pair.first}, {"total_seconds", total_seconds}, {"stages", stages}});
+  }
+  std::vector<const CompileStageStats*> totals;
+  for (const auto& pair : stage_name2total) { totals.push_back(&pair.second); }
+  std::sort(totals.begin(), totals.end(),
+            [](const CompileStageStats* lhs, const CompileStageStats* rhs) {
+              return lhs->seconds > rhs->seconds;
+            });
+  report["stages"] = nlohmann::json::array();
+  for (const CompileStageStats* total : totals) {
+    report["stages"].push_back({{"stage_name", total->stage_name},
+                                {"count", stage_name2count.at(total->stage_name)},
+                                {"seconds", total->seconds},
+                                {"rss_growth_bytes", total->rss_growth_bytes},
+                                {"peak_rss_growth_bytes", total->peak_rss_growth_bytes}});
+  }
+  report["peak_rss_bytes"] = GetPeakRssBytes();
+  return report.dump(2);
+}
+
+CompileStageTimer::CompileStageTimer(int64_t job_id)
+    : job_id_(job_id),
+      depth_(compile_stage_depth),
+      last_time_(GetCurTime()),
+      last_rss_bytes_(GetRssBytes()),
+      last_peak_rss_bytes_(GetPeakRssBytes()) {
+  ++compile_stage_depth;
+}
+
+CompileStageTimer::~CompileStageTimer() { --compile_stage_depth; }
+
+void CompileStageTimer::Tick(const std::string& stage_name) {
+  const double cur_time = GetCurTime();
+  const int64_t cur_rss_bytes = GetRssBytes();
+  const int64_t cur_peak_rss_bytes = GetPeakRssBytes();
+  CompileStageStats stats;
+  stats.stage_name = stage_name;
+  stats.depth = depth_;
+  stats.seconds = (cur_time - last_time_) / 1000000000.0;
+  stats.rss_growth_bytes = cur_rss_bytes - last_rss_bytes_;
+  stats.peak_rss_growth_bytes = cur_peak_rss_bytes - last_peak_rss_bytes_;
+  stage_name7seconds_.emplace_back(stage_name, stats.seconds);
+  if (Global<CompileStats>::Get() != nullptr) { Global<CompileStats>::Get()->Add(job_id_, stats); }
+  last_time_ = cur_time;
+  last_rss_bytes_ = cur_rss_bytes;
+  last_peak_rss_bytes_ = cur_peak_rss_bytes;
+}
+
+std::string CompileStageTimer::ToString() const {
+  std::string str;
+  for (const auto& pair : stage_name7seconds_) {
+    str += "\n  " + pair.first + ": " + std::to_string(pair.second) + " seconds";
+  }
+  return str;
+}
+
+ScopedCompileStage::ScopedCompileStage(int64_t job_id, const std::string& stage_name)
+    : timer_(job_id), stage_name_(stage_name) {}
+
+ScopedCompileStage::~ScopedCompileStage() { timer_.Tick(stage_name_); }
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,85 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_COMPILE_STATS_H_
+#define ONEFLOW_CORE_PROFILER_COMPILE_STATS_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+struct CompileStageStats {
+  std::string stage_name;
+  // stages run inside other timed stages are one level deeper than them
+  int64_t depth;
+  double seconds;
+  int64_t rss_growth_bytes;
+  int64_t peak_rss_growth_bytes;
+};
+
+// Wall time and memory growth of the compile stages and job passes of every job of the session
+class CompileStats final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompileStats);
+  CompileStats() = default;
+  ~CompileStats() = default;
+
+  void Add(int64_t job_id, const CompileStageStats& stats);
+  // stages of each job in order, and the stages of the same name aggregated over all jobs
+  std::string ToJson() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<int64_t, std::vector<CompileStageStats>> job_id2stages_;
+};
+
+// Times consecutive stages, each from the previous tick to its own one
+class CompileStageTimer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompileStageTimer);
+  explicit CompileStageTimer(int64_t job_id);
+  ~CompileStageTimer();
+
+  void Tick(const std::string& stage_name);
+  std::string ToString() const;
+
+ private:
+  int64_t job_id_;
+  int64_t depth_;
+  double last_time_;
+  int64_t last_rss_bytes_;
+  int64_t last_peak_rss_bytes_;
+  std::vector<std::pair<std::string, double>> stage_name7seconds_;
+};
+
+// Times one stage from construction to destruction
+class ScopedCompileStage final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ScopedCompileStage);
+  ScopedCompileStage(int64_t job_id, const std::string& stage_name);
+  ~ScopedCompileStage();
+
+ private:
+  CompileStageTimer timer_;
+  std::string stage_name_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_COMPILE_STATS_H_
@@ -0,0 +1,54 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <json.hpp>
+#include "oneflow/core/profiler/compile_stats.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+TEST(CompileStats, nested_stages) {
+  Global<CompileStats>::New();
+  {
+    CompileStageTimer timer(0);
+    {
+      ScopedCompileStage stage(0, "Pass");
+      std::vector<char> buffer(1 << 20, 1);
+    }
+    timer.Tick("Complete");
+    timer.Tick("TaskGraph");
+  }
+  { ScopedCompileStage stage(1, "Pass"); }
+  const nlohmann::json report = nlohmann::json::parse(Global<CompileStats>::Get()->ToJson());
+  Global<CompileStats>::Delete();
+  ASSERT_EQ(report["jobs"].size(), 2);
+  const nlohmann::json& stages = report["jobs"][0]["stages"];
+  ASSERT_EQ(stages.size(), 3);
+  ASSERT_EQ(stages[0]["stage_name"], "Pass");
+  ASSERT_EQ(stages[0]["depth"], 1);
+  ASSERT_EQ(stages[1]["stage_name"], "Complete");
+  ASSERT_EQ(stages[1]["depth"], 0);
+  ASSERT_GE(stages[1]["seconds"].get<double>(), stages[0]["seconds"].get<double>());
+  ASSERT_EQ(report["jobs"][1]["stages"][0]["depth"], 0);
+  for (const nlohmann::json& stage : report["stages"]) {
+    if (stage["stage_name"] == "Pass") { ASSERT_EQ(stage["count"], 2); }
+  }
+  ASSERT_GT(report["peak_rss_bytes"].get<int64_t>(), 0);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,356 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/memory_report.h"
+#include <json.hpp>
+#include "oneflow/core/job/plan.pb.h"
+#include "oneflow/core/register/runtime_register_desc.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+using DeviceKey = std::pair<int64_t, std::string>;
+
+struct RegstLife {
+  const RegstDescProto* regst;
+  const TaskProto* producer;
+  int64_t byte_size;
+  int64_t begin_step;
+  int64_t end_step;
+  // live during the whole job, the mem block it belongs to is not reused between regsts
+  bool is_static;
+  std::vector<int64_t> inplace_regst_desc_ids;
+};
+
+std::string MemCaseName(const MemoryCase& mem_case) {
+  if (mem_case.has_device_cuda_mem()) {
+    return "cuda:" + std::to_string(mem_case.device_cuda_mem().device_id());
+  }
+  if (mem_case.host_mem().has_cuda_pinned_mem()) {
+    return "host_pinned:" + std::to_string(mem_case.host_mem().cuda_pinned_mem().device_id());
+  }
+  return "host";
+}
+
+std::string TaskName(const TaskProto& task) {
+  std::string name;
+  for (const ExecNodeProto& exec_node : task.exec_sequence().exec_node()) {
+    if (!name.empty()) { name += ","; }
+    name += exec_node.kernel_conf().op_attribute().op_conf().name();
+  }
+  return name.empty() ? TaskType_Name(task.task_type()) : name;
+}
+
+int64_t InplaceConsumedRegstDescId(const RegstDescProto& regst) {
+  if (regst.inplace_consumed_regst_desc_id() != -1) {
+    return regst.inplace_consumed_regst_desc_id();
+  }
+  if (regst.has_force_inplace_consumed_regst_desc_id()) {
+    return regst.force_inplace_consumed_regst_desc_id();
+  }
+  if (regst.has_hint_inplace_consumed_regst_desc_id()) {
+    return regst.hint_inplace_consumed_regst_desc_id();
+  }
+  return -1;
+}
+
+std::string EscapeHtml(const std::string& str) {
+  std::string ret;
+  for (char ch : str) {
+    if (ch == '<') {
+      ret += "&lt;";
+    } else if (ch == '>') {
+      ret += "&gt;";
+    } else if (ch == '&') {
+      ret += "&amp;";
+    } else {
+      ret += ch;
+    }
+  }
+  return ret;
+}
+
+std::string ToMiB(int64_t bytes) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << bytes / 1048576.0;
+  return out.str();
+}
+
+std::string GenTimelineSvg(const nlohmann::json& timeline, int64_t peak_bytes) {
+  const int64_t width = 800;
+  const int64_t height = 160;
+  const int64_t max_step = std::max<int64_t>(timeline.back()[0].get<int64_t>(), 1);
+  std::ostringstream out;
+  out << "<svg width=\"" << width << "\" height=\"" << height << "\">"
+      << "<polyline fill=\"none\" stroke=\"steelblue\" points=\"";
+  int64_t last_y = height;
+  for (const nlohmann::json& point : timeline) {
+    const int64_t x = point[0].get<int64_t>() * width / max_step;
+    const int64_t y = height - point[1].get<int64_t>() * height / std::max<int64_t>(peak_bytes, 1);
+    // step shaped, usage holds until the next step where it changes
+    out << x << "," << last_y << " " << x << "," << y << " ";
+    last_y = y;
+  }
+  out << width << "," << last_y << "\"/></svg>";
+  return out.str();
+}
+
+std::string GenHtml(const nlohmann::json& report) {
+  std::ostringstream out;
+  out << "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>memory report</title>"
+      << "<style>table{border-collapse:collapse}td,th{border:1px solid #ccc;padding:2px 6px}"
+      << "</style></head><body>";
+  for (const nlohmann::json& device : report["devices"]) {
+    out << "<h2>machine " << device["machine_id"].get<int64_t>() << " "
+        << device["mem_case"].get<std::string>() << "</h2><p>allocated "
+        << ToMiB(device["allocated_bytes"].get<int64_t>()) << " MiB in "
+        << device["chunks"].size() << " chunks and " << device["mem_block_num"].get<int64_t>()
+        << " mem blocks, peak of live regsts " << ToMiB(device["peak_bytes"].get<int64_t>())
+        << " MiB</p>";
+    for (const nlohmann::json& job : device["jobs"]) {
+      const int64_t peak_bytes = job["peak_bytes"].get<int64_t>();
+      out << "<h3>job " << job["job_id"].get<int64_t>() << "</h3><p>" << job["regst_num"]
+          << " regsts, " << ToMiB(job["static_bytes"].get<int64_t>()) << " MiB static, peak "
+          << ToMiB(peak_bytes) << " MiB at step " << job["peak_step"] << " ("
+          << EscapeHtml(job["peak_task_name"].get<std::string>()) << ")</p>"
+          << GenTimelineSvg(job["timeline"], peak_bytes)
+          << "<table><tr><th>MiB</th><th>regst</th><th>producer</th><th>steps</th>"
+          << "<th>mem_block</th><th>offset</th><th>static</th><th>inplace regsts</th></tr>";
+      for (const nlohmann::json& regst : job["top_contributors"]) {
+        out << "<tr><td>" << ToMiB(regst["bytes"].get<int64_t>()) << "</td><td>"
+            << regst["regst_desc_id"] << "</td><td>"
+            << EscapeHtml(regst["producer"].get<std::string>()) << "</td><td>"
+            << regst["begin_step"] << "-" << regst["end_step"] << "</td><td>"
+            << regst["mem_block_id"] << "</td><td>" << regst["mem_block_offset"] << "</td><td>"
+            << regst["static"] << "</td><td>" << regst["inplace_regst_desc_ids"].dump()
+            << "</td></tr>";
+      }
+      out << "</table>";
+    }
+  }
+  out << "</body></html>";
+  return out.str();
+}
+
+}  // namespace
+
+void GenMemoryReport(const Plan& plan, int64_t top_contributor_num, std::string* json,
+                     std::string* html) {
+  HashMap<int64_t, const TaskProto*> task_id2task;
+  std::map<std::pair<int64_t, int64_t>, std::string> job_id7step2task_name;
+  HashMap<int64_t, const RegstDescProto*> regst_desc_id2regst;
+  HashMap<int64_t, const TaskProto*> regst_desc_id2producer;
+  for (const TaskProto& task : plan.task()) {
+    task_id2task.emplace(task.task_id(), &task);
+    const int64_t step = task.task_set_info().order_in_graph();
+    std::string* task_name = &job_id7step2task_name[std::make_pair(task.job_id(), step)];
+    if (!task_name->empty()) { *task_name += ","; }
+    *task_name += TaskName(task);
+    for (const auto& pair : task.produced_regst_desc()) {
+      regst_desc_id2regst.emplace(pair.second.regst_desc_id(), &pair.second);
+      regst_desc_id2producer.emplace(pair.second.regst_desc_id(), &task);
+    }
+  }
+  HashMap<int64_t, const MemBlockProto*> mem_block_id2mem_block;
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    mem_block_id2mem_block.emplace(mem_block.mem_block_id(), &mem_block);
+  }
+  auto Step4TaskId = [&](int64_t task_id) {
+    return task_id2task.at(task_id)->task_set_info().order_in_graph();
+  };
+  // inplace regsts share the memory of the regst at the end of their inplace chain
+  auto SharedRegst4Regst = [&](const RegstDescProto* regst) {
+    while (true) {
+      const int64_t consumed_id = InplaceConsumedRegstDescId(*regst);
+      const auto it = regst_desc_id2regst.find(consumed_id);
+      if (it == regst_desc_id2regst.end() || it->second->mem_block_id() != regst->mem_block_id()
+          || it->second->mem_block_offset() != regst->mem_block_offset()) {
+        return regst;
+      }
+      regst = it->second;
+    }
+  };
+
+  std::map<DeviceKey, std::map<int64_t, std::map<int64_t, RegstLife>>> device2job_id2regst_lives;
+  std::vector<const RegstDescProto*> inplace_regsts;
+  for (const auto& pair : regst_desc_id2regst) {
+    const RegstDescProto* regst = pair.second;
+    if (!regst->regst_desc_type().has_data_regst_desc() || regst->mem_block_id() == -1) {
+      continue;
+    }
+    if (SharedRegst4Regst(regst) != regst) {
+      inplace_regsts.push_back(regst);
+      continue;
+    }
+    const TaskProto* producer = regst_desc_id2producer.at(regst->regst_desc_id());
+    RegstLife life;
+    life.regst = regst;
+    life.producer = producer;
+    life.byte_size = RtRegstDesc(*regst).TotalByteSize4AllRegst();
+    life.begin_step = producer->task_set_info().order_in_graph();
+    life.end_step = life.begin_step;
+    for (int64_t consumer_task_id : regst->consumer_task_id()) {
+      if (task_id2task.at(consumer_task_id)->job_id() != producer->job_id()) { continue; }
+      life.end_step = std::max(life.end_step, Step4TaskId(consumer_task_id));
+    }
+    const auto block_it = mem_block_id2mem_block.find(regst->mem_block_id());
+    life.is_static =
+        block_it == mem_block_id2mem_block.end() || !block_it->second->enable_reuse_mem();
+    device2job_id2regst_lives[DeviceKey(producer->machine_id(), MemCaseName(regst->mem_case()))]
+                             [producer->job_id()][regst->regst_desc_id()] = life;
+  }
+  // the shared memory stays live until the last consumer of the inplace regsts
+  for (const RegstDescProto* regst : inplace_regsts) {
+    const RegstDescProto* shared_regst = SharedRegst4Regst(regst);
+    const TaskProto* producer = regst_desc_id2producer.at(shared_regst->regst_desc_id());
+    const auto device_it = device2job_id2regst_lives.find(
+        DeviceKey(producer->machine_id(), MemCaseName(shared_regst->mem_case())));
+    if (device_it == device2job_id2regst_lives.end()) { continue; }
+    const auto job_it = device_it->second.find(producer->job_id());
+    if (job_it == device_it->second.end()) { continue; }
+    const auto life_it = job_it->second.find(shared_regst->regst_desc_id());
+    if (life_it == job_it->second.end()) { continue; }
+    RegstLife* life = &life_it->second;
+    life->inplace_regst_desc_ids.push_back(regst->regst_desc_id());
+    life->end_step = std::max(life->end_step, Step4TaskId(regst->producer_task_id()));
+    for (int64_t consumer_task_id : regst->consumer_task_id()) {
+      if (task_id2task.at(consumer_task_id)->job_id() != producer->job_id()) { continue; }
+      life->end_step = std::max(life->end_step, Step4TaskId(consumer_task_id));
+    }
+  }
+
+  nlohmann::json report;
+  report["devices"] = nlohmann::json::array();
+  for (const auto& device_pair : device2job_id2regst_lives) {
+    const DeviceKey& device_key = device_pair.first;
+    auto IsOnDevice = [&](int64_t machine_id, const MemoryCase& mem_case) {
+      return machine_id == device_key.first && MemCaseName(mem_case) == device_key.second;
+    };
+    nlohmann::json device;
+    device["machine_id"] = device_key.first;
+    device["mem_case"] = device_key.second;
+    int64_t allocated_bytes = 0;
+    device["chunks"] = nlohmann::json::array();
+    for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
+      if (!IsOnDevice(chunk.machine_id(), chunk.mem_case())) { continue; }
+      device["chunks"].push_back({{"chunk_id", chunk.chunk_id()},
+                                  {"bytes", chunk.mem_size()},
+                                  {"job_ids", chunk.job_id()}});
+      allocated_bytes += chunk.mem_size();
+    }
+    std::vector<const MemBlockProto*> mem_blocks;
+    for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+      if (!IsOnDevice(mem_block.machine_id(), mem_block.mem_case())) { continue; }
+      mem_blocks.push_back(&mem_block);
+      // the blocks in chunks are part of the chunk allocation
+      if (mem_block.chunk_id() == -1) { allocated_bytes += mem_block.mem_size(); }
+    }
+    std::sort(mem_blocks.begin(), mem_blocks.end(),
+              [](const MemBlockProto* lhs, const MemBlockProto* rhs) {
+                return lhs->mem_size() > rhs->mem_size();
+              });
+    device["allocated_bytes"] = allocated_bytes;
+    device["mem_block_num"] = mem_blocks.size();
+    device["top_mem_blocks"] = nlohmann::json::array();
+    FOR_RANGE(int64_t, i, 0, std::min<int64_t>(mem_blocks.size(), top_contributor_num)) {
+      const MemBlockProto* mem_block = mem_blocks.at(i);
+      device["top_mem_blocks"].push_back({{"mem_block_id", mem_block->mem_block_id()},
+                                          {"bytes", mem_block->mem_size()},
+                                          {"chunk_id", mem_block->chunk_id()},
+                                          {"chunk_offset", mem_block->chunk_offset()},
+                                          {"enable_reuse_mem", mem_block->enable_reuse_mem()},
+                                          {"job_ids", mem_block->job_id()}});
+    }
+
+    int64_t device_peak_bytes = 0;
+    device["jobs"] = nlohmann::json::array();
+    for (const auto& job_pair : device_pair.second) {
+      const int64_t job_id = job_pair.first;
+      const std::map<int64_t, RegstLife>& regst_lives = job_pair.second;
+      int64_t static_bytes = 0;
+      std::map<int64_t, int64_t> step2delta_bytes;
+      for (const auto& pair : regst_lives) {
+        const RegstLife& life = pair.second;
+        if (life.is_static) {
+          static_bytes += life.byte_size;
+        } else {
+          step2delta_bytes[life.begin_step] += life.byte_size;
+          step2delta_bytes[life.end_step + 1] -= life.byte_size;
+        }
+      }
+      nlohmann::json timeline = nlohmann::json::array();
+      int64_t live_bytes = static_bytes;
+      int64_t peak_bytes = static_bytes;
+      int64_t peak_step = step2delta_bytes.empty() ? 0 : step2delta_bytes.begin()->first;
+      timeline.push_back({peak_step, static_bytes});
+      for (const auto& pair : step2delta_bytes) {
+        live_bytes += pair.second;
+        timeline.push_back({pair.first, live_bytes});
+        if (live_bytes > peak_bytes) {
+          peak_bytes = live_bytes;
+          peak_step = pair.first;
+        }
+      }
+      std::vector<const RegstLife*> peak_lives;
+      for (const auto& pair : regst_lives) {
+        const RegstLife& life = pair.second;
+        if (life.is_static || (life.begin_step <= peak_step && peak_step <= life.end_step)) {
+          peak_lives.push_back(&life);
+        }
+      }
+      std::sort(peak_lives.begin(), peak_lives.end(),
+                [](const RegstLife* lhs, const RegstLife* rhs) {
+                  return lhs->byte_size > rhs->byte_size;
+                });
+      nlohmann::json top_contributors = nlohmann::json::array();
+      FOR_RANGE(int64_t, i, 0, std::min<int64_t>(peak_lives.size(), top_contributor_num)) {
+        const RegstLife* life = peak_lives.at(i);
+        top_contributors.push_back({{"regst_desc_id", life->regst->regst_desc_id()},
+                                    {"producer", TaskName(*life->producer)},
+                                    {"bytes", life->byte_size},
+                                    {"register_num", life->regst->register_num()},
+                                    {"begin_step", life->begin_step},
+                                    {"end_step", life->end_step},
+                                    {"static", life->is_static},
+                                    {"mem_block_id", life->regst->mem_block_id()},
+                                    {"mem_block_offset", life->regst->mem_block_offset()},
+                                    {"inplace_regst_desc_ids", life->inplace_regst_desc_ids}});
+      }
+      const auto peak_task_it = job_id7step2task_name.find(std::make_pair(job_id, peak_step));
+      device["jobs"].push_back(
+          {{"job_id", job_id},
+           {"regst_num", regst_lives.size()},
+           {"static_bytes", static_bytes},
+           {"peak_bytes", peak_bytes},
+           {"peak_step", peak_step},
+           {"peak_task_name",
+            peak_task_it == job_id7step2task_name.end() ? "" : peak_task_it->second},
+           {"timeline", timeline},
+           {"top_contributors", top_contributors}});
+      device_peak_bytes = std::max(device_peak_bytes, peak_bytes);
+    }
+    device["peak_bytes"] = device_peak_bytes;
+    report["devices"].push_back(device);
+  }
+  *json = report.dump(2);
+  *html = GenHtml(report);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,38 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_MEMORY_REPORT_H_
+#define ONEFLOW_CORE_PROFILER_MEMORY_REPORT_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+class Plan;
+
+namespace profiler {
+
+// Memory timeline of every device of a memory-planned plan. For each job on each device the regsts
+// live at every topological step of the task graph are summed, inplace regsts counted once by the
+// regst they share memory with, and the regsts live at the peak step are listed as contributors.
+// The allocated chunks and mem blocks of the device are reported alongside.
+void GenMemoryReport(const Plan& plan, int64_t top_contributor_num, std::string* json,
+                     std::string* html);
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_MEMORY_REPORT_H_
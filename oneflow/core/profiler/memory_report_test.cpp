@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <json.hpp>
+#include "oneflow/core/profiler/memory_report.h"
+#include "oneflow/core/job/plan.pb.h"
+#include "oneflow/core/register/blob_desc.h"
+#include "oneflow/core/register/runtime_register_desc.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+TaskProto* AddTask(Plan* plan, int64_t task_id) {
+  TaskProto* task = plan->add_task();
+  task->set_task_type(TaskType::kNormalForward);
+  task->set_machine_id(0);
+  task->set_thrd_id(0);
+  task->set_task_id(task_id);
+  task->set_job_id(0);
+  task->mutable_task_set_info()->set_order_in_graph(task_id);
+  return task;
+}
+
+RegstDescProto* AddRegst(TaskProto* producer, int64_t regst_desc_id, int64_t elem_cnt,
+                         int64_t mem_block_id, int64_t mem_block_offset) {
+  RegstDescProto* regst =
+      &(*producer->mutable_produced_regst_desc())["out" + std::to_string(regst_desc_id)];
+  regst->set_regst_desc_id(regst_desc_id);
+  regst->set_producer_task_id(producer->task_id());
+  regst->set_min_register_num(1);
+  regst->set_max_register_num(1);
+  regst->set_register_num(1);
+  regst->mutable_mem_case()->mutable_host_mem();
+  DataRegstDesc* data_regst_desc = regst->mutable_regst_desc_type()->mutable_data_regst_desc();
+  BlobDesc(Shape({elem_cnt}), DataType::kFloat)
+      .ToProto(data_regst_desc->mutable_packed_blob_desc());
+  Shape({1, 1}).ToProto(data_regst_desc->mutable_time_shape());
+  regst->set_enable_reuse_mem(true);
+  regst->set_mem_block_id(mem_block_id);
+  regst->set_mem_block_offset(mem_block_offset);
+  return regst;
+}
+
+void AddMemBlock(Plan* plan, int64_t mem_block_id, bool enable_reuse_mem, int64_t mem_size) {
+  MemBlockProto* mem_block = plan->mutable_block_chunk_list()->add_mem_block();
+  mem_block->set_mem_block_id(mem_block_id);
+  mem_block->set_machine_id(0);
+  mem_block->mutable_mem_case()->mutable_host_mem();
+  mem_block->set_enable_reuse_mem(enable_reuse_mem);
+  mem_block->set_mem_size(mem_size);
+}
+
+}  // namespace
+
+TEST(MemoryReport, peak_of_live_regsts) {
+  // task 0 -> a -> task 1 -> b -> task 2, c produced by task 2 inplace of b, d in a static block
+  Plan plan;
+  TaskProto* task0 = AddTask(&plan, 0);
+  TaskProto* task1 = AddTask(&plan, 1);
+  TaskProto* task2 = AddTask(&plan, 2);
+  RegstDescProto* a = AddRegst(task0, 10, 4096, 1, 0);
+  a->add_consumer_task_id(1);
+  const int64_t a_size = RtRegstDesc(*a).TotalByteSize4AllRegst();
+  RegstDescProto* b = AddRegst(task1, 11, 1024, 1, a_size);
+  b->add_consumer_task_id(2);
+  const int64_t b_size = RtRegstDesc(*b).TotalByteSize4AllRegst();
+  RegstDescProto* c = AddRegst(task2, 12, 1024, 1, a_size);
+  c->set_force_inplace_consumed_regst_desc_id(11);
+  RegstDescProto* d = AddRegst(task0, 13, 256, 2, 0);
+  const int64_t d_size = RtRegstDesc(*d).TotalByteSize4AllRegst();
+  AddMemBlock(&plan, 1, true, a_size + b_size);
+  AddMemBlock(&plan, 2, false, d_size);
+
+  std::string json;
+  std::string html;
+  GenMemoryReport(plan, 2, &json, &html);
+  const nlohmann::json report = nlohmann::json::parse(json);
+  ASSERT_EQ(report["devices"].size(), 1);
+  const nlohmann::json& device = report["devices"][0];
+  ASSERT_EQ(device["mem_case"], "host");
+  ASSERT_EQ(device["allocated_bytes"], a_size + b_size + d_size);
+  ASSERT_EQ(device["jobs"].size(), 1);
+  const nlohmann::json& job = device["jobs"][0];
+  ASSERT_EQ(job["regst_num"], 3);
+  ASSERT_EQ(job["static_bytes"], d_size);
+  ASSERT_EQ(job["peak_step"], 1);
+  ASSERT_EQ(job["peak_bytes"], a_size + b_size + d_size);
+  // b stays live until task 2 produces c inplace
+  ASSERT_EQ(job["timeline"].back(), nlohmann::json({3, d_size}));
+  const nlohmann::json& top_contributors = job["top_contributors"];
+  ASSERT_EQ(top_contributors.size(), 2);
+  ASSERT_EQ(top_contributors[0]["regst_desc_id"], 10);
+  ASSERT_EQ(top_contributors[1]["regst_desc_id"], 11);
+  ASSERT_EQ(top_contributors[1]["end_step"], 2);
+  ASSERT_EQ(top_contributors[1]["inplace_regst_desc_ids"], nlohmann::json({12}));
+  ASSERT_NE(html.find("<svg"), std::string::npos);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
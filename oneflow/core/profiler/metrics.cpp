@@ -0,0 +1,248 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/metrics.h"
+#include "oneflow/core/common/platform.h"
+#include <iomanip>
+#ifdef OF_PLATFORM_POSIX
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif  // OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+std::string EscapeLabelValue(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+class PrometheusTextWriter final {
+ public:
+  PrometheusTextWriter() = default;
+  ~PrometheusTextWriter() = default;
+
+  void AddSample(const std::string& metric, const std::string& type, const std::string& labels,
+                 double value) {
+    auto& samples = metric2samples_[metric];
+    if (samples.empty()) { metric2type_[metric] = type; }
+    std::ostringstream ss;
+    // exact for counters below 1e15
+    ss << std::setprecision(15) << metric << "{" << labels << "} " << value << "\n";
+    samples += ss.str();
+  }
+
+  std::string ToString() const {
+    std::string text;
+    for (const auto& pair : metric2samples_) {
+      text += "# TYPE " + pair.first + " " + metric2type_.at(pair.first) + "\n" + pair.second;
+    }
+    return text;
+  }
+
+ private:
+  std::map<std::string, std::string> metric2samples_;
+  std::map<std::string, std::string> metric2type_;
+};
+
+double LoadSeconds(const std::atomic<int64_t>& ns) {
+  return ns.load(std::memory_order_relaxed) / 1e9;
+}
+
+double Load(const std::atomic<int64_t>& val) { return val.load(std::memory_order_relaxed); }
+
+}  // namespace
+
+ActorMetrics* MetricsRegistry::NewActorMetrics(int64_t actor_id, const std::string& name) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& name7metrics = actor_id2metrics_[actor_id];
+  CHECK(!name7metrics.second) << "actor " << actor_id;
+  name7metrics.first = name;
+  name7metrics.second.reset(new ActorMetrics());
+  return name7metrics.second.get();
+}
+
+ThreadMetrics* MetricsRegistry::NewThreadMetrics(int64_t thrd_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& metrics = thrd_id2metrics_[thrd_id];
+  CHECK(!metrics) << "thread " << thrd_id;
+  metrics.reset(new ThreadMetrics());
+  return metrics.get();
+}
+
+CommNetPeerMetrics* MetricsRegistry::CommNetPeerMetrics4MachineId(int64_t machine_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto& metrics = machine_id2comm_net_metrics_[machine_id];
+  if (!metrics) { metrics.reset(new CommNetPeerMetrics()); }
+  return metrics.get();
+}
+
+std::string MetricsRegistry::ToPrometheusText() const {
+  PrometheusTextWriter writer;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const auto& pair : actor_id2metrics_) {
+    const std::string labels = "actor_id=\"" + std::to_string(pair.first) + "\",name=\""
+                               + EscapeLabelValue(pair.second.first) + "\"";
+    const ActorMetrics& metrics = *pair.second.second;
+    writer.AddSample("oneflow_actor_act_total", "counter", labels, Load(metrics.act_cnt));
+    writer.AddSample("oneflow_actor_read_blocked_seconds_total", "counter", labels,
+                     LoadSeconds(metrics.read_blocked_ns));
+    writer.AddSample("oneflow_actor_write_blocked_seconds_total", "counter", labels,
+                     LoadSeconds(metrics.write_blocked_ns));
+    writer.AddSample("oneflow_actor_consumed_regst", "gauge", labels,
+                     Load(metrics.consumed_regst_cnt));
+    writer.AddSample("oneflow_actor_free_produced_regst", "gauge", labels,
+                     Load(metrics.produced_regst_cnt));
+  }
+  for (const auto& pair : thrd_id2metrics_) {
+    const std::string labels = "thrd_id=\"" + std::to_string(pair.first) + "\"";
+    const ThreadMetrics& metrics = *pair.second;
+    writer.AddSample("oneflow_thread_msg_total", "counter", labels, Load(metrics.msg_cnt));
+    writer.AddSample("oneflow_thread_idle_seconds_total", "counter", labels,
+                     LoadSeconds(metrics.idle_ns));
+    writer.AddSample("oneflow_thread_msg_queue_depth", "gauge", labels,
+                     Load(metrics.msg_queue_depth));
+    writer.AddSample("oneflow_thread_max_msg_queue_depth", "gauge", labels,
+                     Load(metrics.max_msg_queue_depth));
+  }
+  for (const auto& pair : machine_id2comm_net_metrics_) {
+    const std::string labels = "peer_machine_id=\"" + std::to_string(pair.first) + "\"";
+    const CommNetPeerMetrics& metrics = *pair.second;
+    writer.AddSample("oneflow_comm_net_read_total", "counter", labels, Load(metrics.read_cnt));
+    writer.AddSample("oneflow_comm_net_read_bytes_total", "counter", labels,
+                     Load(metrics.read_bytes));
+    writer.AddSample("oneflow_comm_net_pending_read", "gauge", labels,
+                     Load(metrics.pending_read_cnt));
+  }
+  return writer.ToString();
+}
+
+MetricsExporter::MetricsExporter(const std::string& path, int32_t http_port,
+                                 const std::string& http_bind_address, int64_t interval_ms)
+    : path_(path), interval_ms_(interval_ms), is_stopped_(false) {
+  CHECK_GT(interval_ms_, 0);
+  if (!path_.empty()) {
+    file_thread_ = std::thread([this]() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!cond_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                             [this]() { return is_stopped_; })) {
+        WriteFile();
+      }
+    });
+  }
+  if (http_port > 0) {
+#ifdef OF_PLATFORM_POSIX
+    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    PCHECK(server_fd >= 0);
+    int reuse_addr = 1;
+    PCHECK(setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_addr, sizeof(reuse_addr)) == 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    CHECK_EQ(inet_pton(AF_INET, http_bind_address.c_str(), &addr.sin_addr), 1)
+        << "invalid metrics http bind address " << http_bind_address;
+    addr.sin_port = htons(http_port);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(server_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(server_fd, 16) != 0
+        || getsockname(server_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+      PLOG(WARNING) << "metrics can not be served on " << http_bind_address << ":" << http_port;
+      close(server_fd);
+    } else {
+      char ip[INET_ADDRSTRLEN];
+      CHECK_NOTNULL(inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip)));
+      http_listen_address_ = std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+      LOG(INFO) << "metrics are served on " << http_listen_address_;
+      http_thread_ = std::thread([this, server_fd]() { ServeHttp(server_fd); });
+    }
+#else
+    LOG(WARNING) << "serving metrics over http is not supported on this platform";
+#endif  // OF_PLATFORM_POSIX
+  }
+}
+
+MetricsExporter::~MetricsExporter() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  cond_.notify_all();
+  if (file_thread_.joinable()) { file_thread_.join(); }
+  if (http_thread_.joinable()) { http_thread_.join(); }
+  // the last values of the finished run
+  if (!path_.empty()) { WriteFile(); }
+}
+
+void MetricsExporter::WriteFile() const {
+  // replaced at once so that readers never see a partially written file
+  const std::string tmp_path = path_ + ".tmp";
+  {
+    std::ofstream out(tmp_path);
+    out << Global<MetricsRegistry>::Get()->ToPrometheusText();
+  }
+  if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    PLOG(WARNING) << "failed to write metrics to " << path_;
+  }
+}
+
+void MetricsExporter::ServeHttp(int server_fd) {
+#ifdef OF_PLATFORM_POSIX
+  pollfd server_poll_fd{server_fd, POLLIN, 0};
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (is_stopped_) { break; }
+    }
+    if (poll(&server_poll_fd, 1, 200) <= 0) { continue; }
+    int conn_fd = accept(server_fd, nullptr, nullptr);
+    if (conn_fd < 0) { continue; }
+    // every request is answered with the metrics, whatever its path
+    char request[1024];
+    pollfd conn_poll_fd{conn_fd, POLLIN, 0};
+    if (poll(&conn_poll_fd, 1, 1000) > 0) { (void)read(conn_fd, request, sizeof(request)); }
+    const std::string body = Global<MetricsRegistry>::Get()->ToPrometheusText();
+    const std::string response =
+        "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+        + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+      ssize_t n = send(conn_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) { break; }
+      sent += n;
+    }
+    close(conn_fd);
+  }
+  close(server_fd);
+#endif  // OF_PLATFORM_POSIX
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,108 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_METRICS_H_
+#define ONEFLOW_CORE_PROFILER_METRICS_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// Metrics are updated with relaxed atomics on the hot paths and read by the exporter
+struct ActorMetrics {
+  std::atomic<int64_t> act_cnt{0};
+  // time between an act and the next one spent waiting for readable or writeable regsts
+  std::atomic<int64_t> read_blocked_ns{0};
+  std::atomic<int64_t> write_blocked_ns{0};
+  // regsts held in the consumed slots and free regsts in the produced slots after the last act
+  std::atomic<int64_t> consumed_regst_cnt{0};
+  std::atomic<int64_t> produced_regst_cnt{0};
+};
+
+struct ThreadMetrics {
+  std::atomic<int64_t> msg_cnt{0};
+  std::atomic<int64_t> idle_ns{0};
+  std::atomic<int64_t> msg_queue_depth{0};
+  std::atomic<int64_t> max_msg_queue_depth{0};
+};
+
+struct CommNetPeerMetrics {
+  std::atomic<int64_t> read_cnt{0};
+  std::atomic<int64_t> read_bytes{0};
+  std::atomic<int64_t> pending_read_cnt{0};
+};
+
+inline void IncreaseMetric(std::atomic<int64_t>* metric, int64_t val) {
+  metric->fetch_add(val, std::memory_order_relaxed);
+}
+
+inline void SetMetric(std::atomic<int64_t>* metric, int64_t val) {
+  metric->store(val, std::memory_order_relaxed);
+}
+
+class MetricsRegistry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MetricsRegistry);
+  MetricsRegistry() = default;
+  ~MetricsRegistry() = default;
+
+  // The returned metrics live as long as the registry, beyond their actors and threads
+  ActorMetrics* NewActorMetrics(int64_t actor_id, const std::string& name);
+  ThreadMetrics* NewThreadMetrics(int64_t thrd_id);
+  CommNetPeerMetrics* CommNetPeerMetrics4MachineId(int64_t machine_id);
+
+  // Prometheus text exposition format
+  std::string ToPrometheusText() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<int64_t, std::pair<std::string, std::unique_ptr<ActorMetrics>>> actor_id2metrics_;
+  std::map<int64_t, std::unique_ptr<ThreadMetrics>> thrd_id2metrics_;
+  std::map<int64_t, std::unique_ptr<CommNetPeerMetrics>> machine_id2comm_net_metrics_;
+};
+
+// Periodically writes the metrics of this process to a file and/or serves them over http. The
+// requests are not authenticated, so http_bind_address is better a loopback one.
+class MetricsExporter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MetricsExporter);
+  MetricsExporter(const std::string& path, int32_t http_port,
+                  const std::string& http_bind_address, int64_t interval_ms);
+  ~MetricsExporter();
+
+  // "<ip>:<port>" the http server listens on, empty if metrics are not served
+  const std::string& http_listen_address() const { return http_listen_address_; }
+
+ private:
+  void WriteFile() const;
+  void ServeHttp(int server_fd);
+
+  std::string path_;
+  std::string http_listen_address_;
+  int64_t interval_ms_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_stopped_;
+  std::thread file_thread_;
+  std::thread http_thread_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_METRICS_H_
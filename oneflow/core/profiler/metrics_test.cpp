@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/metrics.h"
+#include "oneflow/core/common/platform.h"
+#ifdef OF_PLATFORM_POSIX
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif  // OF_PLATFORM_POSIX
+
+namespace oneflow {
+
+namespace profiler {
+
+TEST(MetricsRegistry, prometheus_text) {
+  MetricsRegistry registry;
+  ActorMetrics* actor_metrics = registry.NewActorMetrics(3, "kNormalForward:\"op\"");
+  IncreaseMetric(&actor_metrics->act_cnt, 2);
+  IncreaseMetric(&actor_metrics->read_blocked_ns, 1500000000);
+  ThreadMetrics* thread_metrics = registry.NewThreadMetrics(1);
+  SetMetric(&thread_metrics->msg_queue_depth, 5);
+  IncreaseMetric(&registry.CommNetPeerMetrics4MachineId(1)->read_bytes, 1024);
+  ASSERT_EQ(registry.CommNetPeerMetrics4MachineId(1), registry.CommNetPeerMetrics4MachineId(1));
+  const std::string text = registry.ToPrometheusText();
+  const std::string actor_labels = "{actor_id=\"3\",name=\"kNormalForward:\\\"op\\\"\"}";
+  ASSERT_NE(text.find("# TYPE oneflow_actor_act_total counter\n"), std::string::npos);
+  ASSERT_NE(text.find("oneflow_actor_act_total" + actor_labels + " 2\n"), std::string::npos);
+  ASSERT_NE(text.find("oneflow_actor_read_blocked_seconds_total" + actor_labels + " 1.5\n"),
+            std::string::npos);
+  ASSERT_NE(text.find("oneflow_thread_msg_queue_depth{thrd_id=\"1\"} 5\n"), std::string::npos);
+  ASSERT_NE(text.find("oneflow_comm_net_read_bytes_total{peer_machine_id=\"1\"} 1024\n"),
+            std::string::npos);
+}
+
+#ifdef OF_PLATFORM_POSIX
+TEST(MetricsExporter, http_listens_on_loopback) {
+  Global<MetricsRegistry>::New();
+  const int32_t http_port = 20000 + getpid() % 20000;
+  {
+    MetricsExporter exporter("", http_port, "127.0.0.1", 1000);
+    ASSERT_EQ(exporter.http_listen_address(), "127.0.0.1:" + std::to_string(http_port));
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(http_port);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(send(fd, request.data(), request.size(), 0), request.size());
+    char response[64] = {0};
+    ASSERT_GT(read(fd, response, sizeof(response) - 1), 0);
+    ASSERT_EQ(std::string(response).find("HTTP/1.0 200 OK"), 0);
+    close(fd);
+  }
+  Global<MetricsRegistry>::Delete();
+}
+#endif  // OF_PLATFORM_POSIX
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/tracer.h"
 #ifdef OF_ENABLE_PROFILER
 #include <nvtx3/nvToolsExt.h>
 #include <sys/syscall.h>
@@ -46,6 +47,7 @@ void ParseBoolFlagFromEnv(const std::string& env_var, bool* flag) {
 }
 
 void NameThisHostThread(const std::string& name) {
+  SetTraceThreadName(name);
 #ifdef OF_ENABLE_PROFILER
   nvtxNameOsThreadA(syscall(SYS_gettid), name.c_str());
 #endif  // OF_ENABLE_PROFILER
@@ -0,0 +1,120 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/roofline.h"
+#include "oneflow/core/graph/op_graph.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+std::string OpTypeName4Op(const Operator& op) {
+  const OperatorConf& op_conf = op.op_conf();
+  if (op_conf.has_user_conf()) { return op_conf.user_conf().op_type_name(); }
+  return OperatorConf::descriptor()->FindFieldByNumber(op_conf.op_type_case())->name();
+}
+
+// physical cost on the first device of the op
+ComputeCost InferPhysicalComputeCost(const OpNode& op_node) {
+  const Operator& op = op_node.op();
+  const int64_t parallel_num = op_node.parallel_desc().parallel_num();
+  HashMap<std::string, std::unique_ptr<BlobDesc>> bn2blob_desc;
+  for (const auto& bns : {op.input_bns(), op.output_bns()}) {
+    for (const std::string& bn : bns) {
+      const BlobDesc& logical_blob_desc = op_node.LogicalBlobDesc4Lbi(op.BnInOp2Lbi(bn));
+      const Shape physical_shape = *CHECK_JUST(GetPhysicalShape(
+          logical_blob_desc.shape(), op_node.SbpParallel4BnInOp(bn), parallel_num, 0));
+      bn2blob_desc[bn].reset(new BlobDesc(physical_shape, logical_blob_desc.data_type()));
+    }
+  }
+  ComputeCost cost;
+  CHECK_JUST(op.InferComputeCost(
+      [&](const std::string& bn) -> const BlobDesc* {
+        const auto it = bn2blob_desc.find(bn);
+        return it == bn2blob_desc.end() ? nullptr : it->second.get();
+      },
+      &cost));
+  return cost;
+}
+
+}  // namespace
+
+RooflineRow MakeRooflineRow(const std::string& op_name, const std::string& op_type_name,
+                            const std::string& device_tag, int64_t parallel_num,
+                            const ComputeCost& cost, const RooflinePeak& peak) {
+  RooflineRow row;
+  row.op_name = op_name;
+  row.op_type_name = op_type_name;
+  row.device_tag = device_tag;
+  row.parallel_num = parallel_num;
+  row.cost = cost;
+  const int64_t bytes = cost.read_bytes + cost.written_bytes;
+  row.intensity = cost.flops / std::max<int64_t>(bytes, 1);
+  row.attainable_gflops = std::min(peak.gflops, row.intensity * peak.memory_gbps);
+  // GFLOP/s and GB/s are the same as kFLOP/us and kB/us
+  const double compute_us = cost.flops / (peak.gflops * 1e3);
+  const double memory_us = bytes / (peak.memory_gbps * 1e3);
+  row.is_compute_bound = compute_us >= memory_us;
+  row.estimated_us = std::max(compute_us, memory_us);
+  return row;
+}
+
+std::string FormatRooflineTable(std::vector<RooflineRow> rows) {
+  std::sort(rows.begin(), rows.end(), [](const RooflineRow& lhs, const RooflineRow& rhs) {
+    return lhs.estimated_us > rhs.estimated_us;
+  });
+
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3);
+  out << std::left << std::setw(12) << "est_us" << std::setw(12) << "MFLOP" << std::setw(12)
+      << "MB_read" << std::setw(12) << "MB_written" << std::setw(12) << "FLOP/B" << std::setw(12)
+      << "GFLOP/s" << std::setw(9) << "bound" << std::setw(8) << "device" << std::setw(9)
+      << "parallel" << std::setw(28) << "op_type" << "op_name" << std::endl;
+  double total_us = 0;
+  double compute_bound_us = 0;
+  for (const RooflineRow& row : rows) {
+    out << std::setw(12) << row.estimated_us << std::setw(12) << row.cost.flops / 1e6
+        << std::setw(12) << row.cost.read_bytes / 1e6 << std::setw(12)
+        << row.cost.written_bytes / 1e6 << std::setw(12) << row.intensity << std::setw(12)
+        << row.attainable_gflops << std::setw(9) << (row.is_compute_bound ? "compute" : "memory")
+        << std::setw(8) << row.device_tag << std::setw(9) << row.parallel_num << std::setw(28)
+        << row.op_type_name << row.op_name << std::endl;
+    total_us += row.estimated_us;
+    if (row.is_compute_bound) { compute_bound_us += row.estimated_us; }
+  }
+  out << "total: " << rows.size() << " ops, " << total_us << " us estimated, "
+      << compute_bound_us << " us of them compute bound" << std::endl;
+  return out.str();
+}
+
+std::string GenRooflineReport(const OpGraph& op_graph,
+                              const std::function<RooflinePeak(DeviceType)>& Peak4DeviceType) {
+  std::vector<RooflineRow> rows;
+  op_graph.ForEachNode([&](OpNode* op_node) {
+    const ParallelDesc& parallel_desc = op_node->parallel_desc();
+    rows.push_back(MakeRooflineRow(
+        op_node->op().op_name(), OpTypeName4Op(op_node->op()),
+        CHECK_JUST(DeviceTag4DeviceType(parallel_desc.device_type())),
+        parallel_desc.parallel_num(), InferPhysicalComputeCost(*op_node),
+        Peak4DeviceType(parallel_desc.device_type())));
+  });
+  return FormatRooflineTable(std::move(rows));
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_ROOFLINE_H_
+#define ONEFLOW_CORE_PROFILER_ROOFLINE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/device_type.pb.h"
+#include "oneflow/core/operator/compute_cost.h"
+
+namespace oneflow {
+
+class OpGraph;
+
+namespace profiler {
+
+struct RooflinePeak {
+  double gflops;
+  double memory_gbps;
+};
+
+struct RooflineRow {
+  std::string op_name;
+  std::string op_type_name;
+  std::string device_tag;
+  int64_t parallel_num;
+  ComputeCost cost;
+  double intensity;
+  double attainable_gflops;
+  bool is_compute_bound;
+  double estimated_us;
+};
+
+// Places the cost of an op on one device against the roofline of the device
+RooflineRow MakeRooflineRow(const std::string& op_name, const std::string& op_type_name,
+                            const std::string& device_tag, int64_t parallel_num,
+                            const ComputeCost& cost, const RooflinePeak& peak);
+
+// One line per row sorted by the estimated time, followed by the total
+std::string FormatRooflineTable(std::vector<RooflineRow> rows);
+
+// Table of the compute cost of every op on one of its devices against the roofline of the device,
+// sorted by the estimated time, which is the larger one of compute time and memory time
+std::string GenRooflineReport(const OpGraph& op_graph,
+                              const std::function<RooflinePeak(DeviceType)>& Peak4DeviceType);
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_ROOFLINE_H_
@@ -0,0 +1,80 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/roofline.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+ComputeCost MakeComputeCost(double flops, int64_t read_bytes, int64_t written_bytes) {
+  ComputeCost cost;
+  cost.flops = flops;
+  cost.read_bytes = read_bytes;
+  cost.written_bytes = written_bytes;
+  return cost;
+}
+
+}  // namespace
+
+TEST(Roofline, compute_and_memory_bound) {
+  // ridge point at 10 FLOP/B
+  const RooflinePeak peak{1000, 100};
+  const RooflineRow matmul =
+      MakeRooflineRow("matmul", "matmul", "gpu", 1, MakeComputeCost(4e6, 1e5, 1e5), peak);
+  ASSERT_DOUBLE_EQ(matmul.intensity, 20);
+  ASSERT_DOUBLE_EQ(matmul.attainable_gflops, 1000);
+  ASSERT_TRUE(matmul.is_compute_bound);
+  ASSERT_DOUBLE_EQ(matmul.estimated_us, 4);
+
+  const RooflineRow relu =
+      MakeRooflineRow("relu", "relu", "gpu", 1, MakeComputeCost(1e5, 4e5, 4e5), peak);
+  ASSERT_DOUBLE_EQ(relu.intensity, 0.125);
+  ASSERT_DOUBLE_EQ(relu.attainable_gflops, 12.5);
+  ASSERT_FALSE(relu.is_compute_bound);
+  ASSERT_DOUBLE_EQ(relu.estimated_us, 8);
+}
+
+TEST(Roofline, table_sorted_by_estimated_time) {
+  const RooflinePeak peak{1000, 100};
+  std::vector<RooflineRow> rows;
+  rows.push_back(MakeRooflineRow("b", "relu", "gpu", 1, MakeComputeCost(1e5, 1e5, 1e5), peak));
+  rows.push_back(MakeRooflineRow("d", "gather", "gpu", 1, MakeComputeCost(0, 0, 0), peak));
+  rows.push_back(MakeRooflineRow("a", "matmul", "gpu", 1, MakeComputeCost(8e6, 1e5, 1e5), peak));
+  rows.push_back(MakeRooflineRow("c", "relu", "gpu", 1, MakeComputeCost(1e5, 1e4, 1e4), peak));
+  std::istringstream table(FormatRooflineTable(rows));
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(table, line)) { lines.push_back(line); }
+  // a header, one line per op and the total
+  ASSERT_EQ(lines.size(), rows.size() + 2);
+  std::string op_names;
+  double last_estimated_us = std::numeric_limits<double>::max();
+  FOR_RANGE(size_t, i, 1, lines.size() - 1) {
+    const double estimated_us = std::stod(lines.at(i));
+    ASSERT_LE(estimated_us, last_estimated_us);
+    last_estimated_us = estimated_us;
+    op_names += lines.at(i).substr(lines.at(i).find_last_of(' ') + 1);
+  }
+  ASSERT_EQ(op_names, "abcd");
+  ASSERT_EQ(lines.back().find("total: 4 ops, 10.200 us estimated, 8.000 us of them compute bound"),
+            0);
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,301 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/tracer.h"
+#include "oneflow/core/profiler/profiler.h"
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+struct TraceEventRecord {
+  int64_t name_id;
+  int64_t begin_ns;
+  int64_t end_ns;
+  int64_t arg;
+  TraceCategory category;
+};
+
+// A single-producer ring buffer. Each slot carries a sequence number so that a concurrent dump
+// can detect and skip the slots being overwritten instead of blocking the recording thread.
+class TraceBuffer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TraceBuffer);
+  TraceBuffer(int64_t tid, size_t capacity)
+      : tid_(tid), capacity_(capacity), slots_(new Slot[capacity]), head_(0) {}
+  ~TraceBuffer() = default;
+
+  int64_t tid() const { return tid_; }
+
+  void Push(const TraceEventRecord& record) {
+    const uint64_t index = head_.load(std::memory_order_relaxed);
+    Slot* slot = &slots_[index % capacity_];
+    slot->seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->record = record;
+    slot->seq.store(index + 1, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+  }
+
+  void Snapshot(std::vector<TraceEventRecord>* records) const {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t begin =
+        std::max(head > capacity_ ? head - capacity_ : 0, cleared_head_.load());
+    for (uint64_t index = begin; index < head; ++index) {
+      const Slot& slot = slots_[index % capacity_];
+      if (slot.seq.load(std::memory_order_acquire) != index + 1) { continue; }
+      TraceEventRecord record = slot.record;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) != index + 1) { continue; }
+      records->push_back(record);
+    }
+  }
+
+  // Only hides the recorded events from later snapshots, the owner thread keeps writing from head_
+  void Clear() { cleared_head_.store(head_.load(std::memory_order_acquire)); }
+
+  std::string thread_name() const {
+    std::unique_lock<std::mutex> lock(thread_name_mutex_);
+    return thread_name_;
+  }
+  void set_thread_name(const std::string& name) {
+    std::unique_lock<std::mutex> lock(thread_name_mutex_);
+    thread_name_ = name;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> seq{0};
+    TraceEventRecord record;
+  };
+
+  const int64_t tid_;
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> cleared_head_{0};
+  mutable std::mutex thread_name_mutex_;
+  std::string thread_name_;
+};
+
+// Names are never removed, ids stay valid for the whole process. A deque keeps the references
+// handed out by Name stable while other threads intern new names.
+class TraceNameTable final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TraceNameTable);
+  TraceNameTable() = default;
+  ~TraceNameTable() = default;
+
+  int64_t Intern(const std::string& name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto it = name2id_.find(name);
+    if (it != name2id_.end()) { return it->second; }
+    const int64_t id = names_.size();
+    names_.push_back(name);
+    name2id_.emplace(name, id);
+    return id;
+  }
+
+  const std::string& Name(int64_t id) const {
+    static const std::string empty;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (id < 0 || id >= static_cast<int64_t>(names_.size())) { return empty; }
+    return names_.at(id);
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  HashMap<std::string, int64_t> name2id_;
+  std::deque<std::string> names_;
+};
+
+TraceNameTable* GetTraceNameTable() {
+  static TraceNameTable table;
+  return &table;
+}
+
+size_t TraceBufferCapacity() {
+  static const size_t capacity = []() -> size_t {
+    const char* env_p = std::getenv("ONEFLOW_PROFILER_TRACE_BUFFER_SIZE");
+    const int64_t size = env_p == nullptr ? 0 : std::atoll(env_p);
+    return size > 0 ? size : (1 << 16);
+  }();
+  return capacity;
+}
+
+bool TracingEnabledByEnv() {
+  bool enabled = false;
+  ParseBoolFlagFromEnv("ONEFLOW_PROFILER_TRACE", &enabled);
+  return enabled;
+}
+
+std::atomic<bool>* MutTracingEnabled() {
+  static std::atomic<bool> enabled(TracingEnabledByEnv());
+  return &enabled;
+}
+
+class TraceBufferRegistry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TraceBufferRegistry);
+  TraceBufferRegistry() = default;
+  ~TraceBufferRegistry() = default;
+
+  // Buffers stay registered after their threads exit so that their events can still be dumped
+  std::shared_ptr<TraceBuffer> NewBuffer(const std::string& thread_name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto buffer = std::make_shared<TraceBuffer>(buffers_.size() + 1, TraceBufferCapacity());
+    buffer->set_thread_name(thread_name);
+    buffers_.push_back(buffer);
+    return buffer;
+  }
+
+  std::vector<std::shared_ptr<TraceBuffer>> buffers() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return buffers_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+};
+
+TraceBufferRegistry* GetTraceBufferRegistry() {
+  static TraceBufferRegistry registry;
+  return &registry;
+}
+
+thread_local std::string this_thread_name;
+thread_local std::shared_ptr<TraceBuffer> this_thread_buffer;
+
+// The buffer is created on the first event so that untraced threads cost no memory
+TraceBuffer* ThisThreadBuffer() {
+  if (!this_thread_buffer) {
+    this_thread_buffer = GetTraceBufferRegistry()->NewBuffer(this_thread_name);
+  }
+  return this_thread_buffer.get();
+}
+
+const char* TraceCategoryName(TraceCategory category) {
+  switch (category) {
+    case TraceCategory::kKernel: return "kernel";
+    case TraceCategory::kActor: return "actor";
+    case TraceCategory::kRegst: return "regst";
+    case TraceCategory::kVmInstruction: return "vm_instruction";
+    case TraceCategory::kCommNet: return "comm_net";
+    default: return "unknown";
+  }
+}
+
+void WriteJsonString(std::ostream& out, const char* str) {
+  if (str == nullptr) { str = ""; }
+  out << '"';
+  for (const char* c = str; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      out << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      out << ' ';
+    } else {
+      out << *c;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+void EnableTracing() { MutTracingEnabled()->store(true, std::memory_order_relaxed); }
+
+void DisableTracing() { MutTracingEnabled()->store(false, std::memory_order_relaxed); }
+
+bool IsTracingEnabled() { return MutTracingEnabled()->load(std::memory_order_relaxed); }
+
+int64_t TraceNowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t InternTraceName(const std::string& name) { return GetTraceNameTable()->Intern(name); }
+
+void RecordTraceEvent(TraceCategory category, int64_t name_id, int64_t begin_ns, int64_t end_ns,
+                      int64_t arg) {
+  if (!IsTracingEnabled()) { return; }
+  ThisThreadBuffer()->Push(TraceEventRecord{name_id, begin_ns, end_ns, arg, category});
+}
+
+void RecordInstantTraceEvent(TraceCategory category, int64_t name_id, int64_t arg) {
+  const int64_t now_ns = TraceNowNanos();
+  RecordTraceEvent(category, name_id, now_ns, now_ns, arg);
+}
+
+void SetTraceThreadName(const std::string& name) {
+  this_thread_name = name;
+  if (this_thread_buffer) { this_thread_buffer->set_thread_name(name); }
+}
+
+Maybe<void> DumpChromeTrace(const std::string& path) {
+  std::ofstream out(path);
+  CHECK_OR_RETURN(out.is_open()) << "can not open " << path;
+  const int64_t pid = getpid();
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool is_first = true;
+  auto Separate = [&]() {
+    if (!is_first) { out << ",\n"; }
+    is_first = false;
+  };
+  std::vector<TraceEventRecord> records;
+  for (const auto& buffer : GetTraceBufferRegistry()->buffers()) {
+    Separate();
+    out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << buffer->tid()
+        << ",\"args\":{\"name\":";
+    const std::string thread_name = buffer->thread_name();
+    WriteJsonString(out, thread_name.empty() ? "unnamed thread" : thread_name.c_str());
+    out << "}}";
+    records.clear();
+    buffer->Snapshot(&records);
+    for (const TraceEventRecord& record : records) {
+      Separate();
+      // Chrome trace timestamps are in microseconds
+      out << "{\"name\":";
+      WriteJsonString(out, GetTraceNameTable()->Name(record.name_id).c_str());
+      out << ",\"cat\":\"" << TraceCategoryName(record.category) << "\",\"pid\":" << pid
+          << ",\"tid\":" << buffer->tid() << std::fixed << std::setprecision(3)
+          << ",\"ts\":" << record.begin_ns / 1e3;
+      if (record.end_ns == record.begin_ns) {
+        out << ",\"ph\":\"i\",\"s\":\"t\"";
+      } else {
+        out << ",\"ph\":\"X\",\"dur\":" << (record.end_ns - record.begin_ns) / 1e3;
+      }
+      out << ",\"args\":{\"arg\":" << record.arg << "}}";
+    }
+  }
+  out << "]}\n";
+  CHECK_OR_RETURN(out.good()) << "failed to write " << path;
+  return Maybe<void>::Ok();
+}
+
+void ClearTraceEvents() {
+  for (const auto& buffer : GetTraceBufferRegistry()->buffers()) { buffer->Clear(); }
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,100 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_TRACER_H_
+#define ONEFLOW_CORE_PROFILER_TRACER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+enum class TraceCategory : int8_t {
+  kKernel = 0,
+  kActor,
+  kRegst,
+  kVmInstruction,
+  kCommNet,
+};
+
+// The tracer records events into per-thread ring buffers which are only written by their owner
+// thread, so recording is a few stores and never takes a lock. It is disabled unless the env var
+// ONEFLOW_PROFILER_TRACE is set or EnableTracing() is called at runtime.
+void EnableTracing();
+void DisableTracing();
+bool IsTracingEnabled();
+
+int64_t TraceNowNanos();
+
+// Events refer to their names by ids into a process-wide table of interned names, so that the
+// records stay valid after the kernels and actors which named them are destroyed. Interning takes
+// a lock, owners intern their names once and keep the ids.
+int64_t InternTraceName(const std::string& name);
+
+void RecordTraceEvent(TraceCategory category, int64_t name_id, int64_t begin_ns, int64_t end_ns,
+                      int64_t arg);
+void RecordInstantTraceEvent(TraceCategory category, int64_t name_id, int64_t arg);
+
+void SetTraceThreadName(const std::string& name);
+
+// Writes the events still held by the ring buffers in the Chrome trace event format, which can be
+// opened by chrome://tracing or https://ui.perfetto.dev
+Maybe<void> DumpChromeTrace(const std::string& path);
+void ClearTraceEvents();
+
+class TraceGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TraceGuard);
+  TraceGuard(TraceCategory category, int64_t name_id, int64_t arg)
+      : category_(category), name_id_(name_id), arg_(arg), begin_ns_(-1) {
+    if (IsTracingEnabled()) { begin_ns_ = TraceNowNanos(); }
+  }
+  ~TraceGuard() {
+    if (begin_ns_ >= 0) { RecordTraceEvent(category_, name_id_, begin_ns_, TraceNowNanos(), arg_); }
+  }
+
+ private:
+  TraceCategory category_;
+  int64_t name_id_;
+  int64_t arg_;
+  int64_t begin_ns_;
+};
+
+// id of a string literal, interned on the first use
+#define OF_PROFILER_TRACE_NAME_ID(literal)                                                         \
+  ([]() {                                                                                          \
+    static const int64_t name_id = ::oneflow::profiler::InternTraceName(literal);                  \
+    return name_id;                                                                                \
+  }())
+
+#define OF_PROFILER_TRACE_GUARD(category, name_id, arg)                                            \
+  ::oneflow::profiler::TraceGuard OF_PP_CAT(_of_profiler_trace_guard_, __COUNTER__)(               \
+      ::oneflow::profiler::TraceCategory::category, name_id, arg)
+
+#define OF_PROFILER_TRACE_INSTANT(category, name_id, arg)                                          \
+  do {                                                                                             \
+    if (::oneflow::profiler::IsTracingEnabled()) {                                                 \
+      ::oneflow::profiler::RecordInstantTraceEvent(::oneflow::profiler::TraceCategory::category,   \
+                                                   name_id, arg);                                  \
+    }                                                                                              \
+  } while (0)
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_TRACER_H_
@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/tracer.h"
+#include "oneflow/core/profiler/profiler.h"
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+std::string DumpToString() {
+  const std::string path = "/tmp/oneflow_tracer_test_" + std::to_string(getpid()) + ".json";
+  CHECK_JUST(DumpChromeTrace(path));
+  std::ifstream in(path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::remove(path.c_str());
+  return ss.str();
+}
+
+}  // namespace
+
+TEST(Tracer, record_and_dump) {
+  ClearTraceEvents();
+  EnableTracing();
+  std::thread thread([]() {
+    NameThisHostThread("tracer test thread");
+    { OF_PROFILER_TRACE_GUARD(kKernel, OF_PROFILER_TRACE_NAME_ID("test_kernel"), 0); }
+    OF_PROFILER_TRACE_INSTANT(kRegst, OF_PROFILER_TRACE_NAME_ID("test_regst"), 7);
+  });
+  thread.join();
+  DisableTracing();
+  { OF_PROFILER_TRACE_GUARD(kKernel, OF_PROFILER_TRACE_NAME_ID("untraced_kernel"), 0); }
+  const std::string trace = DumpToString();
+  ASSERT_NE(trace.find("\"tracer test thread\""), std::string::npos);
+  ASSERT_NE(trace.find("\"test_kernel\""), std::string::npos);
+  ASSERT_NE(trace.find("\"test_regst\""), std::string::npos);
+  ASSERT_EQ(trace.find("untraced_kernel"), std::string::npos);
+  ClearTraceEvents();
+  ASSERT_EQ(DumpToString().find("test_kernel"), std::string::npos);
+}
+
+TEST(Tracer, dump_after_name_owner_destroyed) {
+  ClearTraceEvents();
+  EnableTracing();
+  {
+    std::unique_ptr<std::string> owned_name(new std::string("short_lived_kernel"));
+    OF_PROFILER_TRACE_GUARD(kKernel, InternTraceName(*owned_name), 0);
+    owned_name->assign(owned_name->size(), 'x');
+  }
+  DisableTracing();
+  const std::string trace = DumpToString();
+  ASSERT_NE(trace.find("\"short_lived_kernel\""), std::string::npos);
+  ClearTraceEvents();
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -41,10 +41,12 @@ int64_t RegstDesc::mem_block_offset() const {
 }
 
 void RegstDesc::AddConsumer(const TaskNode* new_consumer) {
+  std::unique_lock<std::mutex> lock(consumers_mutex_);
   CHECK(consumers_.insert(new_consumer).second);
 }
 
 void RegstDesc::DeleteConsumer(const TaskNode* consumer) {
+  std::unique_lock<std::mutex> lock(consumers_mutex_);
   CHECK_EQ(consumers_.erase(consumer), 1);
 }
 
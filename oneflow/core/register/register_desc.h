@@ -109,6 +109,7 @@ class RegstDesc final {
   int64_t regst_desc_id_;
   const TaskNode* producer_;
   HashSet<const TaskNode*> consumers_;
+  std::mutex consumers_mutex_;
   int32_t min_register_num_;
   int32_t max_register_num_;
 
@@ -18,6 +18,8 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/actor/actor.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/profiler/metrics.h"
+#include "oneflow/core/profiler/tracer.h"
 
 namespace oneflow {
 
@@ -42,10 +44,25 @@ void Thread::EnqueueActorMsg(const ActorMsg& msg) {
 }
 
 void Thread::PollMsgChannel(const ThreadCtx& thread_ctx) {
+  auto* metrics_registry = Global<profiler::MetricsRegistry>::Get();
+  profiler::ThreadMetrics* metrics =
+      metrics_registry == nullptr ? nullptr : metrics_registry->NewThreadMetrics(thrd_id_);
   while (true) {
     if (local_msg_queue_.empty()) {
-      CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      if (metrics == nullptr) {
+        CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+      } else {
+        const int64_t idle_begin_ns = profiler::TraceNowNanos();
+        CHECK_EQ(msg_channel_.ReceiveMany(&local_msg_queue_), kChannelStatusSuccess);
+        profiler::IncreaseMetric(&metrics->idle_ns, profiler::TraceNowNanos() - idle_begin_ns);
+        const int64_t depth = local_msg_queue_.size();
+        profiler::SetMetric(&metrics->msg_queue_depth, depth);
+        if (depth > metrics->max_msg_queue_depth.load(std::memory_order_relaxed)) {
+          profiler::SetMetric(&metrics->max_msg_queue_depth, depth);
+        }
+      }
     }
+    if (metrics != nullptr) { profiler::IncreaseMetric(&metrics->msg_cnt, 1); }
     ActorMsg msg = std::move(local_msg_queue_.front());
     local_msg_queue_.pop();
     if (msg.msg_type() == ActorMsgType::kCmdMsg) {
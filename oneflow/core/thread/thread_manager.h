@@ -41,9 +41,6 @@ class ThreadMgr final {
   HashMap<int64_t, std::unique_ptr<Thread>> threads_;
 };
 
-void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback);
-void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback);
-
 #define REGISTER_DEVICE_THREAD_CREATOR_WITH_STREAM_ID(device, creator) \
   REGISTER_CLASS_CREATOR(int, device, Thread, creator, const StreamId&)
 
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/blocking_counter.h"
 
 namespace oneflow {
 
@@ -41,4 +43,23 @@ void ThreadPool::AddWork(const std::function<void()>& work) {
   work_chans_.at(cur_chan_idx).Send(work);
 }
 
+void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
+  FOR_RANGE(size_t, i, 0, num) { Callback(i); }
+}
+
+void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
+  if (num == 0) { return; }
+  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
+  thread_num = std::min(num, thread_num);
+  BalancedSplitter bs(num, thread_num);
+  BlockingCounter bc(thread_num);
+  FOR_RANGE(size_t, range_id, 0, thread_num) {
+    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, Callback] {
+      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+}
+
 }  // namespace oneflow
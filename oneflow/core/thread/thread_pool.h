@@ -38,6 +38,9 @@ class ThreadPool final {
   std::atomic<size_t> work_cnt_;
 };
 
+void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback);
+void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_THREAD_THREAD_POOL_H_
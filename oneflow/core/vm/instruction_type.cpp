@@ -28,6 +28,11 @@ HashMap<std::string, InstrTypeId>* InstrTypeId4InstructionName() {
   return &map;
 }
 
+HashMap<const InstructionType*, std::string>* InstructionName4InstructionType() {
+  static HashMap<const InstructionType*, std::string> map;
+  return &map;
+}
+
 }  // namespace
 
 const InstrTypeId& LookupInstrTypeId(const std::string& name) {
@@ -51,6 +56,12 @@ void RegisterInstrTypeId(const std::string& instruction_name, const StreamType*
   InstrTypeId instr_type_id;
   instr_type_id.__Init__(stream_type, instruction_type, interpret_type);
   CHECK(InstrTypeId4InstructionName()->emplace(instruction_name, instr_type_id).second);
+  // the compute name is registered before the "Infer-" one and is kept
+  InstructionName4InstructionType()->emplace(instruction_type, instruction_name);
+}
+
+const std::string& LookupInstrTypeName(const InstructionType* instruction_type) {
+  return InstructionName4InstructionType()->at(instruction_type);
 }
 
 }  // namespace vm
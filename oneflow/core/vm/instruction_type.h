@@ -50,6 +50,7 @@ const InstrTypeId& LookupInstrTypeId(const std::string& instr_type_name);
 void ForEachInstrTypeId(std::function<void(const InstrTypeId&)> DoEach);
 void RegisterInstrTypeId(const std::string& instr_type_name, const StreamType* stream_type,
                          const InstructionType* instruction_type, InterpretType interpret_type);
+const std::string& LookupInstrTypeName(const InstructionType* instruction_type);
 
 HashMap<std::type_index, const InstructionType*>* InstructionType4TypeIndex();
 
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/vm/instruction.msg.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/object_msg/object_msg.h"
+#include "oneflow/core/profiler/tracer.h"
 
 namespace oneflow {
 namespace vm {
@@ -30,6 +31,19 @@ HashMap<StreamTypeId, StreamTypeId>* InferStreamTypeId4ComputeStreamTypeId() {
   return &map;
 }
 
+int64_t TraceNameId4Instruction(const Instruction* instruction) {
+  if (!profiler::IsTracingEnabled()) { return -1; }
+  static thread_local HashMap<const InstructionType*, int64_t> instr_type2trace_name_id;
+  const InstructionType* instr_type = &instruction->instr_msg().instr_type_id().instruction_type();
+  auto it = instr_type2trace_name_id.find(instr_type);
+  if (it == instr_type2trace_name_id.end()) {
+    it = instr_type2trace_name_id
+             .emplace(instr_type, profiler::InternTraceName(LookupInstrTypeName(instr_type)))
+             .first;
+  }
+  return it->second;
+}
+
 }  // namespace
 
 HashMap<std::type_index, const StreamType*>* StreamType4TypeIndex() {
@@ -42,6 +56,7 @@ const StreamTypeId& LookupInferStreamTypeId(const StreamTypeId& compute_stream_t
 }
 
 void StreamType::Run(Instruction* instruction) const {
+  OF_PROFILER_TRACE_GUARD(kVmInstruction, TraceNameId4Instruction(instruction), 0);
   const auto& stream_type_id = instruction->stream().stream_id().stream_type_id();
   auto interpret_type = stream_type_id.interpret_type();
   if (interpret_type == InterpretType::kCompute) {
@@ -65,6 +80,7 @@ void StreamType::Run(VirtualMachine* vm, InstructionMsg* instr_msg) const {
 }
 
 void StreamType::Run(VirtualMachine* vm, Instruction* instruction) const {
+  OF_PROFILER_TRACE_GUARD(kVmInstruction, TraceNameId4Instruction(instruction), 0);
   auto interpret_type = instruction->stream().stream_id().stream_type_id().interpret_type();
   if (interpret_type == InterpretType::kCompute) {
     Compute(vm, instruction);
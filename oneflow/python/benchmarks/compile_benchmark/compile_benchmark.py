@@ -0,0 +1,164 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+from __future__ import absolute_import, division, print_function
+
+"""
+Compile time of synthetic large CPU jobs. The generated graph has layers of width
+parallel dense branches joined by add_n with a residual connection, so the op count
+grows with layers * width. For each suite it reports the time to the first iteration
+and the slowest compile stages and job passes from compile_stats.json. The peak rss is
+that of the whole process, so every suite runs in a process of its own.
+
+    python3 compile_benchmark.py --suites=predict,train --layers=200 --width=4 \
+        --output_json=compile_benchmark.json
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import oneflow as flow
+import oneflow.typing as tp
+
+parser = argparse.ArgumentParser(description="flags for compile benchmark")
+parser.add_argument(
+    "--suites",
+    type=str,
+    default="predict,train",
+    help="comma separated suites of predict and train",
+)
+parser.add_argument("--layers", type=int, default=100, help="layers of the graph")
+parser.add_argument("--width", type=int, default=4, help="dense branches per layer")
+parser.add_argument("--hidden", type=int, default=16, help="units of each dense")
+parser.add_argument("--batch_size", type=int, default=8)
+parser.add_argument(
+    "--top_num", type=int, default=10, help="slowest stages printed per suite"
+)
+parser.add_argument(
+    "--work_dir", type=str, default=None, help="directory of the oneflow logs"
+)
+parser.add_argument("--output_json", type=str, default=None)
+args = parser.parse_args()
+
+
+def BuildGraph():
+    blob = flow.data.decode_random(
+        (args.hidden,), dtype=flow.float, batch_size=args.batch_size, name="source"
+    )
+    for layer in range(args.layers):
+        branches = [
+            flow.layers.dense(
+                blob,
+                args.hidden,
+                activation=flow.nn.relu,
+                name="dense_{}_{}".format(layer, branch),
+            )
+            for branch in range(args.width)
+        ]
+        blob = flow.math.add_n(branches + [blob], name="join_{}".format(layer))
+    return flow.math.reduce_mean(blob, name="loss")
+
+
+def RunSuite(suite):
+    flow.clear_default_session()
+    flow.config.cpu_device_num(1)
+    flow.config.compile_stats_report(True)
+    func_config = flow.FunctionConfig()
+    func_config.default_logical_view(flow.scope.consistent_view())
+
+    @flow.global_function(type=suite, function_config=func_config)
+    def BenchmarkJob() -> tp.Numpy:
+        with flow.scope.placement("cpu", "0:0"):
+            loss = BuildGraph()
+            if suite == "train":
+                flow.optimizer.SGD(
+                    flow.optimizer.PiecewiseConstantScheduler([], [0.001]), momentum=0
+                ).minimize(loss)
+            return loss
+
+    # the jobs are built and compiled at the first call
+    start = time.perf_counter()
+    BenchmarkJob()
+    seconds = time.perf_counter() - start
+    flow.clear_default_session()
+
+    with open(os.path.join(args.work_dir, "compile_stats.json")) as f:
+        compile_stats = json.load(f)
+    return {
+        "suite": suite,
+        "first_iter_seconds": seconds,
+        "peak_rss_bytes": compile_stats["peak_rss_bytes"],
+        "jobs": compile_stats["jobs"],
+        "stages": compile_stats["stages"],
+    }
+
+
+def RunSuiteInSubprocess(suite):
+    suite_args = dict(vars(args))
+    suite_args["suites"] = suite
+    suite_args["work_dir"] = os.path.join(args.work_dir, suite)
+    suite_args["output_json"] = os.path.join(args.work_dir, suite + "_result.json")
+    cmd = [sys.executable, os.path.abspath(__file__)]
+    cmd += ["--{}={}".format(key, value) for key, value in suite_args.items()]
+    subprocess.check_call(cmd)
+    with open(suite_args["output_json"]) as f:
+        return json.load(f)["results"][0]
+
+
+def main():
+    suites = [suite for suite in args.suites.split(",") if len(suite) > 0]
+    for suite in suites:
+        assert suite in ("predict", "train"), "unknown suite " + suite
+    if args.work_dir is None:
+        args.work_dir = tempfile.mkdtemp(prefix="compile_benchmark_")
+    os.makedirs(args.work_dir, exist_ok=True)
+    if len(suites) > 1:
+        # the suites print their own reports
+        results = [RunSuiteInSubprocess(suite) for suite in suites]
+        if args.output_json is not None:
+            with open(args.output_json, "w") as f:
+                json.dump({"args": vars(args), "results": results}, f, indent=2)
+        return
+    flow.env.log_dir(args.work_dir)
+    results = []
+    for suite in suites:
+        result = RunSuite(suite)
+        print(
+            "{}: {:.2f} seconds to the first iteration, peak rss {:.1f} MiB".format(
+                suite, result["first_iter_seconds"], result["peak_rss_bytes"] / 2 ** 20
+            )
+        )
+        for stage in result["stages"][: args.top_num]:
+            print(
+                "  {}: {:.3f} seconds in {} runs, peak rss +{:.1f} MiB".format(
+                    stage["stage_name"],
+                    stage["seconds"],
+                    stage["count"],
+                    stage["peak_rss_growth_bytes"] / 2 ** 20,
+                )
+            )
+        results.append(result)
+    if args.output_json is not None:
+        with open(args.output_json, "w") as f:
+            json.dump({"args": vars(args), "results": results}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
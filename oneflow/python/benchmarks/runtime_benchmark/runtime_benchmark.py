@@ -0,0 +1,280 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+from __future__ import absolute_import, division, print_function
+
+"""
+Throughput of the actor runtime and the data pipeline on synthetic CPU jobs whose
+kernels do almost no math. For each suite it reports iterations/sec, actor messages
+per iteration and per second from the runtime metrics, and the per-stage act latency
+from a short traced window.
+
+    python3 runtime_benchmark.py --suites=chain,diamond --depth=64 --width=4 \
+        --output_json=runtime_benchmark.json
+"""
+
+import argparse
+import json
+import os
+import struct
+import tempfile
+import time
+
+import numpy as np
+import oneflow as flow
+import oneflow.core.record.record_pb2 as record_pb
+import oneflow.typing as tp
+
+parser = argparse.ArgumentParser(description="flags for runtime benchmark")
+parser.add_argument(
+    "--suites",
+    type=str,
+    default="chain,diamond,decode_random,ofrecord",
+    help="comma separated suites of chain, diamond, decode_random and ofrecord",
+)
+parser.add_argument("--depth", type=int, default=32, help="depth of chain and diamond")
+parser.add_argument("--width", type=int, default=4, help="width of chain and diamond")
+parser.add_argument(
+    "--blob_shape",
+    type=str,
+    default="1",
+    help="shape of the blobs passed through chain and diamond, e.g. 16x16",
+)
+parser.add_argument("--batch_size", type=int, default=32, help="batch size of pipelines")
+parser.add_argument(
+    "--record_size", type=int, default=256, help="floats per record of pipelines"
+)
+parser.add_argument(
+    "--record_num", type=int, default=4096, help="records generated for ofrecord"
+)
+parser.add_argument(
+    "--data_part_num", type=int, default=4, help="part files generated for ofrecord"
+)
+parser.add_argument("--warmup_iters", type=int, default=20)
+parser.add_argument("--iters", type=int, default=200)
+parser.add_argument(
+    "--trace_iters", type=int, default=20, help="traced iterations for stage latency"
+)
+parser.add_argument(
+    "--work_dir", type=str, default=None, help="directory of generated files"
+)
+parser.add_argument("--output_json", type=str, default=None)
+args = parser.parse_args()
+
+
+def _Sink(blob):
+    return flow.math.reduce_sum(blob)
+
+
+def _BlobShape():
+    return tuple(int(dim) for dim in args.blob_shape.split("x"))
+
+
+def _Source():
+    return flow.data.decode_random(
+        _BlobShape(), dtype=flow.float, batch_size=1, name="source"
+    )
+
+
+def BuildChain():
+    # width independent chains of depth identity ops joined at the end
+    source = _Source()
+    tails = []
+    for w in range(args.width):
+        blob = source
+        for d in range(args.depth):
+            blob = flow.identity(blob, name="chain_{}_{}".format(w, d))
+        tails.append(blob)
+    return _Sink(flow.math.add_n(tails, name="join"))
+
+
+def BuildDiamond():
+    # depth levels, each fans out to width identity ops and joins them back
+    blob = _Source()
+    for d in range(args.depth):
+        branches = [
+            flow.identity(blob, name="diamond_{}_{}".format(d, w))
+            for w in range(args.width)
+        ]
+        blob = flow.math.add_n(branches, name="diamond_join_{}".format(d))
+    return _Sink(blob)
+
+
+def BuildDecodeRandom():
+    blob = flow.data.decode_random(
+        (args.record_size,), dtype=flow.float, batch_size=args.batch_size, name="reader"
+    )
+    return _Sink(flow.identity(blob, name="preprocess"))
+
+
+def BuildOFRecord():
+    ofrecord = flow.data.ofrecord_reader(
+        _OFRecordDir(),
+        batch_size=args.batch_size,
+        data_part_num=args.data_part_num,
+        name="reader",
+    )
+    blob = flow.data.OFRecordRawDecoder(
+        ofrecord, "x", shape=(args.record_size,), dtype=flow.float, name="decoder"
+    )
+    return _Sink(blob)
+
+
+def _OFRecordDir():
+    return os.path.join(args.work_dir, "ofrecord")
+
+
+def GenerateOFRecords():
+    data_dir = _OFRecordDir()
+    os.makedirs(data_dir, exist_ok=True)
+    records_per_part = (args.record_num + args.data_part_num - 1) // args.data_part_num
+    for part in range(args.data_part_num):
+        with open(os.path.join(data_dir, "part-{}".format(part)), "wb") as f:
+            for _ in range(records_per_part):
+                record = record_pb.OFRecord()
+                record.feature["x"].float_list.value.extend(
+                    np.random.rand(args.record_size).tolist()
+                )
+                serialized = record.SerializeToString()
+                f.write(struct.pack("q", len(serialized)))
+                f.write(serialized)
+
+
+def ParsePrometheusText(path):
+    name2samples = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if len(line) == 0 or line.startswith("#"):
+                continue
+            sample, value = line.rsplit(" ", 1)
+            name = sample.split("{", 1)[0]
+            name2samples.setdefault(name, []).append(float(value))
+    return name2samples
+
+
+def StageLatencies(trace_path):
+    with open(trace_path) as f:
+        events = json.load(f)["traceEvents"]
+    name2durations = {}
+    for event in events:
+        if event.get("ph") == "X" and event.get("cat") == "actor":
+            name2durations.setdefault(event["name"], []).append(event["dur"])
+    stages = []
+    for name, durations in sorted(name2durations.items()):
+        durations = np.array(durations, dtype=np.float64)
+        stages.append(
+            {
+                "name": name,
+                "act_cnt": int(durations.size),
+                "mean_us": float(durations.mean()),
+                "p50_us": float(np.percentile(durations, 50)),
+                "p99_us": float(np.percentile(durations, 99)),
+            }
+        )
+    return stages
+
+
+def RunSuite(suite, build_fn):
+    flow.clear_default_session()
+    flow.config.cpu_device_num(1)
+    metrics_path = os.path.join(args.work_dir, suite + ".prom")
+    trace_path = os.path.join(args.work_dir, suite + ".trace.json")
+    flow.config.metrics_export_path(metrics_path)
+    func_config = flow.FunctionConfig()
+    func_config.default_logical_view(flow.scope.consistent_view())
+
+    @flow.global_function(type="predict", function_config=func_config)
+    def BenchmarkJob() -> tp.Callback[tp.Numpy]:
+        with flow.scope.placement("cpu", "0:0"):
+            return build_fn()
+
+    def RunIters(iter_num):
+        for _ in range(iter_num):
+            BenchmarkJob()(lambda x: None)
+        flow.sync_default_session()
+
+    RunIters(args.warmup_iters)
+    start = time.perf_counter()
+    RunIters(args.iters)
+    seconds = time.perf_counter() - start
+    flow.profiler.clear_trace()
+    flow.profiler.start_tracing()
+    RunIters(args.trace_iters)
+    flow.profiler.stop_tracing()
+    flow.profiler.dump_chrome_trace(trace_path)
+    flow.profiler.clear_trace()
+    # the runtime writes the metrics a last time when it is destroyed
+    flow.clear_default_session()
+
+    name2samples = ParsePrometheusText(metrics_path)
+    total_iters = args.warmup_iters + args.iters + args.trace_iters
+    iters_per_sec = args.iters / seconds
+    msgs_per_iter = sum(name2samples.get("oneflow_thread_msg_total", [])) / total_iters
+    acts_per_iter = sum(name2samples.get("oneflow_actor_act_total", [])) / total_iters
+    return {
+        "suite": suite,
+        "iters": args.iters,
+        "seconds": seconds,
+        "iters_per_sec": iters_per_sec,
+        "actor_num": len(name2samples.get("oneflow_actor_act_total", [])),
+        "acts_per_iter": acts_per_iter,
+        "msgs_per_iter": msgs_per_iter,
+        "msgs_per_sec": msgs_per_iter * iters_per_sec,
+        "stages": StageLatencies(trace_path),
+    }
+
+
+def main():
+    suite2build_fn = {
+        "chain": BuildChain,
+        "diamond": BuildDiamond,
+        "decode_random": BuildDecodeRandom,
+        "ofrecord": BuildOFRecord,
+    }
+    suites = [suite for suite in args.suites.split(",") if len(suite) > 0]
+    for suite in suites:
+        assert suite in suite2build_fn, "unknown suite " + suite
+    if args.work_dir is None:
+        args.work_dir = tempfile.mkdtemp(prefix="runtime_benchmark_")
+    os.makedirs(args.work_dir, exist_ok=True)
+    if "ofrecord" in suites:
+        GenerateOFRecords()
+    results = []
+    for suite in suites:
+        result = RunSuite(suite, suite2build_fn[suite])
+        print(
+            "{}: {:.1f} iters/sec, {} actors, {:.1f} msgs/iter, {:.0f} msgs/sec".format(
+                suite,
+                result["iters_per_sec"],
+                result["actor_num"],
+                result["msgs_per_iter"],
+                result["msgs_per_sec"],
+            )
+        )
+        for stage in result["stages"]:
+            print(
+                "  {}: mean {:.1f} us, p50 {:.1f} us, p99 {:.1f} us".format(
+                    stage["name"], stage["mean_us"], stage["p50_us"], stage["p99_us"]
+                )
+            )
+        results.append(result)
+    if args.output_json is not None:
+        with open(args.output_json, "w") as f:
+            json.dump({"args": vars(args), "results": results}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -270,6 +270,24 @@ def use_rdma(val=True):
     sess.config_proto.resource.use_rdma = val
 
 
+@oneflow_export("config.use_shm_comm_net")
+def api_use_shm_comm_net(val: bool = True) -> None:
+    r"""Whether use shared memory to speed up data transmission between processes on the same
+          host or not. if not, then use normal epoll mode. It has no effect when rdma is used.
+
+    Args:
+        val (bool, optional):  Defaults to True.
+    """
+    return enable_if.unique([use_shm_comm_net, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def use_shm_comm_net(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.use_shm_comm_net = val
+
+
 @oneflow_export("config.thread_enable_local_message_queue")
 def api_thread_enable_local_message_queue(val: bool) -> None:
     """Whether or not enable thread using local  message queue.
@@ -391,8 +409,224 @@ def api_collect_act_event(val: bool = True) -> None:
 @enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
 def collect_act_event(val=True):
     sess = session_ctx.GetDefaultSession()
-    assert type(val) is int
-    sess.config_proto.profile_conf.collect_act_event = val
+    assert type(val) is bool
+    sess.config_proto.profiler_conf.collect_act_event = val
+
+
+@oneflow_export("config.act_event_sample_period")
+def api_act_event_sample_period(val: int) -> None:
+    r"""Collect the act event of every val-th act of each actor only, which keeps collecting
+    act events cheap enough for long running jobs. The experiment phase always collects all.
+
+    Args:
+        val (int): the sample period. Defaults to 1.
+    """
+    return enable_if.unique([act_event_sample_period, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def act_event_sample_period(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int and val >= 1
+    sess.config_proto.profiler_conf.act_event_sample_period = val
+
+
+@oneflow_export("config.metrics_export_path")
+def api_metrics_export_path(val: str) -> None:
+    r"""Periodically write the runtime metrics of actors, threads and comm net connections
+    to a file in the Prometheus text format. With several processes the file of each process
+    is suffixed by its rank.
+
+    Args:
+        val (str): path of the metrics file
+    """
+    return enable_if.unique([metrics_export_path, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def metrics_export_path(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is str
+    sess.config_proto.profiler_conf.metrics_export_path = val
+
+
+@oneflow_export("config.metrics_http_port")
+def api_metrics_http_port(val: int) -> None:
+    r"""Serve the runtime metrics in the Prometheus text format over http. The process of
+    rank r listens on port val + r of the address set by config.metrics_http_bind_address,
+    the loopback one by default.
+
+    Args:
+        val (int): the port of rank 0, 0 disables serving
+    """
+    return enable_if.unique([metrics_http_port, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def metrics_http_port(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int and val >= 0
+    sess.config_proto.profiler_conf.metrics_http_port = val
+
+
+@oneflow_export("config.metrics_http_bind_address")
+def api_metrics_http_bind_address(val: str) -> None:
+    r"""Set up the IPv4 address the metrics http server listens on. The requests are not
+    authenticated, so only use an address reachable from other machines, like "0.0.0.0",
+    on a trusted network.
+
+    Args:
+        val (str): the address. Defaults to "127.0.0.1".
+    """
+    return enable_if.unique([metrics_http_bind_address, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def metrics_http_bind_address(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is str
+    sess.config_proto.profiler_conf.metrics_http_bind_address = val
+
+
+@oneflow_export("config.metrics_export_interval_ms")
+def api_metrics_export_interval_ms(val: int) -> None:
+    r"""Set up the interval between two writes of the metrics file.
+
+    Args:
+        val (int): interval in milliseconds. Defaults to 10000.
+    """
+    return enable_if.unique([metrics_export_interval_ms, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def metrics_export_interval_ms(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int and val > 0
+    sess.config_proto.profiler_conf.metrics_export_interval_ms = val
+
+
+@oneflow_export("config.tune_regst_num")
+def api_tune_regst_num(val: bool = True) -> None:
+    r"""Whether or not tune register_num from the act events measured in this session. The tuned
+    register_num are dumped to regst_num_patch in the log dir when the session closes.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([tune_regst_num, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def tune_regst_num(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.profiler_conf.tune_regst_num = val
+
+
+@oneflow_export("config.regst_num_patch_path")
+def api_regst_num_patch_path(val: str) -> None:
+    r"""Set up the path of a register_num patch dumped by a session with tune_regst_num enabled.
+    The patch is applied to the same jobs before their memory is planned.
+
+    Args:
+        val (str): path of the patch file
+    """
+    return enable_if.unique([regst_num_patch_path, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def regst_num_patch_path(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is str
+    sess.config_proto.profiler_conf.regst_num_patch_path = val
+
+
+@oneflow_export("config.roofline_report")
+def api_roofline_report(val: bool = True) -> None:
+    r"""Whether or not write a per-op roofline table of each compiled job to roofline_<job_id>
+    in the log dir. It lists the FLOPs and bytes of every op on one of its devices with the time
+    estimated against the peaks set by config.roofline_device_peak.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([roofline_report, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def roofline_report(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.profiler_conf.roofline_report = val
+
+
+@oneflow_export("config.roofline_device_peak")
+def api_roofline_device_peak(device_tag: str, gflops: float, memory_gbps: float) -> None:
+    r"""Set up the peak compute and memory bandwidth of one device the roofline table is drawn
+    against.
+
+    Args:
+        device_tag (str): "cpu" or "gpu"
+        gflops (float): peak GFLOP/s
+        memory_gbps (float): peak memory bandwidth in GB/s
+    """
+    return enable_if.unique([roofline_device_peak, do_nothing])(
+        device_tag, gflops, memory_gbps
+    )
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def roofline_device_peak(device_tag, gflops, memory_gbps):
+    sess = session_ctx.GetDefaultSession()
+    assert device_tag in ("cpu", "gpu")
+    assert gflops > 0 and memory_gbps > 0
+    profiler_conf = sess.config_proto.profiler_conf
+    setattr(profiler_conf, "roofline_{}_peak_gflops".format(device_tag), float(gflops))
+    setattr(
+        profiler_conf,
+        "roofline_{}_peak_memory_gbps".format(device_tag),
+        float(memory_gbps),
+    )
+
+
+@oneflow_export("config.memory_report")
+def api_memory_report(val: bool = True, top_num: int = 20) -> None:
+    r"""Whether or not write the memory timeline of the merged plan to memory_report.json and
+    memory_report.html in the log dir. For each device and job it lists the bytes of live regsts
+    at every topological step, and the top_num regsts live at the peak.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+        top_num (int, optional): number of contributors listed. Defaults to 20.
+    """
+    return enable_if.unique([memory_report, do_nothing])(val=val, top_num=top_num)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def memory_report(val=True, top_num=20):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    assert type(top_num) is int and top_num > 0
+    sess.config_proto.profiler_conf.memory_report = val
+    sess.config_proto.profiler_conf.memory_report_top_num = top_num
+
+
+@oneflow_export("config.compile_stats_report")
+def api_compile_stats_report(val: bool = True) -> None:
+    r"""Whether or not write the wall time and memory growth of the compile stages and job passes
+    of every job to compile_stats.json in the log dir.
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([compile_stats_report, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def compile_stats_report(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.profiler_conf.compile_stats_report = val
 
 
 @oneflow_export("config.collective_boxing.enable_fusion")
@@ -430,6 +664,41 @@ def num_callback_threads(val):
     sess.config_proto.resource.collective_boxing_conf.num_callback_threads = val
 
 
+@oneflow_export("config.collective_boxing.enable_gradient_bucketing")
+def api_enable_gradient_bucketing(val: bool = True) -> None:
+    r"""Whether or not launch the all-reduces of gradients in buckets of bounded size,
+            in the order backward produces the gradients, to overlap them with backward
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([enable_gradient_bucketing, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def enable_gradient_bucketing(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.enable_gradient_bucketing = val
+
+
+@oneflow_export("config.collective_boxing.gradient_bucket_size_mb")
+def api_gradient_bucket_size_mb(val: int) -> None:
+    r"""Set up the size of the buckets of gradients
+
+    Args:
+        val (int): int number, e.g. 25(mb)
+    """
+    return enable_if.unique([gradient_bucket_size_mb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def gradient_bucket_size_mb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.gradient_bucket_size_mb = val
+
+
 @oneflow_export("config.enable_tensor_float_32_compute")
 def api_enable_tensor_float_32_compute(val: bool = True) -> None:
     r"""Whether or not to enable Tensor-float-32 on supported GPUs
@@ -481,6 +750,78 @@ def disable_group_boxing_by_dst_parallel(val=False):
     sess.config_proto.resource.disable_group_boxing_by_dst_parallel = val
 
 
+@oneflow_export("config.plan_cache_dir")
+def api_plan_cache_dir(val: str) -> None:
+    r"""Set up the directory where compiled plans are cached. Jobs identical to a cached one
+    skip compilation on the next session start. Empty string disables the cache.
+
+    Args:
+        val (str): path of the cache directory
+    """
+    return enable_if.unique([plan_cache_dir, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def plan_cache_dir(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is str
+    sess.config_proto.resource.plan_cache_dir = val
+
+
+@oneflow_export("config.plan_distribution.enable_compression")
+def api_plan_distribution_enable_compression(val: bool = True) -> None:
+    r"""Whether or not compress the plan with lz4 while distributing it to other machines
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([plan_distribution_enable_compression, do_nothing])(val=val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def plan_distribution_enable_compression(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.plan_distribution_conf.enable_compression = val
+
+
+@oneflow_export("config.plan_distribution.chunk_kbyte")
+def api_plan_distribution_chunk_kbyte(val: int) -> None:
+    r"""Set up the size of the chunks the plan is split into while distributing it
+
+    Args:
+        val (int): int number, e.g. 1024(kbyte)
+    """
+    return enable_if.unique([plan_distribution_chunk_kbyte, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def plan_distribution_chunk_kbyte(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val > 0
+    sess.config_proto.resource.plan_distribution_conf.chunk_kbyte = val
+
+
+@oneflow_export("config.plan_distribution.relay_fanout")
+def api_plan_distribution_relay_fanout(val: int) -> None:
+    r"""Set up the fanout of the tree in which workers relay the parts of the plan shared by
+    all machines, 0 to let all workers pull them from the master
+
+    Args:
+        val (int): int number, e.g. 4
+    """
+    return enable_if.unique([plan_distribution_relay_fanout, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def plan_distribution_relay_fanout(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val >= 0
+    sess.config_proto.resource.plan_distribution_conf.relay_fanout = val
+
+
 @oneflow_export("config.collective_boxing.nccl_num_streams")
 def api_nccl_num_streams(val: int) -> None:
     r"""Set up the number of nccl parallel streams while use boxing
@@ -670,6 +1011,78 @@ def nccl_enable_mixed_fusion(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_enable_mixed_fusion = val
 
 
+@oneflow_export("config.collective_boxing.nccl_enable_hierarchical_all_reduce")
+def api_nccl_enable_hierarchical_all_reduce(val: bool) -> None:
+    r"""Whether or not all-reduce across machines hierarchically: reduce-scatter inside
+    each machine, all-reduce across machines, then all-gather inside each machine
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([nccl_enable_hierarchical_all_reduce, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def nccl_enable_hierarchical_all_reduce(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.nccl_enable_hierarchical_all_reduce = (
+        val
+    )
+
+
+@oneflow_export("config.collective_boxing.cpu_enable")
+def api_cpu_enable_collective_boxing(val: bool = True) -> None:
+    r"""Whether or not use collective boxing between cpu devices instead of naive boxing
+
+    Args:
+        val (bool, optional): True or False. Defaults to True.
+    """
+    return enable_if.unique([cpu_enable_collective_boxing, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_enable_collective_boxing(val=True):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.cpu_enable = val
+
+
+@oneflow_export("config.collective_boxing.cpu_enable_recursive_halving")
+def api_cpu_enable_recursive_halving(val: bool) -> None:
+    r"""Whether or not use recursive halving/doubling instead of ring between machines
+        when the number of machines is a power of 2
+
+    Args:
+        val (bool): True or False
+    """
+    return enable_if.unique([cpu_enable_recursive_halving, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_enable_recursive_halving(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.collective_boxing_conf.cpu_enable_recursive_halving = val
+
+
+@oneflow_export("config.collective_boxing.cpu_fusion_threshold_mb")
+def api_cpu_fusion_threshold_mb(val: int) -> None:
+    r"""Set up the total size of cpu collective boxing requests launched together
+
+    Args:
+        val (int): int number, e.g. 10(mb)
+    """
+    return enable_if.unique([cpu_fusion_threshold_mb, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def cpu_fusion_threshold_mb(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.collective_boxing_conf.cpu_fusion_threshold_mb = val
+
+
 @enable_if.condition(hob.in_normal_mode & hob.session_initialized)
 def do_nothing(*args, **kwargs):
     print("Nothing happened because the session is running")
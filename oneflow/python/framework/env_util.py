@@ -157,6 +157,24 @@ def data_port(val):
     default_env_proto.data_port = val
 
 
+@oneflow_export("env.ctrl_tree_fanout")
+def api_ctrl_tree_fanout(val: int) -> None:
+    r"""Set the fanout of the tree in which machines meet at barriers and relay broadcast values.
+    0 to let all machines meet at the master. Same on every machine.
+
+    Args:
+        val: a non-negative int, e.g. 8
+    """
+    return enable_if.unique([ctrl_tree_fanout, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.env_initialized)
+def ctrl_tree_fanout(val):
+    assert type(val) is int
+    assert val >= 0
+    default_env_proto.ctrl_tree_fanout = val
+
+
 @oneflow_export("env.grpc_use_no_signal")
 @oneflow_deprecate()
 def api_grpc_use_no_signal(val: bool = True) -> None:
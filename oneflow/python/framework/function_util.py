@@ -356,10 +356,37 @@ def policy_time_line(func_desc):
     return "use_time_line_algo"
 
 
+@oneflow_function_config("static_mem_alloc_policy_white_list.policy_lifetime_best_fit")
+def policy_lifetime_best_fit(func_desc):
+    r"""A static memory allocation policy called: lifetime_best_fit
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_lifetime_best_fit_algo"
+
+
+@oneflow_function_config("static_mem_alloc_local_search_time_limit_ms")
+def set_static_mem_alloc_local_search_time_limit_ms(func_desc, value):
+    r"""Set the time limit of local search refining the static memory allocation of each
+        memory chain, 0 means no local search
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    conf = func_desc.job_config_proto.mutable_memory_allocation_algorithm_conf()
+    conf.set_local_search_time_limit_ms(value)
+
+
 @oneflow_function_config("static_mem_alloc_algo_white_list.show")
 def show_static_mem_alloc_algo_white_list(func_desc):
     r"""Show configuration of  static memory allocation policy,
-          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo"
+          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo",
+          "use_lifetime_best_fit_algo"
 
     Args:
         func_desc ([type]): [description]
@@ -371,6 +398,7 @@ def show_static_mem_alloc_algo_white_list(func_desc):
         "use_mem_size_first_algo",
         "use_mutual_exclusion_first_algo",
         "use_time_line_algo",
+        "use_lifetime_best_fit_algo",
     ]
 
 
@@ -588,13 +616,15 @@ def set_all_reduce_fp16(func_desc, value=True):
     "train.optimizer_placement_optimization_mode",
 )
 def set_optimizer_placement_optimization_mode(func_desc, mode):
-    r"""Enable optimizer_placement_optimization with mode 'mode'
+    r"""Enable optimizer_placement_optimization with mode 'mode'.
+            'fully_sharded' also keeps the variables split across the devices and gathers
+            them just before their forward and backward consumers
 
     Args:
         func_desc ([type]): [description]
         mode (str): [description].
     """
-    assert mode in ["non_distributed", "distributed_split"]
+    assert mode in ["non_distributed", "distributed_split", "fully_sharded"]
     func_desc.job_config_proto.set_optimizer_placement_optimization_mode(mode)
 
 
@@ -606,6 +636,57 @@ def set_optimizer_placement_optimization_threshold(func_desc, value):
     func_desc.job_config_proto.set_optimizer_placement_optimization_threshold(value)
 
 
+@oneflow_function_config(
+    "auto_checkpointing_memory_budget_mbyte",
+    "train.auto_checkpointing_memory_budget_mbyte",
+)
+def set_auto_checkpointing_memory_budget_mbyte(func_desc, value):
+    r"""Set the memory budget of each device in MB, forward ops chosen automatically are
+        recomputed in backward until the job is estimated to fit into it. 0 disables it
+
+    Args:
+        func_desc ([type]): [description]
+        value (int): memory budget in MB
+    """
+    func_desc.job_config_proto.set_auto_checkpointing_memory_budget_mbyte(value)
+
+
+@oneflow_function_config("enable_auto_parallel")
+def set_enable_auto_parallel(func_desc, value=True):
+    r"""Whether search sbp signatures of all ops by an estimated cost of the whole job or not
+
+    Args:
+        func_desc ([type]): [description]
+        value (bool, optional): [description]. Defaults to True.
+    """
+    func_desc.job_config_proto.mutable_auto_parallel_conf().set_enable(value)
+
+
+@oneflow_function_config("auto_parallel_device_gflops")
+def set_auto_parallel_device_gflops(func_desc, value):
+    r"""Set the device compute throughput in GFLOPS the auto parallel cost model assumes
+
+    Args:
+        func_desc ([type]): [description]
+        value (float): [description]
+    """
+    func_desc.job_config_proto.mutable_auto_parallel_conf().set_device_gflops(value)
+
+
+@oneflow_function_config("auto_parallel_bandwidth_gbyte_per_sec")
+def set_auto_parallel_bandwidth_gbyte_per_sec(func_desc, intra_node, inter_node):
+    r"""Set the bandwidth in GB/s the auto parallel cost model assumes for boxing
+
+    Args:
+        func_desc ([type]): [description]
+        intra_node (float): bandwidth between devices of the same machine
+        inter_node (float): bandwidth between machines
+    """
+    conf = func_desc.job_config_proto.mutable_auto_parallel_conf()
+    conf.set_intra_node_bandwidth_gbyte_per_sec(intra_node)
+    conf.set_inter_node_bandwidth_gbyte_per_sec(inter_node)
+
+
 @oneflow_function_config("enable_non_distributed_optimizer")
 def set_enable_non_distributed_optimizer(func_desc, value=True):
     r"""Whether enable non_distributed optimizer or not
@@ -801,6 +882,34 @@ def set_indexed_slices_optimizer_conf(func_desc, value):
     pb_util.PythonDict2CFG(value, pb_msg)
 
 
+@oneflow_function_config("gradient_compression_conf")
+def set_gradient_compression_conf(func_desc, value):
+    r"""Set how gradients are compressed before they are all-reduced in data parallel training,
+            e.g. {"enable_fp16": True, "top_k_include_op_names": {"op_name": ["embedding"]}, "top_k_ratio": 0.01}
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    assert type(value) is dict
+    pb_msg = func_desc.job_config_proto.mutable_gradient_compression_conf()
+    pb_util.PythonDict2CFG(value, pb_msg)
+
+
+@oneflow_function_config("pipeline_parallel_conf")
+def set_pipeline_parallel_conf(func_desc, value):
+    r"""Set how the ops placed with the loss are split into pipeline stages,
+            e.g. {"stage_num": 4, "micro_batch_num": 8}
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    assert type(value) is dict
+    pb_msg = func_desc.job_config_proto.mutable_pipeline_parallel_conf()
+    pb_util.PythonDict2CFG(value, pb_msg)
+
+
 @oneflow_function_config("enable_fuse_model_update_ops")
 def set_enable_fuse_model_update_ops(func_desc, value=True):
     r"""Whether enable fuse_model_update_ops.
@@ -0,0 +1,60 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+from __future__ import absolute_import
+
+from oneflow.python.oneflow_export import oneflow_export
+import oneflow_api
+
+
+@oneflow_export("profiler.start_tracing")
+def start_tracing() -> None:
+    r"""Start recording kernel, actor, regst, vm instruction and comm net events
+    into per-thread ring buffers. Tracing can also be enabled at startup by
+    setting the environment variable ONEFLOW_PROFILER_TRACE=1.
+    """
+    oneflow_api.profiler.EnableTracing()
+
+
+@oneflow_export("profiler.stop_tracing")
+def stop_tracing() -> None:
+    r"""Stop recording events. The events recorded so far are kept for dumping.
+    """
+    oneflow_api.profiler.DisableTracing()
+
+
+@oneflow_export("profiler.is_tracing")
+def is_tracing() -> bool:
+    return oneflow_api.profiler.IsTracingEnabled()
+
+
+@oneflow_export("profiler.clear_trace")
+def clear_trace() -> None:
+    r"""Drop the events recorded so far.
+    """
+    oneflow_api.profiler.ClearTraceEvents()
+
+
+@oneflow_export("profiler.dump_chrome_trace")
+def dump_chrome_trace(path: str) -> None:
+    r"""Write the recorded events of this process to `path` in the Chrome trace
+    event format, which can be opened by chrome://tracing or ui.perfetto.dev.
+    Each ring buffer keeps the latest ONEFLOW_PROFILER_TRACE_BUFFER_SIZE events
+    (65536 by default) of its thread.
+
+    Args:
+        path (str): The json file to write.
+    """
+    oneflow_api.profiler.DumpChromeTrace(path)
@@ -0,0 +1,81 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+import oneflow as flow
+from test_util import GenArgList
+import oneflow.typing as oft
+
+
+def _test_cpu_collective_boxing(
+    test_case, src, dst, placement, recursive_halving,
+):
+    flow.clear_default_session()
+    flow.config.cpu_device_num(2)
+    flow.config.collective_boxing.cpu_enable(True)
+    flow.config.collective_boxing.cpu_enable_recursive_halving(recursive_halving)
+    func_config = flow.FunctionConfig()
+    func_config.default_data_type(flow.float)
+    func_config.default_logical_view(flow.scope.consistent_view())
+
+    def Distribute(blob, sbp):
+        if sbp == "S":
+            return blob.with_distribute(flow.distribute.split(0))
+        elif sbp == "B":
+            return blob.with_distribute(flow.distribute.broadcast())
+        else:
+            # reduce_sum over the split axis makes a partial sum
+            blob = flow.identity(blob.with_distribute(flow.distribute.split(0)))
+            return flow.math.reduce_sum(blob, axis=0)
+
+    @flow.global_function(function_config=func_config)
+    def cpu_collective_boxing_job(x: oft.Numpy.Placeholder((32, 32, 16))):
+        with flow.scope.placement("cpu", placement):
+            src_blob = flow.identity(Distribute(x, src))
+            dst_blob = flow.identity(Distribute(src_blob, dst))
+        return dst_blob
+
+    x = np.random.uniform(-1e-2, 1e-2, (32, 32, 16)).astype(np.float32)
+    y = cpu_collective_boxing_job(x).get().numpy()
+    expected = np.sum(x, axis=0) if src == "P" else x
+    test_case.assertTrue(np.allclose(expected, y, atol=1e-5))
+
+
+def _test_all(test_case, placement):
+    arg_dict = OrderedDict()
+    # P->B all reduce, P->S reduce scatter, S->B all gather
+    arg_dict["src_dst"] = [("P", "B"), ("P", "S"), ("S", "B")]
+    arg_dict["recursive_halving"] = [True, False]
+    for (src_dst, recursive_halving) in GenArgList(arg_dict):
+        _test_cpu_collective_boxing(test_case, *src_dst, placement, recursive_halving)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestCpuCollectiveBoxing1n(flow.unittest.TestCase):
+    def test_cpu_collective_boxing(test_case):
+        _test_all(test_case, "0:0-1")
+
+
+@flow.unittest.skip_unless_2n1d()
+class TestCpuCollectiveBoxing2n(flow.unittest.TestCase):
+    def test_cpu_collective_boxing(test_case):
+        _test_all(test_case, ["0:0-1", "1:0-1"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,111 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+import oneflow as flow
+import oneflow.typing as oft
+from oneflow.python.framework import c_api_util
+
+# ops through which the optimizer may read a gradient after its all-reduce
+_DIFF_FORWARDING_OP_TYPE_NAMES = ["cast_to_static_shape", "parallel_cast", "identity"]
+
+
+def _SoleInput(op_conf, arg_name):
+    return op_conf.user_conf.input[arg_name].s[0]
+
+
+# the bucket id of the all-reduced gradient of every variable
+def _VariableName2BucketId(job):
+    lbn2bucket_id = job.helper.lbn2gradient_bucket_id
+    lbn2producer = {}
+    for op_conf in job.net.op:
+        if op_conf.HasField("user_conf"):
+            for output in op_conf.user_conf.output.values():
+                for lbn in output.s:
+                    lbn2producer[lbn] = op_conf
+    variable_name2bucket_id = {}
+    for op_conf in job.net.op:
+        if not op_conf.HasField("user_conf"):
+            continue
+        if op_conf.user_conf.op_type_name != "sgd_update":
+            continue
+        lbn = _SoleInput(op_conf, "model_diff")
+        while lbn not in lbn2bucket_id:
+            producer = lbn2producer[lbn]
+            assert producer.user_conf.op_type_name in _DIFF_FORWARDING_OP_TYPE_NAMES
+            lbn = _SoleInput(producer, "in")
+        variable_name = _SoleInput(op_conf, "model").split("/")[0]
+        variable_name2bucket_id[variable_name] = lbn2bucket_id[lbn]
+    return variable_name2bucket_id
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestGradientBucketing(flow.unittest.TestCase):
+    def test_bucket_assignment(test_case):
+        bucket_size_mb = 1
+        flow.clear_default_session()
+        flow.config.gpu_device_num(2)
+        flow.config.collective_boxing.enable_gradient_bucketing(True)
+        flow.config.collective_boxing.gradient_bucket_size_mb(bucket_size_mb)
+        func_config = flow.FunctionConfig()
+        func_config.default_logical_view(flow.scope.consistent_view())
+        # the variables of 512KB, 768KB, 960KB and 1120KB are told apart by their sizes
+        dims = [256, 512, 384, 640, 448]
+        variable_shapes = [(dims[i], dims[i + 1]) for i in range(len(dims) - 1)]
+
+        @flow.global_function(type="train", function_config=func_config)
+        def Mlp(x: oft.Numpy.Placeholder((8, dims[0]))) -> oft.Numpy:
+            with flow.scope.placement("gpu", "0:0-1"):
+                hidden = flow.parallel_cast(x, distribute=flow.distribute.split(0))
+                for i, shape in enumerate(variable_shapes):
+                    w = flow.get_variable(
+                        "w{}".format(i),
+                        shape,
+                        initializer=flow.random_uniform_initializer(-0.1, 0.1),
+                    )
+                    hidden = flow.math.tanh(flow.matmul(hidden, w))
+                loss = flow.math.reduce_mean(hidden)
+                flow.optimizer.SGD(
+                    flow.optimizer.PiecewiseConstantScheduler([], [0.1]), momentum=0
+                ).minimize(loss)
+                return loss
+
+        Mlp(np.ones((8, dims[0]), dtype=np.float32))
+        jobs = c_api_util.GetJobSet().job
+        job = [job for job in jobs if job.job_conf.job_name == "Mlp"][0]
+        variable_name2bucket_id = _VariableName2BucketId(job)
+        bucket_ids = [
+            variable_name2bucket_id["w{}".format(i)]
+            for i in range(len(variable_shapes))
+        ]
+        # backward produces the gradient of the last layer first, it goes to bucket 0
+        test_case.assertEqual(bucket_ids[-1], 0)
+        for i in range(len(bucket_ids) - 1):
+            test_case.assertGreaterEqual(bucket_ids[i], bucket_ids[i + 1])
+        # a bucket is closed once the next gradient does not fit into it
+        bucket_id2byte_sizes = {}
+        for bucket_id, shape in zip(bucket_ids, variable_shapes):
+            bucket_id2byte_sizes.setdefault(bucket_id, []).append(np.prod(shape) * 4)
+        bucket_byte_size = bucket_size_mb * 1024 * 1024
+        for byte_sizes in bucket_id2byte_sizes.values():
+            if len(byte_sizes) > 1:
+                test_case.assertLessEqual(sum(byte_sizes), bucket_byte_size)
+        # no two of the variables fit into one bucket
+        test_case.assertEqual(len(bucket_id2byte_sizes), len(variable_shapes))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,74 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+import oneflow as flow
+import oneflow.typing as oft
+
+
+def _train_toy_model(gradient_compression_conf, iters=200):
+    flow.clear_default_session()
+    flow.config.gpu_device_num(2)
+    func_config = flow.FunctionConfig()
+    func_config.default_logical_view(flow.scope.consistent_view())
+    if gradient_compression_conf is not None:
+        func_config.gradient_compression_conf(gradient_compression_conf)
+
+    @flow.global_function(type="train", function_config=func_config)
+    def Train(
+        x: oft.Numpy.Placeholder((64, 16)), y: oft.Numpy.Placeholder((64, 1))
+    ) -> oft.Numpy:
+        w = flow.get_variable(
+            "w", (16, 1), initializer=flow.constant_initializer(0), trainable=True
+        )
+        loss = flow.math.reduce_mean(flow.math.square(flow.matmul(x, w) - y))
+        flow.optimizer.SGD(
+            flow.optimizer.PiecewiseConstantScheduler([], [0.1]), momentum=0
+        ).minimize(loss)
+        return loss
+
+    rng = np.random.RandomState(0)
+    w_true = rng.rand(16, 1).astype(np.float32)
+    losses = []
+    for _ in range(iters):
+        x = rng.rand(64, 16).astype(np.float32)
+        losses.append(Train(x, np.matmul(x, w_true)).mean())
+    return losses
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestGradientCompression(flow.unittest.TestCase):
+    def test_fp16(test_case):
+        ref_losses = _train_toy_model(None)
+        losses = _train_toy_model({"enable_fp16": True})
+        test_case.assertLess(losses[-1], 1e-2)
+        test_case.assertTrue(np.allclose(losses, ref_losses, rtol=1e-2, atol=1e-3))
+
+    def test_top_k(test_case):
+        losses = _train_toy_model(
+            {
+                "enable_fp16": False,
+                "top_k_include_op_names": {"op_name": ["w"]},
+                "top_k_ratio": 0.25,
+            },
+            iters=400,
+        )
+        test_case.assertLess(losses[-1], 1e-2)
+        test_case.assertLess(losses[-1], losses[0] / 100)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -17,6 +17,7 @@ import unittest
 import numpy as np
 import oneflow as flow
 import oneflow.typing as oft
+from oneflow.python.framework import c_api_util
 
 
 def _test(test_case, mode):
@@ -38,6 +39,66 @@ def _test(test_case, mode):
     Foo(np.ones((2, 1024 * 1024), dtype=np.float32))
 
 
+def _train_mlp(mode, init_vars, x, iter_num):
+    flow.clear_default_session()
+    flow.config.gpu_device_num(2)
+    func_config = flow.FunctionConfig()
+    func_config.default_logical_view(flow.scope.consistent_view())
+    if mode is not None:
+        func_config.optimizer_placement_optimization_mode(mode)
+        func_config.optimizer_placement_optimization_threshold(1)
+
+    @flow.global_function(type="train", function_config=func_config)
+    def Mlp(x: oft.Numpy.Placeholder(x.shape)) -> oft.Numpy:
+        with flow.scope.placement("gpu", "0:0-1"):
+            hidden = x
+            for name in sorted(init_vars.keys()):
+                w = flow.get_variable(
+                    name, init_vars[name].shape, initializer=flow.zeros_initializer()
+                )
+                hidden = flow.math.tanh(flow.matmul(hidden, w))
+            loss = flow.math.reduce_mean(hidden * hidden)
+            flow.optimizer.SGD(
+                flow.optimizer.PiecewiseConstantScheduler([], [0.1]), momentum=0
+            ).minimize(loss)
+            return loss
+
+    flow.load_variables(init_vars)
+    losses = [Mlp(x) for _ in range(iter_num)]
+    variables = {name: blob.numpy() for name, blob in flow.get_all_variables().items()}
+    job = [job for job in c_api_util.GetJobSet().job if job.job_conf.job_name == "Mlp"]
+    return losses, variables, job[0]
+
+
+def _test_fully_sharded(test_case):
+    rng = np.random.RandomState(0)
+    init_vars = {
+        "w0": rng.uniform(-0.5, 0.5, (32, 64)).astype(np.float32),
+        "w1": rng.uniform(-0.5, 0.5, (64, 16)).astype(np.float32),
+    }
+    x = rng.uniform(-1, 1, (8, 32)).astype(np.float32)
+    losses, variables, _ = _train_mlp(None, init_vars, x, 3)
+    sharded_losses, sharded_variables, sharded_job = _train_mlp(
+        "fully_sharded", init_vars, x, 3
+    )
+    for loss, sharded_loss in zip(losses, sharded_losses):
+        test_case.assertTrue(np.allclose(loss, sharded_loss, rtol=1e-4, atol=1e-5))
+    for name in init_vars.keys():
+        test_case.assertTrue(
+            np.allclose(variables[name], sharded_variables[name], rtol=1e-4, atol=1e-5)
+        )
+    # every variable is kept split and read by its consumers through a gather
+    op_name2op_conf = {op_conf.name: op_conf for op_conf in sharded_job.net.op}
+    for name in init_vars.keys():
+        variable_conf = op_name2op_conf[name].variable_conf
+        test_case.assertTrue(variable_conf.HasField("split_axis"))
+        test_case.assertEqual(variable_conf.split_axis.value, 0)
+        gather_prefix = "System-ParameterSharding-Gather-" + name
+        test_case.assertTrue(
+            any(op_name.startswith(gather_prefix) for op_name in op_name2op_conf)
+        )
+
+
 @flow.unittest.skip_unless_1n2d()
 class TestOptimizerPlacementOptimization(flow.unittest.TestCase):
     def test_non_distributed(test_case):
@@ -46,6 +107,9 @@ class TestOptimizerPlacementOptimization(flow.unittest.TestCase):
     def test_distributed_split(test_case):
         _test(test_case, "distributed_split")
 
+    def test_fully_sharded(test_case):
+        _test_fully_sharded(test_case)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,137 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import glob
+import os
+import unittest
+import numpy as np
+import oneflow as flow
+import oneflow.typing as oft
+from oneflow.python.framework import c_api_util
+from oneflow.python.framework import env_util
+
+
+def _train_mlp(pipeline_parallel_conf, init_vars, x, iter_num):
+    flow.clear_default_session()
+    flow.config.cpu_device_num(2)
+    func_config = flow.FunctionConfig()
+    func_config.default_logical_view(flow.scope.consistent_view())
+    if pipeline_parallel_conf is not None:
+        func_config.pipeline_parallel_conf(pipeline_parallel_conf)
+
+    @flow.global_function(type="train", function_config=func_config)
+    def Mlp(x: oft.Numpy.Placeholder(x.shape)) -> oft.Numpy:
+        with flow.scope.placement("cpu", "0:0-1"):
+            hidden = x
+            for name in sorted(init_vars.keys()):
+                w = flow.get_variable(
+                    name, init_vars[name].shape, initializer=flow.zeros_initializer()
+                )
+                hidden = flow.math.tanh(flow.matmul(hidden, w, name=name + "_matmul"))
+            # one loss per sample, so the losses of the micro-batches are packed back
+            loss = flow.math.reduce_mean(hidden * hidden, axis=1, name="loss")
+            flow.optimizer.SGD(
+                flow.optimizer.PiecewiseConstantScheduler([], [0.1]), momentum=0
+            ).minimize(loss)
+            return loss
+
+    flow.load_variables(init_vars)
+    losses = [Mlp(x) for _ in range(iter_num)]
+    variables = {name: blob.numpy() for name, blob in flow.get_all_variables().items()}
+    job = [job for job in c_api_util.GetJobSet().job if job.job_conf.job_name == "Mlp"]
+    return losses, variables, job[0]
+
+
+def _ParseReport(path):
+    bubble_fraction = None
+    stages = []
+    with open(path) as f:
+        for line in f:
+            words = line.split()
+            if words[0] == "stage_num":
+                bubble_fraction = float(
+                    words[words.index("predicted_bubble_fraction") + 1]
+                )
+            elif words[0] == "stage":
+                stages.append(
+                    {
+                        "devices": words[words.index("devices") + 1],
+                        "first_op": words[words.index("first_op") + 1],
+                        "time": float(words[words.index("time_per_micro_batch") + 1]),
+                    }
+                )
+    return bubble_fraction, stages
+
+
+def _DeviceNames4OpName(job, op_name):
+    for placement_group in job.placement.placement_group:
+        if op_name in placement_group.op_set.op_name:
+            return list(placement_group.parallel_conf.device_name)
+    return None
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestPipelineParallel(flow.unittest.TestCase):
+    def test_two_stage_cpu_pipeline(test_case):
+        rng = np.random.RandomState(0)
+        init_vars = {
+            "w{}".format(i): rng.uniform(-0.5, 0.5, (16, 16)).astype(np.float32)
+            for i in range(4)
+        }
+        x = rng.uniform(-1, 1, (8, 16)).astype(np.float32)
+        losses, variables, _ = _train_mlp(None, init_vars, x, 3)
+        micro_batch_num = 2
+        pipelined_losses, pipelined_variables, pipelined_job = _train_mlp(
+            {"stage_num": 2, "micro_batch_num": micro_batch_num}, init_vars, x, 3
+        )
+        for loss, pipelined_loss in zip(losses, pipelined_losses):
+            test_case.assertTrue(
+                np.allclose(loss, pipelined_loss, rtol=1e-4, atol=1e-5)
+            )
+        for name in init_vars.keys():
+            test_case.assertTrue(
+                np.allclose(
+                    variables[name], pipelined_variables[name], rtol=1e-4, atol=1e-5
+                )
+            )
+
+        log_dir = env_util.default_env_proto.cpp_logging_conf.log_dir
+        report_pattern = os.path.join(log_dir, "pipeline_parallel_report_job_*")
+        report_paths = glob.glob(report_pattern)
+        test_case.assertTrue(len(report_paths) > 0)
+        report_path = max(report_paths, key=os.path.getmtime)
+        bubble_fraction, stages = _ParseReport(report_path)
+        # each stage runs on one of the devices, the first and the last ops are in the
+        # first and the last stages
+        test_case.assertEqual([stage["devices"] for stage in stages], ["0:0", "0:1"])
+        for stage in stages:
+            test_case.assertEqual(
+                _DeviceNames4OpName(pipelined_job, stage["first_op"]),
+                [stage["devices"]],
+            )
+        test_case.assertEqual(_DeviceNames4OpName(pipelined_job, "w0_matmul"), ["0:0"])
+        test_case.assertEqual(_DeviceNames4OpName(pipelined_job, "loss"), ["0:1"])
+        # the bubble of a GPipe schedule with the reported stage times
+        times = [stage["time"] for stage in stages]
+        iteration_time = sum(times) + (micro_batch_num - 1) * max(times)
+        expected_bubble_fraction = 1 - micro_batch_num * sum(times) / (
+            len(times) * iteration_time
+        )
+        test_case.assertTrue(0 <= bubble_fraction < 1)
+        test_case.assertAlmostEqual(bubble_fraction, expected_bubble_fraction, places=4)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,467 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/device/cpu_device_context.h"
+#include "oneflow/core/framework/user_op_conf.h"
+#include "oneflow/core/framework/user_op_registry_manager.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
+#include "oneflow/core/kernel/kernel.h"
+#include "oneflow/core/operator/operator.h"
+#include "oneflow/core/register/register_desc.h"
+#include "oneflow/core/register/runtime_blob_desc.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+const std::string kBenchmarkOpName = "oneflow_benchmark";
+
+// One benchmark case is an op type with the specs of its synthetic inputs and its attrs.
+//   inputs: "arg:dtype:shape[:low,high];..." e.g. "a:kFloat:64x256;b:kFloat:256x128"
+//   attrs:  "name=value;..." e.g. "transpose_a=false;transpose_b=false", lists are comma separated
+struct BenchmarkCase {
+  std::string op_type_name;
+  std::string inputs;
+  std::string attrs;
+};
+
+struct InputSpec {
+  std::string arg_name;
+  DataType data_type;
+  Shape shape;
+  double low;
+  double high;
+};
+
+struct BenchmarkResult {
+  BenchmarkCase benchmark_case;
+  int64_t warmup_iters;
+  int64_t iters;
+  std::vector<double> sorted_latency_us;
+  double mean_latency_us;
+  int64_t bytes;
+  double flops;
+};
+
+std::vector<std::string> SplitNonEmpty(const std::string& str, char delim) {
+  std::vector<std::string> ret;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, delim)) {
+    if (!item.empty()) { ret.push_back(item); }
+  }
+  return ret;
+}
+
+Maybe<Shape> ParseShape(const std::string& str) {
+  DimVector dim_vec;
+  for (const std::string& dim : SplitNonEmpty(str, 'x')) { dim_vec.push_back(std::stoll(dim)); }
+  CHECK_OR_RETURN(!dim_vec.empty()) << "invalid shape: " << str;
+  return Shape(dim_vec);
+}
+
+Maybe<DataType> ParseDataType(const std::string& str) {
+  DataType data_type = DataType::kInvalidDataType;
+  CHECK_OR_RETURN(DataType_Parse(str, &data_type)) << "invalid data type: " << str;
+  return data_type;
+}
+
+Maybe<void> ParseAttrValue(AttrType attr_type, const std::string& str, AttrValue* attr_val) {
+  const std::vector<std::string> items = SplitNonEmpty(str, ',');
+  switch (attr_type) {
+    case kAtInt32: attr_val->set_at_int32(std::stoi(str)); break;
+    case kAtInt64: attr_val->set_at_int64(std::stoll(str)); break;
+    case kAtBool: attr_val->set_at_bool(str == "true" || str == "1"); break;
+    case kAtFloat: attr_val->set_at_float(std::stof(str)); break;
+    case kAtDouble: attr_val->set_at_double(std::stod(str)); break;
+    case kAtString: attr_val->set_at_string(str); break;
+    case kAtShape: JUST(ParseShape(str))->ToProto(attr_val->mutable_at_shape()); break;
+    case kAtDataType: attr_val->set_at_data_type(JUST(ParseDataType(str))); break;
+    case kAtListInt32:
+      for (const auto& item : items) {
+        attr_val->mutable_at_list_int32()->add_val(std::stoi(item));
+      }
+      break;
+    case kAtListInt64:
+      for (const auto& item : items) {
+        attr_val->mutable_at_list_int64()->add_val(std::stoll(item));
+      }
+      break;
+    case kAtListFloat:
+      for (const auto& item : items) {
+        attr_val->mutable_at_list_float()->add_val(std::stof(item));
+      }
+      break;
+    case kAtListDataType:
+      for (const auto& item : items) {
+        attr_val->mutable_at_list_data_type()->add_val(JUST(ParseDataType(item)));
+      }
+      break;
+    case kAtListShape:
+      for (const auto& item : items) {
+        JUST(ParseShape(item))->ToProto(attr_val->mutable_at_list_shape()->add_val());
+      }
+      break;
+    case kAtListString:
+      for (const auto& item : items) { attr_val->mutable_at_list_string()->add_val(item); }
+      break;
+    default: OF_UNIMPLEMENTED() << "unsupported attr type: " << AttrType_Name(attr_type);
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<std::vector<InputSpec>> ParseInputSpecs(const std::string& inputs) {
+  std::vector<InputSpec> input_specs;
+  for (const std::string& input : SplitNonEmpty(inputs, ';')) {
+    const std::vector<std::string> fields = SplitNonEmpty(input, ':');
+    CHECK_OR_RETURN(fields.size() == 3 || fields.size() == 4) << "invalid input spec: " << input;
+    InputSpec spec;
+    spec.arg_name = fields.at(0);
+    spec.data_type = JUST(ParseDataType(fields.at(1)));
+    spec.shape = *JUST(ParseShape(fields.at(2)));
+    spec.low = 0;
+    spec.high = 1;
+    if (fields.size() == 4) {
+      const std::vector<std::string> range = SplitNonEmpty(fields.at(3), ',');
+      CHECK_EQ_OR_RETURN(range.size(), 2) << "invalid value range: " << fields.at(3);
+      spec.low = std::stod(range.at(0));
+      spec.high = std::stod(range.at(1));
+      CHECK_LT_OR_RETURN(spec.low, spec.high) << "invalid value range: " << fields.at(3);
+    }
+    input_specs.push_back(spec);
+  }
+  return input_specs;
+}
+
+Maybe<OperatorConf> GenUserOpConf(const BenchmarkCase& benchmark_case,
+                                  const std::vector<InputSpec>& input_specs) {
+  const user_op::OpRegistryResult* val =
+      user_op::UserOpRegistryMgr::Get().GetOpRegistryResult(benchmark_case.op_type_name);
+  CHECK_OR_RETURN(val != nullptr) << "op_type_name " << benchmark_case.op_type_name
+                                  << " is not registered";
+  OperatorConf op_conf;
+  op_conf.set_name(kBenchmarkOpName);
+  UserOpConf* user_conf = op_conf.mutable_user_conf();
+  user_conf->set_op_type_name(benchmark_case.op_type_name);
+  for (const InputSpec& spec : input_specs) {
+    auto* lbns = (*user_conf->mutable_input())[spec.arg_name].mutable_s();
+    lbns->Add()->assign("input/" + GenRepeatedBn(spec.arg_name, lbns->size()));
+  }
+  for (const auto& output_def : val->op_def.output()) {
+    if (output_def.is_optional()) { continue; }
+    auto* lbns = (*user_conf->mutable_output())[output_def.name()].mutable_s();
+    FOR_RANGE(int32_t, i, 0, output_def.num()) {
+      lbns->Add()->assign(kBenchmarkOpName + "/" + GenRepeatedBn(output_def.name(), i));
+    }
+  }
+  HashMap<std::string, AttrType> attr_name2attr_type;
+  for (const auto& attr_def : val->op_def.attr()) {
+    attr_name2attr_type.emplace(attr_def.name(), attr_def.type());
+  }
+  for (const std::string& attr : SplitNonEmpty(benchmark_case.attrs, ';')) {
+    const size_t pos = attr.find('=');
+    CHECK_OR_RETURN(pos != std::string::npos) << "invalid attr: " << attr;
+    const std::string attr_name = attr.substr(0, pos);
+    const auto it = attr_name2attr_type.find(attr_name);
+    CHECK_OR_RETURN(it != attr_name2attr_type.end())
+        << benchmark_case.op_type_name << " has no attr " << attr_name;
+    JUST(ParseAttrValue(it->second, attr.substr(pos + 1),
+                        &(*user_conf->mutable_attr())[attr_name]));
+  }
+  return CheckAndCompleteUserOpConfImpl(op_conf);
+}
+
+template<typename T>
+void RandomFillBody(Blob* blob, double low, double high, std::mt19937* gen) {
+  T* dptr = blob->mut_dptr<T>();
+  if (std::is_floating_point<T>::value) {
+    std::uniform_real_distribution<double> dis(low, high);
+    FOR_RANGE(int64_t, i, 0, blob->shape().elem_cnt()) { dptr[i] = static_cast<T>(dis(*gen)); }
+  } else {
+    std::uniform_int_distribution<int64_t> dis(static_cast<int64_t>(std::ceil(low)),
+                                               static_cast<int64_t>(std::ceil(high)) - 1);
+    FOR_RANGE(int64_t, i, 0, blob->shape().elem_cnt()) { dptr[i] = static_cast<T>(dis(*gen)); }
+  }
+}
+
+void RandomFillBlob(Blob* blob, const InputSpec& spec, std::mt19937* gen) {
+  switch (blob->data_type()) {
+    case DataType::kFloat: RandomFillBody<float>(blob, spec.low, spec.high, gen); break;
+    case DataType::kDouble: RandomFillBody<double>(blob, spec.low, spec.high, gen); break;
+    case DataType::kInt8: RandomFillBody<int8_t>(blob, spec.low, spec.high, gen); break;
+    case DataType::kInt32: RandomFillBody<int32_t>(blob, spec.low, spec.high, gen); break;
+    case DataType::kInt64: RandomFillBody<int64_t>(blob, spec.low, spec.high, gen); break;
+    case DataType::kUInt8: RandomFillBody<uint8_t>(blob, spec.low, spec.high, gen); break;
+    case DataType::kChar: RandomFillBody<char>(blob, spec.low, spec.high, gen); break;
+    default: std::memset(blob->mut_dptr(), 0, blob->ByteSizeOfBlobBody());
+  }
+}
+
+// Host memory and the Blob view of one synthetic tensor
+class BenchmarkBlob final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BenchmarkBlob);
+  explicit BenchmarkBlob(const BlobDesc& blob_desc)
+      : rt_blob_desc_(blob_desc),
+        header_(rt_blob_desc_.ByteSizeOfBlobHeader()),
+        body_(rt_blob_desc_.AlignedByteSizeOfBlobBody()) {
+    blob_.reset(new Blob(MakeHostMemCase(), &rt_blob_desc_, header_.data(), body_.data()));
+  }
+  ~BenchmarkBlob() = default;
+
+  Blob* blob() const { return blob_.get(); }
+
+ private:
+  const RtBlobDesc rt_blob_desc_;
+  std::vector<char> header_;
+  std::vector<char> body_;
+  std::unique_ptr<Blob> blob_;
+};
+
+Maybe<BenchmarkResult> RunBenchmarkCase(const BenchmarkCase& benchmark_case, int64_t warmup_iters,
+                                        int64_t iters) {
+  const std::vector<InputSpec> input_specs = *JUST(ParseInputSpecs(benchmark_case.inputs));
+  const OperatorConf op_conf = *JUST(GenUserOpConf(benchmark_case, input_specs));
+  std::shared_ptr<Operator> op = ConstructOp(op_conf, DeviceType::kCPU);
+  JUST(op->FillOpParallelDesc(ParallelDesc(GenParallelConfOfCpuZeroOnMaster())));
+
+  HashMap<std::string, std::unique_ptr<BlobDesc>> bn2blob_desc;
+  HashMap<std::string, const InputSpec*> ibn2input_spec;
+  HashMap<std::string, int32_t> arg_name2index;
+  for (const InputSpec& spec : input_specs) {
+    const std::string ibn = GenRepeatedBn(spec.arg_name, arg_name2index[spec.arg_name]++);
+    bn2blob_desc[ibn].reset(new BlobDesc(spec.shape, spec.data_type));
+    ibn2input_spec[ibn] = &spec;
+  }
+  for (const std::string& ibn : op->input_bns()) {
+    CHECK_OR_RETURN(bn2blob_desc.find(ibn) != bn2blob_desc.end()) << "missing input " << ibn;
+  }
+  auto BlobDesc4BnInOp = [&](const std::string& bn) -> BlobDesc* {
+    auto& blob_desc = bn2blob_desc[bn];
+    if (!blob_desc) { blob_desc.reset(new BlobDesc(DataType::kInvalidDataType)); }
+    return blob_desc.get();
+  };
+  JUST(op->FillLogicalInBlobDesc(BlobDesc4BnInOp));
+  JUST(op->InferLogicalOutBlobDescsIf());
+  SbpSignature sbp_signature;
+  op->ForEachBnInOp([&](const std::string& bn) {
+    (*sbp_signature.mutable_bn_in_op2sbp_parallel())[bn].mutable_broadcast_parallel();
+  });
+  JUST(op->FillSbpSignature(sbp_signature));
+  ParallelContext parallel_ctx;
+  parallel_ctx.set_parallel_id(0);
+  parallel_ctx.set_parallel_num(1);
+  JUST(op->InferBlobDescsIf(BlobDesc4BnInOp, &parallel_ctx, &GlobalJobDesc()));
+
+  KernelConf kernel_conf;
+  op->GenKernelConf(
+      [&](const std::string& bn) -> const BlobDesc* {
+        const auto it = bn2blob_desc.find(bn);
+        return it == bn2blob_desc.end() ? nullptr : it->second.get();
+      },
+      &parallel_ctx, &kernel_conf);
+  CpuDeviceCtx device_ctx;
+  std::unique_ptr<const Kernel> kernel =
+      ConstructKernel(&GlobalJobDesc(), kernel_conf, &device_ctx);
+
+  HashMap<std::string, std::unique_ptr<BenchmarkBlob>> bn2blob;
+  std::mt19937 gen(0);
+  int64_t bytes = 0;
+  for (const auto& pair : bn2blob_desc) {
+    bn2blob[pair.first].reset(new BenchmarkBlob(*pair.second));
+    const auto spec_it = ibn2input_spec.find(pair.first);
+    if (spec_it != ibn2input_spec.end()) {
+      RandomFillBlob(bn2blob.at(pair.first)->blob(), *spec_it->second, &gen);
+    }
+  }
+  for (const auto& bns : {op->input_bns(), op->output_bns()}) {
+    for (const std::string& bn : bns) { bytes += bn2blob.at(bn)->blob()->ByteSizeOfBlobBody(); }
+  }
+  auto BnInOp2Blob = [&](const std::string& bn) -> Blob* {
+    const auto it = bn2blob.find(bn);
+    return it == bn2blob.end() ? nullptr : it->second->blob();
+  };
+  KernelCtx kernel_ctx;
+  kernel_ctx.device_ctx = &device_ctx;
+  FOR_RANGE(int64_t, i, 0, warmup_iters) { kernel->Launch(kernel_ctx, BnInOp2Blob); }
+  device_ctx.SyncDevice();
+
+  BenchmarkResult result;
+  result.benchmark_case = benchmark_case;
+  result.warmup_iters = warmup_iters;
+  result.iters = iters;
+  double total_latency_us = 0;
+  FOR_RANGE(int64_t, i, 0, iters) {
+    const auto start = std::chrono::steady_clock::now();
+    kernel->Launch(kernel_ctx, BnInOp2Blob);
+    device_ctx.SyncDevice();
+    const double latency_us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+            .count();
+    result.sorted_latency_us.push_back(latency_us);
+    total_latency_us += latency_us;
+  }
+  std::sort(result.sorted_latency_us.begin(), result.sorted_latency_us.end());
+  result.mean_latency_us = total_latency_us / iters;
+  result.bytes = bytes;
+  result.flops = EstimateLogicalFlops(*op, [&](const LogicalBlobId& lbi) -> const BlobDesc& {
+    for (const auto& pair : bn2blob_desc) {
+      if (op->BnInOp2Lbi(pair.first) == lbi) { return *pair.second; }
+    }
+    UNIMPLEMENTED();
+  });
+  return result;
+}
+
+// nearest-rank percentile of the sorted latencies
+double Percentile(const std::vector<double>& sorted_latency_us, double p) {
+  const int64_t rank = static_cast<int64_t>(std::ceil(p / 100 * sorted_latency_us.size()));
+  return sorted_latency_us.at(std::max<int64_t>(rank - 1, 0));
+}
+
+std::string EscapeJsonString(const std::string& str) {
+  std::string ret;
+  for (char c : str) {
+    if (c == '"' || c == '\\') { ret += '\\'; }
+    ret += c;
+  }
+  return ret;
+}
+
+void PrintBenchmarkResult(const BenchmarkResult& result, std::ostream& out) {
+  const double mean_seconds = result.mean_latency_us / 1e6;
+  out << result.benchmark_case.op_type_name << " [" << result.benchmark_case.inputs << "]"
+      << std::endl
+      << "  latency(us) min: " << result.sorted_latency_us.front()
+      << ", mean: " << result.mean_latency_us
+      << ", p50: " << Percentile(result.sorted_latency_us, 50)
+      << ", p90: " << Percentile(result.sorted_latency_us, 90)
+      << ", p99: " << Percentile(result.sorted_latency_us, 99) << std::endl
+      << "  " << result.bytes / mean_seconds / 1e9 << " GB/s, "
+      << result.flops / mean_seconds / 1e9 << " GFLOP/s" << std::endl;
+}
+
+void WriteBenchmarkResultsJson(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+  out << "[";
+  FOR_RANGE(size_t, i, 0, results.size()) {
+    const BenchmarkResult& result = results.at(i);
+    const double mean_seconds = result.mean_latency_us / 1e6;
+    out << (i == 0 ? "" : ",") << "\n  {\"op_type_name\": \""
+        << EscapeJsonString(result.benchmark_case.op_type_name) << "\", \"inputs\": \""
+        << EscapeJsonString(result.benchmark_case.inputs) << "\", \"attrs\": \""
+        << EscapeJsonString(result.benchmark_case.attrs)
+        << "\", \"warmup_iters\": " << result.warmup_iters << ", \"iters\": " << result.iters
+        << ", \"latency_us\": {\"min\": " << result.sorted_latency_us.front()
+        << ", \"mean\": " << result.mean_latency_us
+        << ", \"p50\": " << Percentile(result.sorted_latency_us, 50)
+        << ", \"p90\": " << Percentile(result.sorted_latency_us, 90)
+        << ", \"p99\": " << Percentile(result.sorted_latency_us, 99)
+        << ", \"max\": " << result.sorted_latency_us.back() << "}, \"bytes\": " << result.bytes
+        << ", \"flops\": " << result.flops
+        << ", \"gb_per_sec\": " << result.bytes / mean_seconds / 1e9
+        << ", \"gflop_per_sec\": " << result.flops / mean_seconds / 1e9 << "}";
+  }
+  out << "\n]\n";
+}
+
+// Each non-empty line not starting with '#' is a case "op_type_name|inputs|attrs"
+Maybe<std::vector<BenchmarkCase>> ReadBenchmarkCases(const std::string& path) {
+  std::ifstream in(path);
+  CHECK_OR_RETURN(in.is_open()) << "failed to open " << path;
+  std::vector<BenchmarkCase> cases;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line.front() == '#') { continue; }
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, '|')) { fields.push_back(field); }
+    CHECK_OR_RETURN(fields.size() == 2 || fields.size() == 3) << "invalid case: " << line;
+    cases.push_back(
+        BenchmarkCase{fields.at(0), fields.at(1), fields.size() == 3 ? fields.at(2) : ""});
+  }
+  return cases;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+/*
+ * Try run this benchmark exe by :
+ *     ./oneflow_benchmark -op_type_name=matmul -inputs="a:kFloat:256x512;b:kFloat:512x256" \
+ *         -attrs="transpose_a=false;transpose_b=false" -output_json=matmul.json
+ * or with one case per line "op_type_name|inputs|attrs" in a file :
+ *     ./oneflow_benchmark -cases_file=cases.txt -output_json=result.json
+ */
+DEFINE_string(op_type_name, "", "user op type name of the kernel to benchmark");
+DEFINE_string(inputs, "", "synthetic inputs, \"arg:dtype:shape[:low,high];...\", e.g. "
+                          "\"x:kFloat:64x1024;indices:kInt32:64:0,1024\"");
+DEFINE_string(attrs, "", "op attrs, \"name=value;...\", list values are comma separated");
+DEFINE_string(cases_file, "", "file of cases \"op_type_name|inputs|attrs\", one per line");
+DEFINE_int64(warmup_iters, 10, "untimed iterations before timing");
+DEFINE_int64(iters, 100, "timed iterations");
+DEFINE_string(output_json, "", "path of the json report, skipped if empty");
+DEFINE_int32(thread_num, std::thread::hardware_concurrency(), "size of the thread pool");
+
+int main(int argc, char* argv[]) {
+  using namespace oneflow;
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_GT(FLAGS_iters, 0);
+  std::vector<BenchmarkCase> cases;
+  if (!FLAGS_cases_file.empty()) { cases = *CHECK_JUST(ReadBenchmarkCases(FLAGS_cases_file)); }
+  if (!FLAGS_op_type_name.empty()) {
+    cases.push_back(BenchmarkCase{FLAGS_op_type_name, FLAGS_inputs, FLAGS_attrs});
+  }
+  CHECK(!cases.empty()) << "no case, set -op_type_name or -cases_file";
+
+  Global<ProcessCtx>::New();
+  Global<ProcessCtx>::Get()->set_rank(0);
+  Address* addr = Global<ProcessCtx>::Get()->add_ctrl_addr();
+  addr->set_host("127.0.0.1");
+  addr->set_port(0);
+  Resource resource;
+  resource.set_machine_num(1);
+  resource.set_cpu_device_num(1);
+  resource.set_gpu_device_num(0);
+  Global<ResourceDesc, ForSession>::New(resource);
+  Global<ThreadPool>::New(FLAGS_thread_num);
+  std::vector<BenchmarkResult> results;
+  {
+    JobConfigProto job_conf;
+    job_conf.set_job_name(kBenchmarkOpName);
+    job_conf.mutable_predict_conf();
+    GlobalJobDescScope job_desc_scope(job_conf, 0);
+    for (const BenchmarkCase& benchmark_case : cases) {
+      results.push_back(
+          *CHECK_JUST(RunBenchmarkCase(benchmark_case, FLAGS_warmup_iters, FLAGS_iters)));
+      PrintBenchmarkResult(results.back(), std::cout);
+    }
+  }
+  if (!FLAGS_output_json.empty()) {
+    std::ofstream out(FLAGS_output_json);
+    CHECK(out.is_open()) << "failed to open " << FLAGS_output_json;
+    WriteBenchmarkResultsJson(results, out);
+  }
+  Global<ThreadPool>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<ProcessCtx>::Delete();
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+template<typename T>
+class CpuTopKGradientSparsifyKernel final : public user_op::OpKernel {
+ public:
+  CpuTopKGradientSparsifyKernel() = default;
+  ~CpuTopKGradientSparsifyKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* gradient = ctx->Tensor4ArgNameAndIndex("gradient", 0);
+    user_op::Tensor* residual = ctx->Tensor4ArgNameAndIndex("residual", 0);
+    user_op::Tensor* indices = ctx->Tensor4ArgNameAndIndex("indices", 0);
+    user_op::Tensor* values = ctx->Tensor4ArgNameAndIndex("values", 0);
+    const int64_t num_rows = gradient->shape().At(0);
+    const int64_t row_size = gradient->shape().Count(1);
+    const int64_t k = indices->shape().elem_cnt();
+    CHECK_LE(k, num_rows);
+    const T* gradient_ptr = gradient->dptr<T>();
+    T* residual_ptr = residual->mut_dptr<T>();
+    std::vector<T> norms(num_rows);
+    FOR_RANGE(int64_t, row, 0, num_rows) {
+      T norm = 0;
+      FOR_RANGE(int64_t, i, row * row_size, (row + 1) * row_size) {
+        residual_ptr[i] += gradient_ptr[i];
+        norm += residual_ptr[i] * residual_ptr[i];
+      }
+      norms[row] = norm;
+    }
+    std::vector<int32_t> rows(num_rows);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::nth_element(rows.begin(), rows.begin() + k - 1, rows.end(),
+                     [&](int32_t lhs, int32_t rhs) { return norms[lhs] > norms[rhs]; });
+    int32_t* indices_ptr = indices->mut_dptr<int32_t>();
+    T* values_ptr = values->mut_dptr<T>();
+    FOR_RANGE(int64_t, i, 0, k) {
+      const int32_t row = rows[i];
+      indices_ptr[i] = row;
+      T* residual_row = residual_ptr + row * row_size;
+      std::copy(residual_row, residual_row + row_size, values_ptr + i * row_size);
+      std::fill(residual_row, residual_row + row_size, static_cast<T>(0));
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_TOP_K_GRADIENT_SPARSIFY_KERNEL(dtype)  \
+  REGISTER_USER_KERNEL("top_k_gradient_sparsify")           \
+      .SetCreateFn<CpuTopKGradientSparsifyKernel<dtype>>()  \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")   \
+                       & (user_op::HobDataType("gradient", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_TOP_K_GRADIENT_SPARSIFY_KERNEL(float)
+REGISTER_CPU_TOP_K_GRADIENT_SPARSIFY_KERNEL(double)
+
+}  // namespace oneflow
@@ -0,0 +1,128 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/radix_sort.cuh"
+#include <cub/cub.cuh>
+
+namespace oneflow {
+
+namespace {
+
+constexpr int32_t kNumThreadsPerRow = 256;
+
+template<typename T>
+struct TmpBufferLayout {
+  explicit TmpBufferLayout(int64_t num_rows)
+      : norms_bytes(GetCudaAlignedSize(num_rows * sizeof(T))),
+        row_ids_bytes(GetCudaAlignedSize(num_rows * sizeof(int32_t))),
+        temp_storage_bytes(InferTempStorageForSortPairsDescending<T, int32_t>(1, num_rows)) {}
+
+  int64_t TotalBytes() const { return 2 * norms_bytes + 2 * row_ids_bytes + temp_storage_bytes; }
+
+  int64_t norms_bytes;
+  int64_t row_ids_bytes;
+  int64_t temp_storage_bytes;
+};
+
+template<typename T>
+__global__ void AccumulateAndComputeRowNorms(int64_t row_size, const T* gradient, T* residual,
+                                             T* norms) {
+  typedef cub::BlockReduce<T, kNumThreadsPerRow> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  const int64_t row = blockIdx.x;
+  T norm = 0;
+  for (int64_t i = row * row_size + threadIdx.x; i < (row + 1) * row_size; i += blockDim.x) {
+    const T val = residual[i] + gradient[i];
+    residual[i] = val;
+    norm += val * val;
+  }
+  norm = BlockReduce(temp_storage).Sum(norm);
+  if (threadIdx.x == 0) { norms[row] = norm; }
+}
+
+__global__ void InitializeRowIds(int32_t num_rows, int32_t* row_ids) {
+  CUDA_1D_KERNEL_LOOP(i, num_rows) { row_ids[i] = i; }
+}
+
+template<typename T>
+__global__ void TakeRows(int64_t elem_cnt, int64_t row_size, const int32_t* indices, T* residual,
+                         T* values) {
+  CUDA_1D_KERNEL_LOOP_T(int64_t, i, elem_cnt) {
+    const int64_t offset = indices[i / row_size] * row_size + i % row_size;
+    values[i] = residual[offset];
+    residual[offset] = 0;
+  }
+}
+
+}  // namespace
+
+template<typename T>
+class GpuTopKGradientSparsifyKernel final : public user_op::OpKernel {
+ public:
+  GpuTopKGradientSparsifyKernel() = default;
+  ~GpuTopKGradientSparsifyKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* gradient = ctx->Tensor4ArgNameAndIndex("gradient", 0);
+    user_op::Tensor* residual = ctx->Tensor4ArgNameAndIndex("residual", 0);
+    user_op::Tensor* indices = ctx->Tensor4ArgNameAndIndex("indices", 0);
+    user_op::Tensor* values = ctx->Tensor4ArgNameAndIndex("values", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t num_rows = gradient->shape().At(0);
+    const int64_t row_size = gradient->shape().Count(1);
+    const int64_t k = indices->shape().elem_cnt();
+    CHECK_LE(k, num_rows);
+    const TmpBufferLayout<T> layout(num_rows);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), layout.TotalBytes());
+    char* ptr = tmp_buffer->mut_dptr<char>();
+    T* norms = reinterpret_cast<T*>(ptr);
+    T* sorted_norms = reinterpret_cast<T*>(ptr + layout.norms_bytes);
+    int32_t* row_ids = reinterpret_cast<int32_t*>(ptr + 2 * layout.norms_bytes);
+    int32_t* sorted_row_ids =
+        reinterpret_cast<int32_t*>(ptr + 2 * layout.norms_bytes + layout.row_ids_bytes);
+    void* temp_storage = ptr + 2 * layout.norms_bytes + 2 * layout.row_ids_bytes;
+    cudaStream_t stream = ctx->device_ctx()->cuda_stream();
+    AccumulateAndComputeRowNorms<T><<<num_rows, kNumThreadsPerRow, 0, stream>>>(
+        row_size, gradient->dptr<T>(), residual->mut_dptr<T>(), norms);
+    InitializeRowIds<<<BlocksNum4ThreadsNum(num_rows), kCudaThreadsNumPerBlock, 0, stream>>>(
+        num_rows, row_ids);
+    SortPairsDescending(norms, row_ids, 1, num_rows, temp_storage, layout.temp_storage_bytes,
+                        sorted_norms, sorted_row_ids, stream);
+    OF_CUDA_CHECK(cudaMemcpyAsync(indices->mut_dptr<int32_t>(), sorted_row_ids,
+                                  k * sizeof(int32_t), cudaMemcpyDefault, stream));
+    const int64_t elem_cnt = k * row_size;
+    TakeRows<T><<<BlocksNum4ThreadsNum(elem_cnt), kCudaThreadsNumPerBlock, 0, stream>>>(
+        elem_cnt, row_size, indices->dptr<int32_t>(), residual->mut_dptr<T>(),
+        values->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_GPU_TOP_K_GRADIENT_SPARSIFY_KERNEL(dtype)                                  \
+  REGISTER_USER_KERNEL("top_k_gradient_sparsify")                                           \
+      .SetCreateFn<GpuTopKGradientSparsifyKernel<dtype>>()                                  \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "gpu")                                   \
+                       & (user_op::HobDataType("gradient", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                   \
+        const Shape* gradient_shape = ctx->Shape4ArgNameAndIndex("gradient", 0);            \
+        return TmpBufferLayout<dtype>(gradient_shape->At(0)).TotalBytes();                  \
+      });
+
+REGISTER_GPU_TOP_K_GRADIENT_SPARSIFY_KERNEL(float)
+REGISTER_GPU_TOP_K_GRADIENT_SPARSIFY_KERNEL(double)
+
+}  // namespace oneflow
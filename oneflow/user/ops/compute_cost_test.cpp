@@ -0,0 +1,142 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace user_op {
+
+namespace {
+
+ComputeCost InferComputeCost4UserOp(
+    const UserOpConfWrapper& user_op_conf,
+    const HashMap<std::string, std::pair<Shape, DataType>>& bn2shape_and_data_type) {
+  OperatorConf op_conf = user_op_conf.op_conf();
+  op_conf.set_device_tag("cpu");
+  std::shared_ptr<Operator> op = ConstructOp(op_conf);
+  HashMap<std::string, std::unique_ptr<BlobDesc>> bn2blob_desc;
+  for (const auto& pair : bn2shape_and_data_type) {
+    bn2blob_desc[pair.first].reset(new BlobDesc(pair.second.first, pair.second.second));
+  }
+  ComputeCost cost;
+  CHECK_JUST(op->InferComputeCost(
+      [&](const std::string& bn) -> const BlobDesc* {
+        const auto it = bn2blob_desc.find(bn);
+        return it == bn2blob_desc.end() ? nullptr : it->second.get();
+      },
+      &cost));
+  return cost;
+}
+
+}  // namespace
+
+TEST(ComputeCost, matmul) {
+  // (3, 5) * (5, 7), a multiply-add along k = 5 for each of the 21 outputs
+  const auto conf = UserOpConfWrapperBuilder("matmul")
+                        .Op("matmul")
+                        .Input("a", "a/out")
+                        .Input("b", "b/out")
+                        .Output("out")
+                        .Attr<bool>("transpose_a", false)
+                        .Attr<bool>("transpose_b", false)
+                        .Build();
+  const ComputeCost cost =
+      InferComputeCost4UserOp(conf, {{"a_0", {Shape({3, 5}), DataType::kFloat}},
+                                     {"b_0", {Shape({5, 7}), DataType::kFloat}},
+                                     {"out_0", {Shape({3, 7}), DataType::kFloat}}});
+  ASSERT_EQ(cost.flops, 2 * 21 * 5);
+  ASSERT_EQ(cost.read_bytes, (15 + 35) * 4);
+  ASSERT_EQ(cost.written_bytes, 21 * 4);
+
+  // k is taken from the other axis of a when a is transposed
+  const auto transposed_conf = UserOpConfWrapperBuilder("matmul_transpose_a")
+                                   .Op("matmul")
+                                   .Input("a", "a/out")
+                                   .Input("b", "b/out")
+                                   .Output("out")
+                                   .Attr<bool>("transpose_a", true)
+                                   .Attr<bool>("transpose_b", false)
+                                   .Build();
+  const ComputeCost transposed_cost = InferComputeCost4UserOp(
+      transposed_conf, {{"a_0", {Shape({5, 3}), DataType::kFloat}},
+                        {"b_0", {Shape({5, 7}), DataType::kFloat}},
+                        {"out_0", {Shape({3, 7}), DataType::kFloat}}});
+  ASSERT_EQ(transposed_cost.flops, 2 * 21 * 5);
+}
+
+TEST(ComputeCost, conv2d) {
+  // 4 filters of 3x3x3 over a (2, 3, 8, 8) input, a multiply-add with each of the 27 weights
+  // for every element of the (2, 4, 6, 6) output
+  const auto conf = UserOpConfWrapperBuilder("conv2d")
+                        .Op("conv2d")
+                        .Input("in", "in/out")
+                        .Input("weight", "weight/out")
+                        .Output("out")
+                        .Attr<int32_t>("filters", 4)
+                        .Attr<std::vector<int32_t>>("padding_before", {0, 0})
+                        .Attr<std::string>("data_format", "channels_first")
+                        .Attr<std::vector<int32_t>>("kernel_size", {3, 3})
+                        .Attr<std::vector<int32_t>>("strides", {1, 1})
+                        .Attr<std::vector<int32_t>>("dilation_rate", {1, 1})
+                        .Build();
+  const ComputeCost cost =
+      InferComputeCost4UserOp(conf, {{"in_0", {Shape({2, 3, 8, 8}), DataType::kFloat}},
+                                     {"weight_0", {Shape({4, 3, 3, 3}), DataType::kFloat}},
+                                     {"out_0", {Shape({2, 4, 6, 6}), DataType::kFloat}}});
+  ASSERT_EQ(cost.flops, 2 * 288 * 27);
+  ASSERT_EQ(cost.read_bytes, (384 + 108) * 4);
+  ASSERT_EQ(cost.written_bytes, 288 * 4);
+}
+
+TEST(ComputeCost, reduce_sum) {
+  // one operation per input element
+  const auto conf = UserOpConfWrapperBuilder("reduce_sum")
+                        .Op("reduce_sum")
+                        .Input("input_tensor", "x/out")
+                        .Output("output_tensor")
+                        .Attr<std::vector<int32_t>>("axis", {1})
+                        .Attr<bool>("keepdims", false)
+                        .Build();
+  const ComputeCost cost = InferComputeCost4UserOp(
+      conf, {{"input_tensor_0", {Shape({4, 5}), DataType::kDouble}},
+             {"output_tensor_0", {Shape({4}), DataType::kDouble}}});
+  ASSERT_EQ(cost.flops, 20);
+  ASSERT_EQ(cost.read_bytes, 20 * 8);
+  ASSERT_EQ(cost.written_bytes, 4 * 8);
+}
+
+TEST(ComputeCost, gather) {
+  // 6 rows of 8 gathered from a (100, 8) table, the rest of the table is not read
+  const auto conf = UserOpConfWrapperBuilder("gather")
+                        .Op("gather")
+                        .Input("in", "table/out")
+                        .Input("indices", "indices/out")
+                        .Output("out")
+                        .Attr<int64_t>("axis", 0)
+                        .Build();
+  const ComputeCost cost =
+      InferComputeCost4UserOp(conf, {{"in_0", {Shape({100, 8}), DataType::kFloat}},
+                                     {"indices_0", {Shape({6}), DataType::kInt32}},
+                                     {"out_0", {Shape({6, 8}), DataType::kFloat}}});
+  ASSERT_EQ(cost.flops, 0);
+  ASSERT_EQ(cost.read_bytes, 6 * 4 + 48 * 4);
+  ASSERT_EQ(cost.written_bytes, 48 * 4);
+}
+
+}  // namespace user_op
+
+}  // namespace oneflow
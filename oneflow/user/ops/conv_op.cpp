@@ -155,6 +155,20 @@ Maybe<void> CheckAttr(const user_op::UserOpDefWrapper& def,
   }
 }
 
+// a multiply-add with each weight of the filter for every element of the output channels,
+// which are out for the forward and dy for the backward
+user_op::ComputeCostFn MakeComputeCostFn4Conv(const std::string& out_arg_name,
+                                              const std::string& weight_arg_name) {
+  return [out_arg_name, weight_arg_name](user_op::ComputeCostFnContext* ctx) -> Maybe<void> {
+    JUST(user_op::ComputeCostFnUtil::MemoryOnly(ctx));
+    const Shape& out_shape = ctx->TensorDesc4ArgNameAndIndex(out_arg_name, 0)->shape();
+    const Shape& weight_shape = ctx->TensorDesc4ArgNameAndIndex(weight_arg_name, 0)->shape();
+    ctx->mut_compute_cost()->flops =
+        2.0 * out_shape.elem_cnt() * weight_shape.elem_cnt() / weight_shape.At(0);
+    return Maybe<void>::Ok();
+  };
+}
+
 void GenerateBackwardOpConf4Conv(const user_op::UserOpWrapper& op, user_op::AddOpFn AddOp) {
   const auto& padding_before = op.attr<std::vector<int32_t>>("padding_before");
   std::string data_format = op.attr<std::string>("data_format");
@@ -239,6 +253,7 @@ REGISTER_USER_OP("conv1d")
     .Attr<int32_t>("groups", 1)
     .SetCheckAttrFn(CheckAttr<1>)
     .SetTensorDescInferFn(InferTensorDesc4Conv<1>)
+    .SetComputeCostFn(MakeComputeCostFn4Conv("out", "weight"))
     .SetGetSbpFn(GetSbpSignatures4Conv);
 
 REGISTER_USER_OP("conv2d")
@@ -256,6 +271,7 @@ REGISTER_USER_OP("conv2d")
     .Attr<int32_t>("groups", 1)
     .SetCheckAttrFn(CheckAttr<2>)
     .SetTensorDescInferFn(InferTensorDesc4Conv<2>)
+    .SetComputeCostFn(MakeComputeCostFn4Conv("out", "weight"))
     .SetGetSbpFn(GetSbpSignatures4Conv);
 
 REGISTER_USER_OP("conv3d")
@@ -273,6 +289,7 @@ REGISTER_USER_OP("conv3d")
     .Attr<int32_t>("groups", 1)
     .SetCheckAttrFn(CheckAttr<3>)
     .SetTensorDescInferFn(InferTensorDesc4Conv<3>)
+    .SetComputeCostFn(MakeComputeCostFn4Conv("out", "weight"))
     .SetGetSbpFn(GetSbpSignatures4Conv);
 
 REGISTER_USER_OP_GRAD("conv1d").SetGenBackwardOpConfFn(GenerateBackwardOpConf4Conv);
@@ -312,6 +329,7 @@ REGISTER_USER_OP("conv_data_grad")
       *dx = *x_like;
       return Maybe<void>::Ok();
     })
+    .SetComputeCostFn(MakeComputeCostFn4Conv("dy", "filter"))
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       std::vector<user_op::OpArg> split_args;
       split_args.emplace_back("dy", 0);
@@ -378,6 +396,7 @@ REGISTER_USER_OP("conv_filter_grad")
 
       return Maybe<void>::Ok();
     })
+    .SetComputeCostFn(MakeComputeCostFn4Conv("dy", "filter_diff"))
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       ctx->NewBuilder()
           .Split(user_op::OpArg("dy", 0), 0)
@@ -422,6 +441,7 @@ REGISTER_USER_OP("conv_bias_grad")
       }
       return Maybe<void>::Ok();
     })
+    .SetComputeCostFn(user_op::ComputeCostFnUtil::Reduce)
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       ctx->NewBuilder()
           .Split(user_op::OpArg("dy", 0), 0)
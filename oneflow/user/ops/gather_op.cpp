@@ -49,6 +49,19 @@ REGISTER_USER_OP("gather")
       CHECK(indices_modifier != nullptr);
       indices_modifier->set_requires_grad(false);
     })
+    .SetComputeCostFn([](user_op::ComputeCostFnContext* ctx) -> Maybe<void> {
+      // only the gathered slices of in are read
+      const user_op::TensorDesc* indices = ctx->TensorDesc4ArgNameAndIndex("indices", 0);
+      const user_op::TensorDesc* out = ctx->TensorDesc4ArgNameAndIndex("out", 0);
+      const int64_t out_byte_size =
+          out->shape().elem_cnt() * GetSizeOfDataType(out->data_type());
+      ComputeCost* cost = ctx->mut_compute_cost();
+      cost->flops = 0;
+      cost->read_bytes =
+          indices->shape().elem_cnt() * GetSizeOfDataType(indices->data_type()) + out_byte_size;
+      cost->written_bytes = out_byte_size;
+      return Maybe<void>::Ok();
+    })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       const int64_t in_num_axes =
           ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0).shape().NumAxes();
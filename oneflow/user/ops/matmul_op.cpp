@@ -62,6 +62,18 @@ Maybe<void> InferTensorDesc4Matmul(user_op::InferContext* ctx) {
   return Maybe<void>::Ok();
 }
 
+// a multiply-add along k for every output element
+Maybe<void> ComputeCost4Matmul(user_op::ComputeCostFnContext* ctx) {
+  JUST(user_op::ComputeCostFnUtil::MemoryOnly(ctx));
+  const Shape& a_shape = ctx->TensorDesc4ArgNameAndIndex("a", 0)->shape();
+  const int64_t num_axes = a_shape.NumAxes();
+  const int64_t k =
+      ctx->Attr<bool>("transpose_a") ? a_shape.At(num_axes - 2) : a_shape.At(num_axes - 1);
+  const int64_t out_elem_cnt = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
+  ctx->mut_compute_cost()->flops = 2.0 * out_elem_cnt * k;
+  return Maybe<void>::Ok();
+}
+
 void GenBackwardOpConf4Matmul(const std::string& op_type_name, const user_op::UserOpWrapper& op,
                               user_op::AddOpFn AddOp) {
   bool transpose_a = op.attr<bool>("transpose_a");
@@ -134,6 +146,7 @@ REGISTER_USER_OP("matmul")
     .Attr<bool>("transpose_a", false)
     .Attr<bool>("transpose_b", false)
     .SetTensorDescInferFn(InferTensorDesc4Matmul)
+    .SetComputeCostFn(ComputeCost4Matmul)
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       // (m, k_a) * (k_b, n) where k_a == k_b
       int32_t m_axis = -1;
@@ -200,6 +213,7 @@ REGISTER_USER_OP("batch_matmul")
     .Attr<bool>("transpose_a", false)
     .Attr<bool>("transpose_b", false)
     .SetTensorDescInferFn(InferTensorDesc4Matmul)
+    .SetComputeCostFn(ComputeCost4Matmul)
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& a_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("a", 0);
       std::vector<user_op::OpArg> out_and_add_to_output_args;
@@ -70,13 +70,14 @@ Maybe<void> GetSbpFn(user_op::SbpContext* ctx) {
   return Maybe<void>::Ok();
 }
 
-#define REGISTER_REDUCE_USER_OP(op_name, binary_func) \
-  REGISTER_USER_OP(op_name)                           \
-      .Input("input_tensor")                          \
-      .Output("output_tensor")                        \
-      .Attr<std::vector<int32_t>>("axis")             \
-      .Attr<bool>("keepdims")                         \
-      .SetTensorDescInferFn(InferTensorDescFn)        \
+#define REGISTER_REDUCE_USER_OP(op_name, binary_func)       \
+  REGISTER_USER_OP(op_name)                                 \
+      .Input("input_tensor")                                \
+      .Output("output_tensor")                              \
+      .Attr<std::vector<int32_t>>("axis")                   \
+      .Attr<bool>("keepdims")                               \
+      .SetTensorDescInferFn(InferTensorDescFn)              \
+      .SetComputeCostFn(user_op::ComputeCostFnUtil::Reduce) \
       .SetGetSbpFn(GetSbpFn<binary_func>);
 
 REGISTER_REDUCE_USER_OP("reduce_any", BinaryFuncAny)
@@ -28,6 +28,13 @@ REGISTER_USER_OP("softmax")
       *out_shape = *in_shape;
       return Maybe<void>::Ok();
     })
+    .SetComputeCostFn([](user_op::ComputeCostFnContext* ctx) -> Maybe<void> {
+      // max, sub, exp, sum and div for each element
+      JUST(user_op::ComputeCostFnUtil::MemoryOnly(ctx));
+      ctx->mut_compute_cost()->flops =
+          5.0 * ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape().elem_cnt();
+      return Maybe<void>::Ok();
+    })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& in_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("in", 0);
       FOR_RANGE(int64_t, axis, 0, in_tensor.shape().NumAxes()) {
@@ -51,6 +58,13 @@ REGISTER_USER_OP("softmax_grad")
       *dx_shape = *dy_shape;
       return Maybe<void>::Ok();
     })
+    .SetComputeCostFn([](user_op::ComputeCostFnContext* ctx) -> Maybe<void> {
+      // mul, sum, sub and mul for each element
+      JUST(user_op::ComputeCostFnUtil::MemoryOnly(ctx));
+      ctx->mut_compute_cost()->flops =
+          4.0 * ctx->TensorDesc4ArgNameAndIndex("y", 0)->shape().elem_cnt();
+      return Maybe<void>::Ok();
+    })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
       const user_op::TensorDesc& y_tensor = ctx->LogicalTensorDesc4InputArgNameAndIndex("y", 0);
       FOR_RANGE(int64_t, axis, 0, y_tensor.shape().NumAxes()) {
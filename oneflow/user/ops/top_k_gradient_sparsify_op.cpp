@@ -0,0 +1,86 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace {
+
+// rows of the gradient kept by each rank
+int64_t GetSparsifyK(int64_t num_rows, float ratio) {
+  const int64_t k = static_cast<int64_t>(std::ceil(num_rows * static_cast<double>(ratio)));
+  return std::max<int64_t>(std::min(k, num_rows), 1);
+}
+
+Maybe<void> InferTensorDesc(user_op::InferContext* ctx) {
+  const user_op::TensorDesc* gradient = ctx->TensorDesc4ArgNameAndIndex("gradient", 0);
+  const user_op::TensorDesc* residual = ctx->TensorDesc4ArgNameAndIndex("residual", 0);
+  const float ratio = ctx->Attr<float>("ratio");
+  CHECK_GT_OR_RETURN(ratio, 0);
+  CHECK_LE_OR_RETURN(ratio, 1);
+  const Shape& shape = gradient->shape();
+  CHECK_GT_OR_RETURN(shape.NumAxes(), 0);
+  CHECK_LE_OR_RETURN(shape.At(0), GetMaxVal<int32_t>());
+  CHECK_EQ_OR_RETURN(residual->data_type(), gradient->data_type());
+  CHECK_EQ_OR_RETURN(residual->shape().NumAxes(), shape.NumAxes());
+  // the residual of every rank is a slice of the logical residual on axis 0
+  CHECK_EQ_OR_RETURN(residual->shape().At(0) % shape.At(0), 0);
+  FOR_RANGE(int64_t, i, 1, shape.NumAxes()) {
+    CHECK_EQ_OR_RETURN(residual->shape().At(i), shape.At(i));
+  }
+  const int64_t num_ranks = residual->shape().At(0) / shape.At(0);
+  const int64_t k = GetSparsifyK(shape.At(0), ratio);
+  user_op::TensorDesc* indices = ctx->TensorDesc4ArgNameAndIndex("indices", 0);
+  *indices->mut_shape() = Shape({num_ranks * k});
+  *indices->mut_data_type() = DataType::kInt32;
+  user_op::TensorDesc* values = ctx->TensorDesc4ArgNameAndIndex("values", 0);
+  DimVector values_dim_vec = shape.dim_vec();
+  values_dim_vec.at(0) = num_ranks * k;
+  *values->mut_shape() = Shape(values_dim_vec);
+  *values->mut_data_type() = gradient->data_type();
+  return Maybe<void>::Ok();
+}
+
+void InputArgModifierFn(const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                        const user_op::UserOpConfWrapper& conf) {
+  user_op::InputArgModifier* residual = GetInputArgModifierFn("residual", 0);
+  CHECK(residual != nullptr);
+  residual->set_is_mutable(true);
+}
+
+}  // namespace
+
+// Adds the gradient to the residual of this rank, takes out the k rows of the largest norm as
+// indexed slices and keeps the rest in the residual for the next iterations.
+REGISTER_USER_OP("top_k_gradient_sparsify")
+    .Input("gradient")
+    .Input("residual")
+    .Output("indices")
+    .Output("values")
+    .Attr<float>("ratio", 0.01)
+    .SetTensorDescInferFn(InferTensorDesc)
+    .SetInputArgModifyFn(InputArgModifierFn)
+    .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
+      ctx->NewBuilder()
+          .PartialSum(user_op::OpArg("gradient", 0))
+          .Split(user_op::OpArg("residual", 0), 0)
+          .Split(user_op::OpArg("indices", 0), 0)
+          .Split(user_op::OpArg("values", 0), 0)
+          .Build();
+      return Maybe<void>::Ok();
+    });
+
+}  // namespace oneflow